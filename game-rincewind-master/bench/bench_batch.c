@@ -0,0 +1,73 @@
+#include "batch.h"
+#include "test_util.h"
+#include <stdlib.h>
+
+const double DT = 1.0 / 60;
+// Matches stepped together; each iteration is this many match ticks
+const size_t BATCH_MATCHES = 64;
+
+/** Keeps both players running, jumping, and shooting at each other */
+player_input_t bench_input(size_t match, body_type_t player, size_t tick) {
+  size_t phase = tick + 13 * match;
+  player_input_t input = (phase / 30 + player) % 2 ? INPUT_LEFT : INPUT_RIGHT;
+  if (phase % 20 == 0) {
+    input |= INPUT_JUMP;
+  }
+  if (phase % 15 == player) {
+    input |= INPUT_SHOOT;
+  }
+  return input;
+}
+
+void bench_batch_step(bench_t *bench, size_t threads) {
+  game_state_t *maps = malloc(BATCH_MATCHES * sizeof(game_state_t));
+  for (size_t i = 0; i < BATCH_MATCHES; i++) {
+    maps[i] = i % 2 == 0 ? MAP1 : MAP2;
+  }
+  batch_t *batch = batch_init(maps, BATCH_MATCHES, threads);
+  player_input_t(*inputs)[MATCH_PLAYERS] =
+      malloc(BATCH_MATCHES * sizeof(*inputs));
+  match_observation_t *observations =
+      malloc(BATCH_MATCHES * sizeof(match_observation_t));
+
+  size_t tick = 0;
+  BENCH_LOOP(bench) {
+    for (size_t i = 0; i < BATCH_MATCHES; i++) {
+      match_t *match = batch_get_match(batch, i);
+      if (match_is_over(match)) {
+        batch_restart(batch, i);
+      }
+      for (body_type_t player = PLAYER1; player <= PLAYER2; player++) {
+        inputs[i][player] = bench_input(i, player, tick);
+      }
+    }
+    batch_step(batch, inputs, DT, observations);
+    tick++;
+  }
+
+  free(observations);
+  free(inputs);
+  batch_free(batch);
+  free(maps);
+}
+
+void bench_batch_step_64_1thread(bench_t *bench) {
+  bench_batch_step(bench, 1);
+}
+
+void bench_batch_step_64_4threads(bench_t *bench) {
+  bench_batch_step(bench, 4);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all benchmarks if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read benchmark name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_BENCH(bench_batch_step_64_1thread)
+  DO_BENCH(bench_batch_step_64_4threads)
+}
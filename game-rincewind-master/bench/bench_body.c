@@ -0,0 +1,45 @@
+#include "body.h"
+#include "test_util.h"
+
+const double DT = 1.0 / 60;
+
+// Results are stored here so the benchmarked calls are not optimized out
+volatile double sink;
+
+body_t *make_body(void) {
+  body_t *body = body_init(rect_init(2, 2), 1, (rgb_color_t){0, 0, 0});
+  body_set_velocity(body, (vector_t){1, 2});
+  body_set_rot_velocity(body, 0.5);
+  return body;
+}
+
+void bench_body_get_centroid(bench_t *bench) {
+  body_t *body = make_body();
+  double sum = 0;
+  BENCH_LOOP(bench) { sum += body_get_centroid(body).x; }
+  sink = sum;
+  body_free(body);
+}
+
+void bench_body_tick(bench_t *bench) {
+  body_t *body = make_body();
+  BENCH_LOOP(bench) {
+    body_add_force(body, (vector_t){0, -1});
+    body_tick(body, DT);
+  }
+  sink = body_get_centroid(body).y;
+  body_free(body);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all benchmarks if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read benchmark name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_BENCH(bench_body_get_centroid)
+  DO_BENCH(bench_body_tick)
+}
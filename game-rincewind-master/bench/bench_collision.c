@@ -0,0 +1,51 @@
+#include "collision.h"
+#include "list.h"
+#include "test_util.h"
+#include <stdlib.h>
+
+// Vertices of the polygon benchmarked against a rectangle
+const size_t POLYGON_POINTS = 40;
+
+// Results are stored here so the benchmarked calls are not optimized out
+volatile bool sink;
+
+/** Moves every vertex of a shape by offset */
+void translate(list_t *shape, vector_t offset) {
+  for (size_t i = 0; i < list_size(shape); i++) {
+    vector_t *vertex = list_get(shape, i);
+    *vertex = vec_add(*vertex, offset);
+  }
+}
+
+/** Times find_collision() on two overlapping shapes, which frees them */
+void bench_collision(bench_t *bench, list_t *shape1, list_t *shape2) {
+  translate(shape2, (vector_t){1.5, 0.5});
+  bool colliding = false;
+  BENCH_LOOP(bench) {
+    colliding ^= find_collision(shape1, shape2).collided;
+  }
+  sink = colliding;
+  list_free(shape1);
+  list_free(shape2);
+}
+
+void bench_find_collision_rect_rect(bench_t *bench) {
+  bench_collision(bench, rect_init(2, 2), rect_init(2, 2));
+}
+
+void bench_find_collision_polygon_rect(bench_t *bench) {
+  bench_collision(bench, polygon_init(1, POLYGON_POINTS), rect_init(2, 2));
+}
+
+int main(int argc, char *argv[]) {
+  // Run all benchmarks if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read benchmark name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_BENCH(bench_find_collision_rect_rect)
+  DO_BENCH(bench_find_collision_polygon_rect)
+}
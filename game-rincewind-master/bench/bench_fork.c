@@ -0,0 +1,96 @@
+#include "match.h"
+#include "test_util.h"
+
+const double DT = 1.0 / 60;
+// Ticks played before forking, so the players have landed and moved
+const size_t WARMUP_TICKS = 120;
+// Ticks a bot looks ahead in each fork
+const size_t ROLLOUT_TICKS = 30;
+
+/** A match on MAP1 with both players running at each other */
+match_t *make_match(void) {
+  match_t *match = match_init(MAP1);
+  player_input_t inputs[MATCH_PLAYERS] = {INPUT_RIGHT, INPUT_LEFT};
+  for (size_t tick = 0; tick < WARMUP_TICKS; tick++) {
+    match_step(match, inputs, DT);
+  }
+  return match;
+}
+
+/** Plays out what happens if PLAYER1 jumps now */
+void rollout(match_t *fork, size_t ticks) {
+  player_input_t inputs[MATCH_PLAYERS] = {INPUT_JUMP, INPUT_LEFT};
+  for (size_t tick = 0; tick < ticks; tick++) {
+    match_step(fork, inputs, DT);
+  }
+}
+
+/** Plays the match on one tick, as a bot would between forks */
+void advance(match_t *match) {
+  player_input_t inputs[MATCH_PLAYERS] = {INPUT_RIGHT, INPUT_LEFT};
+  match_step(match, inputs, DT);
+}
+
+/**
+ * Each iteration plays the match on a tick, forks it into the same fork as
+ * last time, and looks ahead in the fork. Every moving body has changed
+ * since the last fork, so each one is copied.
+ */
+void bench_fork(bench_t *bench, size_t ticks) {
+  match_t *match = make_match();
+  match_t *fork = match_fork(match, NULL);
+  BENCH_LOOP(bench) {
+    advance(match);
+    fork = match_fork(match, fork);
+    rollout(fork, ticks);
+  }
+  match_free(fork);
+  match_free(match);
+}
+
+/** Like bench_fork(), but builds a new copy of the match each time */
+void bench_deep_copy(bench_t *bench, size_t ticks) {
+  match_t *match = make_match();
+  BENCH_LOOP(bench) {
+    advance(match);
+    match_t *copy = match_fork(match, NULL);
+    rollout(copy, ticks);
+    match_free(copy);
+  }
+  match_free(match);
+}
+
+/** Plays the match on without forking, to subtract from the others */
+void bench_advance_only(bench_t *bench) {
+  match_t *match = make_match();
+  BENCH_LOOP(bench) { advance(match); }
+  match_free(match);
+}
+
+void bench_fork_advancing(bench_t *bench) { bench_fork(bench, 0); }
+
+void bench_deep_copy_advancing(bench_t *bench) { bench_deep_copy(bench, 0); }
+
+void bench_fork_rollout_30(bench_t *bench) {
+  bench_fork(bench, ROLLOUT_TICKS);
+}
+
+void bench_deep_copy_rollout_30(bench_t *bench) {
+  bench_deep_copy(bench, ROLLOUT_TICKS);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all benchmarks if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read benchmark name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_BENCH(bench_advance_only)
+  DO_BENCH(bench_fork_advancing)
+  DO_BENCH(bench_deep_copy_advancing)
+  DO_BENCH(bench_fork_rollout_30)
+  DO_BENCH(bench_deep_copy_rollout_30)
+}
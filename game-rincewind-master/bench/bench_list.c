@@ -0,0 +1,44 @@
+#include "list.h"
+#include "test_util.h"
+
+// Items kept in the list, so adds and removes happen at a realistic size
+const size_t LIST_SIZE = 100;
+
+void bench_list_add_remove(bench_t *bench) {
+  list_t *list = list_init(LIST_SIZE, NULL);
+  int item;
+  for (size_t i = 0; i < LIST_SIZE; i++) {
+    list_add(list, &item);
+  }
+  BENCH_LOOP(bench) {
+    list_add(list, &item);
+    list_remove(list, list_size(list) - 1);
+  }
+  list_free(list);
+}
+
+void bench_list_remove_front(bench_t *bench) {
+  list_t *list = list_init(LIST_SIZE, NULL);
+  int item;
+  for (size_t i = 0; i < LIST_SIZE; i++) {
+    list_add(list, &item);
+  }
+  BENCH_LOOP(bench) {
+    list_remove(list, 0);
+    list_add(list, &item);
+  }
+  list_free(list);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all benchmarks if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read benchmark name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_BENCH(bench_list_add_remove)
+  DO_BENCH(bench_list_remove_front)
+}
@@ -0,0 +1,83 @@
+#include "map_file.h"
+#include "player.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Where the benchmark writes its generated map and the map file it becomes
+const char *const BENCH_TEXT_PATH = "out/bench_map.txt";
+const char *const BENCH_MAP_PATH = "out/bench_map.map";
+// Platforms per row of the generated map
+const size_t PLATFORMS_PER_ROW = 40;
+
+/** Writes and converts a map with a grid of platform_count platforms */
+void make_map_file(size_t platform_count) {
+  FILE *file = fopen(BENCH_TEXT_PATH, "w");
+  assert(file != NULL);
+  fprintf(file, "size %zu %zu\n", 10 * PLATFORMS_PER_ROW,
+          10 * (platform_count / PLATFORMS_PER_ROW + 1));
+  for (size_t i = 0; i < platform_count; i++) {
+    fprintf(file, "rect GROUND static 8 2 %zu %zu 0 0 1 texture ground.png\n",
+            10 * (i % PLATFORMS_PER_ROW) + 5, 10 * (i / PLATFORMS_PER_ROW));
+  }
+  fprintf(file, "spawn PLAYER1 5 5\nspawn PLAYER2 15 5\n");
+  fclose(file);
+  assert(map_file_convert(BENCH_TEXT_PATH, BENCH_MAP_PATH));
+}
+
+/** Loads the map with the hierarchy baked into it */
+void bench_map_load(bench_t *bench, size_t platform_count) {
+  make_map_file(platform_count);
+  BENCH_LOOP(bench) {
+    map_file_t *map = map_file_load(BENCH_MAP_PATH);
+    scene_t *scene = game_scene_init();
+    map_file_instantiate(map, scene);
+    scene_free(scene);
+    map_file_free(map);
+  }
+  remove(BENCH_MAP_PATH);
+  remove(BENCH_TEXT_PATH);
+}
+
+/** Loads the map and then builds its hierarchy again, as before */
+void bench_map_load_rebuild(bench_t *bench, size_t platform_count) {
+  make_map_file(platform_count);
+  BENCH_LOOP(bench) {
+    map_file_t *map = map_file_load(BENCH_MAP_PATH);
+    scene_t *scene = game_scene_init();
+    map_file_instantiate(map, scene);
+    scene_build_static_bvh(scene);
+    scene_free(scene);
+    map_file_free(map);
+  }
+  remove(BENCH_MAP_PATH);
+  remove(BENCH_TEXT_PATH);
+}
+
+void bench_map_load_20(bench_t *bench) { bench_map_load(bench, 20); }
+
+void bench_map_load_rebuild_20(bench_t *bench) {
+  bench_map_load_rebuild(bench, 20);
+}
+
+void bench_map_load_2000(bench_t *bench) { bench_map_load(bench, 2000); }
+
+void bench_map_load_rebuild_2000(bench_t *bench) {
+  bench_map_load_rebuild(bench, 2000);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all benchmarks if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read benchmark name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_BENCH(bench_map_load_20)
+  DO_BENCH(bench_map_load_rebuild_20)
+  DO_BENCH(bench_map_load_2000)
+  DO_BENCH(bench_map_load_rebuild_2000)
+}
@@ -0,0 +1,134 @@
+#include "forces.h"
+#include "player.h"
+#include "projectile.h"
+#include "scene.h"
+#include "test_util.h"
+#include <stdlib.h>
+
+const double DT = 1.0 / 60;
+const double FALL_ACCELERATION = 100;
+// Stacks of 2 wide boxes are this far apart, so neighbours touch
+const double BOX_SPACING = 2;
+// Boxes in each stack
+const size_t STACK_HEIGHT = 2;
+// Gap between the boxes of a stack when they are dropped
+const double STACK_GAP = 0.5;
+// Stacks standing on each floor tile
+const size_t STACKS_PER_TILE = 8;
+// Bullets are spaced this far apart, too far to meet
+const double BULLET_SPACING = 3;
+
+/** Pulls every body in the scene down */
+void constant_gravity(scene_t *scene) {
+  for (size_t i = 0; i < scene_bodies(scene); i++) {
+    body_t *body = scene_get_body(scene, i);
+    double weight = FALL_ACCELERATION * body_get_mass(body);
+    body_add_force(body, (vector_t){0, -weight});
+  }
+}
+
+/**
+ * Builds a row of stacks of box_count boxes in all, dropped onto static
+ * floor tiles. Each box rests on or under another and against the stacks
+ * beside it, so the narrow phase and the contact solver both do real work.
+ * The floor is perfectly elastic, so the stacks keep bouncing, never fall
+ * asleep, and every tick does the full work. Stacks any taller gain energy
+ * and fly apart.
+ */
+scene_t *make_scene(size_t box_count) {
+  scene_t *scene = game_scene_init();
+  size_t stacks = (box_count + STACK_HEIGHT - 1) / STACK_HEIGHT;
+  double tile_width = BOX_SPACING * STACKS_PER_TILE;
+  for (size_t i = 0; i * STACKS_PER_TILE < stacks; i++) {
+    body_t *tile = body_init_with_info(
+        rect_init(tile_width, 2), INFINITY, (rgb_color_t){0, 0, 0},
+        info_init(GROUND, NO_SIDE, NO_WEAPON), info_free);
+    body_set_centroid(tile, (vector_t){tile_width * (i + 0.5), 0});
+    body_set_motion_type(tile, MOTION_STATIC);
+    scene_add_body(scene, tile);
+  }
+  scene_build_static_bvh(scene);
+
+  body_t **boxes = malloc(box_count * sizeof(body_t *));
+  for (size_t i = 0; i < box_count; i++) {
+    size_t stack = i / STACK_HEIGHT;
+    size_t row = i % STACK_HEIGHT;
+    body_t *box = body_init_with_info(rect_init(2, 2), 1,
+                                      (rgb_color_t){0, 0, 0},
+                                      info_init(PLAYER1, NO_SIDE, NO_WEAPON),
+                                      info_free);
+    // Neighbouring stacks start at different heights, so they keep
+    // rubbing against each other rather than bouncing in step
+    double y = 2 + (stack % 3) * STACK_GAP + row * (2 + STACK_GAP);
+    body_set_centroid(box, (vector_t){BOX_SPACING * (stack + 0.5), y});
+    scene_add_body(scene, box);
+    create_static_contacts(scene, 1, box, BODY_MASK(GROUND));
+    if (row > 0) {
+      create_contact(scene, 0, boxes[i - 1], box);
+    }
+    // Every box of the stack before, since the stacks slide past each other
+    for (size_t j = 0; stack > 0 && j < STACK_HEIGHT; j++) {
+      create_contact(scene, 0, boxes[(stack - 1) * STACK_HEIGHT + j], box);
+    }
+    boxes[i] = box;
+  }
+  free(boxes);
+  scene_add_force_creator(scene, (force_creator_t)constant_gravity, scene,
+                          NULL);
+  return scene;
+}
+
+void bench_scene_tick(bench_t *bench, size_t box_count) {
+  scene_t *scene = make_scene(box_count);
+  BENCH_LOOP(bench) { scene_tick(scene, DT); }
+  scene_free(scene);
+}
+
+void bench_scene_tick_10(bench_t *bench) { bench_scene_tick(bench, 10); }
+
+void bench_scene_tick_100(bench_t *bench) { bench_scene_tick(bench, 100); }
+
+void bench_scene_tick_1000(bench_t *bench) { bench_scene_tick(bench, 1000); }
+
+/**
+ * Fires bullet_count still bullets along a line, spaced far enough apart that
+ * none of them meet. They are fired afresh each tick, so none grow old.
+ */
+void bench_projectiles_tick(bench_t *bench, size_t bullet_count) {
+  scene_t *scene = game_scene_init();
+  projectiles_t *fired = projectiles_init();
+  for (size_t i = 0; i < bullet_count; i++) {
+    projectiles_add(fired, (vector_t){BULLET_SPACING * i, 0}, VEC_ZERO, PISTOL,
+                    PLAYER1);
+  }
+  BENCH_LOOP(bench) {
+    projectiles_copy(scene_get_projectiles(scene), fired);
+    scene_tick(scene, DT);
+  }
+  projectiles_free(fired);
+  scene_free(scene);
+}
+
+void bench_projectiles_tick_100(bench_t *bench) {
+  bench_projectiles_tick(bench, 100);
+}
+
+void bench_projectiles_tick_1000(bench_t *bench) {
+  bench_projectiles_tick(bench, 1000);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all benchmarks if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read benchmark name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_BENCH(bench_scene_tick_10)
+  DO_BENCH(bench_scene_tick_100)
+  DO_BENCH(bench_scene_tick_1000)
+  DO_BENCH(bench_projectiles_tick_100)
+  DO_BENCH(bench_projectiles_tick_1000)
+}
@@ -0,0 +1,68 @@
+#include "test_util.h"
+#include "timer_wheel.h"
+#include <stdlib.h>
+
+// Game time of a frame at 60 frames per second (see TIME_MULT)
+const double FRAME_TIME = 10.0 / 60;
+const double TIMER_TICK = 0.1;
+// Timed entities in each benchmark
+const size_t ENTITIES = 10000;
+
+// Results are stored here so the benchmarked loops are not optimized out
+volatile size_t sink;
+
+/** How long an entity waits before it is due again, e.g. a cooldown */
+double entity_delay(size_t entity) { return 1 + entity % 37; }
+
+typedef struct entity {
+  timer_wheel_t *wheel;
+  double delay;
+} entity_t;
+
+void entity_due(void *aux) {
+  entity_t *entity = aux;
+  timer_wheel_schedule(entity->wheel, entity->delay, entity_due, entity);
+}
+
+/** Each iteration is a frame: the wheel fires only the entities due */
+void bench_timer_wheel_frame_10000(bench_t *bench) {
+  timer_wheel_t *wheel = timer_wheel_init(TIMER_TICK);
+  entity_t *entities = malloc(ENTITIES * sizeof(entity_t));
+  for (size_t i = 0; i < ENTITIES; i++) {
+    entities[i] = (entity_t){.wheel = wheel, .delay = entity_delay(i)};
+    timer_wheel_schedule(wheel, entities[i].delay, entity_due, &entities[i]);
+  }
+  BENCH_LOOP(bench) { timer_wheel_advance(wheel, FRAME_TIME); }
+  free(entities);
+  timer_wheel_free(wheel);
+}
+
+/** Each iteration is a frame: every entity's time is counted and checked */
+void bench_poll_frame_10000(bench_t *bench) {
+  double *time_since = calloc(ENTITIES, sizeof(double));
+  size_t due = 0;
+  BENCH_LOOP(bench) {
+    for (size_t i = 0; i < ENTITIES; i++) {
+      time_since[i] += FRAME_TIME;
+      if (time_since[i] > entity_delay(i)) {
+        time_since[i] = 0;
+        due++;
+      }
+    }
+  }
+  sink = due;
+  free(time_since);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all benchmarks if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read benchmark name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_BENCH(bench_timer_wheel_frame_10000)
+  DO_BENCH(bench_poll_frame_10000)
+}
@@ -0,0 +1,23 @@
+#include "test_util.h"
+#include "vector.h"
+
+// Results are stored here so the benchmarked calls are not optimized out
+volatile double sink;
+
+void bench_vec_rotate(bench_t *bench) {
+  vector_t v = {1, 2};
+  BENCH_LOOP(bench) { v = vec_rotate(v, 0.1); }
+  sink = v.x;
+}
+
+int main(int argc, char *argv[]) {
+  // Run all benchmarks if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read benchmark name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_BENCH(bench_vec_rotate)
+}
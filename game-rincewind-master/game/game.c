@@ -1,8 +1,10 @@
+#include "alloc_track.h"
 #include "game_const.h"
 #include "game_weapon.h"
 #include "map.h"
 #include "scene.h"
 #include "sdl_wrapper.h"
+#include "timer_wheel.h"
 #include "vector.h"
 
 #include <assert.h>
@@ -14,52 +16,57 @@
 
 typedef struct state {
   scene_t *scene;
+  // Scenes of the menus and end screens, built once at startup and shown
+  // again whenever their game state comes back; map scenes are not kept
+  scene_t *menu_scenes[GAME_STATE_COUNT];
   bool *key_states;
   list_t *sound_effects;
   game_state_t game_state;
-  double time_since_drop;
-  double time_since_respawn;
-  double time_since_p1_jump;
-  double time_since_p2_jump;
+  // Timed events, in game time (see TIME_MULT)
+  timer_wheel_t *timers;
+  timer_id_t drop_timer;
+  timer_id_t respawn_cooldown;
+  timer_id_t p1_jump_cooldown;
+  timer_id_t p2_jump_cooldown;
+  timer_id_t p1_shot_cooldown;
+  timer_id_t p2_shot_cooldown;
+  timer_id_t p1_anim_timer;
+  timer_id_t p2_anim_timer;
   size_t p1lives;
   size_t p2lives;
   bool story_mode;
 } state_t;
 
-const double TIME_THRESHOLD = 1.0;
-const double TIME_MULT = 10.0;
-
 const size_t NUM_OF_KEYS = 10;
-
-const double ANGLE_ERROR = 0.1;
-const double ANGULAR_MULTIPLIER_BIG = 1.3;
-const double ANGULAR_MULTIPLIER_SMALL = 1.5;
+// Length of a tick of the timer wheel, in game time; 10 ms of real time
+const double TIMER_TICK = 0.1;
+// How long a player's animation frame shows, in game time, standing and
+// running
+const double IDLE_FRAME_TIME = 6.0;
+const double RUN_FRAME_TIME = 2.0;
 
 // Player
-const double PLAYER_ACCELERATION = 5000.0;
-const double PLAYER_MAX_SPEED = 40.0;
-const int STARTING_LIVES = 5;
 const double LIVES_WIDTH = 5.0;
 const double LIVES_HEIGHT = 5.0;
 
 /** Generates a random number between 0 and 1 */
 double rand_double(void) { return (double)rand() / RAND_MAX; }
 
-bool in_game(state_t *state) {
-  game_state_t game_state = state->game_state;
-  if (game_state == MAP1 || game_state == MAP2 || game_state == MAP3) {
-    return true;
-  }
-
-  return false;
+/** Returns whether a game state is played on a map, rather than a menu */
+bool is_map(game_state_t game_state) {
+  return game_state == MAP1 || game_state == MAP2 || game_state == MAP3;
 }
 
+bool in_game(state_t *state) { return is_map(state->game_state); }
+
 body_t *get_life(vector_t center, body_type_t type) {
   list_t *shape = rect_init(LIVES_WIDTH, LIVES_HEIGHT);
   rgb_color_t color = type == P1_LIFE ? PLAYER_1_COLOR : PLAYER_2_COLOR;
-  body_t *life = body_init_with_info(shape, 1, color,
-                                     info_init(type, NO_SIDE, NO_WEAPON), free);
+  body_t *life =
+      body_init_with_info(shape, 1, color, info_init(type, NO_SIDE, NO_WEAPON),
+                          info_free);
   body_set_centroid(life, center);
+  body_set_motion_type(life, MOTION_STATIC);
 
   return life;
 }
@@ -100,47 +107,49 @@ void add_lives(state_t *state) {
 
 // ---------------------- KEY EVENTS
 // ---------------------------------------------------------------------
-void jumping_handler(state_t *state, body_t *player) {
-  vector_t PLAYER_JUMP = {.x = 0.0, .y = (PLAYER_MASS * 85)};
-
-  body_t *player_feet = get_player_feet(player);
-  scene_t *scene = state->scene;
-
-  for (size_t i = 0; i < scene_bodies(scene); i++) {
-    body_info_t *info = get_info(scene_get_body(scene, i));
-    if (info->type == GROUND) {
-      if (find_collision(body_get_shape(player_feet),
-                         body_get_shape(scene_get_body(scene, i)))
-              .collided) {
-        sdl_sound_effects(state, JUMP);
-        body_add_impulse(player, PLAYER_JUMP);
-        break;
-      }
-    }
+/** Starts a cooldown, replacing the one already running, if any */
+void restart_cooldown(state_t *state, timer_id_t *cooldown, double length) {
+  timer_wheel_cancel(state->timers, *cooldown);
+  *cooldown = timer_wheel_schedule(state->timers, length, NULL, NULL);
+}
+
+void jumping_handler(state_t *state, body_t *player, timer_id_t *cooldown) {
+  if (timer_wheel_pending(state->timers, *cooldown)) {
+    return;
+  }
+  restart_cooldown(state, cooldown, TIME_THRESHOLD);
+  if (player_jump(state->scene, player)) {
+    sdl_sound_effects(state, JUMP);
   }
-  body_free(player_feet);
 }
 
-void player_shoot(state_t *state, body_t *player) {
-  scene_t *scene = state->scene;
-  bool shot = game_weapon_shoot(scene, player);
-  if (shot) {
-    switch (get_info(player)->weapon_type) {
-    case PISTOL: {
-      sdl_sound_effects(state, PISTOL_S);
-      break;
-    }
-    case SHOTGUN: {
-      sdl_sound_effects(state, SHOTGUN_S);
-      break;
-    }
-    case RICOCHET: {
-      sdl_sound_effects(state, RICOCHET_S);
-      break;
-    }
-    default:
-      break;
-    }
+/** Players can shoot once SHOT_THRESHOLD has passed since they spawned */
+void restart_shot_cooldowns(state_t *state) {
+  restart_cooldown(state, &state->p1_shot_cooldown, SHOT_THRESHOLD);
+  restart_cooldown(state, &state->p2_shot_cooldown, SHOT_THRESHOLD);
+}
+
+void player_shoot(state_t *state, body_t *player, timer_id_t *cooldown) {
+  if (timer_wheel_pending(state->timers, *cooldown)) {
+    return;
+  }
+  restart_cooldown(state, cooldown, SHOT_THRESHOLD);
+  game_weapon_fire(state->scene, player);
+  switch (get_info(player)->weapon_type) {
+  case PISTOL: {
+    sdl_sound_effects(state, PISTOL_S);
+    break;
+  }
+  case SHOTGUN: {
+    sdl_sound_effects(state, SHOTGUN_S);
+    break;
+  }
+  case RICOCHET: {
+    sdl_sound_effects(state, RICOCHET_S);
+    break;
+  }
+  default:
+    break;
   }
 }
 
@@ -154,40 +163,117 @@ void apply_key_states(state_t *state, body_t *player1, body_t *player2) {
   }
 
   if (state->key_states[SPACE]) {
-    player_shoot(state, player1);
+    player_shoot(state, player1, &state->p1_shot_cooldown);
   }
   if (state->key_states[PERIOD]) {
-    player_shoot(state, player2);
+    player_shoot(state, player2, &state->p2_shot_cooldown);
   }
 
   if (state->key_states[W_KEY]) {
-    if (state->time_since_p1_jump > TIME_THRESHOLD) {
-      jumping_handler(state, player1);
-      state->time_since_p1_jump = 0;
-    }
+    jumping_handler(state, player1, &state->p1_jump_cooldown);
   }
   if (state->key_states[UP_ARROW]) {
-    if (state->time_since_p2_jump > TIME_THRESHOLD) {
-      jumping_handler(state, player2);
-      state->time_since_p2_jump = 0;
+    jumping_handler(state, player2, &state->p2_jump_cooldown);
+  }
+}
+
+/** Returns the top right corner of the scene shown in a game state */
+vector_t get_scene_max(game_state_t game_state) {
+  if (game_state == MAP2 || game_state == MAP3) {
+    return MAX2;
+  } else if (game_state == MAP1) {
+    return MAX1;
+  }
+  return MAX_MENU;
+}
+
+/**
+ * Drops a powerup when the drop timer fires, and sets it again. If the map
+ * already has as many powerups as it can, tries again shortly instead.
+ */
+void drop_timer_fired(void *aux) {
+  state_t *state = aux;
+  size_t powerups_on_screen =
+      scene_bodies_of_type(state->scene, POWERUP_RICOCHET) +
+      scene_bodies_of_type(state->scene, POWERUP_SHOTGUN);
+  if (powerups_on_screen >= (size_t)MAX_POWERUPS) {
+    state->drop_timer = timer_wheel_schedule(state->timers, TIME_THRESHOLD,
+                                             drop_timer_fired, state);
+    return;
+  }
+  body_t *powerup = drop_powerup(state->scene, state->game_state);
+  sprite_img_add(state->scene, powerup, state->game_state);
+  state->drop_timer = timer_wheel_schedule(state->timers, POWERUP_TIME,
+                                           drop_timer_fired, state);
+}
+
+/**
+ * Shows a player's next animation frame when its animation timer fires, and
+ * sets the timer again; running players change frames faster.
+ */
+void animate_player(state_t *state, body_type_t type, timer_id_t *timer,
+                    timer_callback_t fire) {
+  double frame_time = IDLE_FRAME_TIME;
+  sprite_t *sprite = fetch_sprite(state->scene, type);
+  if (sprite != NULL) {
+    sprite_img_advance(sprite);
+    if (body_get_velocity(sprite_get_body(sprite)).x != 0) {
+      frame_time = RUN_FRAME_TIME;
     }
   }
+  *timer = timer_wheel_schedule(state->timers, frame_time, fire, state);
+}
+
+void p1_anim_fired(void *aux) {
+  state_t *state = aux;
+  animate_player(state, PLAYER1, &state->p1_anim_timer, p1_anim_fired);
 }
 
+void p2_anim_fired(void *aux) {
+  state_t *state = aux;
+  animate_player(state, PLAYER2, &state->p2_anim_timer, p2_anim_fired);
+}
+
+/** Builds the scene of a game state, with its sprites */
+scene_t *build_scene(game_state_t game_state) {
+  scene_t *scene = game_scene_init();
+  scene_seed_random(scene, rand());
+  create_map(scene, game_state);
+  sdl_sprites_init(scene, game_state);
+  return scene;
+}
+
+/**
+ * Switches to another game state. Menus show the scene they were built with
+ * at startup, so moving between them allocates nothing; maps start afresh.
+ */
 void menu_handler(state_t *state, game_state_t new_game_state) {
   sdl_sound_effects(state, CLICK);
-  scene_free(state->scene);
+  if (in_game(state)) {
+    scene_free(state->scene);
+  }
+  // Powerups drop and players animate only while a map is played, and the
+  // first powerup comes a whole POWERUP_TIME into it
+  timer_wheel_cancel(state->timers, state->drop_timer);
+  timer_wheel_cancel(state->timers, state->p1_anim_timer);
+  timer_wheel_cancel(state->timers, state->p2_anim_timer);
+  state->drop_timer = TIMER_NONE;
+  state->p1_anim_timer = TIMER_NONE;
+  state->p2_anim_timer = TIMER_NONE;
   state->game_state = new_game_state;
-  state->scene = scene_init();
-  if (new_game_state == MAP2 || new_game_state == MAP3) {
-    sdl_init((vector_t)VEC_ZERO, (vector_t)MAX2);
-  } else if (new_game_state == MAP1) {
-    sdl_init((vector_t)VEC_ZERO, (vector_t)MAX1);
+  sdl_set_viewport(VEC_ZERO, get_scene_max(new_game_state));
+  if (is_map(new_game_state)) {
+    state->scene = build_scene(new_game_state);
+    restart_shot_cooldowns(state);
+    state->drop_timer = timer_wheel_schedule(state->timers, POWERUP_TIME,
+                                             drop_timer_fired, state);
+    state->p1_anim_timer = timer_wheel_schedule(state->timers, IDLE_FRAME_TIME,
+                                                p1_anim_fired, state);
+    state->p2_anim_timer = timer_wheel_schedule(state->timers, IDLE_FRAME_TIME,
+                                                p2_anim_fired, state);
   } else {
-    sdl_init((vector_t)VEC_ZERO, (vector_t)MAX_MENU);
+    state->scene = state->menu_scenes[new_game_state];
   }
-  create_map(state->scene, state->game_state);
-  sdl_sprites_init(state->scene, state->game_state);
 }
 
 void key_event_handler(char key, key_event_type_t type, double held_time,
@@ -207,73 +293,35 @@ void key_event_handler(char key, key_event_type_t type, double held_time,
       state->key_states[(game_key_t)key] = true;
       switch (key) {
       case A_KEY: {
-        get_info(player1)->side = LEFT;
-        if (body_get_velocity(player1).x > 0) {
-          body_set_velocity(player1,
-                            (vector_t){0.0, body_get_velocity(player1).y});
-        }
-        if (body_get_velocity(player1).x > -PLAYER_MAX_SPEED) {
-          body_add_force(player1,
-                         (vector_t){.x = -PLAYER_ACCELERATION, .y = 0.0});
-        }
+        player_run(player1, LEFT);
         break;
       }
       case D_KEY: {
-        get_info(player1)->side = RIGHT;
-        if (body_get_velocity(player1).x < 0) {
-          body_set_velocity(player1,
-                            (vector_t){0.0, body_get_velocity(player1).y});
-        }
-        if (body_get_velocity(player1).x < PLAYER_MAX_SPEED) {
-          body_add_force(player1,
-                         (vector_t){.x = PLAYER_ACCELERATION, .y = 0.0});
-        }
+        player_run(player1, RIGHT);
         break;
       }
       case W_KEY: {
-        if (state->time_since_p1_jump > TIME_THRESHOLD) {
-          jumping_handler(state, player1);
-          state->time_since_p1_jump = 0;
-        }
+        jumping_handler(state, player1, &state->p1_jump_cooldown);
         break;
       }
       case SPACE: {
-        player_shoot(state, player1);
+        player_shoot(state, player1, &state->p1_shot_cooldown);
         break;
       }
       case LEFT_ARROW: {
-        get_info(player2)->side = LEFT;
-        if (body_get_velocity(player2).x > 0) {
-          body_set_velocity(player2,
-                            (vector_t){0.0, body_get_velocity(player2).y});
-        }
-        if (body_get_velocity(player2).x > -PLAYER_MAX_SPEED) {
-          body_add_force(player2,
-                         (vector_t){.x = -PLAYER_ACCELERATION, .y = 0.0});
-        }
+        player_run(player2, LEFT);
         break;
       }
       case RIGHT_ARROW: {
-        get_info(player2)->side = RIGHT;
-        if (body_get_velocity(player2).x < 0) {
-          body_set_velocity(player2,
-                            (vector_t){0.0, body_get_velocity(player2).y});
-        }
-        if (body_get_velocity(player2).x < PLAYER_MAX_SPEED) {
-          body_add_force(player2,
-                         (vector_t){.x = PLAYER_ACCELERATION, .y = 0.0});
-        }
+        player_run(player2, RIGHT);
         break;
       }
       case UP_ARROW: {
-        if (state->time_since_p2_jump > TIME_THRESHOLD) {
-          jumping_handler(state, player2);
-          state->time_since_p2_jump = 0;
-        }
+        jumping_handler(state, player2, &state->p2_jump_cooldown);
         break;
       }
       case PERIOD: {
-        player_shoot(state, player2);
+        player_shoot(state, player2, &state->p2_shot_cooldown);
         break;
       }
       default:
@@ -374,20 +422,10 @@ void key_event_handler(char key, key_event_type_t type, double held_time,
 // ---------------------- END KEY EVENTS
 // ---------------------------------------------------------------------
 
-void wrap(scene_t *scene) {
-  // only applies to map 2
-  body_t *player1 = fetch_object(scene, PLAYER1);
-  body_t *player2 = fetch_object(scene, PLAYER2);
-
-  if (player1 != NULL && player2 != NULL) {
-    check_bounds(player1);
-    check_bounds(player2);
-  }
-}
-
 void reset_map(state_t *state) {
   scene_free(state->scene);
-  state->scene = scene_init();
+  state->scene = game_scene_init();
+  scene_seed_random(state->scene, rand());
 
   if (state->story_mode) {
     if (rand() % 2 == 0) {
@@ -398,13 +436,14 @@ void reset_map(state_t *state) {
   }
   create_map(state->scene, state->game_state);
   sdl_sprites_init(state->scene, state->game_state);
+  restart_shot_cooldowns(state);
 }
 
 bool respawn(state_t *state) {
   if (in_game(state)) {
     if (fetch_object(state->scene, PLAYER1) == NULL && state->p1lives >= 1) {
       state->p1lives -= 1;
-      state->time_since_respawn = 0;
+      restart_cooldown(state, &state->respawn_cooldown, TIME_THRESHOLD);
       sdl_sound_effects(state, HIT);
       reset_map(state);
       add_lives(state);
@@ -413,7 +452,7 @@ bool respawn(state_t *state) {
     }
     if (fetch_object(state->scene, PLAYER2) == NULL && state->p2lives >= 1) {
       state->p2lives -= 1;
-      state->time_since_respawn = 0;
+      restart_cooldown(state, &state->respawn_cooldown, TIME_THRESHOLD);
       sdl_sound_effects(state, HIT);
       reset_map(state);
       add_lives(state);
@@ -430,14 +469,26 @@ bool respawn(state_t *state) {
 
 state_t *state_init() {
   state_t *state = malloc(sizeof(state_t));
-  state->scene = scene_init();
+  state->scene = NULL;
+  for (size_t i = 0; i < GAME_STATE_COUNT; i++) {
+    state->menu_scenes[i] = NULL;
+  }
   state->key_states = calloc(NUM_OF_KEYS + 1, sizeof(bool));
   state->sound_effects = sdl_load_sounds();
   state->game_state = INTRO_MENU;
-  state->time_since_drop = 0;
-  state->time_since_respawn = 0;
-  state->time_since_p1_jump = 0;
-  state->time_since_p2_jump = 0;
+  state->timers = timer_wheel_init(TIMER_TICK);
+  state->drop_timer = TIMER_NONE;
+  // Nothing can happen until the cooldowns first pass
+  state->respawn_cooldown =
+      timer_wheel_schedule(state->timers, TIME_THRESHOLD, NULL, NULL);
+  state->p1_jump_cooldown =
+      timer_wheel_schedule(state->timers, TIME_THRESHOLD, NULL, NULL);
+  state->p2_jump_cooldown =
+      timer_wheel_schedule(state->timers, TIME_THRESHOLD, NULL, NULL);
+  state->p1_shot_cooldown = TIMER_NONE;
+  state->p2_shot_cooldown = TIMER_NONE;
+  state->p1_anim_timer = TIMER_NONE;
+  state->p2_anim_timer = TIMER_NONE;
   state->p1lives = STARTING_LIVES;
   state->p2lives = STARTING_LIVES;
   state->story_mode = false;
@@ -452,31 +503,22 @@ state_t *emscripten_init(void) {
   srand(time(NULL));
 
   state_t *state = state_init();
-  create_map(state->scene, state->game_state);
-
-  if (state->game_state == MAP2) {
-    sdl_init((vector_t)VEC_ZERO, (vector_t)MAX2);
-  } else if (state->game_state == MAP1) {
-    sdl_init((vector_t)VEC_ZERO, (vector_t)MAX1);
-  } else {
-    sdl_init((vector_t)VEC_ZERO, (vector_t)MAX_MENU);
+  sdl_init(VEC_ZERO, get_scene_max(state->game_state));
+  for (game_state_t game_state = 0; game_state < GAME_STATE_COUNT;
+       game_state++) {
+    if (!is_map(game_state)) {
+      state->menu_scenes[game_state] = build_scene(game_state);
+    }
   }
-
-  sdl_sprites_init(state->scene, state->game_state);
+  state->scene = state->menu_scenes[state->game_state];
   sdl_on_key(key_event_handler);
   sdl_music(state, MENU_MUS);
   return state;
 }
 
-void apply_time(state_t *state, double dt, body_t *player1, body_t *player2) {
-  state->time_since_drop += TIME_MULT * dt;
-  state->time_since_respawn += TIME_MULT * dt;
-  state->time_since_p1_jump += TIME_MULT * dt;
-  state->time_since_p2_jump += TIME_MULT * dt;
-  if (player1 != NULL && player2 != NULL) {
-    get_info(player1)->time_since_last_shot += TIME_MULT * dt;
-    get_info(player2)->time_since_last_shot += TIME_MULT * dt;
-  }
+/** Moves game time forward, firing any timers that come due */
+void apply_time(state_t *state, double dt) {
+  timer_wheel_advance(state->timers, TIME_MULT * dt);
 }
 
 void emscripten_main(state_t *state) {
@@ -484,57 +526,18 @@ void emscripten_main(state_t *state) {
   body_t *player1 = fetch_object(state->scene, PLAYER1);
   body_t *player2 = fetch_object(state->scene, PLAYER2);
 
-  apply_time(state, dt, player1, player2);
+  apply_time(state, dt);
   if (player1 != NULL && player2 != NULL) {
     apply_key_states(state, player1, player2);
   }
 
-  // Clock
-  if (state->game_state == MAP2 || state->game_state == MAP3) {
-    body_t *clock_big_arm = fetch_object(state->scene, CLOCK_BIG_ARM);
-    body_t *clock_small_arm = fetch_object(state->scene, CLOCK_SMALL_ARM);
-    if (clock_big_arm != NULL && clock_small_arm != NULL) {
-      double angle1 = body_get_angle(clock_big_arm);
-      double angle2 = body_get_angle(clock_small_arm);
-      if (fabs(angle1 - angle2) < ANGLE_ERROR) {
-        body_set_rot_acceleration(clock_big_arm,
-                                  body_get_rot_acceleration(clock_big_arm) *
-                                      ANGULAR_MULTIPLIER_BIG);
-        body_set_rot_acceleration(clock_small_arm,
-                                  body_get_rot_acceleration(clock_small_arm) *
-                                      ANGULAR_MULTIPLIER_SMALL);
-      }
-    }
-  }
-
-  // Powerups
-  if (state->game_state == MAP1 || state->game_state == MAP2 ||
-      state->game_state == MAP3) {
-    size_t powerups_on_screen = 0;
-    for (size_t i = 0; i < scene_bodies(state->scene); i++) {
-      body_type_t type = get_info(scene_get_body(state->scene, i))->type;
-      if (type == POWERUP_RICOCHET || type == POWERUP_SHOTGUN) {
-        powerups_on_screen++;
-        if (powerups_on_screen >= MAX_POWERUPS) {
-          break;
-        }
-      }
-    }
-    bool spawned = spawn_powerup(state->scene, state->time_since_drop,
-                                 powerups_on_screen, state->game_state);
-    if (spawned) {
-      state->time_since_drop = 0;
-    }
-  }
-
-  // Wrap
-  if (state->game_state == MAP2 || state->game_state == MAP3) {
-    wrap(state->scene);
-  }
+  // Clock and wrap
+  map_update(state->scene, state->game_state);
 
   // Tick and Reset
   scene_tick(state->scene, dt);
-  if (((!respawn(state)) && state->time_since_respawn > TIME_THRESHOLD) ||
+  if (((!respawn(state)) &&
+       !timer_wheel_pending(state->timers, state->respawn_cooldown)) ||
       !in_game(state)) {
     sdl_render_game(state->scene);
   }
@@ -550,11 +553,26 @@ void emscripten_main(state_t *state) {
       menu_handler(state, GAME_WIN_P1);
     }
   }
+
+  sdl_flush_sounds(state);
+  track_end_frame();
 }
 
 void emscripten_free(state_t *state) {
-  scene_free(state->scene);
+  if (in_game(state)) {
+    scene_free(state->scene);
+  }
+  for (size_t i = 0; i < GAME_STATE_COUNT; i++) {
+    if (state->menu_scenes[i] != NULL) {
+      scene_free(state->menu_scenes[i]);
+    }
+  }
+  list_free(state->sound_effects);
+  timer_wheel_free(state->timers);
+  free(state->key_states);
   free(state);
+  sdl_clean();
+  track_report_leaks();
 }
 
 // ---------------------- END INIT/RUNTIME
@@ -0,0 +1,16 @@
+#include "map_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Converts maps from their text form into map files, e.g.
+ * bin/map_convert maps/map1.txt assets/maps/map1.map
+ */
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s <text map> <map file>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  return map_file_convert(argv[1], argv[2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
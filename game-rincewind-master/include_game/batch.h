@@ -0,0 +1,67 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include "match.h"
+
+/**
+ * Many independent matches stepped together on a pool of threads, e.g. to
+ * train bots or to test balance changes over thousands of games.
+ * Matches share nothing, so each one plays out exactly as it would alone,
+ * whichever thread steps it.
+ */
+typedef struct batch batch_t;
+
+/**
+ * Starts a new match on each of the given maps, and the threads to step them.
+ *
+ * @param maps the map of each match: MAP1, MAP2, or MAP3
+ * @param count the number of matches
+ * @param threads the number of threads to step the matches on, including the
+ * calling thread; 0 or 1 steps them all on the calling thread
+ * @return the new batch
+ */
+batch_t *batch_init(const game_state_t *maps, size_t count, size_t threads);
+
+/**
+ * Stops a batch's threads and frees its matches.
+ *
+ * @param batch a pointer to a batch returned from batch_init()
+ */
+void batch_free(batch_t *batch);
+
+/** Returns the number of matches in a batch */
+size_t batch_size(batch_t *batch);
+
+/**
+ * Gets one of the matches of a batch.
+ * It must not be used while batch_step() is running.
+ *
+ * @param batch a pointer to a batch returned from batch_init()
+ * @param index the index of the match, less than batch_size()
+ * @return the match
+ */
+match_t *batch_get_match(batch_t *batch, size_t index);
+
+/**
+ * Replaces one of the matches of a batch, e.g. once it is over, with a new
+ * match on the same map.
+ *
+ * @param batch a pointer to a batch returned from batch_init()
+ * @param index the index of the match, less than batch_size()
+ */
+void batch_restart(batch_t *batch, size_t index);
+
+/**
+ * Steps every match of a batch by one tick (see match_step()), split among
+ * the batch's threads. Returns once every match has been stepped.
+ *
+ * @param batch a pointer to a batch returned from batch_init()
+ * @param inputs the inputs of each match, in the order of the matches
+ * @param dt the time elapsed since the last tick, in seconds
+ * @param observations if not NULL, set to the observation of each match
+ * after its tick (see match_observe())
+ */
+void batch_step(batch_t *batch, const player_input_t (*inputs)[MATCH_PLAYERS],
+                double dt, match_observation_t *observations);
+
+#endif // #ifndef __BATCH_H__
@@ -25,6 +25,9 @@ typedef enum game_state {
   GAME_WIN_P2
 } game_state_t;
 
+/** Number of game states, for tables indexed by game_state_t */
+#define GAME_STATE_COUNT (GAME_WIN_P2 + 1)
+
 typedef enum side { LEFT, RIGHT, UP, DOWN, NO_SIDE } side_t;
 
 typedef enum sound {
@@ -58,12 +61,18 @@ typedef enum body_type {
   P2_LIFE
 } body_type_t;
 
+/** Number of body types, for tables indexed by body_type_t */
+#define BODY_TYPE_COUNT (P2_LIFE + 1)
+
 typedef struct body_info {
   body_type_t type;
   side_t side;
   game_weapon_type_t weapon_type;
   double time_since_last_shot;
   size_t shots_left;
+  // Image the body is drawn with, named by its map file; NULL if the
+  // renderer picks one by type
+  const char *texture;
 } body_info_t;
 
 #endif // #ifndef __GAME_H__
\ No newline at end of file
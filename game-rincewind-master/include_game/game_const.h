@@ -9,14 +9,24 @@ extern const vector_t MAX1;
 extern const vector_t MAX2;
 extern const vector_t MAX_MENU;
 
+// Timers, which count in tenths of a second
+extern const double TIME_THRESHOLD;
+extern const double TIME_MULT;
+
 // Player
 extern const double PLAYER_MASS;
+extern const int STARTING_LIVES;
 extern const rgb_color_t PLAYER_1_COLOR;
 extern const rgb_color_t PLAYER_2_COLOR;
 
 // Powerups
 extern const int MAX_POWERUPS;
 
+// Clock arms on maps 2 and 3
+extern const double ANGLE_ERROR;
+extern const double ANGULAR_MULTIPLIER_BIG;
+extern const double ANGULAR_MULTIPLIER_SMALL;
+
 // Gravity
 extern const double G; // N m^2 / kg^2
 
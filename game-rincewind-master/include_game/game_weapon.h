@@ -4,14 +4,55 @@
 #include "forces.h"
 #include "game.h"
 
+/** Game time between powerup drops */
+extern const double POWERUP_TIME;
+/** Game time a player waits between shots, and after spawning */
+extern const double SHOT_THRESHOLD;
+
 void game_weapon_upgrade(body_t *player, game_weapon_type_t upgrade);
 
-bool spawn_powerup(scene_t *scene, double time_since_last_drop,
-                   double powerups_on_screen, game_state_t map);
+/**
+ * Makes a powerup and adds it to a scene, with its collisions with the
+ * scene's players, gravity and other powerups.
+ *
+ * @param scene the scene to add the powerup to
+ * @param type POWERUP_RICOCHET or POWERUP_SHOTGUN
+ * @return the new powerup, which still needs a centroid and a sprite
+ */
+body_t *get_powerup(scene_t *scene, body_type_t type);
+
+/**
+ * Drops a random powerup at one of a map's spawn points.
+ *
+ * @return the new powerup, which still needs a sprite
+ */
+body_t *drop_powerup(scene_t *scene, game_state_t map);
+
+/**
+ * Drops a powerup (see drop_powerup()) if enough time has passed since the
+ * last one and there is room for another.
+ *
+ * @return the new powerup, which still needs a sprite, or NULL if none spawned
+ */
+body_t *spawn_powerup(scene_t *scene, double time_since_last_drop,
+                      double powerups_on_screen, game_state_t map);
 
+/**
+ * Fires a player's weapon (see game_weapon_fire()) if SHOT_THRESHOLD has
+ * passed since their last shot, as counted in their time_since_last_shot.
+ *
+ * @return whether the player shot
+ */
 bool game_weapon_shoot(scene_t *scene, body_t *player);
 
-typedef struct collision_aux_radial collision_aux_radial_t;
+/**
+ * Fires a player's weapon, whatever their cooldown, using up one of its
+ * shots. A weapon with none left is swapped for a pistol first.
+ *
+ * @param scene the scene to add the bullets to
+ * @param player the player body
+ */
+void game_weapon_fire(scene_t *scene, body_t *player);
 
 /**
  * @brief Adds a force creator between a player and a powerup such that when
@@ -26,29 +67,6 @@ typedef struct collision_aux_radial collision_aux_radial_t;
 void create_powerup_pickup_collision(scene_t *scene, body_t *player,
                                      body_t *powerup);
 
-/**
- * @brief Adds a force creator between two bodies that can destroy the bodies
- * if they get too far away from each other
- *
- * @param scene the scene where the bodies are contained
- * @param body1 a body object
- * @param body2 a body object
- * @param body1_destroyable whether body1 will be destroyed during the collision
- * @param body2_destroyable whether body2 will be destroyed during the collision
- * @param radius how far away the bodies are allowed to be apart
- */
-void create_radial_destructive_collision(scene_t *scene, body_t *body1,
-                                         body_t *body2, bool body1_destroyable,
-                                         bool body2_destroyable, double radius);
-
-/**
- * @brief Destroys bodies if they are too far apart from one another
- *
- * @param void_aux contains two bodies, radius and which bodies should be
- * destroyed
- */
-void calc_radial_destructive_collision(void *void_aux);
-
 /**
  * @brief Performs destructive collision on powerup and give player
  * a new weapon.
@@ -2,16 +2,35 @@
 #define __MAP_H__
 
 #include "game_const.h"
+#include "map_file.h"
 #include "player.h"
 
 void generate_menu(scene_t *scene);
 
-void generate_map1(scene_t *scene);
+/**
+ * Gets the map file a map is played on, loading it the first time.
+ * Map files stay loaded, and may be used from any thread.
+ *
+ * @param map MAP1, MAP2, or MAP3
+ * @return the map file
+ */
+map_file_t *map_get_file(game_state_t map);
 
-void generate_map2(scene_t *scene);
+/** Picks one of a map's powerup spawn points with the scene's generator */
+vector_t map_random_powerup_spawn(scene_t *scene, game_state_t map);
 
 void create_map(scene_t *scene, game_state_t game_state);
 
 void check_bounds(body_t *body);
 
+/**
+ * Applies a map's per-tick rules before the scene is ticked: on maps 2 and 3
+ * the clock arms speed up whenever they line up, and players wrap around the
+ * edges of the screen.
+ *
+ * @param scene the scene created for the map
+ * @param game_state the map being played
+ */
+void map_update(scene_t *scene, game_state_t game_state);
+
 #endif // #ifndef __MAP_H__
\ No newline at end of file
@@ -0,0 +1,123 @@
+#ifndef __MAP_FILE_H__
+#define __MAP_FILE_H__
+
+#include "game.h"
+#include "scene.h"
+#include <stdbool.h>
+
+/**
+ * A map loaded from a binary map file: the map's bodies, where players and
+ * powerups spawn, and the static hierarchy over its geometry, baked ahead of
+ * time by map_file_convert() from a text description.
+ *
+ * The file is mapped into memory rather than read, and its fixed-size records
+ * are used where they lie, so loading it costs little more than the page
+ * faults of touching it. A loaded map can be instantiated into any number of
+ * scenes, from any number of threads at once.
+ *
+ * The text form has one entry per line; '#' starts a comment:
+ *
+ *   size <width> <height>
+ *   rect <type> <motion> <width> <height> <x> <y> <r> <g> <b> [options]
+ *   circle <type> <motion> <radius> <points> <x> <y> <r> <g> <b> [options]
+ *   spawn <PLAYER1 | PLAYER2 | POWERUP> <x> <y>
+ *
+ * where <type> is a body type such as GROUND or WALL, <motion> is static,
+ * kinematic, or dynamic, and (x, y) is the body's centroid. The options are
+ *
+ *   mass <mass>          otherwise INFINITY
+ *   spin <rot_velocity> <rot_acceleration> <center_x> <center_y>
+ *   texture <name>       the body's image, loaded into the game state's
+ *                        atlas; bodies without one are drawn by type
+ *
+ * Bodies are added to the scene in the order they are listed.
+ */
+typedef struct map_file map_file_t;
+
+/** Where something appears on a map (see map_file_spawn()) */
+typedef enum map_spawn {
+  SPAWN_PLAYER1,
+  SPAWN_PLAYER2,
+  SPAWN_POWERUP,
+  SPAWN_KIND_COUNT
+} map_spawn_t;
+
+/**
+ * Converts a map from its text form into a binary map file.
+ * Errors in the text are reported on stderr with their line numbers.
+ *
+ * @param text_path the path of the text form
+ * @param map_path the path of the map file to write
+ * @return whether the map file was written
+ */
+bool map_file_convert(const char *text_path, const char *map_path);
+
+/**
+ * Maps a binary map file into memory.
+ *
+ * @param path the path of a file written by map_file_convert()
+ * @return the loaded map, or NULL if the file is missing or not a map file
+ */
+map_file_t *map_file_load(const char *path);
+
+/**
+ * Unmaps a map file. Scenes instantiated from it are not affected.
+ *
+ * @param map a pointer to a map returned from map_file_load()
+ */
+void map_file_free(map_file_t *map);
+
+/** Returns the size of a map, from (0, 0) to its top right corner */
+vector_t map_file_size(map_file_t *map);
+
+/** Returns the number of bodies a map adds to a scene */
+size_t map_file_bodies(map_file_t *map);
+
+/**
+ * Gets the texture of one of a map's bodies.
+ *
+ * @param map a pointer to a map returned from map_file_load()
+ * @param index the index of the body, in the order it is added to scenes
+ * @return the name of the body's image, or NULL if it has none
+ */
+const char *map_file_texture(map_file_t *map, size_t index);
+
+/** Returns the number of spawn points of a kind a map has */
+size_t map_file_spawns(map_file_t *map, map_spawn_t kind);
+
+/**
+ * Gets one of a map's spawn points.
+ *
+ * @param map a pointer to a map returned from map_file_load()
+ * @param kind what spawns there
+ * @param index the index among spawn points of that kind, in file order
+ * @return the spawn point
+ */
+vector_t map_file_spawn(map_file_t *map, map_spawn_t kind, size_t index);
+
+/**
+ * Adds a map's bodies to a scene, and gives the scene the map's static
+ * hierarchy (see scene_set_static_bvh()). The scene must have no static
+ * bodies yet; bodies added afterwards are checked one by one, as usual.
+ * Players are not added; see map_file_spawn(). Each body's info names its
+ * texture (see map_file_texture()).
+ *
+ * @param map a pointer to a map returned from map_file_load()
+ * @param scene the scene to add the bodies to
+ */
+void map_file_instantiate(map_file_t *map, scene_t *scene);
+
+/**
+ * Adds a map's bodies to a scene like map_file_instantiate(), but shares the
+ * static bodies and hierarchy of another scene the map was instantiated in
+ * instead of building them again (see scene_share_body()); only the moving
+ * bodies are built. The scene must have no bodies yet, and the other scene's
+ * first bodies must be the map's.
+ *
+ * @param map a pointer to a map returned from map_file_load()
+ * @param scene the scene to add the bodies to
+ * @param owner a scene map_file_instantiate() added the map's bodies to
+ */
+void map_file_share(map_file_t *map, scene_t *scene, scene_t *owner);
+
+#endif // #ifndef __MAP_FILE_H__
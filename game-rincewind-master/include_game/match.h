@@ -0,0 +1,194 @@
+#ifndef __MATCH_H__
+#define __MATCH_H__
+
+#include "game.h"
+#include "scene.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Number of players in a match */
+#define MATCH_PLAYERS 2
+
+/**
+ * The buttons a player is holding during one tick, as a set of
+ * player_input_flag_t bits.
+ */
+typedef uint8_t player_input_t;
+
+typedef enum player_input_flag {
+  INPUT_LEFT = 1 << 0,
+  INPUT_RIGHT = 1 << 1,
+  INPUT_JUMP = 1 << 2,
+  INPUT_SHOOT = 1 << 3
+} player_input_flag_t;
+
+/** Most powerups and bullets a match_observation_t lists */
+#define OBSERVED_POWERUPS 4
+#define OBSERVED_BULLETS 16
+
+/** What a bot can see of one player */
+typedef struct player_observation {
+  // Whether the player is in the scene; false for a moment after being shot
+  bool alive;
+  vector_t position;
+  vector_t velocity;
+  bool grounded;
+  size_t lives;
+  game_weapon_type_t weapon;
+  size_t shots_left;
+  double time_since_last_shot;
+  double time_since_jump;
+} player_observation_t;
+
+/**
+ * What a bot can see of a match, in a fixed size so that batches of them can
+ * be laid out in one array.
+ */
+typedef struct match_observation {
+  player_observation_t players[MATCH_PLAYERS];
+  size_t powerup_count;
+  body_type_t powerup_types[OBSERVED_POWERUPS];
+  vector_t powerup_positions[OBSERVED_POWERUPS];
+  // The first OBSERVED_BULLETS bullets, if there are more
+  size_t bullet_count;
+  game_weapon_type_t bullet_weapons[OBSERVED_BULLETS];
+  vector_t bullet_positions[OBSERVED_BULLETS];
+  vector_t bullet_velocities[OBSERVED_BULLETS];
+  size_t round;
+  bool over;
+} match_observation_t;
+
+/**
+ * One game played on a map until a player runs out of lives.
+ * A match owns its scene and applies the game's rules to it each tick, but
+ * knows nothing of the screen, keyboard, or sound, so it can also be run by a
+ * server or a test without SDL.
+ */
+typedef struct match match_t;
+
+/**
+ * A saved copy of everything about a match that changes as it is played
+ * (see match_save()).
+ */
+typedef struct match_state match_state_t;
+
+/**
+ * Starts a match with both players on full lives.
+ *
+ * @param map MAP1, MAP2, or MAP3
+ * @return the new match
+ */
+match_t *match_init(game_state_t map);
+
+/**
+ * Releases a match and its scene.
+ *
+ * @param match a pointer to a match returned from match_init()
+ */
+void match_free(match_t *match);
+
+/**
+ * Advances a match by one tick.
+ * Each player's input is applied, the map's rules run, powerups drop, and the
+ * scene is ticked. If a player was shot, they lose a life and the map is
+ * rebuilt for the next round. Does nothing once the match is over.
+ *
+ * @param match a pointer to a match returned from match_init()
+ * @param inputs the input of PLAYER1 and of PLAYER2, in that order
+ * @param dt the time elapsed since the last tick, in seconds
+ */
+void match_step(match_t *match, const player_input_t inputs[MATCH_PLAYERS],
+                double dt);
+
+/**
+ * Gets the scene a match is being played in.
+ * The scene is replaced at the start of every round, so the pointer is only
+ * valid until the next call to match_step().
+ *
+ * @param match a pointer to a match returned from match_init()
+ * @return the match's current scene
+ */
+scene_t *match_get_scene(match_t *match);
+
+game_state_t match_get_map(match_t *match);
+
+/**
+ * Gets the number of lives a player has left.
+ *
+ * @param match a pointer to a match returned from match_init()
+ * @param player PLAYER1 or PLAYER2
+ * @return the player's remaining lives
+ */
+size_t match_get_lives(match_t *match, body_type_t player);
+
+/** Returns the number of rounds finished so far, starting at 0 */
+size_t match_get_round(match_t *match);
+
+/** Returns whether a player has run out of lives */
+bool match_is_over(match_t *match);
+
+/**
+ * Describes the current state of a match for a bot to act on.
+ *
+ * @param match a pointer to a match returned from match_init()
+ * @param observation set to what can be seen of the match
+ */
+void match_observe(match_t *match, match_observation_t *observation);
+
+/**
+ * Allocates an empty buffer to save a match into.
+ *
+ * @return the new buffer
+ */
+match_state_t *match_state_init(void);
+
+/**
+ * Releases a match state buffer.
+ *
+ * @param state a pointer to a buffer returned from match_state_init()
+ */
+void match_state_free(match_state_t *state);
+
+/**
+ * Saves a match: its timers, lives and round, and its scene (see
+ * scene_save()). Only allocates the first few times a buffer is used.
+ *
+ * @param match a pointer to a match returned from match_init()
+ * @param state a pointer to a buffer returned from match_state_init()
+ */
+void match_save(match_t *match, match_state_t *state);
+
+/**
+ * Puts a match back in a state saved from it, so that stepping it with the
+ * same inputs plays out exactly as it did before.
+ * The scene is restored in place, without allocating, unless one of its
+ * bodies has been freed since the save (a powerup was picked up or a round
+ * ended), in which case it is rebuilt and match_get_scene() changes.
+ *
+ * @param match a pointer to a match returned from match_init()
+ * @param state a pointer to a buffer passed to match_save()
+ */
+void match_load(match_t *match, const match_state_t *state);
+
+/**
+ * Makes a copy of a match to look ahead in, e.g. for a bot to see what
+ * happens over the next few ticks if it jumps or shoots now.
+ * The fork shares the map's static bodies and hierarchy with the match (see
+ * map_file_share()); passing NULL builds just the moving bodies, players, and
+ * powerups, and copies the match into them. Pass back a fork made before to
+ * copy the match into it again instead: the fork keeps the bodies it built,
+ * and only the bodies, contacts, and bullets that changed are copied (see
+ * scene_fork()). They are only built again once a body has been freed in
+ * either match since, e.g. when a powerup is picked up or a round ends.
+ * Since the fork reads the match's static bodies, it must be forked again
+ * before it is stepped once the match has started a new round; it can be
+ * freed at any time.
+ *
+ * @param match a pointer to a match returned from match_init()
+ * @param fork NULL, or a fork of a match on the same map returned from an
+ * earlier call
+ * @return the fork, to be released with match_free()
+ */
+match_t *match_fork(match_t *match, match_t *fork);
+
+#endif // #ifndef __MATCH_H__
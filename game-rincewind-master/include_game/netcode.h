@@ -0,0 +1,125 @@
+#ifndef __NETCODE_H__
+#define __NETCODE_H__
+
+#include "match.h"
+#include "net.h"
+#include "snapshot.h"
+
+/**
+ * Snapshots kept by each end of a connection. A snapshot older than this
+ * many ticks can no longer be used as a baseline.
+ */
+#define NET_HISTORY 32
+
+/**
+ * The authority for a two player match played over UDP.
+ * The first two addresses that send it input become PLAYER1 and PLAYER2, and
+ * the match starts once both have joined. Every tick the server applies the
+ * latest input from each player, then sends each of them a snapshot encoded
+ * against the last one that player acknowledged.
+ */
+typedef struct net_server net_server_t;
+
+/**
+ * The connection of one player to a server. A client sends the player's
+ * input every tick and keeps the snapshots it receives.
+ */
+typedef struct net_client net_client_t;
+
+/**
+ * Starts a server with a new match.
+ *
+ * @param port the port to listen on, or 0 for any free port
+ * @param map the map to play
+ * @return the new server, or NULL if the port could not be bound
+ */
+net_server_t *net_server_init(uint16_t port, game_state_t map);
+
+/**
+ * Shuts down a server and frees its match.
+ *
+ * @param server a pointer to a server returned from net_server_init()
+ */
+void net_server_free(net_server_t *server);
+
+/** Returns the socket a server listens on, e.g. to simulate a bad network */
+net_socket_t *net_server_get_socket(net_server_t *server);
+
+match_t *net_server_get_match(net_server_t *server);
+
+/** Returns the number of players that have joined, up to MATCH_PLAYERS */
+size_t net_server_players(net_server_t *server);
+
+/**
+ * Runs one tick of a server: reads every packet that has arrived, then, if
+ * both players have joined, steps the match and sends out its snapshot.
+ *
+ * @param server a pointer to a server returned from net_server_init()
+ * @param dt the time elapsed since the last tick, in seconds
+ */
+void net_server_tick(net_server_t *server, double dt);
+
+/**
+ * Gets a snapshot the server sent recently.
+ *
+ * @param server a pointer to a server returned from net_server_init()
+ * @param tick the tick of the snapshot, starting at 1
+ * @return the snapshot, or NULL if it is older than NET_HISTORY ticks or has
+ * not been taken yet
+ */
+const snapshot_t *net_server_snapshot(net_server_t *server, uint32_t tick);
+
+/**
+ * Gets the number of bytes a server has sent to one player.
+ *
+ * @param server a pointer to a server returned from net_server_init()
+ * @param player PLAYER1 or PLAYER2
+ * @return the total size of the snapshots sent to the player
+ */
+size_t net_server_bytes_sent(net_server_t *server, body_type_t player);
+
+/**
+ * Connects to a server. Nothing is sent until net_client_send_input().
+ *
+ * @param server the address of the server
+ * @return the new client, or NULL if it could not open a socket
+ */
+net_client_t *net_client_init(net_address_t server);
+
+/**
+ * Closes a client's connection.
+ *
+ * @param client a pointer to a client returned from net_client_init()
+ */
+void net_client_free(net_client_t *client);
+
+/** Returns the socket a client sends from, e.g. to simulate a bad network */
+net_socket_t *net_client_get_socket(net_client_t *client);
+
+/**
+ * Sends the player's input for this tick, along with the newest snapshot the
+ * client has, so the server can encode the next ones against it.
+ *
+ * @param client a pointer to a client returned from net_client_init()
+ * @param input the buttons the player is holding
+ */
+void net_client_send_input(net_client_t *client, player_input_t input);
+
+/**
+ * Decodes every snapshot that has arrived. Snapshots whose baseline the
+ * client no longer has are dropped.
+ *
+ * @param client a pointer to a client returned from net_client_init()
+ * @return the number of snapshots decoded
+ */
+size_t net_client_poll(net_client_t *client);
+
+/**
+ * Gets the newest snapshot a client has received.
+ *
+ * @param client a pointer to a client returned from net_client_init()
+ * @return the snapshot, or NULL if none has arrived yet
+ */
+const snapshot_t *net_client_latest(net_client_t *client);
+
+#endif // #ifndef __NETCODE_H__
@@ -6,14 +6,49 @@
 body_info_t *info_init(body_type_t type, side_t side,
                        game_weapon_type_t weapon);
 
+/** Acts like info_init(), but takes the info from an arena if one is given */
+body_info_t *info_init_in(arena_t *arena, body_type_t type, side_t side,
+                          game_weapon_type_t weapon);
+
+/** Frees an info from info_init(); infos from an arena are not freed */
+void info_free(void *info);
+
 body_info_t *get_info(body_t *body);
 
+/**
+ * Gets the type in a body's body_info_t, or BODY_TYPE_COUNT if it has none.
+ * Game scenes index their bodies by it.
+ */
+size_t get_body_type(body_t *body);
+
+/** Allocates an empty scene that indexes its bodies by body_type_t */
+scene_t *game_scene_init(void);
+
 body_t *fetch_object(scene_t *scene, body_type_t body_type);
 
 sprite_t *fetch_sprite(scene_t *scene, body_type_t body_type);
 
 body_t *add_player(scene_t *scene, body_type_t type, vector_t spawn);
 
-body_t *get_player_feet(body_t *player);
+/** Returns whether a player is standing on the ground */
+bool player_is_grounded(scene_t *scene, body_t *player);
+
+/**
+ * Turns a player to face a side and accelerates them towards it, up to their
+ * top speed. A player running against their current motion stops first.
+ *
+ * @param player the player body
+ * @param side LEFT or RIGHT
+ */
+void player_run(body_t *player, side_t side);
+
+/**
+ * Makes a player jump if they are standing on the ground.
+ *
+ * @param scene the scene containing the player
+ * @param player the player body
+ * @return whether the player jumped
+ */
+bool player_jump(scene_t *scene, body_t *player);
 
 #endif // #ifndef __PLAYER_H__
\ No newline at end of file
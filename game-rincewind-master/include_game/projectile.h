@@ -0,0 +1,95 @@
+#ifndef __PROJECTILE_H__
+#define __PROJECTILE_H__
+
+#include "color.h"
+#include "game.h"
+#include "vector.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct scene scene_t;
+
+/**
+ * Every live bullet in a scene, stored as parallel arrays.
+ * Bullets are points moved by projectiles_tick() and cast against the bodies
+ * they can hit, so they need no body_t, shape, or force creators of their own.
+ */
+typedef struct projectiles projectiles_t;
+
+/**
+ * Allocates an empty projectile store.
+ *
+ * @return the new store
+ */
+projectiles_t *projectiles_init(void);
+
+/**
+ * Releases a projectile store and its arrays.
+ *
+ * @param projectiles a pointer to a store returned from projectiles_init()
+ */
+void projectiles_free(projectiles_t *projectiles);
+
+/**
+ * Makes one store hold exactly the bullets of another, e.g. to save and
+ * restore them. Only allocates if the destination has never held as many
+ * bullets before.
+ *
+ * @param dest the store to overwrite
+ * @param src the store to copy
+ */
+void projectiles_copy(projectiles_t *dest, projectiles_t *src);
+
+/**
+ * Fires a bullet. Ricochet bullets get a few bounces; the rest are destroyed
+ * by the first thing they hit.
+ *
+ * @param projectiles a pointer to a store returned from projectiles_init()
+ * @param position where the bullet starts
+ * @param velocity the bullet's initial velocity
+ * @param weapon the weapon that fired it, which decides how it behaves
+ * @param owner the player that fired it
+ */
+void projectiles_add(projectiles_t *projectiles, vector_t position,
+                     vector_t velocity, game_weapon_type_t weapon,
+                     body_type_t owner);
+
+/**
+ * Gets the number of live bullets.
+ *
+ * @param projectiles a pointer to a store returned from projectiles_init()
+ * @return the number of bullets added and not yet destroyed
+ */
+size_t projectiles_count(projectiles_t *projectiles);
+
+vector_t projectiles_get_position(projectiles_t *projectiles, size_t index);
+
+vector_t projectiles_get_velocity(projectiles_t *projectiles, size_t index);
+
+game_weapon_type_t projectiles_get_weapon(projectiles_t *projectiles,
+                                          size_t index);
+
+/**
+ * Gets the color and size a weapon's bullets are drawn with.
+ *
+ * @param weapon the weapon that fired the bullet
+ * @param size set to the bullet's length (along its velocity) and height
+ * @return the bullet's color
+ */
+rgb_color_t projectile_appearance(game_weapon_type_t weapon, vector_t *size);
+
+/**
+ * Moves every bullet through one tick.
+ * Each bullet's path is cast against the walls, ground, clock arms, players,
+ * and powerups in the scene. A player that is hit is removed along with the
+ * bullet, and a ricochet bullet reflects off the geometry it hits while it
+ * has bounces left. Bullets that meet each other are destroyed, except that
+ * shotgun pellets survive hitting other bullets.
+ *
+ * @param projectiles a pointer to a store returned from projectiles_init()
+ * @param scene the scene holding the bodies the bullets can hit
+ * @param dt the time elapsed since the last tick, in seconds
+ */
+void projectiles_tick(projectiles_t *projectiles, scene_t *scene, double dt);
+
+#endif // #ifndef __PROJECTILE_H__
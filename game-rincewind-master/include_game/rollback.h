@@ -0,0 +1,88 @@
+#ifndef __ROLLBACK_H__
+#define __ROLLBACK_H__
+
+#include "match.h"
+
+/**
+ * Frames a peer may run ahead of the last remote input it has received.
+ * This is also the most frames it ever resimulates at once.
+ */
+#define ROLLBACK_MAX_FRAMES 8
+
+/**
+ * One peer of a two player match played with rollback: both peers simulate
+ * the whole match, each applying its own player's input at once and
+ * predicting the other's. When the other player's real input for a frame
+ * arrives and differs from the prediction, the match is loaded from that
+ * frame and resimulated up to the present.
+ * How inputs travel between the peers is up to the caller.
+ */
+typedef struct rollback rollback_t;
+
+/**
+ * Starts running a match with rollback.
+ * Both peers must start from matches in the same state.
+ *
+ * @param match the match to run, which the peer steps but does not own
+ * @param local_player PLAYER1 or PLAYER2, whichever this peer controls
+ * @param dt the length of a frame, in seconds
+ * @return the new peer
+ */
+rollback_t *rollback_init(match_t *match, body_type_t local_player, double dt);
+
+/**
+ * Releases a peer and its saved frames. Does not free its match.
+ *
+ * @param rollback a pointer to a peer returned from rollback_init()
+ */
+void rollback_free(rollback_t *rollback);
+
+/**
+ * Simulates the next frame with the local player's input, after first
+ * resimulating any frames whose remote input was mispredicted.
+ * If the peer is already ROLLBACK_MAX_FRAMES ahead of the remote input, it
+ * stalls instead: nothing is stepped and the input is not used.
+ *
+ * @param rollback a pointer to a peer returned from rollback_init()
+ * @param local_input the local player's input for the frame, which the
+ * caller also sends to the other peer as its input for that frame
+ * @return whether the frame was simulated
+ */
+bool rollback_advance(rollback_t *rollback, player_input_t local_input);
+
+/**
+ * Records the other player's input for a frame, as received from the other
+ * peer. Inputs may arrive late, out of order, or more than once. Inputs for
+ * frames that are already confirmed, or further ahead than the other peer
+ * could have got, are ignored.
+ *
+ * @param rollback a pointer to a peer returned from rollback_init()
+ * @param frame the frame the input is for
+ * @param input the other player's input
+ */
+void rollback_add_remote_input(rollback_t *rollback, size_t frame,
+                               player_input_t input);
+
+/**
+ * Loads the earliest frame whose remote input was mispredicted, if any, and
+ * simulates the match again from there up to the present.
+ * rollback_advance() does this first anyway; calling it sooner shows the
+ * corrected match right away.
+ *
+ * @param rollback a pointer to a peer returned from rollback_init()
+ */
+void rollback_resimulate(rollback_t *rollback);
+
+/** Returns the number of frames simulated so far, i.e. the next frame */
+size_t rollback_frame(rollback_t *rollback);
+
+/**
+ * Returns the number of frames whose inputs are all known, so that they will
+ * never be resimulated.
+ */
+size_t rollback_confirmed_frame(rollback_t *rollback);
+
+/** Returns the total number of frames simulated again after a rollback */
+size_t rollback_resimulated_frames(rollback_t *rollback);
+
+#endif // #ifndef __ROLLBACK_H__
@@ -0,0 +1,116 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include "match.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Most moving bodies a snapshot records; the rest are left out */
+#define SNAPSHOT_MAX_ENTITIES 32
+/** Most bullets a snapshot records; the rest are left out */
+#define SNAPSHOT_MAX_PROJECTILES 64
+
+/**
+ * A moving body in a snapshot, with its position, velocity, and angle
+ * quantized to fixed point (see snapshot_dequantize_position() and friends).
+ */
+typedef struct entity_state {
+  // The body's type in the high byte and its index among bodies of that type
+  // in the low byte
+  uint16_t id;
+  uint8_t side;
+  uint8_t weapon;
+  // Shots left with the weapon, capped at UINT8_MAX for a pistol's infinity
+  uint8_t shots_left;
+  int32_t x;
+  int32_t y;
+  int32_t vx;
+  int32_t vy;
+  int32_t angle;
+} entity_state_t;
+
+/** A bullet in a snapshot, quantized like an entity_state_t */
+typedef struct projectile_state {
+  uint8_t weapon;
+  int32_t x;
+  int32_t y;
+  int32_t vx;
+  int32_t vy;
+} projectile_state_t;
+
+/**
+ * The state of a match at the end of one tick, as a server sends it to its
+ * clients. Static bodies are left out since every client builds the same map.
+ */
+typedef struct snapshot {
+  uint32_t tick;
+  uint8_t map;
+  uint8_t round;
+  uint8_t lives[MATCH_PLAYERS];
+  // Sorted by id
+  size_t entity_count;
+  entity_state_t entities[SNAPSHOT_MAX_ENTITIES];
+  size_t projectile_count;
+  projectile_state_t projectiles[SNAPSHOT_MAX_PROJECTILES];
+} snapshot_t;
+
+/**
+ * Records the state of a match.
+ *
+ * @param snapshot the snapshot to fill in
+ * @param match the match
+ * @param tick the number of the tick that just finished
+ */
+void snapshot_capture(snapshot_t *snapshot, match_t *match, uint32_t tick);
+
+/**
+ * Encodes a snapshot into a packet, as the changes from a baseline snapshot
+ * the receiver already has. Only the entities that changed are written, and
+ * only the fields of each that changed, as differences from the baseline.
+ *
+ * @param snapshot the snapshot to encode
+ * @param baseline an earlier snapshot to encode against, or NULL to encode
+ * the whole snapshot
+ * @param buffer where to write the packet
+ * @param capacity the size of the buffer
+ * @return the size of the packet, or 0 if it did not fit in the buffer
+ */
+size_t snapshot_encode(const snapshot_t *snapshot, const snapshot_t *baseline,
+                       void *buffer, size_t capacity);
+
+/**
+ * Reads which snapshot a packet holds and which baseline it needs.
+ *
+ * @param buffer a packet written by snapshot_encode()
+ * @param size the size of the packet
+ * @param tick set to the tick of the snapshot
+ * @param baseline_tick set to the tick of the baseline it was encoded against
+ * @return whether the packet has a baseline
+ */
+bool snapshot_read_header(const void *buffer, size_t size, uint32_t *tick,
+                          uint32_t *baseline_tick);
+
+/**
+ * Decodes a packet written by snapshot_encode().
+ *
+ * @param snapshot the snapshot to fill in
+ * @param baseline the snapshot with the tick snapshot_read_header() gives,
+ * or NULL if the packet has no baseline
+ * @param buffer the packet
+ * @param size the size of the packet
+ * @return whether the packet was well formed
+ */
+bool snapshot_decode(snapshot_t *snapshot, const snapshot_t *baseline,
+                     const void *buffer, size_t size);
+
+/** Returns whether two snapshots hold exactly the same state */
+bool snapshot_equal(const snapshot_t *snapshot1, const snapshot_t *snapshot2);
+
+vector_t snapshot_dequantize_position(int32_t x, int32_t y);
+
+vector_t snapshot_dequantize_velocity(int32_t vx, int32_t vy);
+
+double snapshot_dequantize_angle(int32_t angle);
+
+#endif // #ifndef __SNAPSHOT_H__
@@ -0,0 +1,98 @@
+#ifndef __ALLOC_TRACK_H__
+#define __ALLOC_TRACK_H__
+
+#include <stddef.h>
+#include <stdlib.h>
+
+/**
+ * Subsystems that tracked allocations are charged to.
+ */
+typedef enum {
+  TRACK_LIST,
+  TRACK_BODY,
+  TRACK_SPRITE,
+  TRACK_FORCE_BIND,
+  TRACK_FORCE_AUX,
+  TRACK_CONTACT,
+  TRACK_ARENA,
+  TRACK_INFO,
+  TRACK_PROJECTILE,
+  TRACK_BVH,
+  TRACK_ATLAS,
+  TRACK_TAG_COUNT
+} track_tag_t;
+
+#ifdef TRACK_ALLOCATIONS
+
+/**
+ * Allocates memory charged to a subsystem.
+ * The allocation records where it was made, so leaks can be traced back to
+ * their call sites. It must be freed with track_free(), not free().
+ *
+ * @param tag the subsystem the memory belongs to
+ * @param size the number of bytes to allocate
+ * @return the new memory, or NULL if it could not be allocated
+ */
+#define track_malloc(tag, size)                                                \
+  track_malloc_at((tag), (size), __FILE__, __LINE__)
+
+void *track_malloc_at(track_tag_t tag, size_t size, const char *file,
+                      int line);
+
+/**
+ * Releases memory returned from track_malloc().
+ *
+ * @param ptr the memory to free, or NULL
+ */
+void track_free(void *ptr);
+
+/**
+ * Gets how many bytes a subsystem currently has allocated.
+ *
+ * @param tag the subsystem
+ * @return the size of its allocations that have not been freed
+ */
+size_t track_live_bytes(track_tag_t tag);
+
+/**
+ * Gets how many allocations a subsystem currently has.
+ *
+ * @param tag the subsystem
+ * @return the number of its allocations that have not been freed
+ */
+size_t track_live_count(track_tag_t tag);
+
+/**
+ * Gets how many allocations a subsystem made during the last whole frame.
+ *
+ * @param tag the subsystem
+ * @return the number of allocations between the last two calls to
+ * track_end_frame()
+ */
+size_t track_frame_allocs(track_tag_t tag);
+
+/**
+ * Marks the end of a frame, for track_frame_allocs().
+ */
+void track_end_frame(void);
+
+/**
+ * Prints every subsystem's live allocations to stderr, and the call sites
+ * of those still live. Meant to be called once everything has been freed,
+ * so anything it lists has leaked.
+ */
+void track_report_leaks(void);
+
+#else // Compiled out: tracked allocations are plain allocations
+
+#define track_malloc(tag, size) malloc(size)
+#define track_free(ptr) free(ptr)
+#define track_live_bytes(tag) ((size_t)0)
+#define track_live_count(tag) ((size_t)0)
+#define track_frame_allocs(tag) ((size_t)0)
+#define track_end_frame() ((void)0)
+#define track_report_leaks() ((void)0)
+
+#endif // #ifdef TRACK_ALLOCATIONS
+
+#endif // #ifndef __ALLOC_TRACK_H__
@@ -0,0 +1,44 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+/**
+ * Hands out memory from a few large blocks, and frees it all at once. Meant
+ * for things that live exactly as long as their owner, e.g. the bodies a
+ * scene loads from a map file, which then cost one allocation per block
+ * instead of several each.
+ */
+typedef struct arena arena_t;
+
+/**
+ * Allocates memory for an empty arena.
+ *
+ * @param block_size the size of the blocks memory is taken from, in bytes;
+ *   larger allocations get a block of their own
+ * @return the new arena
+ */
+arena_t *arena_init(size_t block_size);
+
+/**
+ * Releases an arena and everything allocated from it.
+ *
+ * @param arena a pointer to an arena returned from arena_init()
+ */
+void arena_free(arena_t *arena);
+
+/**
+ * Allocates memory that lasts until the arena is freed. It is aligned for
+ * any type, and must not be passed to free().
+ * Asserts that the required memory was allocated.
+ *
+ * @param arena a pointer to an arena returned from arena_init()
+ * @param size the number of bytes to allocate
+ * @return the new memory
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/** Returns the number of bytes allocated from an arena so far */
+size_t arena_used(arena_t *arena);
+
+#endif // #ifndef __ARENA_H__
@@ -0,0 +1,72 @@
+#ifndef __ATLAS_H__
+#define __ATLAS_H__
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+/**
+ * A texture atlas: many images packed into a single texture,
+ * with a table of the region each image occupies.
+ * Drawing every sprite from one atlas lets the renderer keep the same texture
+ * bound for a whole frame.
+ */
+typedef struct atlas atlas_t;
+
+/**
+ * Allocates an empty atlas. Images are added with atlas_add() and packed
+ * into a texture by atlas_build().
+ *
+ * @return the new atlas
+ */
+atlas_t *atlas_init(void);
+
+/**
+ * Releases an atlas, its texture, and any images not yet packed.
+ *
+ * @param atlas a pointer to an atlas returned from atlas_init()
+ */
+void atlas_free(atlas_t *atlas);
+
+/**
+ * Adds an image to be packed into the atlas.
+ * The atlas takes ownership of the surface and frees it once packed.
+ * Asserts that the atlas has not been built yet.
+ *
+ * @param atlas a pointer to an atlas returned from atlas_init()
+ * @param name the name the image is looked up by, e.g. its file name
+ * @param surface the image; any color key it has is kept as transparency
+ */
+void atlas_add(atlas_t *atlas, const char *name, SDL_Surface *surface);
+
+/**
+ * Packs every added image into shelves of one surface and uploads it as a
+ * texture. Images are sorted tallest first and separated by a pixel of
+ * padding so neighbouring regions do not bleed into each other.
+ * Asserts that the packed sheet fits within the renderer's largest texture
+ * and that the texture was created, so missing sprites cannot go unnoticed.
+ *
+ * @param atlas a pointer to an atlas returned from atlas_init()
+ * @param renderer the renderer the texture is created for
+ */
+void atlas_build(atlas_t *atlas, SDL_Renderer *renderer);
+
+/**
+ * Gets the atlas' texture, or NULL if it has not been built
+ * or has no images.
+ *
+ * @param atlas a pointer to an atlas returned from atlas_init()
+ * @return the texture holding every packed image
+ */
+SDL_Texture *atlas_get_texture(atlas_t *atlas);
+
+/**
+ * Looks up where an image was packed.
+ *
+ * @param atlas a pointer to a built atlas
+ * @param name the name passed to atlas_add()
+ * @param region set to the image's source rect in the atlas' texture
+ * @return whether an image with that name was packed
+ */
+bool atlas_find(atlas_t *atlas, const char *name, SDL_Rect *region);
+
+#endif // #ifndef __ATLAS_H__
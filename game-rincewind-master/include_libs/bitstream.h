@@ -0,0 +1,77 @@
+#ifndef __BITSTREAM_H__
+#define __BITSTREAM_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Reads or writes values of any bit width, packed back to back into a
+ * caller's byte buffer. Bits fill each byte from its lowest bit up.
+ * Running past the end of the buffer never touches memory outside it; the
+ * stream is marked as overflowed instead, and reads past the end return 0.
+ */
+typedef struct bitstream {
+  uint8_t *data;
+  size_t capacity;
+  size_t bit;
+  bool overflow;
+} bitstream_t;
+
+/**
+ * Starts a stream at the beginning of a buffer.
+ *
+ * @param stream the stream to initialize
+ * @param data the buffer to read from or write into
+ * @param capacity the size of the buffer in bytes
+ */
+void bitstream_init(bitstream_t *stream, void *data, size_t capacity);
+
+/**
+ * Writes the low bits of a value.
+ *
+ * @param stream a stream set up by bitstream_init()
+ * @param value the value to write
+ * @param bits how many of its bits to write, at most 32
+ */
+void bitstream_write(bitstream_t *stream, uint32_t value, size_t bits);
+
+/**
+ * Reads a value written by bitstream_write().
+ *
+ * @param stream a stream set up by bitstream_init()
+ * @param bits how many bits the value was written with, at most 32
+ * @return the value
+ */
+uint32_t bitstream_read(bitstream_t *stream, size_t bits);
+
+/**
+ * Writes a signed integer in as few bits as its size allows.
+ * Values near 0 take 5 bits, and each further 4 bits of magnitude costs 5
+ * more, so this suits the small differences of delta compression.
+ *
+ * @param stream a stream set up by bitstream_init()
+ * @param value the value to write
+ */
+void bitstream_write_varint(bitstream_t *stream, int32_t value);
+
+/**
+ * Reads a value written by bitstream_write_varint().
+ *
+ * @param stream a stream set up by bitstream_init()
+ * @return the value
+ */
+int32_t bitstream_read_varint(bitstream_t *stream);
+
+/**
+ * Gets how much of the buffer has been read or written.
+ *
+ * @param stream a stream set up by bitstream_init()
+ * @return the number of bytes touched, counting a partial last byte
+ */
+size_t bitstream_bytes(bitstream_t *stream);
+
+/** Returns whether a stream has run past the end of its buffer */
+bool bitstream_overflowed(bitstream_t *stream);
+
+#endif // #ifndef __BITSTREAM_H__
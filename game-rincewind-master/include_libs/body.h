@@ -1,6 +1,7 @@
 #ifndef __BODY_H__
 #define __BODY_H__
 
+#include "collision.h"
 #include "color.h"
 #include "list.h"
 #include "vector.h"
@@ -14,6 +15,39 @@
  */
 typedef struct body body_t;
 
+/**
+ * How a body is moved by body_tick().
+ * Dynamic bodies respond to forces and impulses.
+ * Kinematic bodies follow their velocity and rotation but ignore forces.
+ * Static bodies never move and are skipped by scene_tick().
+ */
+typedef enum motion_type {
+  MOTION_DYNAMIC,
+  MOTION_KINEMATIC,
+  MOTION_STATIC
+} motion_type_t;
+
+/**
+ * Everything about a body that changes as it is simulated, so a body can be
+ * saved and later put back exactly as it was (see body_save()).
+ * The body's shape, mass, color, and info are not included.
+ */
+typedef struct body_state {
+  vector_t centroid;
+  vector_t velocity;
+  double angle;
+  double rot_velocity;
+  double rot_acceleration;
+  vector_t rotation_center;
+  vector_t net_force;
+  vector_t net_impulse;
+  motion_type_t motion_type;
+  bool is_removed;
+  bool is_sleeping;
+  bool was_woken;
+  size_t quiet_ticks;
+} body_state_t;
+
 /**
  * Initializes a body without any info.
  * Acts like body_init_with_info() where info and info_freer are NULL.
@@ -22,7 +56,7 @@ body_t *body_init(list_t *shape, double mass, rgb_color_t color);
 
 /**
  * Allocates memory for a body with the given parameters.
- * The body is initially at rest.
+ * The body is initially at rest and dynamic.
  * Asserts that the mass is positive and that the required memory is allocated.
  *
  * @param shape a list of vectors describing the initial shape of the body
@@ -36,6 +70,18 @@ body_t *body_init(list_t *shape, double mass, rgb_color_t color);
 body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color,
                             void *info, free_func_t info_freer);
 
+/**
+ * Acts like body_init_with_info(), but takes the body and its world-space
+ * shape from an arena, so they are freed with the arena rather than by
+ * body_free(). The shape and info are still freed by body_free(), so ones
+ * from the same arena should have no freers.
+ *
+ * @param arena the arena to allocate from, or NULL to act like
+ *   body_init_with_info()
+ */
+body_t *body_init_in(arena_t *arena, list_t *shape, double mass,
+                     rgb_color_t color, void *info, free_func_t info_freer);
+
 /**
  * Releases the memory allocated for a body.
  *
@@ -60,6 +106,153 @@ double body_distance(body_t *body1, body_t *body2);
  */
 list_t *body_get_shape(body_t *body);
 
+/**
+ * Gets the current shape of a body without copying it.
+ * The body keeps its polygon relative to its centroid and only recomputes
+ * the world-space vertices when they are asked for after the body moved.
+ * The list is owned by the body and must not be modified or freed;
+ * it is only valid until the body next moves or changes shape.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the polygon describing the body's current position
+ */
+list_t *body_get_world_shape(body_t *body);
+
+/**
+ * Gets one vertex of the body's current shape without copying the shape.
+ * Asserts that the index is valid.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param index the index of the vertex (starting at 0)
+ * @return the vertex at the given index
+ */
+vector_t body_get_vertex(body_t *body, size_t index);
+
+/**
+ * Gets a counter that changes every time the body's shape moves.
+ * Callers that cache anything derived from the body's position
+ * (e.g. a sprite's destination rect) can compare revisions to tell
+ * whether the cache is stale.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's current revision
+ */
+size_t body_get_revision(body_t *body);
+
+/**
+ * Gets the smallest axis-aligned box containing the body's current shape.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's bounding box
+ */
+aabb_t body_get_aabb(body_t *body);
+
+/**
+ * Changes how a body is moved each tick (see motion_type_t).
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param motion_type the body's new motion type
+ */
+void body_set_motion_type(body_t *body, motion_type_t motion_type);
+
+/**
+ * Gets how a body is moved each tick.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's motion type, MOTION_DYNAMIC unless changed
+ */
+motion_type_t body_get_motion_type(body_t *body);
+
+/**
+ * Returns whether a body has been put to sleep by the scene.
+ * Sleeping bodies are not integrated and are not tested against static
+ * bodies until something wakes them.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return whether the body is asleep
+ */
+bool body_is_sleeping(body_t *body);
+
+/**
+ * Returns whether a body cannot move this tick,
+ * i.e. it is static or asleep.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return whether the body is resting
+ */
+bool body_is_resting(body_t *body);
+
+/**
+ * Puts a body to sleep, clearing its velocity and accumulated forces.
+ *
+ * @param body a pointer to a body returned from body_init()
+ */
+void body_sleep(body_t *body);
+
+/**
+ * Wakes a body up so it is integrated again.
+ * Happens automatically when a sleeping body is moved, has its velocity
+ * changed, or receives a non-zero force or impulse.
+ * The rest of the body's island wakes with it on the next scene_tick().
+ *
+ * @param body a pointer to a body returned from body_init()
+ */
+void body_wake(body_t *body);
+
+/**
+ * Starts a new tick of island building: the body forms an island by itself.
+ * Called by scene_tick() on every body before running force creators.
+ *
+ * @param body a pointer to a body returned from body_init()
+ */
+void body_island_begin(body_t *body);
+
+/**
+ * Gets the representative body of the island containing a body.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body that represents the whole island
+ */
+body_t *body_get_island(body_t *body);
+
+/**
+ * Records that two bodies touch, merging their islands.
+ * Only dynamic bodies form islands, so resting on static ground does not
+ * connect everything standing on it.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ */
+void body_join_islands(body_t *body1, body_t *body2);
+
+/**
+ * Records that two bodies are touching this tick.
+ * A sleeping body touched by one that can move is woken up,
+ * and the two bodies' islands are merged.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ */
+void body_touch(body_t *body1, body_t *body2);
+
+/**
+ * Adds a body's motion this tick to its island's summary.
+ * Must be called on every body before body_island_settle().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param dt the number of seconds in the current tick
+ */
+void body_island_gather(body_t *body, double dt);
+
+/**
+ * Wakes the body if anything in its island is moving or was woken,
+ * otherwise counts another quiet tick and puts the whole island to sleep
+ * once every member has been quiet long enough.
+ *
+ * @param body a pointer to a body returned from body_init()
+ */
+void body_island_settle(body_t *body);
+
 /**
  * Gets the current center of mass of a body.
  * While this could be calculated with polygon_centroid(), that becomes too slow
@@ -182,6 +375,9 @@ void body_rotate_about(body_t *body, double angle, vector_t point);
 
 /**
  * @brief adds a vertex to the body
+ * The vertex is in world space and is owned by the body afterwards.
+ * Recomputes the body's centroid, so it is meant for building shapes,
+ * not for every tick.
  *
  * @param body a pointer to a body returned from body_init()
  * @param vector a vector representing the vertex to be added to the body
@@ -192,6 +388,7 @@ void body_add_vertex(body_t *body, vector_t *vector);
  * Applies a force to a body over the current tick.
  * If multiple forces are applied in the same tick, they should be added.
  * Should not change the body's position or velocity; see body_tick().
+ * Static bodies never move, so they ignore it.
  *
  * @param body a pointer to a body returned from body_init()
  * @param force the force vector to apply
@@ -204,6 +401,7 @@ void body_add_force(body_t *body, vector_t force);
  * which is useful for modeling collisions.
  * If multiple impulses are applied in the same tick, they should be added.
  * Should not change the body's position or velocity; see body_tick().
+ * Static bodies never move, so they ignore it.
  *
  * @param body a pointer to a body returned from body_init()
  * @param impulse the impulse vector to apply
@@ -218,12 +416,36 @@ void body_add_impulse(body_t *body, vector_t impulse);
 void body_remove_all_forces(body_t *body);
 
 void body_remove_x_forces(body_t *body);
+/**
+ * Computes how far body_tick() would move the body over a time interval,
+ * given the forces and impulses accumulated so far.
+ * Does not change the body.
+ *
+ * @param body the body to predict
+ * @param dt the number of seconds the tick would last
+ * @return the translation of the body's centroid over the tick
+ */
+vector_t body_get_tick_displacement(body_t *body, double dt);
+
+/**
+ * Computes the velocity body_tick() would leave the body with,
+ * given the forces and impulses accumulated so far.
+ * Resting bodies report zero and kinematic bodies keep their velocity.
+ * Does not change the body.
+ *
+ * @param body the body to predict
+ * @param dt the number of seconds the tick would last
+ * @return the body's velocity at the end of the tick
+ */
+vector_t body_get_tick_velocity(body_t *body, double dt);
+
 /**
  * Updates the body after a given time interval has elapsed.
  * Sets acceleration and velocity according to the forces and impulses
  * applied to the body during the tick.
  * The body should be translated at the *average* of the velocities before
  * and after the tick.
+ * Kinematic bodies keep their velocity and static bodies do not move.
  * Resets the forces and impulses accumulated on the body.
  *
  * @param body the body to tick
@@ -250,6 +472,28 @@ void body_remove(body_t *body);
  */
 bool body_is_removed(body_t *body);
 
+/**
+ * Records the state of a body.
+ *
+ * @param body the body to save
+ * @return its state, to pass to body_restore()
+ */
+body_state_t body_save(body_t *body);
+
+/**
+ * Puts a body back in a state recorded by body_save().
+ *
+ * @param body the body to restore
+ * @param state a state saved from the same body
+ */
+void body_restore(body_t *body, const body_state_t *state);
+
+/**
+ * Returns whether two body states are exactly the same, so restoring one over
+ * the other would change nothing.
+ */
+bool body_state_equal(const body_state_t *state1, const body_state_t *state2);
+
 void body_set_shape(body_t *body, list_t *shape);
 void body_set_rotation_center(body_t *body, vector_t center);
 void body_set_rot_acceleration(body_t *body, double rot_acceleration);
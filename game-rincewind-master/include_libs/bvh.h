@@ -0,0 +1,125 @@
+#ifndef __BVH_H__
+#define __BVH_H__
+
+#include "body.h"
+#include "collision.h"
+#include "list.h"
+#include <stdint.h>
+
+/**
+ * An immutable bounding volume hierarchy over a set of bodies that never
+ * move, such as a map's platforms and walls.
+ * The tree is built once with the surface area heuristic and stored as one
+ * contiguous array of nodes in depth-first order.
+ */
+typedef struct bvh bvh_t;
+
+/**
+ * A function called for each body a query finds, with the query's aux value.
+ */
+typedef void (*bvh_visitor_t)(body_t *body, void *aux);
+
+/**
+ * A node of a hierarchy in a fixed-size form that can be written to a file
+ * and loaded back without building the tree again (see bvh_bake()).
+ */
+typedef struct bvh_baked_node {
+  aabb_t box;
+  // As in the hierarchy: the first item of a leaf, or an internal node's
+  // right child
+  uint32_t offset;
+  // Number of items in a leaf, or 0 for internal nodes
+  uint32_t count;
+} bvh_baked_node_t;
+
+/**
+ * An item of a baked hierarchy: a body, by its index in the list the
+ * hierarchy is loaded with, and its bounding box.
+ */
+typedef struct bvh_baked_item {
+  aabb_t box;
+  uint32_t body;
+  uint32_t padding;
+} bvh_baked_item_t;
+
+/**
+ * Builds a hierarchy over the given bodies, using their current bounding
+ * boxes. The bodies must not move or be freed while the hierarchy is in use.
+ *
+ * @param bodies a list of body_t pointers; the list is not kept or freed
+ * @return the new hierarchy
+ */
+bvh_t *bvh_init(list_t *bodies);
+
+/**
+ * Checks that baked nodes form a hierarchy, as bvh_bake() writes them: a
+ * tree in depth-first order, whose children all come after their parents and
+ * whose leaves cover the items in order, each once. Nodes read from a file
+ * should be checked before they are loaded.
+ *
+ * @param nodes the baked nodes
+ * @param node_count the number of nodes
+ * @param item_count the number of items the leaves should cover
+ * @return whether the nodes form a hierarchy over the items
+ */
+bool bvh_baked_is_valid(const bvh_baked_node_t *nodes, size_t node_count,
+                        size_t item_count);
+
+/**
+ * Loads a hierarchy baked by bvh_bake(), without building it or computing
+ * any bounding boxes. The bodies must be where they were when it was baked.
+ *
+ * @param bodies the bodies the items refer to, by index; the list is not kept
+ * or freed
+ * @param nodes the baked nodes, in depth-first order
+ * @param node_count the number of nodes
+ * @param items the baked items
+ * @param item_count the number of items
+ * @return the new hierarchy, or NULL if the nodes do not form one (see
+ * bvh_baked_is_valid()) or an item refers to a body past the end of bodies
+ */
+bvh_t *bvh_init_baked(list_t *bodies, const bvh_baked_node_t *nodes,
+                      size_t node_count, const bvh_baked_item_t *items,
+                      size_t item_count);
+
+/**
+ * Releases a hierarchy. Does not free its bodies.
+ *
+ * @param bvh a pointer to a hierarchy returned from bvh_init()
+ */
+void bvh_free(bvh_t *bvh);
+
+/**
+ * Gets the number of bodies in a hierarchy.
+ *
+ * @param bvh a pointer to a hierarchy returned from bvh_init()
+ * @return the number of bodies it was built with
+ */
+size_t bvh_size(bvh_t *bvh);
+
+/** Returns the number of nodes in a hierarchy, for bvh_bake() */
+size_t bvh_node_count(bvh_t *bvh);
+
+/**
+ * Writes out a hierarchy so bvh_init_baked() can load it later.
+ *
+ * @param bvh a pointer to a hierarchy returned from bvh_init()
+ * @param bodies the list it was built with; items refer to bodies by their
+ * index in it
+ * @param nodes set to the nodes; room for bvh_node_count() of them
+ * @param items set to the items; room for bvh_size() of them
+ */
+void bvh_bake(bvh_t *bvh, list_t *bodies, bvh_baked_node_t *nodes,
+              bvh_baked_item_t *items);
+
+/**
+ * Calls visit on every body whose bounding box overlaps a box.
+ *
+ * @param bvh a pointer to a hierarchy returned from bvh_init()
+ * @param box the box to look in
+ * @param visit the function to call on each body found
+ * @param aux passed through to visit
+ */
+void bvh_query(bvh_t *bvh, aabb_t box, bvh_visitor_t visit, void *aux);
+
+#endif // #ifndef __BVH_H__
@@ -19,8 +19,130 @@ typedef struct {
    * If collided is false, this value is undefined.
    */
   vector_t axis;
+  /**
+   * If the shapes are colliding, how far they overlap along the axis.
+   * If collided is false, this value is undefined.
+   */
+  double depth;
 } collision_info_t;
 
+/** The most points a contact manifold between two polygons can have */
+#define MAX_MANIFOLD_POINTS 2
+
+/**
+ * One point where two overlapping polygons touch.
+ */
+typedef struct {
+  /** Where the point is, on the surface of the incident shape */
+  vector_t point;
+  /** How far the shapes overlap at this point, along the manifold's normal */
+  double depth;
+  /**
+   * Identifies the pair of edges/vertices that produced the point.
+   * The same features produce the same id from one tick to the next,
+   * so per-point state (e.g. accumulated impulses) can be carried over.
+   */
+  size_t id;
+} contact_point_t;
+
+/**
+ * The set of points where two overlapping polygons touch.
+ */
+typedef struct {
+  /** Number of valid entries in points (0 if the shapes do not overlap) */
+  size_t point_count;
+  /** Unit vector pointing from the first shape towards the second */
+  vector_t normal;
+  contact_point_t points[MAX_MANIFOLD_POINTS];
+} contact_manifold_t;
+
+/**
+ * An axis-aligned bounding box, given by its bottom left and top right corners.
+ */
+typedef struct {
+  vector_t min;
+  vector_t max;
+} aabb_t;
+
+/**
+ * Where a line segment first crosses the boundary of a polygon.
+ */
+typedef struct {
+  /** Whether the segment crosses the polygon's boundary */
+  bool hit;
+  /**
+   * If hit, the fraction of the way from the segment's start to its end
+   * (between 0 and 1) at which it first crosses the boundary.
+   */
+  double fraction;
+  /** If hit, where the boundary is first touched */
+  vector_t point;
+  /**
+   * If hit, the unit normal of the surface that was hit,
+   * pointing back against the direction of motion.
+   */
+  vector_t normal;
+} segment_hit_t;
+
+/**
+ * Returns whether two boxes overlap. Boxes that only touch count as
+ * overlapping.
+ *
+ * @param box1 the first box
+ * @param box2 the second box
+ * @return whether the boxes share any point
+ */
+bool aabb_overlaps(aabb_t box1, aabb_t box2);
+
+/**
+ * Computes the smallest box containing two boxes.
+ *
+ * @param box1 the first box
+ * @param box2 the second box
+ * @return the box bounding both
+ */
+aabb_t aabb_union(aabb_t box1, aabb_t box2);
+
+/**
+ * Computes when a box moving in a straight line first touches a still box.
+ * Boxes that already overlap are ignored, so callers check for that first
+ * with aabb_overlaps(). Two moving boxes, e.g. bullets, can be tested by
+ * moving one by the difference of their displacements.
+ *
+ * @param moving the box at the start of its motion
+ * @param displacement how far the moving box travels
+ * @param still the box it may hit
+ * @return the fraction of the displacement (between 0 and 1) travelled
+ *   before the boxes touch, or INFINITY if they do not touch in that time
+ */
+double find_time_of_impact(aabb_t moving, vector_t displacement, aabb_t still);
+
+/**
+ * Casts a line segment against a polygon's edges.
+ * A segment that starts inside the polygon only hits it on the way out.
+ *
+ * @param shape the polygon, wound either way
+ * @param start where the segment starts
+ * @param end where the segment ends
+ * @return the first edge the segment crosses, if any
+ */
+segment_hit_t find_segment_hit(list_t *shape, vector_t start, vector_t end);
+
+/**
+ * Casts a convex polygon along a straight line against another convex
+ * polygon. Either a vertex of the moving shape crosses an edge of the still
+ * shape, or a vertex of the still shape crosses an edge of the moving one;
+ * the earliest of these is the hit.
+ * Shapes that already overlap hit at fraction 0.
+ *
+ * @param moving the moving shape at the start of its motion
+ * @param displacement how far the moving shape travels
+ * @param still the shape it may hit
+ * @return the first contact between the shapes, if any
+ */
+segment_hit_t find_shape_hit(list_t *moving, vector_t displacement,
+                             list_t *still);
+
 /**
  * Computes the status of the collision between two convex polygons.
  * The shapes are given as lists of vertices in counterclockwise order.
@@ -34,4 +156,26 @@ typedef struct {
  */
 collision_info_t find_collision(list_t *shape1, list_t *shape2);
 
+/**
+ * Computes the contact points between two overlapping convex polygons.
+ * Uses the axis of least penetration found by the separating axis test as
+ * the reference edge and clips the most opposed edge of the other shape
+ * against it, producing up to MAX_MANIFOLD_POINTS points.
+ * Shapes may be wound either way.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @return the contact manifold, with no points if the shapes do not overlap
+ */
+contact_manifold_t find_contact_manifold(list_t *shape1, list_t *shape2);
+
+/**
+ * Gets how many narrow-phase tests have been run: calls to find_collision(),
+ * find_contact_manifold(), find_segment_hit() and find_shape_hit().
+ * Take the difference of two calls to count the tests in between.
+ *
+ * @return the number of tests run on the calling thread since it started
+ */
+size_t collision_test_count(void);
+
 #endif // #ifndef __COLLISION_H__
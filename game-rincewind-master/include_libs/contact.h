@@ -0,0 +1,107 @@
+#ifndef __CONTACT_H__
+#define __CONTACT_H__
+
+#include "body.h"
+#include "collision.h"
+#include <stdbool.h>
+
+/**
+ * A persistent contact constraint between two bodies.
+ * Each tick the contact rebuilds its manifold, carries over the impulses
+ * accumulated at points that still exist (warm starting), and is then solved
+ * together with the scene's other contacts by sequential impulses.
+ */
+typedef struct contact contact_t;
+
+/**
+ * The part of a contact that carries over from one tick to the next: its
+ * last manifold and the impulses accumulated at each of its points.
+ */
+typedef struct contact_state {
+  contact_manifold_t manifold;
+  double impulses[MAX_MANIFOLD_POINTS];
+} contact_state_t;
+
+/**
+ * Allocates a contact between two bodies.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param elasticity the coefficient of restitution of impacts between them
+ * @return the new contact
+ */
+contact_t *contact_init(body_t *body1, body_t *body2, double elasticity);
+
+/**
+ * Gets the second body passed to contact_init().
+ *
+ * @param contact a pointer to a contact returned from contact_init()
+ * @return the contact's second body
+ */
+body_t *contact_get_body2(contact_t *contact);
+
+/**
+ * Reuses a contact for another pair of bodies, as if it had just been
+ * returned from contact_init(), so contacts can be pooled.
+ *
+ * @param contact a pointer to a contact returned from contact_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param elasticity the coefficient of restitution of impacts between them
+ */
+void contact_reset(contact_t *contact, body_t *body1, body_t *body2,
+                   double elasticity);
+
+/**
+ * Releases the memory allocated for a contact. Does not free its bodies.
+ *
+ * @param contact a pointer to a contact returned from contact_init()
+ */
+void contact_free(contact_t *contact);
+
+/**
+ * Returns whether either of the contact's bodies has been removed.
+ *
+ * @param contact a pointer to a contact returned from contact_init()
+ * @return whether the contact should be dropped
+ */
+bool contact_is_removed(contact_t *contact);
+
+/**
+ * Rebuilds the contact's manifold for the current tick and applies the
+ * impulses cached from the previous tick to its bodies.
+ * Must be called after all forces for the tick have been applied,
+ * and before contact_solve().
+ *
+ * @param contact a pointer to a contact returned from contact_init()
+ * @param dt the number of seconds in the current tick
+ */
+void contact_prepare(contact_t *contact, double dt);
+
+/**
+ * Runs one sequential-impulse iteration on the contact, pushing its bodies'
+ * end-of-tick velocities towards not approaching each other.
+ *
+ * @param contact a pointer to a contact returned from contact_init()
+ * @param dt the number of seconds in the current tick
+ */
+void contact_solve(contact_t *contact, double dt);
+
+/**
+ * Records what a contact carries over to the next tick.
+ *
+ * @param contact a pointer to a contact returned from contact_init()
+ * @return its state, to pass to contact_restore()
+ */
+contact_state_t contact_save(contact_t *contact);
+
+/**
+ * Puts back what a contact carries over to the next tick, as recorded by
+ * contact_save() from a contact between the same bodies.
+ *
+ * @param contact a pointer to a contact returned from contact_init()
+ * @param state the state to restore
+ */
+void contact_restore(contact_t *contact, const contact_state_t *state);
+
+#endif // #ifndef __CONTACT_H__
@@ -5,6 +5,8 @@
 #include "collision.h"
 #include "vector.h"
 
+typedef struct scene scene_t;
+
 /**
  * A function called when a collision occurs.
  * @param body1 the first body passed to create_collision()
@@ -16,12 +18,39 @@
 typedef void (*collision_handler_t)(body_t *body1, body_t *body2, vector_t axis,
                                     void *aux);
 
+/**
+ * Whether a collision event marks two bodies starting to touch,
+ * still touching, or no longer touching.
+ */
+typedef enum collision_phase {
+  COLLISION_BEGIN,
+  COLLISION_PERSIST,
+  COLLISION_END
+} collision_phase_t;
+
+/**
+ * The result of testing one pair registered with create_collision().
+ * Collision force creators only record these; the scene dispatches the
+ * handlers afterwards (see scene_tick()).
+ */
+typedef struct collision_event {
+  /** The handler passed to create_collision() */
+  collision_handler_t handler;
+  body_t *body1;
+  body_t *body2;
+  /** Unit vector pointing from body1 towards body2 (undefined on end) */
+  vector_t axis;
+  /** How far the bodies overlap along the axis (undefined on end) */
+  double depth;
+  collision_phase_t phase;
+  /** The auxiliary value passed to create_collision() */
+  void *aux;
+} collision_event_t;
+
 typedef struct force_aux_2bodies force_aux_2bodies_t;
 
 typedef struct force_aux_1body force_aux_1body_t;
 
-typedef struct force_aux_collision_bodies force_aux_collision_bodies_t;
-
 typedef struct force_aux_collision force_aux_collision_t;
 
 typedef struct collision_aux_destructive collision_aux_destructive_t;
@@ -33,10 +62,8 @@ force_aux_1body_t *force_aux_1body_init(double constant, body_t *body);
 force_aux_2bodies_t *force_aux_2bodies_init(double constant, body_t *body1,
                                             body_t *body2);
 
-force_aux_collision_bodies_t *force_aux_collision_bodies_init(body_t *body1,
-                                                              body_t *body_2);
-
-force_aux_collision_t *force_aux_collision_init(body_t *body1, body_t *body2,
+force_aux_collision_t *force_aux_collision_init(scene_t *scene, body_t *body1,
+                                                body_t *body2,
                                                 collision_handler_t handler,
                                                 void *aux, free_func_t freer);
 
@@ -53,8 +80,6 @@ void calc_spring(void *aux);
 
 void calc_drag(void *aux);
 
-void calc_normal_force(void *void_aux);
-
 void calc_collision(void *aux);
 
 void calc_destructive_collision(body_t *body1, body_t *body2, vector_t axis,
@@ -63,8 +88,12 @@ void calc_destructive_collision(body_t *body1, body_t *body2, vector_t axis,
 void calc_physics_collision(body_t *body1, body_t *body2, vector_t axis,
                             void *aux);
 
+/** Frees an aux allocated with malloc() */
 void standard_free_aux(void *aux);
 
+/** Frees an aux allocated with track_malloc(), like the ones made here */
+void tracked_free_aux(void *aux);
+
 void free_aux_collision(void *aux);
 
 #endif // #ifndef __FORCE_CREATOR_H__
\ No newline at end of file
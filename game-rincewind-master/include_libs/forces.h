@@ -118,6 +118,31 @@ void create_delayed_destructive_collision(scene_t *scene, body_t *body1,
 void create_physics_collision(scene_t *scene, double elasticity, body_t *body1,
                               body_t *body2);
 
-void create_normal_force(scene_t *scene, body_t *body1, body_t *body2);
+/**
+ * Adds a contact between two bodies to the scene's contact solver.
+ * Unlike create_physics_collision(), resting bodies stay in place without
+ * jitter, even when stacked and at a large dt; impacts bounce with the given
+ * elasticity.
+ *
+ * @param scene the scene containing the bodies
+ * @param elasticity the "coefficient of restitution" of impacts
+ * @param body1 the first body
+ * @param body2 the second body
+ */
+void create_contact(scene_t *scene, double elasticity, body_t *body1,
+                    body_t *body2);
+
+/**
+ * Adds contacts between a body and every static body of the given types,
+ * found near the body each tick rather than bound one by one
+ * (see scene_add_static_contacts()).
+ *
+ * @param scene the scene containing the bodies
+ * @param elasticity the "coefficient of restitution" of impacts
+ * @param body the body to keep out of the static bodies
+ * @param mask the body types it collides with (see BODY_MASK())
+ */
+void create_static_contacts(scene_t *scene, double elasticity, body_t *body,
+                            uint32_t mask);
 
 #endif // #ifndef __FORCES_H__
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef __LIST_H__
 #define __LIST_H__
 
+#include "arena.h"
 #include <stddef.h>
 
 /**
@@ -28,6 +29,19 @@ typedef void (*free_func_t)(void *);
  */
 list_t *list_init(size_t initial_size, free_func_t freer);
 
+/**
+ * Acts like list_init(), but takes the list and its array from an arena, so
+ * they are freed with the arena rather than by list_free(). The list still
+ * grows as needed, leaving its old arrays in the arena.
+ *
+ * @param arena the arena to allocate from, or NULL to act like list_init()
+ * @param initial_size the number of elements to allocate space for
+ * @param freer if non-NULL, a function to call on elements in the list
+ *   in list_free() when they are no longer in use
+ * @return a pointer to the newly allocated list
+ */
+list_t *list_init_in(arena_t *arena, size_t initial_size, free_func_t freer);
+
 /**
  * Creates a rectangle with the given width and height, centered at (0, 0)
  * Adds top-left corner first, then counter-clockwise
@@ -46,7 +60,8 @@ list_t *circle_init(double radius, size_t points);
 list_t *polygon_init(double radius, size_t num_of_points);
 
 /**
- * Releases the memory allocated for a list.
+ * Releases the memory allocated for a list. A list from an arena keeps its
+ * memory until the arena is freed, but its elements are still freed.
  *
  * @param list a pointer to a list returned from list_init()
  */
@@ -0,0 +1,106 @@
+#ifndef __NET_H__
+#define __NET_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Largest datagram sent or received, small enough to avoid fragmentation */
+#define NET_MAX_PACKET 1200
+
+/** An IPv4 address and port, both in host byte order */
+typedef struct net_address {
+  uint32_t host;
+  uint16_t port;
+} net_address_t;
+
+/**
+ * A non-blocking UDP socket.
+ * A socket can also simulate a bad connection for testing: with
+ * net_socket_simulate(), every datagram it sends is delayed by a number of
+ * ticks and may be lost on the way.
+ */
+typedef struct net_socket net_socket_t;
+
+/**
+ * Gets the address of a port on this machine.
+ *
+ * @param port the port
+ * @return the address of the port on the loopback interface
+ */
+net_address_t net_address_loopback(uint16_t port);
+
+/** Returns whether two addresses are the same */
+bool net_address_equal(net_address_t address1, net_address_t address2);
+
+/**
+ * Opens a socket bound to a port on the loopback interface.
+ *
+ * @param port the port to bind, or 0 to let the system pick a free one
+ * @return the new socket, or NULL if the port could not be bound
+ */
+net_socket_t *net_socket_open(uint16_t port);
+
+/**
+ * Closes a socket, dropping any datagrams its simulation is still holding.
+ *
+ * @param sock a pointer to a socket returned from net_socket_open()
+ */
+void net_socket_close(net_socket_t *sock);
+
+/** Returns the port a socket is bound to */
+uint16_t net_socket_port(net_socket_t *sock);
+
+/**
+ * Sends a datagram. Delivery is not guaranteed, as with any UDP datagram.
+ *
+ * @param sock a pointer to a socket returned from net_socket_open()
+ * @param to the address to send to
+ * @param data the datagram
+ * @param size the size of the datagram, at most NET_MAX_PACKET
+ */
+void net_socket_send(net_socket_t *sock, net_address_t to, const void *data,
+                     size_t size);
+
+/**
+ * Receives the next datagram that has arrived, without waiting.
+ *
+ * @param sock a pointer to a socket returned from net_socket_open()
+ * @param from set to the address the datagram came from
+ * @param buffer where to copy the datagram
+ * @param capacity the size of the buffer; longer datagrams are cut short
+ * @return the size of the datagram, or 0 if none has arrived
+ */
+size_t net_socket_receive(net_socket_t *sock, net_address_t *from,
+                          void *buffer, size_t capacity);
+
+/**
+ * Makes a socket simulate a bad connection for every datagram it sends
+ * from now on. Time is counted in calls to net_socket_pump().
+ *
+ * @param sock a pointer to a socket returned from net_socket_open()
+ * @param latency how many ticks each datagram is held before being sent
+ * @param loss the chance, from 0 to 1, that a datagram is dropped
+ * @param seed seeds the random losses, so a test always loses the same ones
+ */
+void net_socket_simulate(net_socket_t *sock, size_t latency, double loss,
+                         uint32_t seed);
+
+/**
+ * Advances a simulating socket by one tick, sending the datagrams whose
+ * delay has passed. Does nothing for a socket that is not simulating.
+ *
+ * @param sock a pointer to a socket returned from net_socket_open()
+ */
+void net_socket_pump(net_socket_t *sock);
+
+/**
+ * Gets the number of bytes a socket has been asked to send, including
+ * datagrams its simulation went on to drop.
+ *
+ * @param sock a pointer to a socket returned from net_socket_open()
+ * @return the total size of every datagram passed to net_socket_send()
+ */
+size_t net_socket_bytes_sent(net_socket_t *sock);
+
+#endif // #ifndef __NET_H__
@@ -2,9 +2,12 @@
 #define __SCENE_H__
 
 #include "body.h"
+#include "bvh.h"
+#include "contact.h"
 #include "force_creator.h"
 #include "list.h"
 #include "sprites.h"
+#include <stdint.h>
 
 /**
  * A collection of bodies and force creators.
@@ -22,18 +25,85 @@ typedef void (*force_creator_t)(void *aux);
 
 typedef struct sprite sprite_t;
 
+/** The scene's store of bullets (see scene_get_projectiles()) */
+typedef struct projectiles projectiles_t;
+
+/**
+ * A saved copy of a scene's changing state (see scene_save()).
+ */
+typedef struct scene_state scene_state_t;
+
+/** The most body types a scene can index, one per bit of a query mask */
+#define SCENE_MAX_BODY_TYPES 32
+
+/**
+ * Selects a body type in a query mask,
+ * e.g. BODY_MASK(WALL) | BODY_MASK(GROUND)
+ */
+#define BODY_MASK(type) ((uint32_t)1 << (type))
+/** Query mask matching every body type */
+#define BODY_MASK_ALL UINT32_MAX
+
+/**
+ * Gets the type a scene indexes a body under (see scene_init_with_types()).
+ * Types at or past the scene's type count leave the body out of the index.
+ */
+typedef size_t (*body_type_getter_t)(body_t *body);
+
+/**
+ * The first body a ray or shape cast runs into.
+ */
+typedef struct {
+  body_t *body;
+  /** Where the body was hit */
+  vector_t point;
+  /** Unit normal of the body's surface at the hit, facing the cast */
+  vector_t normal;
+  /** How far the cast travelled before the hit */
+  double distance;
+} scene_hit_t;
+
+/**
+ * Work done by the last scene_tick(), for profiling.
+ */
+typedef struct {
+  size_t bodies;
+  size_t force_binds;
+  /** Narrow-phase shape tests run (see collision_test_count()) */
+  size_t pair_tests;
+  /** Static contact sets that searched the static bodies for new contacts;
+   * sets of sleeping bodies keep the contacts they had */
+  size_t static_queries;
+  /** Time the tick took, in seconds, or 0 unless it was timed (see
+   * scene_set_timed()) */
+  double tick_time;
+} scene_stats_t;
+
 /**
  * Allocates memory for an empty scene.
  * Makes a reasonable guess of the number of bodies to allocate space for.
  * Asserts that the required memory is successfully allocated.
+ * The scene has no body types, so it indexes none of its bodies.
  *
  * @return the new scene
  */
 scene_t *scene_init(void);
 
+/**
+ * Allocates memory for an empty scene that indexes its bodies by type, for
+ * scene_first_of_type(), query masks, and static contacts.
+ *
+ * @param type_count the number of body types, at most SCENE_MAX_BODY_TYPES
+ * @param get_type gets the type of each body added to the scene
+ * @return the new scene
+ */
+scene_t *scene_init_with_types(size_t type_count,
+                               body_type_getter_t get_type);
+
 /**
  * Releases memory allocated for a given scene
- * and all the bodies and force creators it contains.
+ * and all the bodies and force creators it contains,
+ * except the bodies shared from another scene (see scene_share_body()).
  *
  * @param scene a pointer to a scene returned from scene_init()
  */
@@ -47,7 +117,6 @@ void scene_free(scene_t *scene);
  */
 size_t scene_bodies(scene_t *scene);
 
-void sprite_list_init(scene_t *scene);
 void sprite_list_update(scene_t *scene);
 void scene_add_sprite(scene_t *scene, sprite_t *sprite);
 void scene_remove_sprite(scene_t *scene, size_t index);
@@ -66,12 +135,67 @@ body_t *scene_get_body(scene_t *scene, size_t index);
 
 /**
  * Adds a body to a scene.
+ * Bodies of one of the scene's types are also indexed by their type.
  *
  * @param scene a pointer to a scene returned from scene_init()
  * @param body a pointer to the body to add to the scene
  */
 void scene_add_body(scene_t *scene, body_t *body);
 
+/**
+ * Adds another scene's static body to a scene without copying it, e.g. to
+ * build a fork of the other scene that reads its static bodies (see
+ * scene_fork()). The body stays the other scene's: the scene neither changes
+ * nor frees it, nor may it be removed from the scene. The scene must not be
+ * ticked once the other scene is freed, but can still be freed itself.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param owner the scene the body belongs to
+ * @param index the index of a static body in the owner
+ */
+void scene_share_body(scene_t *scene, scene_t *owner, size_t index);
+
+/**
+ * Gets the number of bodies of a given type in a scene.
+ * Bodies stay counted until scene_tick() frees them after body_remove().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param type the body type to count
+ * @return the number of bodies of that type
+ */
+size_t scene_bodies_of_type(scene_t *scene, size_t type);
+
+/**
+ * Gets the body at a given index among the bodies of one type,
+ * in the order they were added to the scene.
+ * Together with scene_bodies_of_type(), iterates over all bodies of a type.
+ * Asserts that the index is valid.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param type the body type
+ * @param index the index among bodies of that type (starting at 0)
+ * @return a pointer to the body
+ */
+body_t *scene_get_body_of_type(scene_t *scene, size_t type, size_t index);
+
+/**
+ * Gets the first body of a given type in a scene without scanning it.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param type the body type to look for
+ * @return the first body of that type, or NULL if there is none
+ */
+body_t *scene_first_of_type(scene_t *scene, size_t type);
+
+/**
+ * Gets the first sprite whose body has a given type without scanning.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param type the body type to look for
+ * @return the first such sprite, or NULL if there is none
+ */
+sprite_t *scene_first_sprite_of_type(scene_t *scene, size_t type);
+
 /**
  * @deprecated Use body_remove() instead
  *
@@ -109,10 +233,310 @@ void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
                                     void *aux, list_t *bodies,
                                     free_func_t freer);
 
+/**
+ * Records the outcome of a collision test for dispatch later in the tick.
+ * Called by the force creator added in create_collision(), which never
+ * changes the bodies itself.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param event the collision event to queue
+ */
+void scene_add_collision_event(scene_t *scene, collision_event_t event);
+
+/**
+ * Gets the number of collision events recorded during the last tick.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the number of collision events
+ */
+size_t scene_collision_events(scene_t *scene);
+
+/**
+ * Gets a collision event recorded during the last tick.
+ * Events are grouped by handler, in the order their handlers were dispatched.
+ * Asserts that the index is valid.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param index the index of the event
+ * @return the collision event
+ */
+collision_event_t scene_get_collision_event(scene_t *scene, size_t index);
+
+/**
+ * Adds a persistent contact between two bodies to the scene's contact solver.
+ * The bodies are kept from overlapping and bounce off each other with the
+ * given elasticity; resting contact needs no separate normal force.
+ * The contact is dropped when either body is removed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param elasticity the coefficient of restitution of impacts between them
+ */
+void scene_add_contact(scene_t *scene, body_t *body1, body_t *body2,
+                       double elasticity);
+
+/**
+ * Keeps a body from overlapping the static bodies of the given types,
+ * including ones added later. Each tick, contacts are made with just the
+ * static bodies near the body (see scene_build_static_bvh()) and solved
+ * alongside the scene's other contacts; contacts that stay close are kept
+ * between ticks. While the body sleeps, it keeps the contacts it had
+ * without searching again. The set is dropped when the body is removed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body the body to keep out of the static bodies
+ * @param mask the body types it collides with (see BODY_MASK())
+ * @param elasticity the coefficient of restitution of its impacts with them
+ */
+void scene_add_static_contacts(scene_t *scene, body_t *body, uint32_t mask,
+                               double elasticity);
+
+/**
+ * Builds a bounding volume hierarchy over the scene's static bodies, which
+ * speeds up raycasts, shapecasts, and static contacts.
+ * Call it once the level's geometry has been added. Static bodies added
+ * afterwards are still found, just without the hierarchy's help, and freeing
+ * a body in the hierarchy drops it until the next call.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ */
+void scene_build_static_bvh(scene_t *scene);
+
+/**
+ * Gives a scene a static hierarchy built ahead of time, e.g. baked into a map
+ * file, instead of building one (see scene_build_static_bvh()). It must hold
+ * exactly the scene's live static bodies. The scene takes ownership of it.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param bvh the hierarchy over the scene's static bodies
+ */
+void scene_set_static_bvh(scene_t *scene, bvh_t *bvh);
+
+/**
+ * Gives a scene another scene's static hierarchy, once the scene holds
+ * exactly the other scene's static bodies, shared in the same order (see
+ * scene_share_body()). The hierarchy stays the other scene's, with the same
+ * lifetime rules as the bodies.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param owner a scene with a static hierarchy
+ */
+void scene_share_static_bvh(scene_t *scene, scene_t *owner);
+
+/**
+ * Gets an arena that lives as long as the scene, for bodies that stay in it
+ * until it is freed, e.g. those loaded from a map file (see body_init_in()).
+ * It is made the first time it is asked for, and freed by scene_free() after
+ * the scene's bodies.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the scene's arena
+ */
+arena_t *scene_get_arena(scene_t *scene);
+
+/**
+ * Sets how many sequential-impulse iterations the contact solver runs per
+ * tick. More iterations make stacks stiffer at a higher cost.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param iterations the number of iterations, at least 1
+ */
+void scene_set_contact_iterations(scene_t *scene, size_t iterations);
+
+/**
+ * Gets the bullets flying through the scene.
+ * They are owned by the scene and moved by scene_tick().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the scene's projectile store
+ */
+projectiles_t *scene_get_projectiles(scene_t *scene);
+
+/**
+ * Finds the first body a ray hits.
+ * Only live bodies indexed under a type in mask are considered.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param origin where the ray starts
+ * @param dir the direction of the ray; need not be a unit vector
+ * @param max_dist how far the ray reaches
+ * @param mask the body types the ray can hit (see BODY_MASK())
+ * @param hit set to the first hit, if there is one
+ * @return whether the ray hit anything
+ */
+bool scene_raycast(scene_t *scene, vector_t origin, vector_t dir,
+                   double max_dist, uint32_t mask, scene_hit_t *hit);
+
+/**
+ * Finds the first body a convex polygon hits when moved in a straight line.
+ * A body the polygon already overlaps is hit at distance 0.
+ * Only live bodies indexed under a type in mask are considered.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param shape the polygon, in world coordinates, at the start of its motion
+ * @param dir the direction the polygon moves; need not be a unit vector
+ * @param max_dist how far the polygon moves
+ * @param mask the body types the polygon can hit (see BODY_MASK())
+ * @param hit set to the first hit, if there is one
+ * @return whether the polygon hit anything
+ */
+bool scene_shapecast(scene_t *scene, list_t *shape, vector_t dir,
+                     double max_dist, uint32_t mask, scene_hit_t *hit);
+
+/**
+ * Gets the counters recorded by the last scene_tick().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the scene's counters, all zero before the first tick
+ */
+scene_stats_t scene_get_stats(scene_t *scene);
+
+/**
+ * Sets whether scene_tick() records how long it takes in its stats.
+ * Timing reads the clock twice a tick, so it is off until something shows
+ * the time, e.g. a profiling overlay. Headless builds never time ticks.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param timed whether to time each tick
+ */
+void scene_set_timed(scene_t *scene, bool timed);
+
+/**
+ * Draws the next number from a scene's own random number generator.
+ * Game rules use this instead of rand(), so that a restored scene makes the
+ * same random choices again (see scene_save()).
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return a pseudorandom 32 bit number
+ */
+uint32_t scene_random(scene_t *scene);
+
+/**
+ * Seeds a scene's random number generator. Every scene starts out with the
+ * same seed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param seed the seed
+ */
+void scene_seed_random(scene_t *scene, uint32_t seed);
+
+/**
+ * Allocates an empty buffer to save a scene into.
+ *
+ * @param info_size the size of the info of the scene's bodies, which is
+ * saved along with them
+ * @return the new buffer
+ */
+scene_state_t *scene_state_init(size_t info_size);
+
+/**
+ * Releases a scene state buffer.
+ *
+ * @param state a pointer to a buffer returned from scene_state_init()
+ */
+void scene_state_free(scene_state_t *state);
+
+/**
+ * Saves everything about a scene that changes as it is ticked: the state and
+ * info of every body, the impulses its contacts carry over, its bullets, and
+ * its random number generator.
+ * The buffer keeps the largest arrays it has needed, so saving only
+ * allocates when the scene is bigger than any scene saved into it before.
+ * Force creators are not saved, so their aux values must not change from
+ * tick to tick in a way that matters once restored. The collision state of
+ * the game's pickups and destructive collisions qualifies, since they remove
+ * a body as soon as it touches.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param state a pointer to a buffer returned from scene_state_init()
+ */
+void scene_save(scene_t *scene, scene_state_t *state);
+
+/**
+ * Returns whether a scene can be restored in place to a state saved from
+ * it: no body it had then has been freed since.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param state a pointer to a buffer passed to scene_save()
+ */
+bool scene_can_restore(scene_t *scene, const scene_state_t *state);
+
+/**
+ * Puts a scene back in a saved state.
+ * The scene's first bodies must be the ones that were saved, in the same
+ * order, or copies of them built the same way; bodies added after them are
+ * removed and freed, with their force creators. Either scene_can_restore()
+ * holds, or the scene was rebuilt to match the state.
+ * Restoring a scene in place allocates nothing.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param state a pointer to a buffer passed to scene_save()
+ */
+void scene_restore(scene_t *scene, const scene_state_t *state);
+
+/**
+ * Gets the number of bodies a saved scene had.
+ *
+ * @param state a pointer to a buffer passed to scene_save()
+ * @return the number of bodies saved
+ */
+size_t scene_state_bodies(const scene_state_t *state);
+
+/**
+ * Gets the info a saved body had, e.g. to rebuild the body.
+ *
+ * @param state a pointer to a buffer passed to scene_save()
+ * @param index the index of the body in the scene
+ * @return the saved info, or NULL if the body had none
+ */
+const void *scene_state_get_info(const scene_state_t *state, size_t index);
+
+/**
+ * Makes a scene built body for body like another one stand for it, so that
+ * scene_fork() copies the other scene into it. Each body must be one shared
+ * from the other scene (see scene_share_body()), or a copy of the other
+ * scene's body built the same way, with the same force creators.
+ *
+ * @param fork a pointer to a scene returned from scene_init()
+ * @param scene the scene the fork was built like
+ */
+void scene_mirror(scene_t *fork, scene_t *scene);
+
+/**
+ * Makes one scene a copy of another again, e.g. to look ahead from the
+ * other scene's current state. The fork must have been made a copy of the
+ * scene before, by restoring a state saved from it (see scene_restore()), by
+ * scene_mirror(), or by this function, and neither scene may have freed any
+ * of the copied bodies since; otherwise nothing is done.
+ * Only what changes as a scene is ticked is copied, as by a save and restore:
+ * the fork keeps its own shapes and force creators, and bodies that are
+ * already the same are left alone, so they keep their world shapes. Static
+ * bodies the fork shares with the scene are not copied at all. Bodies the
+ * fork added since are removed and freed. Allocates nothing unless the fork
+ * needs more contacts than it has had before.
+ *
+ * @param fork a pointer to a scene returned from scene_init()
+ * @param scene the scene to copy
+ * @param info_size the size of the info of the scenes' bodies, which is
+ * copied along with them
+ * @return whether the fork could be made a copy of the scene
+ */
+bool scene_fork(scene_t *fork, scene_t *scene, size_t info_size);
+
 /**
  * Executes a tick of a given scene over a small time interval.
  * This requires executing all the force creators
  * and then ticking each body (see body_tick()).
+ * Collision force creators only record events; once every force creator
+ * has run, touching bodies are woken and the handlers of new collisions are
+ * called, grouped by handler.
+ * Contacts are solved after the force creators run, so their impulses
+ * account for every force applied during the tick (see scene_add_contact()).
+ * Projectiles then move against the bodies' positions at the start of the
+ * tick, so bodies they destroy are removed in the same tick.
+ * Touching dynamic bodies are grouped into islands; an island that has been
+ * quiet for a while falls asleep and is skipped until something wakes it.
  * If any bodies are marked for removal, they should be removed from the scene
  * and freed, along with any force creators acting on them.
  *
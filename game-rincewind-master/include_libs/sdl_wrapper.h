@@ -47,19 +47,55 @@ typedef void (*key_handler_t)(char key, key_event_type_t type, double held_time,
 
 /**
  * Initializes the SDL window and renderer.
- * Must be called once before any of the other SDL functions.
+ * Must be called exactly once before any of the other SDL functions;
+ * use sdl_set_viewport() to show a differently sized scene afterwards.
  *
  * @param min the x and y coordinates of the bottom left of the scene
  * @param max the x and y coordinates of the top right of the scene
  */
 void sdl_init(vector_t min, vector_t max);
 
+/**
+ * Changes the region of the scene shown in the existing window.
+ * Does not touch the window or renderer, so it is cheap to call
+ * on every game state change. Cached sprite positions are invalidated.
+ *
+ * @param min the x and y coordinates of the bottom left of the scene
+ * @param max the x and y coordinates of the top right of the scene
+ */
+void sdl_set_viewport(vector_t min, vector_t max);
+
 void sdl_change_music(state_t *state, sound_t sound);
 
+/**
+ * Opens the audio device, sizes the voice pool and loads every sound.
+ * Must be called once; the device stays open until sdl_clean().
+ *
+ * @return the loaded sounds, indexed by sound_t; list_free() frees them
+ */
 list_t *sdl_load_sounds(void);
 
+/**
+ * Queues a sound effect to be played at the end of the frame.
+ * Nothing touches the mixer until sdl_flush_sounds() runs.
+ * If the queue is full, the request replaces a lower priority one
+ * or is dropped.
+ *
+ * @param state the game state holding the loaded sounds
+ * @param sound the sound effect to play
+ */
 void sdl_sound_effects(state_t *state, sound_t sound);
 
+/**
+ * Plays every sound effect queued this frame.
+ * Each effect is limited to a fixed number of overlapping voices;
+ * once it or the whole pool is at its limit, the oldest voice of the same
+ * or lower priority is stolen. Should be called once per frame.
+ *
+ * @param state the game state holding the loaded sounds
+ */
+void sdl_flush_sounds(state_t *state);
+
 void sdl_music(state_t *state, sound_t sound);
 
 void sdl_sprites_init(scene_t *scene, game_state_t state);
@@ -68,8 +104,21 @@ void sprite_img_init(scene_t *scene, game_state_t state);
 
 void sprite_img_add(scene_t *scene, body_t *body, game_state_t state);
 
+/**
+ * Shows a player's jumping or falling frame while the player is in the air.
+ * Frames on the ground change with sprite_img_advance().
+ */
 void sprite_img_update(sprite_t *sprite);
 
+/**
+ * Shows a player's next animation frame, unless the player is in the air.
+ * The game calls this from a timer, so frames change at a steady rate.
+ */
+void sprite_img_advance(sprite_t *sprite);
+
+/**
+ * Destroys the window and renderer created by sdl_init() and shuts SDL down.
+ */
 void sdl_clean(void);
 
 /**
@@ -109,7 +158,12 @@ void sdl_show(void);
  */
 void sdl_render_scene(scene_t *scene);
 
-/** sdl_render_scene but with sprites and body_types */
+/**
+ * sdl_render_scene but with sprites and body_types.
+ * Pressing F3 toggles a performance overlay showing recent frame times,
+ * the time spent ticking and drawing the last frame, the scene's counters
+ * (see scene_get_stats()), and allocations per frame in debug builds.
+ */
 void sdl_render_game(scene_t *scene);
 
 /**
@@ -4,8 +4,10 @@
 #include "body.h"
 #include "list.h"
 #include "vector.h"
+#ifndef HEADLESS
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
+#endif
 
 typedef struct sprite sprite_t;
 
@@ -17,29 +19,58 @@ void sprite_update(sprite_t *sprite);
 
 body_t *sprite_get_body(sprite_t *sprite);
 
-SDL_Rect *sprite_get_destR(sprite_t *sprite);
-
-void sprite_set_destR(sprite_t *sprite, SDL_Rect destR);
-
 bool sprite_is_removed(sprite_t *sprite);
 
 void sprite_free(sprite_t *sprite);
 
+// Built with -DHEADLESS, e.g. to simulate matches on a server, sprites only
+// remember their bodies: nothing below exists, and nothing needs SDL.
+#ifndef HEADLESS
+
+SDL_Rect *sprite_get_destR(sprite_t *sprite);
+
+void sprite_set_destR(sprite_t *sprite, SDL_Rect destR);
+
 vector_t get_window_center(void);
 
 vector_t get_window_position(vector_t scene_pos, vector_t window_center);
 
 double get_scene_scale(vector_t window_center);
 
+/**
+ * Gets a counter that changes whenever the mapping from scene coordinates to
+ * window pixels changes (window resized or new scene bounds).
+ * Sprites compare it against their cached value to know when to recompute
+ * their destination rects.
+ */
+size_t sdl_get_view_revision(void);
+
+/** Most animation frames a sprite can hold */
+#define SPRITE_MAX_FRAMES 4
+
 // Texture
-void sprite_add_tex(sprite_t *sprite, SDL_Texture *tex);
+/**
+ * Sets the texture the sprite's frames are cut from, normally an atlas
+ * texture. The sprite does not own the texture and never frees it.
+ */
+void sprite_set_texture(sprite_t *sprite, SDL_Texture *texture);
 
-SDL_Texture *sprite_get_tex(sprite_t *sprite, size_t index);
+SDL_Texture *sprite_get_texture(sprite_t *sprite);
 
-size_t sprite_textures(sprite_t *sprite);
+/**
+ * Appends an animation frame: a source rect within the sprite's texture.
+ * Asserts that the sprite has fewer than SPRITE_MAX_FRAMES frames.
+ */
+void sprite_add_frame(sprite_t *sprite, SDL_Rect region);
+
+SDL_Rect *sprite_get_frame(sprite_t *sprite, size_t index);
+
+size_t sprite_frames(sprite_t *sprite);
 
 void sprite_set_tex(sprite_t *sprite, size_t index);
 
 size_t sprite_get_curr_ind(sprite_t *sprite);
 
+#endif // #ifndef HEADLESS
+
 #endif // #ifndef __SPRITES_H__
\ No newline at end of file
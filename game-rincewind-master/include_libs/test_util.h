@@ -7,8 +7,12 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "match.h"
 #include "vector.h"
 
+/** Timing samples a benchmark keeps (see DO_BENCH()) */
+#define BENCH_SAMPLES 21
+
 /**
  * Returns whether two double values are nearly equal,
  * i.e. within 10 ** -7 of each other.
@@ -51,6 +55,13 @@ bool vec_within(double epsilon, vector_t v1, vector_t v2);
  */
 void read_testname(char *filename, char *testname, size_t testname_size);
 
+/**
+ * A scripted input for one player on a given tick, so both players of a match
+ * run back and forth, jump, and shoot.
+ * Different seeds give different scripts, e.g. one per match of a batch.
+ */
+player_input_t scripted_input(size_t seed, body_type_t player, size_t tick);
+
 /*
  * This macro checks whether to run the test function (which will be true
  * if the test is called without command-line arguments).
@@ -69,6 +80,68 @@ void read_testname(char *filename, char *testname, size_t testname_size);
     puts(#TEST_FN " PASS");                                                    \
   }
 
+/**
+ * The state of one benchmark: how many iterations are left in the current
+ * timing sample, and the samples taken so far.
+ * Only 'remaining' is read by BENCH_LOOP(); the rest is managed by
+ * bench_next_sample().
+ */
+typedef struct bench {
+  size_t remaining;
+  size_t iterations;
+  bool calibrated;
+  size_t warmups_left;
+  size_t samples_taken;
+  double sample_start;
+  double samples[BENCH_SAMPLES];
+  double median_ns;
+  double mad_ns;
+} bench_t;
+
+/**
+ * Returns a benchmark state ready for BENCH_LOOP().
+ */
+bench_t bench_init(void);
+
+/**
+ * Ends the current timing sample and starts the next one.
+ * The first samples double the iteration count until a sample takes at least
+ * a millisecond, then a few warmup samples are discarded, then
+ * BENCH_SAMPLES samples are kept.
+ * Returns false once they have all been taken, after computing the median
+ * time per iteration and its median absolute deviation.
+ */
+bool bench_next_sample(bench_t *bench);
+
+/**
+ * Prints a finished benchmark's result as one line of JSON:
+ * {"bench": name, "median_ns": ..., "mad_ns": ..., "iterations": ...,
+ *  "samples": ...}, where the times are per iteration.
+ */
+void bench_report(const char *name, bench_t *bench);
+
+/*
+ * Repeats the statement that follows it until the benchmark has been timed.
+ * Anything before the loop is setup, and is not timed:
+ *      scene_t *scene = make_scene(100);
+ *      BENCH_LOOP(bench) { scene_tick(scene, DT); }
+ *      scene_free(scene);
+ */
+#define BENCH_LOOP(BENCH)                                                      \
+  while ((BENCH)->remaining-- > 0 || bench_next_sample(BENCH))
+
+/*
+ * Like DO_TEST(), but for benchmarks, which are functions taking a bench_t *
+ * and timing their work with BENCH_LOOP().
+ * Prints the benchmark's result as JSON (see bench_report()).
+ */
+#define DO_BENCH(BENCH_FN)                                                     \
+  if (all_tests || strcmp(testname, #BENCH_FN) == 0) {                         \
+    bench_t bench = bench_init();                                              \
+    BENCH_FN(&bench);                                                          \
+    bench_report(#BENCH_FN, &bench);                                           \
+  }
+
 /**
  * Executes function 'run' and returns whether it causes an assertion failure,
  * as detected by a SIGABRT signal.
@@ -0,0 +1,90 @@
+#ifndef __TIMER_WHEEL_H__
+#define __TIMER_WHEEL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Schedules callbacks to run once some time has passed, without looking at
+ * each timer every frame. Time advances in ticks of a fixed length, and a
+ * timer fires on the first tick at or after its delay has passed.
+ *
+ * Timers sit in one of several wheels of slots. The first wheel has a slot
+ * per tick; each further wheel's slots span a whole turn of the one before,
+ * and their timers move down a wheel as their time draws near. Scheduling,
+ * cancelling, and firing a timer each take constant time, however many
+ * timers are pending.
+ */
+typedef struct timer_wheel timer_wheel_t;
+
+/**
+ * Identifies a scheduled timer. Once a timer fires or is cancelled, its ID is
+ * never reused, so holding on to it is always safe.
+ */
+typedef uint64_t timer_id_t;
+
+/** The ID of no timer; never pending */
+#define TIMER_NONE ((timer_id_t)0)
+
+/** A function run when a timer fires, with the timer's aux value */
+typedef void (*timer_callback_t)(void *aux);
+
+/**
+ * Allocates memory for an empty set of wheels.
+ *
+ * @param tick_length the length of a tick, in the units delays are given in
+ * @return the new timer wheel
+ */
+timer_wheel_t *timer_wheel_init(double tick_length);
+
+/**
+ * Releases a timer wheel. Pending timers are dropped without firing.
+ *
+ * @param wheel a pointer to a timer wheel returned from timer_wheel_init()
+ */
+void timer_wheel_free(timer_wheel_t *wheel);
+
+/**
+ * Schedules a timer. Delays shorter than a tick are rounded up to one, so a
+ * timer never fires on the tick it is scheduled in.
+ *
+ * @param wheel a pointer to a timer wheel returned from timer_wheel_init()
+ * @param delay how long from now the timer fires
+ * @param fire the function to run when it fires, or NULL for a timer that is
+ * only checked with timer_wheel_pending(), e.g. a cooldown
+ * @param aux the value to pass to fire
+ * @return the timer's ID
+ */
+timer_id_t timer_wheel_schedule(timer_wheel_t *wheel, double delay,
+                                timer_callback_t fire, void *aux);
+
+/**
+ * Cancels a timer, if it is still pending.
+ *
+ * @param wheel a pointer to a timer wheel returned from timer_wheel_init()
+ * @param id the timer's ID, or TIMER_NONE
+ */
+void timer_wheel_cancel(timer_wheel_t *wheel, timer_id_t id);
+
+/**
+ * Returns whether a timer has yet to fire or be cancelled.
+ *
+ * @param wheel a pointer to a timer wheel returned from timer_wheel_init()
+ * @param id the timer's ID, or TIMER_NONE
+ */
+bool timer_wheel_pending(timer_wheel_t *wheel, timer_id_t id);
+
+/** Returns the number of pending timers */
+size_t timer_wheel_size(timer_wheel_t *wheel);
+
+/**
+ * Moves time forward, firing every timer that comes due, in the order they
+ * come due. Fired timers may schedule or cancel others.
+ *
+ * @param wheel a pointer to a timer wheel returned from timer_wheel_init()
+ * @param dt how much time has passed
+ */
+void timer_wheel_advance(timer_wheel_t *wheel, double dt);
+
+#endif // #ifndef __TIMER_WHEEL_H__
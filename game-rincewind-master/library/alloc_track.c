@@ -0,0 +1,183 @@
+#include "alloc_track.h"
+
+#ifdef TRACK_ALLOCATIONS
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+
+// Distinct call sites listed by track_report_leaks()
+#define TRACK_MAX_SITES 32
+
+const char *const TRACK_TAG_NAMES[TRACK_TAG_COUNT] = {
+    "list",  "body", "sprite",     "force bind", "force aux", "contact",
+    "arena", "info", "projectile", "bvh",        "atlas"};
+
+typedef struct track_header {
+  struct track_header *prev;
+  struct track_header *next;
+  const char *file;
+  int line;
+  size_t size;
+  track_tag_t tag;
+} track_header_t;
+
+// Keeps the memory after the header aligned for any type
+typedef union track_block {
+  track_header_t header;
+  max_align_t align;
+} track_block_t;
+
+typedef struct track_stats {
+  size_t live_bytes;
+  size_t live_count;
+  size_t frame_allocs;
+  size_t last_frame_allocs;
+} track_stats_t;
+
+// Every live tracked allocation, most recent first
+track_header_t *track_live = NULL;
+track_stats_t track_stats[TRACK_TAG_COUNT];
+// Guards the list and the counters, since any thread may allocate
+pthread_mutex_t track_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void *track_malloc_at(track_tag_t tag, size_t size, const char *file,
+                      int line) {
+  assert(tag < TRACK_TAG_COUNT);
+  track_block_t *block = malloc(sizeof(track_block_t) + size);
+  if (block == NULL) {
+    return NULL;
+  }
+  track_header_t *header = &block->header;
+  pthread_mutex_lock(&track_lock);
+  *header = (track_header_t){.prev = NULL,
+                             .next = track_live,
+                             .file = file,
+                             .line = line,
+                             .size = size,
+                             .tag = tag};
+  if (track_live != NULL) {
+    track_live->prev = header;
+  }
+  track_live = header;
+
+  track_stats_t *stats = &track_stats[tag];
+  stats->live_bytes += size;
+  stats->live_count++;
+  stats->frame_allocs++;
+  pthread_mutex_unlock(&track_lock);
+  return block + 1;
+}
+
+void track_free(void *ptr) {
+  if (ptr == NULL) {
+    return;
+  }
+  track_block_t *block = (track_block_t *)ptr - 1;
+  track_header_t *header = &block->header;
+  pthread_mutex_lock(&track_lock);
+  if (header->prev != NULL) {
+    header->prev->next = header->next;
+  } else {
+    track_live = header->next;
+  }
+  if (header->next != NULL) {
+    header->next->prev = header->prev;
+  }
+
+  track_stats_t *stats = &track_stats[header->tag];
+  stats->live_bytes -= header->size;
+  stats->live_count--;
+  pthread_mutex_unlock(&track_lock);
+  free(block);
+}
+
+/** Reads one of a subsystem's counters while no thread is changing it */
+size_t track_read(const size_t *counter) {
+  pthread_mutex_lock(&track_lock);
+  size_t value = *counter;
+  pthread_mutex_unlock(&track_lock);
+  return value;
+}
+
+size_t track_live_bytes(track_tag_t tag) {
+  return track_read(&track_stats[tag].live_bytes);
+}
+
+size_t track_live_count(track_tag_t tag) {
+  return track_read(&track_stats[tag].live_count);
+}
+
+size_t track_frame_allocs(track_tag_t tag) {
+  return track_read(&track_stats[tag].last_frame_allocs);
+}
+
+void track_end_frame(void) {
+  pthread_mutex_lock(&track_lock);
+  for (size_t tag = 0; tag < TRACK_TAG_COUNT; tag++) {
+    track_stats[tag].last_frame_allocs = track_stats[tag].frame_allocs;
+    track_stats[tag].frame_allocs = 0;
+  }
+  pthread_mutex_unlock(&track_lock);
+}
+
+typedef struct track_site {
+  const char *file;
+  int line;
+  track_tag_t tag;
+  size_t bytes;
+  size_t count;
+} track_site_t;
+
+void track_report_leaks(void) {
+  size_t total = 0;
+  for (size_t tag = 0; tag < TRACK_TAG_COUNT; tag++) {
+    total += track_stats[tag].live_count;
+  }
+  if (total == 0) {
+    fprintf(stderr, "track: no leaks\n");
+    return;
+  }
+  for (size_t tag = 0; tag < TRACK_TAG_COUNT; tag++) {
+    fprintf(stderr, "track: %-10s %zu bytes leaked in %zu allocations\n",
+            TRACK_TAG_NAMES[tag], track_stats[tag].live_bytes,
+            track_stats[tag].live_count);
+  }
+
+  // Group the leaks by where they were allocated
+  track_site_t sites[TRACK_MAX_SITES];
+  size_t site_count = 0;
+  size_t unlisted = 0;
+  for (track_header_t *header = track_live; header != NULL;
+       header = header->next) {
+    size_t i = 0;
+    while (i < site_count &&
+           (sites[i].file != header->file || sites[i].line != header->line)) {
+      i++;
+    }
+    if (i == site_count) {
+      if (site_count == TRACK_MAX_SITES) {
+        unlisted++;
+        continue;
+      }
+      sites[site_count++] = (track_site_t){.file = header->file,
+                                           .line = header->line,
+                                           .tag = header->tag,
+                                           .bytes = 0,
+                                           .count = 0};
+    }
+    sites[i].bytes += header->size;
+    sites[i].count++;
+  }
+  for (size_t i = 0; i < site_count; i++) {
+    fprintf(stderr, "track:   %s:%d (%s) %zu bytes in %zu allocations\n",
+            sites[i].file, sites[i].line, TRACK_TAG_NAMES[sites[i].tag],
+            sites[i].bytes, sites[i].count);
+  }
+  if (unlisted > 0) {
+    fprintf(stderr, "track:   %zu more allocations at other sites\n",
+            unlisted);
+  }
+}
+
+#endif // #ifdef TRACK_ALLOCATIONS
@@ -0,0 +1,77 @@
+#include "arena.h"
+#include "alloc_track.h"
+#include <assert.h>
+#include <stdalign.h>
+#include <stdlib.h>
+
+typedef struct arena_block {
+  struct arena_block *next;
+} arena_block_t;
+
+// Keeps the memory after a block's header aligned for any type
+typedef union arena_header {
+  arena_block_t block;
+  max_align_t align;
+} arena_header_t;
+
+typedef struct arena {
+  size_t block_size;
+  // Every block, most recent first
+  arena_block_t *blocks;
+  // The unused part of the most recent block that is not a large allocation
+  char *next;
+  size_t remaining;
+  size_t used;
+} arena_t;
+
+arena_t *arena_init(size_t block_size) {
+  assert(block_size > 0);
+  arena_t *arena = malloc(sizeof(arena_t));
+  assert(arena != NULL);
+  *arena = (arena_t){.block_size = block_size,
+                     .blocks = NULL,
+                     .next = NULL,
+                     .remaining = 0,
+                     .used = 0};
+  return arena;
+}
+
+void arena_free(arena_t *arena) {
+  arena_block_t *block = arena->blocks;
+  while (block != NULL) {
+    arena_block_t *next = block->next;
+    track_free(block);
+    block = next;
+  }
+  free(arena);
+}
+
+/** Allocates a block with room for size bytes, and adds it to the arena */
+char *arena_add_block(arena_t *arena, size_t size) {
+  arena_header_t *header = track_malloc(TRACK_ARENA,
+                                        sizeof(arena_header_t) + size);
+  assert(header != NULL);
+  header->block.next = arena->blocks;
+  arena->blocks = &header->block;
+  return (char *)(header + 1);
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+  // Round up, so the next allocation stays aligned too
+  size_t align = alignof(max_align_t);
+  size = (size + align - 1) / align * align;
+  arena->used += size;
+  if (size > arena->block_size) {
+    return arena_add_block(arena, size);
+  }
+  if (size > arena->remaining) {
+    arena->next = arena_add_block(arena, arena->block_size);
+    arena->remaining = arena->block_size;
+  }
+  void *memory = arena->next;
+  arena->next += size;
+  arena->remaining -= size;
+  return memory;
+}
+
+size_t arena_used(arena_t *arena) { return arena->used; }
@@ -0,0 +1,162 @@
+#include "atlas.h"
+#include "alloc_track.h"
+#include "list.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Shelves are packed up to this width, unless one image is wider or the
+// renderer's textures cannot be this wide
+const int ATLAS_WIDTH = 2048;
+// Empty pixels between neighbouring regions
+const int ATLAS_PADDING = 1;
+const size_t INITIAL_ATLAS_ENTRIES = 16;
+
+typedef struct atlas_entry {
+  char *name;
+  SDL_Surface *surface;
+  SDL_Rect region;
+} atlas_entry_t;
+
+typedef struct atlas {
+  list_t *entries;
+  SDL_Texture *texture;
+  bool is_built;
+} atlas_t;
+
+void atlas_entry_free(atlas_entry_t *entry) {
+  if (entry->surface != NULL) {
+    SDL_FreeSurface(entry->surface);
+  }
+  track_free(entry->name);
+  track_free(entry);
+}
+
+atlas_t *atlas_init(void) {
+  atlas_t *atlas = track_malloc(TRACK_ATLAS, sizeof(atlas_t));
+  assert(atlas != NULL);
+  *atlas = (atlas_t){.entries = list_init(INITIAL_ATLAS_ENTRIES,
+                                          (free_func_t)atlas_entry_free),
+                     .texture = NULL,
+                     .is_built = false};
+  return atlas;
+}
+
+void atlas_free(atlas_t *atlas) {
+  list_free(atlas->entries);
+  if (atlas->texture != NULL) {
+    SDL_DestroyTexture(atlas->texture);
+  }
+  track_free(atlas);
+}
+
+void atlas_add(atlas_t *atlas, const char *name, SDL_Surface *surface) {
+  assert(!atlas->is_built);
+  assert(surface != NULL);
+  atlas_entry_t *entry = track_malloc(TRACK_ATLAS, sizeof(atlas_entry_t));
+  assert(entry != NULL);
+  entry->name = track_malloc(TRACK_ATLAS, strlen(name) + 1);
+  assert(entry->name != NULL);
+  strcpy(entry->name, name);
+  entry->surface = surface;
+  entry->region = (SDL_Rect){.x = 0, .y = 0, .w = surface->w, .h = surface->h};
+  list_add(atlas->entries, entry);
+}
+
+int atlas_entry_compare(const void *a, const void *b) {
+  const atlas_entry_t *entry1 = *(atlas_entry_t *const *)a;
+  const atlas_entry_t *entry2 = *(atlas_entry_t *const *)b;
+  return entry2->region.h - entry1->region.h;
+}
+
+/**
+ * Places the entries on shelves, tallest first, no wider than max_width.
+ * Returns the total height and sets width to the atlas' width.
+ */
+int atlas_pack(atlas_entry_t **entries, size_t count, int max_width,
+               int *width) {
+  qsort(entries, count, sizeof(atlas_entry_t *), atlas_entry_compare);
+  *width = ATLAS_WIDTH < max_width ? ATLAS_WIDTH : max_width;
+  for (size_t i = 0; i < count; i++) {
+    if (entries[i]->region.w > *width) {
+      *width = entries[i]->region.w;
+    }
+  }
+  int x = 0, shelf_y = 0, shelf_height = 0;
+  for (size_t i = 0; i < count; i++) {
+    SDL_Rect *region = &entries[i]->region;
+    if (x + region->w > *width) {
+      x = 0;
+      shelf_y += shelf_height + ATLAS_PADDING;
+      shelf_height = 0;
+    }
+    region->x = x;
+    region->y = shelf_y;
+    x += region->w + ATLAS_PADDING;
+    if (region->h > shelf_height) {
+      shelf_height = region->h;
+    }
+  }
+  return shelf_y + shelf_height;
+}
+
+void atlas_build(atlas_t *atlas, SDL_Renderer *renderer) {
+  assert(!atlas->is_built);
+  atlas->is_built = true;
+  size_t count = list_size(atlas->entries);
+  if (count == 0) {
+    return;
+  }
+  atlas_entry_t **entries =
+      track_malloc(TRACK_ATLAS, count * sizeof(atlas_entry_t *));
+  assert(entries != NULL);
+  for (size_t i = 0; i < count; i++) {
+    entries[i] = list_get(atlas->entries, i);
+  }
+  // The sheet must fit in one of the renderer's textures; a limit of 0 means
+  // it has none
+  SDL_RendererInfo info;
+  int max_width = INT_MAX, max_height = INT_MAX;
+  if (SDL_GetRendererInfo(renderer, &info) == 0) {
+    if (info.max_texture_width > 0) {
+      max_width = info.max_texture_width;
+    }
+    if (info.max_texture_height > 0) {
+      max_height = info.max_texture_height;
+    }
+  }
+  int width;
+  int height = atlas_pack(entries, count, max_width, &width);
+  track_free(entries);
+  assert(width <= max_width && height <= max_height);
+
+  // A new surface is fully transparent, so color keyed pixels stay clear
+  SDL_Surface *sheet = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32,
+                                                      SDL_PIXELFORMAT_RGBA32);
+  assert(sheet != NULL);
+  for (size_t i = 0; i < count; i++) {
+    atlas_entry_t *entry = list_get(atlas->entries, i);
+    SDL_SetSurfaceBlendMode(entry->surface, SDL_BLENDMODE_NONE);
+    SDL_BlitSurface(entry->surface, NULL, sheet, &entry->region);
+    SDL_FreeSurface(entry->surface);
+    entry->surface = NULL;
+  }
+  atlas->texture = SDL_CreateTextureFromSurface(renderer, sheet);
+  SDL_FreeSurface(sheet);
+  assert(atlas->texture != NULL);
+  SDL_SetTextureBlendMode(atlas->texture, SDL_BLENDMODE_BLEND);
+}
+
+SDL_Texture *atlas_get_texture(atlas_t *atlas) { return atlas->texture; }
+
+bool atlas_find(atlas_t *atlas, const char *name, SDL_Rect *region) {
+  for (size_t i = 0; i < list_size(atlas->entries); i++) {
+    atlas_entry_t *entry = list_get(atlas->entries, i);
+    if (strcmp(entry->name, name) == 0) {
+      *region = entry->region;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,169 @@
+#include "batch.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+// Matches a thread claims at a time; enough to keep the threads from
+// contending on the counter, few enough to share the work out evenly
+const size_t BATCH_CHUNK = 8;
+
+typedef struct batch {
+  match_t **matches;
+  game_state_t *maps;
+  size_t count;
+  pthread_t *workers;
+  size_t worker_count;
+  pthread_mutex_t lock;
+  // Signalled when a step starts, and when the last worker finishes it
+  pthread_cond_t start;
+  pthread_cond_t done;
+  // Steps started so far, so each worker knows when there is a new one
+  size_t generation;
+  // Workers still running the current step
+  size_t busy;
+  bool stopping;
+  // The step being run
+  const player_input_t (*inputs)[MATCH_PLAYERS];
+  double dt;
+  match_observation_t *observations;
+  // Index of the first match of the current step that no thread has claimed
+  atomic_size_t next;
+} batch_t;
+
+/** Steps and observes matches until every match of the step is claimed */
+void batch_run(batch_t *batch) {
+  while (true) {
+    size_t first = atomic_fetch_add(&batch->next, BATCH_CHUNK);
+    if (first >= batch->count) {
+      return;
+    }
+    size_t last = first + BATCH_CHUNK;
+    if (last > batch->count) {
+      last = batch->count;
+    }
+    for (size_t i = first; i < last; i++) {
+      match_step(batch->matches[i], batch->inputs[i], batch->dt);
+      if (batch->observations != NULL) {
+        match_observe(batch->matches[i], &batch->observations[i]);
+      }
+    }
+  }
+}
+
+void *batch_worker(batch_t *batch) {
+  size_t generation = 0;
+  pthread_mutex_lock(&batch->lock);
+  while (true) {
+    while (batch->generation == generation && !batch->stopping) {
+      pthread_cond_wait(&batch->start, &batch->lock);
+    }
+    if (batch->stopping) {
+      break;
+    }
+    generation = batch->generation;
+    pthread_mutex_unlock(&batch->lock);
+
+    batch_run(batch);
+
+    pthread_mutex_lock(&batch->lock);
+    batch->busy--;
+    if (batch->busy == 0) {
+      pthread_cond_signal(&batch->done);
+    }
+  }
+  pthread_mutex_unlock(&batch->lock);
+  return NULL;
+}
+
+batch_t *batch_init(const game_state_t *maps, size_t count, size_t threads) {
+  batch_t *batch = malloc(sizeof(batch_t));
+  assert(batch != NULL);
+  size_t worker_count = threads > 1 ? threads - 1 : 0;
+  *batch = (batch_t){.matches = malloc(count * sizeof(match_t *)),
+                     .maps = malloc(count * sizeof(game_state_t)),
+                     .count = count,
+                     .workers = malloc(worker_count * sizeof(pthread_t)),
+                     .worker_count = 0,
+                     .generation = 0,
+                     .busy = 0,
+                     .stopping = false,
+                     .inputs = NULL,
+                     .dt = 0,
+                     .observations = NULL};
+  assert(batch->matches != NULL && batch->maps != NULL);
+  assert(batch->workers != NULL || worker_count == 0);
+  atomic_init(&batch->next, 0);
+  pthread_mutex_init(&batch->lock, NULL);
+  pthread_cond_init(&batch->start, NULL);
+  pthread_cond_init(&batch->done, NULL);
+
+  for (size_t i = 0; i < count; i++) {
+    batch->maps[i] = maps[i];
+    batch->matches[i] = match_init(maps[i]);
+  }
+  // Where threads are not available, the calling thread does all the work
+  while (batch->worker_count < worker_count &&
+         pthread_create(&batch->workers[batch->worker_count], NULL,
+                        (void *(*)(void *))batch_worker, batch) == 0) {
+    batch->worker_count++;
+  }
+  return batch;
+}
+
+void batch_free(batch_t *batch) {
+  pthread_mutex_lock(&batch->lock);
+  batch->stopping = true;
+  pthread_cond_broadcast(&batch->start);
+  pthread_mutex_unlock(&batch->lock);
+  for (size_t i = 0; i < batch->worker_count; i++) {
+    pthread_join(batch->workers[i], NULL);
+  }
+  pthread_cond_destroy(&batch->start);
+  pthread_cond_destroy(&batch->done);
+  pthread_mutex_destroy(&batch->lock);
+
+  for (size_t i = 0; i < batch->count; i++) {
+    match_free(batch->matches[i]);
+  }
+  free(batch->matches);
+  free(batch->maps);
+  free(batch->workers);
+  free(batch);
+}
+
+size_t batch_size(batch_t *batch) { return batch->count; }
+
+match_t *batch_get_match(batch_t *batch, size_t index) {
+  assert(index < batch->count);
+  return batch->matches[index];
+}
+
+void batch_restart(batch_t *batch, size_t index) {
+  assert(index < batch->count);
+  match_free(batch->matches[index]);
+  batch->matches[index] = match_init(batch->maps[index]);
+}
+
+void batch_step(batch_t *batch, const player_input_t (*inputs)[MATCH_PLAYERS],
+                double dt, match_observation_t *observations) {
+  batch->inputs = inputs;
+  batch->dt = dt;
+  batch->observations = observations;
+  atomic_store(&batch->next, 0);
+
+  pthread_mutex_lock(&batch->lock);
+  batch->generation++;
+  batch->busy = batch->worker_count;
+  pthread_cond_broadcast(&batch->start);
+  pthread_mutex_unlock(&batch->lock);
+
+  batch_run(batch);
+
+  pthread_mutex_lock(&batch->lock);
+  while (batch->busy > 0) {
+    pthread_cond_wait(&batch->done, &batch->lock);
+  }
+  pthread_mutex_unlock(&batch->lock);
+}
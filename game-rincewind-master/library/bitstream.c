@@ -0,0 +1,69 @@
+#include "bitstream.h"
+#include <assert.h>
+
+// Payload bits in each group of a varint; every group has a continuation bit
+const size_t VARINT_GROUP_BITS = 4;
+
+void bitstream_init(bitstream_t *stream, void *data, size_t capacity) {
+  *stream = (bitstream_t){
+      .data = data, .capacity = capacity, .bit = 0, .overflow = false};
+}
+
+void bitstream_write(bitstream_t *stream, uint32_t value, size_t bits) {
+  assert(bits <= 32);
+  if (stream->bit + bits > stream->capacity * 8) {
+    stream->overflow = true;
+    return;
+  }
+  for (size_t i = 0; i < bits; i++) {
+    size_t byte = stream->bit / 8;
+    uint8_t mask = 1 << (stream->bit % 8);
+    if (value >> i & 1) {
+      stream->data[byte] |= mask;
+    } else {
+      stream->data[byte] &= ~mask;
+    }
+    stream->bit++;
+  }
+}
+
+uint32_t bitstream_read(bitstream_t *stream, size_t bits) {
+  assert(bits <= 32);
+  if (stream->bit + bits > stream->capacity * 8) {
+    stream->overflow = true;
+    return 0;
+  }
+  uint32_t value = 0;
+  for (size_t i = 0; i < bits; i++) {
+    uint32_t bit = stream->data[stream->bit / 8] >> (stream->bit % 8) & 1;
+    value |= bit << i;
+    stream->bit++;
+  }
+  return value;
+}
+
+void bitstream_write_varint(bitstream_t *stream, int32_t value) {
+  // Zigzag encoding interleaves signs so small magnitudes stay small
+  uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+  uint32_t group_mask = (1u << VARINT_GROUP_BITS) - 1;
+  do {
+    bitstream_write(stream, zigzag & group_mask, VARINT_GROUP_BITS);
+    zigzag >>= VARINT_GROUP_BITS;
+    bitstream_write(stream, zigzag != 0, 1);
+  } while (zigzag != 0 && !stream->overflow);
+}
+
+int32_t bitstream_read_varint(bitstream_t *stream) {
+  uint32_t zigzag = 0;
+  for (size_t shift = 0; shift < 32; shift += VARINT_GROUP_BITS) {
+    zigzag |= bitstream_read(stream, VARINT_GROUP_BITS) << shift;
+    if (!bitstream_read(stream, 1)) {
+      break;
+    }
+  }
+  return (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+}
+
+size_t bitstream_bytes(bitstream_t *stream) { return (stream->bit + 7) / 8; }
+
+bool bitstream_overflowed(bitstream_t *stream) { return stream->overflow; }
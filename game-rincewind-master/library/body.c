@@ -1,16 +1,29 @@
 #include "body.h"
+#include "alloc_track.h"
 #include <assert.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 double MAX_ROT_VELOCITY = 0.15;
+// A dynamic body slower than this with less net acceleration is quiet
+const double SLEEP_VELOCITY = 0.5;
+const double SLEEP_ACCELERATION = 1.0;
+// Number of ticks an island must stay quiet before it falls asleep
+const size_t SLEEP_TICKS = 30;
 
 typedef struct body {
+  // Vertices relative to the centroid, before rotation
   list_t *shape;
+  // World-space vertices, rebuilt from shape only after the body moves
+  list_t *world_shape;
+  bool world_is_stale;
   double mass;
   rgb_color_t color;
   double angle;
+  double cos_angle;
+  double sin_angle;
   vector_t velocity;
   double rot_velocity;
   vector_t centroid;
@@ -22,82 +35,192 @@ typedef struct body {
   bool is_destroyable;
   vector_t rotation_center;
   double rot_acceleration;
+  size_t revision;
+  motion_type_t motion_type;
+  bool is_sleeping;
+  bool was_woken;
+  size_t quiet_ticks;
+  // Island bookkeeping, only meaningful during scene_tick()
+  body_t *island;
+  bool island_restless;
+  size_t island_quiet_ticks;
+  // Where the body and its world shapes came from, or NULL if they were
+  // allocated
+  arena_t *arena;
+  // The arena's vertices behind world_shape, reused as the shape changes
+  vector_t *world_vertices;
+  size_t world_capacity;
 } body_t;
 
+double body_area_helper(list_t *shape) {
+  double area = 0;
+  size_t size = list_size(shape);
+  for (size_t i = 0; i < size; i++) { // Mod is to loop around for shoelace
+    area += ((vector_t *)list_get(shape, i))->x *
+            ((vector_t *)list_get(shape, (i + 1) % size))->y;
+    area -= ((vector_t *)list_get(shape, i))->y *
+            ((vector_t *)list_get(shape, (i + 1) % size))->x;
+  }
+  area = area / 2;
+  return area;
+}
+
+/**
+ * Centroid of a polygon, or the average of its vertices
+ * if it has no area (e.g. while vertices are still being added)
+ */
+vector_t polygon_centroid(list_t *shape) {
+  size_t size = list_size(shape);
+  double area = body_area_helper(shape);
+  vector_t centroid = {0.0, 0.0};
+  if (area == 0) {
+    for (size_t i = 0; i < size; i++) {
+      centroid = vec_add(centroid, *(vector_t *)list_get(shape, i));
+    }
+    return size == 0 ? centroid : vec_multiply(1.0 / size, centroid);
+  }
+  for (size_t i = 0; i < size; i++) { // Mod is to loop around
+    double xi = ((vector_t *)list_get(shape, i))->x;
+    double xi_plus1 = ((vector_t *)list_get(shape, (i + 1) % size))->x;
+    double yi = ((vector_t *)list_get(shape, i))->y;
+    double yi_plus1 = ((vector_t *)list_get(shape, (i + 1) % size))->y;
+    centroid.x += (xi + xi_plus1) * (xi * yi_plus1 - xi_plus1 * yi);
+    centroid.y += (yi + yi_plus1) * (xi * yi_plus1 - xi_plus1 * yi);
+  }
+
+  centroid.x = centroid.x / (6 * area);
+  centroid.y = centroid.y / (6 * area);
+  return centroid;
+}
+
+/** Marks everything derived from the body's position as out of date */
+void body_moved(body_t *body) {
+  body->revision++;
+  body->world_is_stale = true;
+}
+
+/**
+ * Takes ownership of a world-space shape and stores it relative to its
+ * centroid, undoing the body's current rotation
+ */
+void body_localize(body_t *body, list_t *shape) {
+  vector_t centroid = polygon_centroid(shape);
+  size_t size = list_size(shape);
+  for (size_t i = 0; i < size; i++) {
+    vector_t *vertex = list_get(shape, i);
+    vector_t diff = vec_subtract(*vertex, centroid);
+    *vertex = (vector_t){body->cos_angle * diff.x + body->sin_angle * diff.y,
+                         body->cos_angle * diff.y - body->sin_angle * diff.x};
+  }
+  if (body->shape != NULL && body->shape != shape) {
+    list_free(body->shape);
+  }
+  body->shape = shape;
+  body->centroid = centroid;
+
+  if (body->arena != NULL) {
+    // The arena frees nothing until the scene goes, so the cache is kept and
+    // only grows, doubling so vertices added one by one rarely allocate
+    if (size > body->world_capacity) {
+      body->world_capacity = size > 2 * body->world_capacity
+                                 ? size
+                                 : 2 * body->world_capacity;
+      body->world_vertices = arena_alloc(
+          body->arena, body->world_capacity * sizeof(vector_t));
+    }
+    if (body->world_shape == NULL) {
+      body->world_shape = list_init_in(body->arena, size, NULL);
+    }
+    while (list_size(body->world_shape) > 0) {
+      list_remove(body->world_shape, list_size(body->world_shape) - 1);
+    }
+    for (size_t i = 0; i < size; i++) {
+      list_add(body->world_shape, &body->world_vertices[i]);
+    }
+  } else {
+    if (body->world_shape != NULL) {
+      list_free(body->world_shape);
+    }
+    body->world_shape = list_init(size, (free_func_t)free);
+    for (size_t i = 0; i < size; i++) {
+      vector_t *vertex = malloc(sizeof(vector_t));
+      assert(vertex != NULL);
+      list_add(body->world_shape, vertex);
+    }
+  }
+  body_moved(body);
+}
+
 body_t *body_init(list_t *shape, double mass, rgb_color_t color) {
-  body_t *body = malloc(sizeof(body_t));
+  return body_init_in(NULL, shape, mass, color, NULL, NULL);
+}
+
+body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color,
+                            void *info, free_func_t info_freer) {
+  return body_init_in(NULL, shape, mass, color, info, info_freer);
+}
+
+body_t *body_init_in(arena_t *arena, list_t *shape, double mass,
+                     rgb_color_t color, void *info, free_func_t info_freer) {
+  body_t *body = arena != NULL ? arena_alloc(arena, sizeof(body_t))
+                               : track_malloc(TRACK_BODY, sizeof(body_t));
+  assert(body != NULL);
   assert(mass > 0);
-  *body = (body_t){.shape = shape,
-                   .mass = mass,
+  *body = (body_t){.mass = mass,
                    .color = color,
                    .angle = 0,
+                   .cos_angle = 1,
+                   .sin_angle = 0,
                    .velocity = VEC_ZERO,
                    .net_force = VEC_ZERO,
                    .net_impulse = VEC_ZERO,
                    .rot_velocity = 0,
-                   .rot_acceleration = 0};
-  assert(body != NULL);
+                   .rot_acceleration = 0,
+                   .info = info,
+                   .info_freer = info_freer,
+                   .arena = arena};
+  body_localize(body, shape);
   return body;
 }
 
-body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color,
-                            void *info, free_func_t info_freer) {
-  body_t *body = body_init(shape, mass, color);
-  body->info = info;
-  body->info_freer = info_freer;
-
-  return body;
-};
-
 void body_free(body_t *body) {
   list_free(body->shape);
+  list_free(body->world_shape);
   if (body->info_freer != NULL) {
     body->info_freer(body->info);
   }
-  free(body);
+  if (body->arena == NULL) {
+    track_free(body);
+  }
+}
+
+list_t *body_get_world_shape(body_t *body) {
+  if (body->world_is_stale) {
+    double c = body->cos_angle;
+    double s = body->sin_angle;
+    for (size_t i = 0; i < list_size(body->shape); i++) {
+      vector_t local = *(vector_t *)list_get(body->shape, i);
+      vector_t *world = list_get(body->world_shape, i);
+      world->x = body->centroid.x + c * local.x - s * local.y;
+      world->y = body->centroid.y + s * local.x + c * local.y;
+    }
+    body->world_is_stale = false;
+  }
+  return body->world_shape;
 }
 
 list_t *body_get_shape(body_t *body) {
-  list_t *return_shape = list_init(list_size(body->shape), (free_func_t)free);
-  for (size_t i = 0; i < list_size(body->shape); i++) {
+  list_t *world_shape = body_get_world_shape(body);
+  list_t *return_shape = list_init(list_size(world_shape), (free_func_t)free);
+  for (size_t i = 0; i < list_size(world_shape); i++) {
     vector_t *return_vec = malloc(sizeof(vector_t));
-    return_vec->x = ((vector_t *)list_get(body->shape, i))->x;
-    return_vec->y = ((vector_t *)list_get(body->shape, i))->y;
+    *return_vec = *(vector_t *)list_get(world_shape, i);
     list_add(return_shape, return_vec);
   }
   return return_shape;
 }
 
-double body_area_helper(list_t *shape) {
-  double area = 0;
-  size_t size = list_size(shape);
-  for (size_t i = 0; i < size; i++) { // Mod is to loop around for shoelace
-    area += ((vector_t *)list_get(shape, i))->x *
-            ((vector_t *)list_get(shape, (i + 1) % size))->y;
-    area -= ((vector_t *)list_get(shape, i))->y *
-            ((vector_t *)list_get(shape, (i + 1) % size))->x;
-  }
-  area = area / 2;
-  return area;
-}
-
-vector_t body_get_centroid(body_t *body) {
-
-  vector_t centroid = {0.0, 0.0};
-  size_t size = list_size(body->shape);
-  for (size_t i = 0; i < size; i++) { // Mod is to loop around
-    double xi = ((vector_t *)list_get(body->shape, i))->x;
-    double xi_plus1 = ((vector_t *)list_get(body->shape, (i + 1) % size))->x;
-    double yi = ((vector_t *)list_get(body->shape, i))->y;
-    double yi_plus1 = ((vector_t *)list_get(body->shape, (i + 1) % size))->y;
-    centroid.x += (xi + xi_plus1) * (xi * yi_plus1 - xi_plus1 * yi);
-    centroid.y += (yi + yi_plus1) * (xi * yi_plus1 - xi_plus1 * yi);
-  }
-
-  centroid.x = centroid.x / (6 * body_area_helper(body->shape));
-  centroid.y = centroid.y / (6 * body_area_helper(body->shape));
-  return centroid;
-}
+vector_t body_get_centroid(body_t *body) { return body->centroid; }
 
 double body_get_mass(body_t *body) { return body->mass; }
 
@@ -113,33 +236,192 @@ rgb_color_t body_get_color(body_t *body) { return body->color; }
 
 double body_get_rot_velocity(body_t *body) { return body->rot_velocity; }
 
+vector_t body_get_vertex(body_t *body, size_t index) {
+  return *(vector_t *)list_get(body_get_world_shape(body), index);
+}
+
+size_t body_get_revision(body_t *body) { return body->revision; }
+
+aabb_t body_get_aabb(body_t *body) {
+  vector_t first = body_get_vertex(body, 0);
+  aabb_t box = {.min = first, .max = first};
+  for (size_t i = 1; i < list_size(body->shape); i++) {
+    vector_t vertex = body_get_vertex(body, i);
+    box.min.x = fmin(box.min.x, vertex.x);
+    box.min.y = fmin(box.min.y, vertex.y);
+    box.max.x = fmax(box.max.x, vertex.x);
+    box.max.y = fmax(box.max.y, vertex.y);
+  }
+  return box;
+}
+
+void body_set_motion_type(body_t *body, motion_type_t motion_type) {
+  body->motion_type = motion_type;
+}
+
+motion_type_t body_get_motion_type(body_t *body) { return body->motion_type; }
+
+bool body_is_sleeping(body_t *body) { return body->is_sleeping; }
+
+bool body_is_resting(body_t *body) {
+  return body->is_sleeping || body->motion_type == MOTION_STATIC;
+}
+
+void body_sleep(body_t *body) {
+  body->is_sleeping = true;
+  body->velocity = VEC_ZERO;
+  body->net_force = VEC_ZERO;
+  body->net_impulse = VEC_ZERO;
+}
+
+void body_wake(body_t *body) {
+  body->is_sleeping = false;
+  body->was_woken = true;
+  body->quiet_ticks = 0;
+}
+
+/** Velocity change caused by the forces and impulses accumulated this tick */
+vector_t body_velocity_change(body_t *body, double dt) {
+  vector_t force_velocity = vec_multiply(dt / body->mass, body->net_force);
+  return vec_add(force_velocity,
+                 vec_multiply(1 / body->mass, body->net_impulse));
+}
+
+/**
+ * Whether the body is barely moving and barely being pushed.
+ * Looks at the net change in velocity, so a body held up by contact
+ * impulses against a constant force still counts as quiet.
+ */
+bool body_is_quiet(body_t *body, double dt) {
+  double velocity_change = vec_length(body_velocity_change(body, dt));
+  return vec_length(body->velocity) < SLEEP_VELOCITY &&
+         velocity_change <= SLEEP_ACCELERATION * dt;
+}
+
+void body_island_begin(body_t *body) {
+  body->island = body;
+  body->island_restless = false;
+  body->island_quiet_ticks = SIZE_MAX;
+}
+
+body_t *body_get_island(body_t *body) {
+  // Path halving keeps the trees shallow
+  while (body->island != body) {
+    body->island = body->island->island;
+    body = body->island;
+  }
+  return body;
+}
+
+void body_join_islands(body_t *body1, body_t *body2) {
+  if (body1->motion_type != MOTION_DYNAMIC ||
+      body2->motion_type != MOTION_DYNAMIC) {
+    return;
+  }
+  body_t *island1 = body_get_island(body1);
+  body_t *island2 = body_get_island(body2);
+  if (island1 != island2) {
+    island2->island = island1;
+  }
+}
+
+void body_touch(body_t *body1, body_t *body2) {
+  if (body1->is_sleeping && !body_is_resting(body2)) {
+    body_wake(body1);
+  }
+  if (body2->is_sleeping && !body_is_resting(body1)) {
+    body_wake(body2);
+  }
+  body_join_islands(body1, body2);
+}
+
+void body_island_gather(body_t *body, double dt) {
+  if (body->motion_type != MOTION_DYNAMIC) {
+    return;
+  }
+  body_t *island = body_get_island(body);
+  if (!body->is_sleeping && (body->was_woken || !body_is_quiet(body, dt))) {
+    island->island_restless = true;
+  }
+  if (body->quiet_ticks < island->island_quiet_ticks) {
+    island->island_quiet_ticks = body->quiet_ticks;
+  }
+}
+
+void body_island_settle(body_t *body) {
+  if (body->motion_type != MOTION_DYNAMIC) {
+    return;
+  }
+  body_t *island = body_get_island(body);
+  body->was_woken = false;
+  if (island->island_restless) {
+    body->is_sleeping = false;
+    body->quiet_ticks = 0;
+    return;
+  }
+  if (!body->is_sleeping) {
+    body->quiet_ticks++;
+    if (island->island_quiet_ticks + 1 >= SLEEP_TICKS) {
+      body_sleep(body);
+    }
+  }
+}
+
 void body_set_centroid(body_t *body, vector_t x) {
-  vector_t center_diff = vec_subtract(x, body_get_centroid(body));
-  for (size_t i = 0; i < list_size(body->shape); i++) {
-    *((vector_t *)list_get(body->shape, i)) =
-        vec_add(*((vector_t *)list_get(body->shape, i)), center_diff);
+  if (vec_equals(x, body->centroid)) {
+    return;
+  }
+  body->centroid = x;
+  body_moved(body);
+  if (body->is_sleeping) {
+    body_wake(body);
+  }
+}
+
+void body_set_velocity(body_t *body, vector_t v) {
+  if (body->is_sleeping && !vec_equals(v, body->velocity)) {
+    body_wake(body);
   }
+  body->velocity = v;
 }
 
-void body_set_velocity(body_t *body, vector_t v) { body->velocity = v; }
+/** Sets the angle along with the cos/sin pair used to place the vertices */
+void body_set_angle(body_t *body, double angle) {
+  body->angle = angle;
+  body->cos_angle = cos(angle);
+  body->sin_angle = sin(angle);
+  body_moved(body);
+}
 
 void body_set_rotation(body_t *body, double angle) {
-  double new_angle = angle - body->angle;
-  vector_t centroid = body_get_centroid(body);
-  for (size_t i = 0; i < list_size(body->shape); i++) {
-    vector_t diff =
-        vec_subtract(*(vector_t *)list_get(body->shape, i), centroid);
-    *(vector_t *)list_get(body->shape, i) = vec_rotate(diff, new_angle);
+  if (angle == body->angle) {
+    return;
+  }
+  body_set_angle(body, angle);
+  if (body->is_sleeping) {
+    body_wake(body);
   }
-  body->angle = angle;
-  body_set_centroid(body, centroid);
 }
 
 void body_add_force(body_t *body, vector_t force) {
+  // Left untouched, so scenes can share static bodies (see scene_share_body())
+  if (body->motion_type == MOTION_STATIC) {
+    return;
+  }
+  if (body->is_sleeping && !vec_equals(force, VEC_ZERO)) {
+    body_wake(body);
+  }
   body->net_force = vec_add(body->net_force, force);
 }
 
 void body_add_impulse(body_t *body, vector_t impulse) {
+  // Static bodies ignore impulses too, as in body_add_force()
+  if (body->motion_type == MOTION_STATIC) {
+    return;
+  }
+  if (body->is_sleeping && !vec_equals(impulse, VEC_ZERO)) {
+    body_wake(body);
+  }
   body->net_impulse = vec_add(body->net_impulse, impulse);
 }
 
@@ -168,14 +450,12 @@ void body_rotate(body_t *body, double angle) {
 }
 
 void body_rotate_about(body_t *body, double angle, vector_t point) {
-  for (size_t i = 0; i < list_size(body->shape); i++) {
-    vector_t diff = vec_subtract(*(vector_t *)list_get(body->shape, i), point);
-    *(vector_t *)list_get(body->shape, i) = vec_rotate(diff, angle);
-    *(vector_t *)list_get(body->shape, i) =
-        vec_add(*(vector_t *)list_get(body->shape, i), point);
+  if (angle == 0) {
+    return;
   }
-
-  body->angle = fmod((body->angle + angle), (2 * M_PI));
+  vector_t diff = vec_subtract(body->centroid, point);
+  body->centroid = vec_add(vec_rotate(diff, angle), point);
+  body_set_angle(body, fmod((body->angle + angle), (2 * M_PI)));
 }
 
 double body_get_angle(body_t *body) { return body->angle; }
@@ -184,10 +464,14 @@ double body_get_rot_acceleration(body_t *body) {
   return body->rot_acceleration;
 }
 
-void body_set_shape(body_t *body, list_t *shape) { body->shape = shape; }
+void body_set_shape(body_t *body, list_t *shape) {
+  body_localize(body, shape);
+}
 
 void body_add_vertex(body_t *body, vector_t *vector) {
-  list_add(body->shape, vector);
+  list_t *shape = body_get_shape(body);
+  list_add(shape, vector);
+  body_localize(body, shape);
 }
 
 void body_set_rot_velocity(body_t *body, double rot_velocity) {
@@ -199,23 +483,48 @@ void body_set_rot_acceleration(body_t *body, double rot_acceleration) {
   body->rot_acceleration = rot_acceleration;
 }
 
-void body_tick(body_t *body, double dt) {
+vector_t body_get_tick_velocity(body_t *body, double dt) {
+  if (body->is_sleeping || body->motion_type == MOTION_STATIC) {
+    return VEC_ZERO;
+  }
+  if (body->motion_type == MOTION_KINEMATIC) {
+    return body->velocity;
+  }
+  return vec_add(body->velocity, body_velocity_change(body, dt));
+}
 
-  vector_t force_velocity = vec_multiply(dt / body->mass, body->net_force);
-  vector_t net_velocity_change =
-      vec_add(force_velocity, vec_multiply(1 / body->mass, body->net_impulse));
+vector_t body_get_tick_displacement(body_t *body, double dt) {
+  if (body->is_sleeping) {
+    return VEC_ZERO;
+  }
+  switch (body->motion_type) {
+  case MOTION_STATIC:
+    return VEC_ZERO;
+  case MOTION_KINEMATIC:
+    return vec_multiply(dt, body->velocity);
+  case MOTION_DYNAMIC:
+    break;
+  }
   vector_t avg_velocity =
-      vec_average(body->velocity, vec_add(body->velocity, net_velocity_change));
-  body->velocity = vec_add(body->velocity, net_velocity_change);
-
-  vector_t new_center =
-      vec_add(body_get_centroid(body), vec_multiply(dt, avg_velocity));
-  body_set_centroid(body, new_center);
+      vec_average(body->velocity,
+                  vec_add(body->velocity, body_velocity_change(body, dt)));
+  return vec_multiply(dt, avg_velocity);
+}
 
-  if (body->rot_velocity < MAX_ROT_VELOCITY) {
-    body->rot_velocity += dt * body->rot_acceleration;
+void body_tick(body_t *body, double dt) {
+  if (body->motion_type != MOTION_STATIC) {
+    vector_t new_center = vec_add(body_get_centroid(body),
+                                  body_get_tick_displacement(body, dt));
+    if (body->motion_type == MOTION_DYNAMIC) {
+      body->velocity = vec_add(body->velocity, body_velocity_change(body, dt));
+    }
+    body_set_centroid(body, new_center);
+
+    if (body->rot_velocity < MAX_ROT_VELOCITY) {
+      body->rot_velocity += dt * body->rot_acceleration;
+    }
+    body_rotate_about(body, body->rot_velocity, body->rotation_center);
   }
-  body_rotate_about(body, body->rot_velocity, body->rotation_center);
 
   body->net_force = VEC_ZERO;
   body->net_impulse = VEC_ZERO;
@@ -223,4 +532,53 @@ void body_tick(body_t *body, double dt) {
 
 void body_remove(body_t *body) { body->is_removed = true; }
 
-bool body_is_removed(body_t *body) { return body->is_removed; }
\ No newline at end of file
+bool body_is_removed(body_t *body) { return body->is_removed; }
+
+body_state_t body_save(body_t *body) {
+  return (body_state_t){.centroid = body->centroid,
+                        .velocity = body->velocity,
+                        .angle = body->angle,
+                        .rot_velocity = body->rot_velocity,
+                        .rot_acceleration = body->rot_acceleration,
+                        .rotation_center = body->rotation_center,
+                        .net_force = body->net_force,
+                        .net_impulse = body->net_impulse,
+                        .motion_type = body->motion_type,
+                        .is_removed = body->is_removed,
+                        .is_sleeping = body->is_sleeping,
+                        .was_woken = body->was_woken,
+                        .quiet_ticks = body->quiet_ticks};
+}
+
+void body_restore(body_t *body, const body_state_t *state) {
+  body->centroid = state->centroid;
+  body->velocity = state->velocity;
+  body->rot_velocity = state->rot_velocity;
+  body->rot_acceleration = state->rot_acceleration;
+  body->rotation_center = state->rotation_center;
+  body->net_force = state->net_force;
+  body->net_impulse = state->net_impulse;
+  body->motion_type = state->motion_type;
+  body->is_removed = state->is_removed;
+  body->is_sleeping = state->is_sleeping;
+  body->was_woken = state->was_woken;
+  body->quiet_ticks = state->quiet_ticks;
+  // Also marks the world shape stale, since the centroid may have changed
+  body_set_angle(body, state->angle);
+}
+
+bool body_state_equal(const body_state_t *state1, const body_state_t *state2) {
+  return vec_equals(state1->centroid, state2->centroid) &&
+         vec_equals(state1->velocity, state2->velocity) &&
+         state1->angle == state2->angle &&
+         state1->rot_velocity == state2->rot_velocity &&
+         state1->rot_acceleration == state2->rot_acceleration &&
+         vec_equals(state1->rotation_center, state2->rotation_center) &&
+         vec_equals(state1->net_force, state2->net_force) &&
+         vec_equals(state1->net_impulse, state2->net_impulse) &&
+         state1->motion_type == state2->motion_type &&
+         state1->is_removed == state2->is_removed &&
+         state1->is_sleeping == state2->is_sleeping &&
+         state1->was_woken == state2->was_woken &&
+         state1->quiet_ticks == state2->quiet_ticks;
+}
@@ -0,0 +1,271 @@
+#include "bvh.h"
+#include "alloc_track.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Leaves may hold up to this many bodies if splitting them costs more
+const size_t BVH_MAX_LEAF = 4;
+// Cost of visiting a node relative to testing one body, for the heuristic
+const double BVH_TRAVERSAL_COST = 1.0;
+
+typedef struct bvh_item {
+  body_t *body;
+  aabb_t box;
+  vector_t center;
+} bvh_item_t;
+
+typedef struct bvh_node {
+  aabb_t box;
+  // First item of a leaf, or the index of an internal node's right child.
+  // An internal node's left child always directly follows it.
+  size_t offset;
+  // Number of items in a leaf, or 0 for internal nodes
+  size_t count;
+} bvh_node_t;
+
+typedef struct bvh {
+  bvh_item_t *items;
+  size_t item_count;
+  bvh_node_t *nodes;
+  size_t node_count;
+} bvh_t;
+
+/** The 2D analogue of surface area, which the heuristic weighs nodes by */
+double aabb_perimeter(aabb_t box) {
+  return 2 * ((box.max.x - box.min.x) + (box.max.y - box.min.y));
+}
+
+int bvh_item_compare_x(const void *a, const void *b) {
+  double x1 = ((const bvh_item_t *)a)->center.x;
+  double x2 = ((const bvh_item_t *)b)->center.x;
+  return (x1 > x2) - (x1 < x2);
+}
+
+int bvh_item_compare_y(const void *a, const void *b) {
+  double y1 = ((const bvh_item_t *)a)->center.y;
+  double y2 = ((const bvh_item_t *)b)->center.y;
+  return (y1 > y2) - (y1 < y2);
+}
+
+int (*const BVH_AXIS_COMPARES[])(const void *, const void *) = {
+    bvh_item_compare_x, bvh_item_compare_y};
+
+/**
+ * Finds the cheapest split of items sorted along one axis.
+ * Sets split to the number of items that go to the left child and returns
+ * the estimated cost of the split, relative to the parent's perimeter.
+ */
+double bvh_best_split(bvh_item_t *items, size_t count, double *right_areas,
+                      size_t *split) {
+  aabb_t right = items[count - 1].box;
+  for (size_t i = count - 1; i > 0; i--) {
+    right = aabb_union(right, items[i].box);
+    right_areas[i] = aabb_perimeter(right);
+  }
+  double best_cost = INFINITY;
+  aabb_t left = items[0].box;
+  for (size_t i = 1; i < count; i++) {
+    double cost = aabb_perimeter(left) * i + right_areas[i] * (count - i);
+    if (cost < best_cost) {
+      best_cost = cost;
+      *split = i;
+    }
+    left = aabb_union(left, items[i].box);
+  }
+  return best_cost;
+}
+
+/** Builds the subtree over items [start, end) and returns its root's index */
+size_t bvh_build(bvh_t *bvh, size_t start, size_t end, double *right_areas) {
+  size_t index = bvh->node_count++;
+  size_t count = end - start;
+  aabb_t box = bvh->items[start].box;
+  for (size_t i = start + 1; i < end; i++) {
+    box = aabb_union(box, bvh->items[i].box);
+  }
+  bvh->nodes[index] = (bvh_node_t){.box = box, .offset = start, .count = count};
+  if (count == 1) {
+    return index;
+  }
+
+  size_t axis_count = sizeof(BVH_AXIS_COMPARES) / sizeof(*BVH_AXIS_COMPARES);
+  double best_cost = INFINITY;
+  size_t best_axis = 0, best_split = 1;
+  for (size_t axis = 0; axis < axis_count; axis++) {
+    qsort(&bvh->items[start], count, sizeof(bvh_item_t),
+          BVH_AXIS_COMPARES[axis]);
+    size_t split;
+    double cost =
+        bvh_best_split(&bvh->items[start], count, &right_areas[start], &split);
+    if (cost < best_cost) {
+      best_cost = cost;
+      best_axis = axis;
+      best_split = split;
+    }
+  }
+
+  double area = aabb_perimeter(box);
+  double split_cost =
+      BVH_TRAVERSAL_COST + (area > 0 ? best_cost / area : count);
+  if (count <= BVH_MAX_LEAF && count <= split_cost) {
+    return index;
+  }
+
+  if (best_axis != axis_count - 1) {
+    qsort(&bvh->items[start], count, sizeof(bvh_item_t),
+          BVH_AXIS_COMPARES[best_axis]);
+  }
+  bvh_build(bvh, start, start + best_split, right_areas);
+  size_t right = bvh_build(bvh, start + best_split, end, right_areas);
+  bvh->nodes[index].offset = right;
+  bvh->nodes[index].count = 0;
+  return index;
+}
+
+bvh_t *bvh_init(list_t *bodies) {
+  bvh_t *bvh = track_malloc(TRACK_BVH, sizeof(bvh_t));
+  assert(bvh != NULL);
+  size_t count = list_size(bodies);
+  *bvh = (bvh_t){
+      .items = track_malloc(TRACK_BVH, count * sizeof(bvh_item_t)),
+      .item_count = count,
+      .nodes = track_malloc(TRACK_BVH, (2 * count + 1) * sizeof(bvh_node_t)),
+      .node_count = 0};
+  assert(bvh->items != NULL && bvh->nodes != NULL);
+  if (count == 0) {
+    return bvh;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    body_t *body = list_get(bodies, i);
+    aabb_t box = body_get_aabb(body);
+    bvh->items[i] = (bvh_item_t){
+        .body = body, .box = box, .center = vec_average(box.min, box.max)};
+  }
+  double *right_areas = malloc(count * sizeof(double));
+  assert(right_areas != NULL);
+  bvh_build(bvh, 0, count, right_areas);
+  free(right_areas);
+  return bvh;
+}
+
+bool bvh_baked_is_valid(const bvh_baked_node_t *nodes, size_t node_count,
+                        size_t item_count) {
+  if (node_count == 0) {
+    return item_count == 0;
+  }
+  // Right children of the internal nodes passed so far, nearest last
+  size_t *pending = malloc(node_count * sizeof(size_t));
+  assert(pending != NULL);
+  size_t pending_count = 0;
+  size_t next_item = 0;
+  bool valid = true;
+  for (size_t i = 0; i < node_count && valid; i++) {
+    const bvh_baked_node_t *node = &nodes[i];
+    if (node->count == 0) {
+      // The left child comes next, and the right child after all of the
+      // left child's subtree
+      valid = node->offset > i + 1 && node->offset < node_count;
+      pending[pending_count++] = node->offset;
+      continue;
+    }
+    valid = node->offset == next_item && node->count <= item_count - next_item;
+    next_item += node->count;
+    // After a leaf comes the right child of the nearest internal node still
+    // waiting for one
+    if (valid && i + 1 < node_count) {
+      valid = pending_count > 0 && pending[--pending_count] == i + 1;
+    }
+  }
+  free(pending);
+  return valid && pending_count == 0 && next_item == item_count;
+}
+
+bvh_t *bvh_init_baked(list_t *bodies, const bvh_baked_node_t *nodes,
+                      size_t node_count, const bvh_baked_item_t *items,
+                      size_t item_count) {
+  if (!bvh_baked_is_valid(nodes, node_count, item_count)) {
+    return NULL;
+  }
+  for (size_t i = 0; i < item_count; i++) {
+    if (items[i].body >= list_size(bodies)) {
+      return NULL;
+    }
+  }
+  bvh_t *bvh = track_malloc(TRACK_BVH, sizeof(bvh_t));
+  assert(bvh != NULL);
+  *bvh = (bvh_t){
+      .items = track_malloc(TRACK_BVH, item_count * sizeof(bvh_item_t)),
+      .item_count = item_count,
+      .nodes = track_malloc(TRACK_BVH, node_count * sizeof(bvh_node_t)),
+      .node_count = node_count};
+  assert(bvh->items != NULL || item_count == 0);
+  assert(bvh->nodes != NULL || node_count == 0);
+  for (size_t i = 0; i < item_count; i++) {
+    bvh->items[i] =
+        (bvh_item_t){.body = list_get(bodies, items[i].body),
+                     .box = items[i].box,
+                     .center = vec_average(items[i].box.min, items[i].box.max)};
+  }
+  for (size_t i = 0; i < node_count; i++) {
+    const bvh_baked_node_t *node = &nodes[i];
+    bvh->nodes[i] = (bvh_node_t){
+        .box = node->box, .offset = node->offset, .count = node->count};
+  }
+  return bvh;
+}
+
+void bvh_free(bvh_t *bvh) {
+  track_free(bvh->items);
+  track_free(bvh->nodes);
+  track_free(bvh);
+}
+
+size_t bvh_size(bvh_t *bvh) { return bvh->item_count; }
+
+size_t bvh_node_count(bvh_t *bvh) { return bvh->node_count; }
+
+void bvh_bake(bvh_t *bvh, list_t *bodies, bvh_baked_node_t *nodes,
+              bvh_baked_item_t *items) {
+  for (size_t i = 0; i < bvh->node_count; i++) {
+    bvh_node_t *node = &bvh->nodes[i];
+    assert(node->offset <= UINT32_MAX && node->count <= UINT32_MAX);
+    nodes[i] = (bvh_baked_node_t){
+        .box = node->box, .offset = node->offset, .count = node->count};
+  }
+  for (size_t i = 0; i < bvh->item_count; i++) {
+    size_t index = 0;
+    while (index < list_size(bodies) &&
+           list_get(bodies, index) != bvh->items[i].body) {
+      index++;
+    }
+    assert(index < list_size(bodies) && index <= UINT32_MAX);
+    items[i] = (bvh_baked_item_t){
+        .box = bvh->items[i].box, .body = index, .padding = 0};
+  }
+}
+
+void bvh_query_node(bvh_t *bvh, size_t index, aabb_t box, bvh_visitor_t visit,
+                    void *aux) {
+  bvh_node_t *node = &bvh->nodes[index];
+  if (!aabb_overlaps(node->box, box)) {
+    return;
+  }
+  if (node->count == 0) {
+    bvh_query_node(bvh, index + 1, box, visit, aux);
+    bvh_query_node(bvh, node->offset, box, visit, aux);
+    return;
+  }
+  for (size_t i = node->offset; i < node->offset + node->count; i++) {
+    if (aabb_overlaps(bvh->items[i].box, box)) {
+      visit(bvh->items[i].body, aux);
+    }
+  }
+}
+
+void bvh_query(bvh_t *bvh, aabb_t box, bvh_visitor_t visit, void *aux) {
+  if (bvh->node_count > 0) {
+    bvh_query_node(bvh, 0, box, visit, aux);
+  }
+}
@@ -4,7 +4,22 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+// Shape1 stays the reference shape unless shape2's axis is clearly better,
+// so the manifold does not flip between nearly equal axes from tick to tick
+const double REFERENCE_TOLERANCE = 1e-3;
+// Bit set in a contact point id when the point was cut by a side plane
+const size_t CLIPPED_FEATURE = 1;
+
+/**
+ * Narrow-phase tests run so far on this thread, for collision_test_count().
+ * Per thread, so scenes ticked on different threads do not race on it.
+ */
+_Thread_local size_t collision_tests = 0;
+
+size_t collision_test_count(void) { return collision_tests; }
+
 collision_info_t find_collision(list_t *shape1, list_t *shape2) {
+  collision_tests++;
 
   collision_info_t collision = {false};
   double min_overlap = INFINITY;
@@ -107,5 +122,262 @@ collision_info_t find_collision(list_t *shape1, list_t *shape2) {
   }
 
   collision.collided = true;
+  collision.depth = min_overlap;
   return collision;
+}
+
+vector_t shape_vertex(list_t *shape, size_t index) {
+  return *(vector_t *)list_get(shape, index % list_size(shape));
+}
+
+/** 1 for counterclockwise shapes, -1 for clockwise ones */
+double shape_winding(list_t *shape) {
+  double area = 0;
+  for (size_t i = 0; i < list_size(shape); i++) {
+    vector_t v1 = shape_vertex(shape, i);
+    vector_t v2 = shape_vertex(shape, i + 1);
+    area += vec_cross(v1, v2);
+  }
+  return area < 0 ? -1 : 1;
+}
+
+/** Outward unit normal of the edge from vertex index to vertex index + 1 */
+vector_t edge_normal(list_t *shape, size_t index, double winding) {
+  vector_t edge =
+      vec_subtract(shape_vertex(shape, index + 1), shape_vertex(shape, index));
+  return vec_unit_vector(vec_multiply(winding, (vector_t){edge.y, -edge.x}));
+}
+
+/**
+ * Finds the edge of reference that other penetrates the least.
+ * Returns the signed distance of other from that edge (negative if they
+ * overlap) and stores the edge's index in edge.
+ */
+double max_separation(list_t *reference, double winding, list_t *other,
+                      size_t *edge) {
+  double best = -INFINITY;
+  for (size_t i = 0; i < list_size(reference); i++) {
+    vector_t normal = edge_normal(reference, i, winding);
+    vector_t vertex = shape_vertex(reference, i);
+    double separation = INFINITY;
+    for (size_t j = 0; j < list_size(other); j++) {
+      double distance =
+          vec_dot(normal, vec_subtract(shape_vertex(other, j), vertex));
+      separation = fmin(separation, distance);
+    }
+    if (separation > best) {
+      best = separation;
+      *edge = i;
+    }
+  }
+  return best;
+}
+
+/**
+ * Keeps the part of a segment where dot(normal, point) <= offset.
+ * Returns false if the whole segment is outside.
+ */
+bool clip_segment(vector_t points[2], size_t ids[2], vector_t normal,
+                  double offset) {
+  double distance0 = vec_dot(normal, points[0]) - offset;
+  double distance1 = vec_dot(normal, points[1]) - offset;
+  if (distance0 > 0 && distance1 > 0) {
+    return false;
+  }
+  if (distance0 > 0 || distance1 > 0) {
+    size_t outside = distance0 > 0 ? 0 : 1;
+    double t = distance0 / (distance0 - distance1);
+    points[outside] = vec_add(
+        points[0], vec_multiply(t, vec_subtract(points[1], points[0])));
+    ids[outside] |= CLIPPED_FEATURE;
+  }
+  return true;
+}
+
+contact_manifold_t find_contact_manifold(list_t *shape1, list_t *shape2) {
+  collision_tests++;
+  contact_manifold_t manifold = {.point_count = 0};
+  if (list_size(shape1) < 3 || list_size(shape2) < 3) {
+    return manifold;
+  }
+  double winding1 = shape_winding(shape1);
+  double winding2 = shape_winding(shape2);
+  size_t edge1, edge2;
+  double separation1 = max_separation(shape1, winding1, shape2, &edge1);
+  if (separation1 > 0) {
+    return manifold;
+  }
+  double separation2 = max_separation(shape2, winding2, shape1, &edge2);
+  if (separation2 > 0) {
+    return manifold;
+  }
+
+  bool flip = separation2 > separation1 + REFERENCE_TOLERANCE;
+  list_t *reference = flip ? shape2 : shape1;
+  list_t *incident = flip ? shape1 : shape2;
+  size_t reference_edge = flip ? edge2 : edge1;
+  double incident_winding = flip ? winding1 : winding2;
+  vector_t normal =
+      edge_normal(reference, reference_edge, flip ? winding2 : winding1);
+
+  // The incident edge is the one facing the reference edge the most
+  size_t incident_edge = 0;
+  double min_dot = INFINITY;
+  for (size_t i = 0; i < list_size(incident); i++) {
+    double dot = vec_dot(edge_normal(incident, i, incident_winding), normal);
+    if (dot < min_dot) {
+      min_dot = dot;
+      incident_edge = i;
+    }
+  }
+  vector_t points[2] = {shape_vertex(incident, incident_edge),
+                        shape_vertex(incident, incident_edge + 1)};
+  size_t ids[2] = {incident_edge << 1,
+                   ((incident_edge + 1) % list_size(incident)) << 1};
+
+  // Clip the incident edge to the sides of the reference edge
+  vector_t start = shape_vertex(reference, reference_edge);
+  vector_t end = shape_vertex(reference, reference_edge + 1);
+  vector_t tangent = vec_unit_vector(vec_subtract(end, start));
+  if (!clip_segment(points, ids, vec_negate(tangent),
+                    -vec_dot(tangent, start)) ||
+      !clip_segment(points, ids, tangent, vec_dot(tangent, end))) {
+    return manifold;
+  }
+
+  manifold.normal = flip ? vec_negate(normal) : normal;
+  for (size_t i = 0; i < 2; i++) {
+    double separation = vec_dot(normal, vec_subtract(points[i], start));
+    if (separation > 0) {
+      continue;
+    }
+    // Pack the reference edge, incident feature and direction into the id
+    size_t id = (reference_edge << 16 | ids[i]) << 1 | flip;
+    manifold.points[manifold.point_count++] =
+        (contact_point_t){.point = points[i], .depth = -separation, .id = id};
+  }
+  return manifold;
+}
+
+/**
+ * Computes the range of times during which a moving interval overlaps a still
+ * one along a single axis. Returns false if they never overlap.
+ */
+bool axis_overlap_times(double moving_min, double moving_max,
+                        double displacement, double still_min,
+                        double still_max, double *enter, double *exit) {
+  if (displacement == 0) {
+    *enter = -INFINITY;
+    *exit = INFINITY;
+    return moving_max >= still_min && still_max >= moving_min;
+  }
+  double t1 = (still_min - moving_max) / displacement;
+  double t2 = (still_max - moving_min) / displacement;
+  *enter = fmin(t1, t2);
+  *exit = fmax(t1, t2);
+  return true;
+}
+
+segment_hit_t find_segment_hit(list_t *shape, vector_t start, vector_t end) {
+  collision_tests++;
+  segment_hit_t result = {.hit = false, .fraction = INFINITY};
+  vector_t direction = vec_subtract(end, start);
+  size_t n = list_size(shape);
+  for (size_t i = 0; i < n; i++) {
+    vector_t a = *(vector_t *)list_get(shape, i);
+    vector_t b = *(vector_t *)list_get(shape, (i + 1) % n);
+    vector_t edge = vec_subtract(b, a);
+    double denominator = vec_cross(direction, edge);
+    if (denominator == 0) {
+      // Parallel to the edge, so it can only graze it
+      continue;
+    }
+    vector_t offset = vec_subtract(a, start);
+    double fraction = vec_cross(offset, edge) / denominator;
+    double along_edge = vec_cross(offset, direction) / denominator;
+    if (fraction < 0 || fraction > 1 || along_edge < 0 || along_edge > 1 ||
+        fraction >= result.fraction) {
+      continue;
+    }
+    vector_t normal = vec_unit_vector((vector_t){-edge.y, edge.x});
+    if (vec_dot(normal, direction) > 0) {
+      normal = vec_negate(normal);
+    }
+    result = (segment_hit_t){
+        .hit = true,
+        .fraction = fraction,
+        .point = vec_add(start, vec_multiply(fraction, direction)),
+        .normal = normal};
+  }
+  return result;
+}
+
+segment_hit_t find_shape_hit(list_t *moving, vector_t displacement,
+                             list_t *still) {
+  collision_tests++;
+  collision_info_t overlap = find_collision(moving, still);
+  if (overlap.collided) {
+    contact_manifold_t manifold = find_contact_manifold(moving, still);
+    vector_t point = manifold.point_count > 0
+                         ? manifold.points[0].point
+                         : *(vector_t *)list_get(moving, 0);
+    return (segment_hit_t){.hit = true,
+                           .fraction = 0,
+                           .point = point,
+                           .normal = vec_negate(overlap.axis)};
+  }
+
+  segment_hit_t result = {.hit = false, .fraction = INFINITY};
+  for (size_t i = 0; i < list_size(moving); i++) {
+    vector_t vertex = *(vector_t *)list_get(moving, i);
+    segment_hit_t hit =
+        find_segment_hit(still, vertex, vec_add(vertex, displacement));
+    if (hit.hit && hit.fraction < result.fraction) {
+      result = hit;
+    }
+  }
+  // Still vertices move the other way relative to the moving shape
+  for (size_t i = 0; i < list_size(still); i++) {
+    vector_t vertex = *(vector_t *)list_get(still, i);
+    segment_hit_t hit =
+        find_segment_hit(moving, vertex, vec_subtract(vertex, displacement));
+    if (hit.hit && hit.fraction < result.fraction) {
+      result = (segment_hit_t){.hit = true,
+                               .fraction = hit.fraction,
+                               .point = vertex,
+                               .normal = vec_negate(hit.normal)};
+    }
+  }
+  return result;
+}
+
+bool aabb_overlaps(aabb_t box1, aabb_t box2) {
+  return box1.min.x <= box2.max.x && box2.min.x <= box1.max.x &&
+         box1.min.y <= box2.max.y && box2.min.y <= box1.max.y;
+}
+
+aabb_t aabb_union(aabb_t box1, aabb_t box2) {
+  return (aabb_t){.min = {fmin(box1.min.x, box2.min.x),
+                          fmin(box1.min.y, box2.min.y)},
+                  .max = {fmax(box1.max.x, box2.max.x),
+                          fmax(box1.max.y, box2.max.y)}};
+}
+
+double find_time_of_impact(aabb_t moving, vector_t displacement,
+                           aabb_t still) {
+  double enter_x, exit_x, enter_y, exit_y;
+  if (!axis_overlap_times(moving.min.x, moving.max.x, displacement.x,
+                          still.min.x, still.max.x, &enter_x, &exit_x) ||
+      !axis_overlap_times(moving.min.y, moving.max.y, displacement.y,
+                          still.min.y, still.max.y, &enter_y, &exit_y)) {
+    return INFINITY;
+  }
+
+  double enter = fmax(enter_x, enter_y);
+  double exit = fmin(exit_x, exit_y);
+  // Already overlapping, never overlapping, or overlapping too late
+  if (enter < 0 || enter > exit || enter > 1) {
+    return INFINITY;
+  }
+  return enter;
 }
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "contact.h"
+#include "alloc_track.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Fraction of the overlap corrected per second of simulated time, per tick
+const double BAUMGARTE = 0.2;
+// Overlap allowed to remain, so resting contacts stay touching
+const double LINEAR_SLOP = 0.01;
+// Impacts slower than this do not bounce, so resting bodies settle
+const double RESTITUTION_THRESHOLD = 1.0;
+
+typedef struct contact {
+  body_t *body1;
+  body_t *body2;
+  double elasticity;
+  contact_manifold_t manifold;
+  // Normal impulse accumulated at each manifold point, kept across ticks
+  double impulses[MAX_MANIFOLD_POINTS];
+  // Separating speed each point should reach by the end of the tick
+  double targets[MAX_MANIFOLD_POINTS];
+  double normal_mass;
+  bool is_active;
+} contact_t;
+
+contact_t *contact_init(body_t *body1, body_t *body2, double elasticity) {
+  contact_t *contact = track_malloc(TRACK_CONTACT, sizeof(contact_t));
+  assert(contact != NULL);
+  contact_reset(contact, body1, body2, elasticity);
+  return contact;
+}
+
+void contact_reset(contact_t *contact, body_t *body1, body_t *body2,
+                   double elasticity) {
+  *contact = (contact_t){.body1 = body1,
+                         .body2 = body2,
+                         .elasticity = elasticity,
+                         .manifold = {.point_count = 0},
+                         .is_active = false};
+}
+
+body_t *contact_get_body2(contact_t *contact) { return contact->body2; }
+
+void contact_free(contact_t *contact) { track_free(contact); }
+
+bool contact_is_removed(contact_t *contact) {
+  return body_is_removed(contact->body1) || body_is_removed(contact->body2);
+}
+
+/** Bodies that are not dynamic, or have infinite mass, take no impulse */
+double inverse_mass(body_t *body) {
+  double mass = body_get_mass(body);
+  if (body_get_motion_type(body) != MOTION_DYNAMIC || mass == INFINITY) {
+    return 0;
+  }
+  return 1 / mass;
+}
+
+/** Applies an impulse to body2 and the opposite impulse to body1 */
+void contact_apply(contact_t *contact, vector_t impulse) {
+  if (inverse_mass(contact->body1) > 0) {
+    body_add_impulse(contact->body1, vec_negate(impulse));
+  }
+  if (inverse_mass(contact->body2) > 0) {
+    body_add_impulse(contact->body2, impulse);
+  }
+}
+
+/** Speed at which the bodies will be separating at the end of the tick */
+double contact_normal_velocity(contact_t *contact, double dt) {
+  vector_t relative = vec_subtract(body_get_tick_velocity(contact->body2, dt),
+                                   body_get_tick_velocity(contact->body1, dt));
+  return vec_dot(relative, contact->manifold.normal);
+}
+
+void contact_prepare(contact_t *contact, double dt) {
+  contact->is_active = false;
+  if (body_is_resting(contact->body1) && body_is_resting(contact->body2)) {
+    // Keep the cached impulses for when the bodies wake up
+    if (contact->manifold.point_count > 0) {
+      body_join_islands(contact->body1, contact->body2);
+    }
+    return;
+  }
+  double inverse_masses =
+      inverse_mass(contact->body1) + inverse_mass(contact->body2);
+  contact_manifold_t old_manifold = contact->manifold;
+  double old_impulses[MAX_MANIFOLD_POINTS];
+  for (size_t i = 0; i < old_manifold.point_count; i++) {
+    old_impulses[i] = contact->impulses[i];
+  }
+  contact->manifold =
+      find_contact_manifold(body_get_world_shape(contact->body1),
+                            body_get_world_shape(contact->body2));
+  if (contact->manifold.point_count == 0 || inverse_masses == 0) {
+    return;
+  }
+  body_touch(contact->body1, contact->body2);
+  contact->normal_mass = 1 / inverse_masses;
+  contact->is_active = true;
+
+  double approach = contact_normal_velocity(contact, dt);
+  for (size_t i = 0; i < contact->manifold.point_count; i++) {
+    contact_point_t *point = &contact->manifold.points[i];
+
+    // Warm start from the impulse found at the same point last tick
+    contact->impulses[i] = 0;
+    for (size_t j = 0; j < old_manifold.point_count; j++) {
+      if (old_manifold.points[j].id == point->id) {
+        contact->impulses[i] = old_impulses[j];
+        break;
+      }
+    }
+    contact_apply(contact, vec_multiply(contact->impulses[i],
+                                        contact->manifold.normal));
+
+    double bias = dt > 0 ? BAUMGARTE / dt * fmax(point->depth - LINEAR_SLOP, 0)
+                         : 0;
+    double bounce = approach < -RESTITUTION_THRESHOLD
+                        ? -contact->elasticity * approach
+                        : 0;
+    contact->targets[i] = fmax(bias, bounce);
+  }
+}
+
+void contact_solve(contact_t *contact, double dt) {
+  if (!contact->is_active) {
+    return;
+  }
+  for (size_t i = 0; i < contact->manifold.point_count; i++) {
+    double velocity = contact_normal_velocity(contact, dt);
+    double delta = (contact->targets[i] - velocity) * contact->normal_mass;
+    // The accumulated impulse may only push the bodies apart
+    double accumulated = fmax(contact->impulses[i] + delta, 0);
+    delta = accumulated - contact->impulses[i];
+    contact->impulses[i] = accumulated;
+    contact_apply(contact, vec_multiply(delta, contact->manifold.normal));
+  }
+}
+
+contact_state_t contact_save(contact_t *contact) {
+  contact_state_t state = {.manifold = contact->manifold};
+  for (size_t i = 0; i < MAX_MANIFOLD_POINTS; i++) {
+    state.impulses[i] = contact->impulses[i];
+  }
+  return state;
+}
+
+void contact_restore(contact_t *contact, const contact_state_t *state) {
+  contact->manifold = state->manifold;
+  for (size_t i = 0; i < MAX_MANIFOLD_POINTS; i++) {
+    contact->impulses[i] = state->impulses[i];
+  }
+}
@@ -1,4 +1,6 @@
 #include "force_creator.h"
+#include "alloc_track.h"
+#include "scene.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -14,18 +16,16 @@ typedef struct force_aux_1body {
   body_t *body;
 } force_aux_1body_t;
 
-typedef struct force_aux_collision_bodies {
-  body_t *body1;
-  body_t *body2;
-} force_aux_collision_bodies_t;
-
 typedef struct force_aux_collision {
+  scene_t *scene;
   collision_handler_t handler;
   body_t *body1;
   body_t *body2;
   void *collision_aux;
   free_func_t freer;
   bool are_colliding;
+  // Last collision found, reported again while both bodies rest
+  collision_info_t last_info;
 } force_aux_collision_t;
 
 typedef struct collision_aux_destructive {
@@ -39,7 +39,8 @@ typedef struct collision_aux_physics {
 } collision_aux_physics_t;
 
 force_aux_1body_t *force_aux_1body_init(double constant, body_t *body) {
-  force_aux_1body_t *aux = malloc(sizeof(force_aux_1body_t));
+  force_aux_1body_t *aux =
+      track_malloc(TRACK_FORCE_AUX, sizeof(force_aux_1body_t));
   aux->Constant = constant;
   aux->body = body;
   return aux;
@@ -47,26 +48,21 @@ force_aux_1body_t *force_aux_1body_init(double constant, body_t *body) {
 
 force_aux_2bodies_t *force_aux_2bodies_init(double constant, body_t *body1,
                                             body_t *body2) {
-  force_aux_2bodies_t *aux = malloc(sizeof(force_aux_2bodies_t));
+  force_aux_2bodies_t *aux =
+      track_malloc(TRACK_FORCE_AUX, sizeof(force_aux_2bodies_t));
   aux->Constant = constant;
   aux->body1 = body1;
   aux->body2 = body2;
   return aux;
 }
 
-force_aux_collision_bodies_t *force_aux_collision_bodies_init(body_t *body1,
-                                                              body_t *body2) {
-  force_aux_collision_bodies_t *aux =
-      malloc(sizeof(force_aux_collision_bodies_t));
-  aux->body1 = body1;
-  aux->body2 = body2;
-  return aux;
-}
-
-force_aux_collision_t *force_aux_collision_init(body_t *body1, body_t *body2,
+force_aux_collision_t *force_aux_collision_init(scene_t *scene, body_t *body1,
+                                                body_t *body2,
                                                 collision_handler_t handler,
                                                 void *aux, free_func_t freer) {
-  force_aux_collision_t *collision_aux = malloc(sizeof(force_aux_collision_t));
+  force_aux_collision_t *collision_aux =
+      track_malloc(TRACK_FORCE_AUX, sizeof(force_aux_collision_t));
+  collision_aux->scene = scene;
   collision_aux->body1 = body1;
   collision_aux->body2 = body2;
   collision_aux->handler = handler;
@@ -77,7 +73,8 @@ force_aux_collision_t *force_aux_collision_init(body_t *body1, body_t *body2,
 }
 
 collision_aux_physics_t *collision_aux_physics_init(double elasticity) {
-  collision_aux_physics_t *aux = malloc(sizeof(collision_aux_physics_t));
+  collision_aux_physics_t *aux =
+      track_malloc(TRACK_FORCE_AUX, sizeof(collision_aux_physics_t));
   aux->elasticity = elasticity;
   return aux;
 }
@@ -87,7 +84,7 @@ collision_aux_destructive_init(bool body1_is_destroyable,
                                bool body2_is_destroyable,
                                size_t coll_before_destruct) {
   collision_aux_destructive_t *aux =
-      malloc(sizeof(collision_aux_destructive_t));
+      track_malloc(TRACK_FORCE_AUX, sizeof(collision_aux_destructive_t));
   aux->body1_is_destroyable = body1_is_destroyable;
   aux->body2_is_destroyable = body2_is_destroyable;
   aux->coll_before_destruct = coll_before_destruct;
@@ -99,6 +96,10 @@ void calc_gravity(void *void_aux) {
   double G = aux->Constant;
   body_t *body1 = aux->body1;
   body_t *body2 = aux->body2;
+  // Gravity alone does not wake a resting body; its support cancels it out
+  if (body_is_sleeping(body1) || body_is_sleeping(body2)) {
+    return;
+  }
 
   vector_t diff =
       vec_subtract(body_get_centroid(body1), body_get_centroid(body2));
@@ -141,20 +142,50 @@ void calc_drag(void *void_aux) {
   body_add_force(body, force);
 }
 
+/**
+ * Two bodies that are both static or asleep cannot start touching,
+ * so they are never tested against each other
+ */
+bool both_resting(body_t *body1, body_t *body2) {
+  return body_is_resting(body1) && body_is_resting(body2);
+}
+
+/** Records the outcome of testing a pair; the scene dispatches it later */
+void push_collision_event(force_aux_collision_t *aux, collision_phase_t phase,
+                          collision_info_t info) {
+  collision_event_t event = {.handler = aux->handler,
+                             .body1 = aux->body1,
+                             .body2 = aux->body2,
+                             .axis = info.axis,
+                             .depth = info.depth,
+                             .phase = phase,
+                             .aux = aux->collision_aux};
+  scene_add_collision_event(aux->scene, event);
+}
+
 void calc_collision(void *void_aux) {
   force_aux_collision_t *aux = (force_aux_collision_t *)void_aux;
-  list_t *shape1 = body_get_shape(aux->body1);
-  list_t *shape2 = body_get_shape(aux->body2);
-  collision_info_t info = find_collision(shape1, shape2);
-  if (!aux->are_colliding && info.collided && aux->body1 != aux->body2) {
+  if (aux->body1 == aux->body2) {
+    return;
+  }
+  if (both_resting(aux->body1, aux->body2)) {
+    // A sleeping stack keeps touching, and stays one island, while it sleeps
+    if (aux->are_colliding) {
+      push_collision_event(aux, COLLISION_PERSIST, aux->last_info);
+    }
+    return;
+  }
+  collision_info_t info = find_collision(body_get_world_shape(aux->body1),
+                                         body_get_world_shape(aux->body2));
+  if (info.collided) {
+    aux->last_info = info;
+    push_collision_event(
+        aux, aux->are_colliding ? COLLISION_PERSIST : COLLISION_BEGIN, info);
     aux->are_colliding = true;
-    vector_t axis = info.axis;
-    aux->handler(aux->body1, aux->body2, axis, aux->collision_aux);
-  } else if (!info.collided) {
+  } else if (aux->are_colliding) {
+    push_collision_event(aux, COLLISION_END, info);
     aux->are_colliding = false;
   }
-  list_free(shape1);
-  list_free(shape2);
 }
 
 void calc_destructive_collision(body_t *body1, body_t *body2, vector_t axis,
@@ -205,66 +236,14 @@ void calc_physics_collision(body_t *body1, body_t *body2, vector_t axis,
   body_add_impulse(body2, vec_negate(impulse_body1));
 }
 
-void calc_normal_force(void *void_aux) {
-  force_aux_collision_bodies_t *aux = (force_aux_collision_bodies_t *)void_aux;
-  body_t *body1 = aux->body1;
-  body_t *body2 = aux->body2;
-
-  list_t *shape1 = body_get_shape(body1);
-  list_t *shape2 = body_get_shape(body2);
-
-  collision_info_t collision = find_collision(shape1, shape2);
-
-  vector_t center_diff =
-      vec_subtract(body_get_centroid(body2), body_get_centroid(body1));
-  if (vec_dot(center_diff, collision.axis) < 0) {
-    collision.axis = vec_negate(collision.axis);
-  }
-
-  if (!collision.collided) {
-    list_free(shape1);
-    list_free(shape2);
-    return;
-  }
-  double normal_force_abs_body1 =
-      vec_dot(body_get_net_force(body1), collision.axis);
-  double normal_force_abs_body2 =
-      vec_dot(body_get_net_force(body2), collision.axis);
-
-  if (normal_force_abs_body1 < 0) {
-    normal_force_abs_body1 = 0;
-  }
-
-  if (normal_force_abs_body2 > 0) {
-    normal_force_abs_body2 = 0;
-  }
-
-  if (body_get_mass(body2) == INFINITY) {
-    vector_t normal =
-        vec_negate(vec_multiply(normal_force_abs_body1, collision.axis));
-    body_add_force(body1, normal);
-  }
-
-  else if (body_get_mass(body1) == INFINITY) {
-    vector_t normal =
-        vec_negate(vec_multiply(normal_force_abs_body2, collision.axis));
-    body_add_force(body2, normal);
-  }
-
-  else {
-    calc_physics_collision(body1, body2, collision.axis, aux);
-  }
-
-  list_free(shape1);
-  list_free(shape2);
-}
-
 void standard_free_aux(void *aux) { free(aux); }
 
+void tracked_free_aux(void *aux) { track_free(aux); }
+
 void free_aux_collision(void *void_aux) {
   force_aux_collision_t *aux = (force_aux_collision_t *)void_aux;
   if (aux->freer != NULL) {
     aux->freer(aux->collision_aux);
   }
-  free(aux);
+  track_free(aux);
 }
\ No newline at end of file
@@ -16,17 +16,17 @@ void create_newtonian_gravity(scene_t *scene, double G, body_t *body1,
   list_add(body_targets, body2);
 
   scene_add_bodies_force_creator(scene, (force_creator_t)calc_gravity, aux,
-                                 body_targets, standard_free_aux);
+                                 body_targets, tracked_free_aux);
 }
 
-void create_normal_force(scene_t *scene, body_t *body1, body_t *body2) {
-  force_aux_collision_bodies_t *aux =
-      force_aux_collision_bodies_init(body1, body2);
-  list_t *body_targets = list_init(collision_number_of_bodies, NULL);
-  list_add(body_targets, body1);
-  list_add(body_targets, body2);
-  scene_add_bodies_force_creator(scene, (force_creator_t)calc_normal_force, aux,
-                                 body_targets, standard_free_aux);
+void create_contact(scene_t *scene, double elasticity, body_t *body1,
+                    body_t *body2) {
+  scene_add_contact(scene, body1, body2, elasticity);
+}
+
+void create_static_contacts(scene_t *scene, double elasticity, body_t *body,
+                            uint32_t mask) {
+  scene_add_static_contacts(scene, body, mask, elasticity);
 }
 
 void create_spring(scene_t *scene, double k, body_t *body1, body_t *body2) {
@@ -36,7 +36,7 @@ void create_spring(scene_t *scene, double k, body_t *body1, body_t *body2) {
   list_add(body_targets, body2);
 
   scene_add_bodies_force_creator(scene, (force_creator_t)calc_spring, aux,
-                                 body_targets, standard_free_aux);
+                                 body_targets, tracked_free_aux);
 }
 
 void create_drag(scene_t *scene, double gamma, body_t *body) {
@@ -46,7 +46,7 @@ void create_drag(scene_t *scene, double gamma, body_t *body) {
   list_add(body_targets, body);
 
   scene_add_bodies_force_creator(scene, (force_creator_t)calc_drag, aux,
-                                 body_targets, standard_free_aux);
+                                 body_targets, tracked_free_aux);
 }
 
 void create_collision(scene_t *scene, body_t *body1, body_t *body2,
@@ -54,7 +54,7 @@ void create_collision(scene_t *scene, body_t *body1, body_t *body2,
                       free_func_t freer) {
   list_t *body_targets = list_init(collision_number_of_bodies, NULL);
   force_aux_collision_t *collision_aux =
-      force_aux_collision_init(body1, body2, handler, aux, freer);
+      force_aux_collision_init(scene, body1, body2, handler, aux, freer);
   list_add(body_targets, body1);
   list_add(body_targets, body2);
   scene_add_bodies_force_creator(scene, (force_creator_t)calc_collision,
@@ -77,7 +77,7 @@ void create_delayed_destructive_collision(
                                      collisions_before_destruction);
   create_collision(scene, body1, body2,
                    (collision_handler_t)calc_destructive_collision, aux,
-                   standard_free_aux);
+                   tracked_free_aux);
 }
 
 void create_physics_collision(scene_t *scene, double elasticity, body_t *body1,
@@ -85,5 +85,5 @@ void create_physics_collision(scene_t *scene, double elasticity, body_t *body1,
   collision_aux_physics_t *aux = collision_aux_physics_init(elasticity);
   create_collision(scene, body1, body2,
                    (collision_handler_t)calc_physics_collision, aux,
-                   standard_free_aux);
+                   tracked_free_aux);
 }
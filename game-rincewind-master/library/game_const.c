@@ -4,13 +4,23 @@ const vector_t MAX1 = {.x = 120.0, .y = 80.0};
 const vector_t MAX2 = {.x = 200.0, .y = 100.0};
 const vector_t MAX_MENU = {.x = 192.0, .y = 108.0};
 
+// Timers
+const double TIME_THRESHOLD = 1.0;
+const double TIME_MULT = 10.0;
+
 // Player
 const double PLAYER_MASS = 1.0;
+const int STARTING_LIVES = 5;
 const rgb_color_t PLAYER_1_COLOR = {.r = 1, .g = 0, .b = 0};
 const rgb_color_t PLAYER_2_COLOR = {.r = 0, .g = 1, .b = 0};
 
 // Powerups
 const int MAX_POWERUPS = 3;
 
+// Clock arms
+const double ANGLE_ERROR = 0.1;
+const double ANGULAR_MULTIPLIER_BIG = 1.3;
+const double ANGULAR_MULTIPLIER_SMALL = 1.5;
+
 // Gravity
 const double G = 6.67E-11;
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "list.h"
+#include "alloc_track.h"
 #include "vector.h"
 #include <assert.h>
 #include <math.h>
@@ -10,21 +11,38 @@ typedef struct list {
   size_t capacity;
   size_t size;
   free_func_t free_func;
+  // Where the list and its arrays came from, or NULL if they were allocated
+  arena_t *arena;
 } list_t;
 
 typedef void (*free_func_t)(void *);
 
+/** Allocates an array for a list, from its arena if it has one */
+void **list_alloc_array(list_t *list, size_t capacity) {
+  if (list->arena != NULL) {
+    return arena_alloc(list->arena, capacity * sizeof(void *));
+  }
+  void **array = track_malloc(TRACK_LIST, capacity * sizeof(void *));
+  assert(array != NULL);
+  return array;
+}
+
 list_t *list_init(size_t initial_size, free_func_t freer) {
-  list_t *list = malloc(sizeof(list_t));
+  return list_init_in(NULL, initial_size, freer);
+}
+
+list_t *list_init_in(arena_t *arena, size_t initial_size, free_func_t freer) {
+  list_t *list = arena != NULL ? arena_alloc(arena, sizeof(list_t))
+                               : track_malloc(TRACK_LIST, sizeof(list_t));
   assert(list != NULL);
   list->free_func = freer;
+  list->arena = arena;
   if (initial_size == 0) {
     initial_size = 1;
   }
   list->capacity = initial_size;
   list->size = 0;
-  list->array = malloc(list->capacity * sizeof(void **));
-  assert(list->array != NULL);
+  list->array = list_alloc_array(list, list->capacity);
   return list;
 }
 
@@ -79,20 +97,24 @@ void list_free(list_t *list) {
       list->free_func(list->array[i]);
     }
   }
-  free(list->array);
-  free(list);
+  if (list->arena == NULL) {
+    track_free(list->array);
+    track_free(list);
+  }
 }
 
 void list_resize(list_t *list) {
   if (list->size >= list->capacity) {
 
-    void **new_array = malloc(list->capacity * 2 * sizeof(void *));
+    void **new_array = list_alloc_array(list, list->capacity * 2);
     for (size_t i = 0; i < list->size; i += 1) {
       void *old = list_get(list, i);
       new_array[i] = old;
     }
 
-    free(list->array);
+    if (list->arena == NULL) {
+      track_free(list->array);
+    }
     list->array = new_array;
     list->capacity *= 2;
   }
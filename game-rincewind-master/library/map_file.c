@@ -0,0 +1,625 @@
+#include "map_file.h"
+#include "player.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Longest line, including its newline, in the text form of a map
+#define MAP_LINE_LENGTH 256
+
+const char MAP_FILE_MAGIC[4] = {'R', 'W', 'M', 'P'};
+// Records are in the machine's byte order, so a file written on a machine
+// with the other byte order has a byte-swapped version and is rejected
+const uint32_t MAP_FILE_VERSION = 1;
+const uint32_t MAP_FILE_NO_TEXTURE = UINT32_MAX;
+const char *const MAP_DELIMITERS = " \t\r\n";
+// Block size of the arena bodies are baked in while converting a map
+const size_t MAP_ARENA_BLOCK_SIZE = 16384;
+
+const char *const BODY_TYPE_NAMES[BODY_TYPE_COUNT] = {
+    "PLAYER1", "PLAYER2", "WALL", "GROUND", "BULLET", "GRAVITY", "BACKGROUND",
+    "POWERUP_RICOCHET", "POWERUP_SHOTGUN", "CLOCK_SMALL_ARM", "CLOCK_BIG_ARM",
+    "CLOCK", "P1_LIFE", "P2_LIFE"};
+// In the order of motion_type_t
+const char *const MOTION_TYPE_NAMES[] = {"dynamic", "kinematic", "static"};
+const char *const SPAWN_KIND_NAMES[SPAWN_KIND_COUNT] = {"PLAYER1", "PLAYER2",
+                                                        "POWERUP"};
+
+/**
+ * The start of a map file. It is followed by each of its sections in turn:
+ * the bodies, their vertices, the spawn points, the static hierarchy's nodes
+ * and items, and finally the texture names, each ending in '\0'.
+ * Every section but the last is a whole number of 8-byte records.
+ */
+typedef struct map_file_header {
+  char magic[4];
+  uint32_t version;
+  vector_t size;
+  uint32_t body_count;
+  uint32_t vertex_count;
+  uint32_t spawn_count;
+  uint32_t node_count;
+  uint32_t item_count;
+  uint32_t name_bytes;
+} map_file_header_t;
+
+typedef struct map_file_body {
+  vector_t centroid;
+  vector_t rotation_center;
+  double mass;
+  double rot_velocity;
+  double rot_acceleration;
+  rgb_color_t color;
+  uint32_t type;
+  uint32_t motion;
+  // The body's shape, relative to its centroid
+  uint32_t first_vertex;
+  uint32_t vertex_count;
+  // Offset of the body's texture among the names, or MAP_FILE_NO_TEXTURE
+  uint32_t texture;
+  // Whether the body spins about its rotation center
+  uint32_t spins;
+  uint32_t padding;
+} map_file_body_t;
+
+typedef struct map_file_spawn {
+  vector_t position;
+  uint32_t kind;
+  uint32_t padding;
+} map_file_spawn_t;
+
+typedef struct map_file {
+  void *data;
+  size_t length;
+  const map_file_header_t *header;
+  const map_file_body_t *bodies;
+  const vector_t *vertices;
+  const map_file_spawn_t *spawns;
+  const bvh_baked_node_t *nodes;
+  const bvh_baked_item_t *items;
+  const char *names;
+  // Spawn points are sorted by kind, so each kind's are together
+  size_t spawn_starts[SPAWN_KIND_COUNT + 1];
+} map_file_t;
+
+/** A map being read from its text form */
+typedef struct map_builder {
+  bool has_size;
+  vector_t size;
+  list_t *bodies;
+  list_t *vertices;
+  list_t *spawns;
+  list_t *names;
+  size_t name_bytes;
+} map_builder_t;
+
+/**
+ * Builds one of a map's bodies the way the game always has: the shape is
+ * placed, then set spinning, then given its motion type. Everything it
+ * allocates comes from the arena, including a copy of the name of the body's
+ * texture, if it has one.
+ */
+body_t *map_body_init(arena_t *arena, const map_file_body_t *record,
+                      const vector_t *vertices, const char *texture) {
+  list_t *shape = list_init_in(arena, record->vertex_count, NULL);
+  vector_t *copies =
+      arena_alloc(arena, record->vertex_count * sizeof(vector_t));
+  for (size_t i = 0; i < record->vertex_count; i++) {
+    copies[i] = vertices[record->first_vertex + i];
+    list_add(shape, &copies[i]);
+  }
+  body_info_t *info = info_init_in(arena, record->type, NO_SIDE, NO_WEAPON);
+  if (texture != NULL) {
+    char *name = arena_alloc(arena, strlen(texture) + 1);
+    strcpy(name, texture);
+    info->texture = name;
+  }
+  body_t *body =
+      body_init_in(arena, shape, record->mass, record->color, info, NULL);
+  body_set_centroid(body, record->centroid);
+  if (record->spins) {
+    body_set_rot_velocity(body, record->rot_velocity);
+    body_set_rot_acceleration(body, record->rot_acceleration);
+    body_set_rotation_center(body, record->rotation_center);
+  }
+  body_set_motion_type(body, record->motion);
+  return body;
+}
+
+/** Finds a name in a table, setting index to its position */
+bool map_parse_name(const char *token, const char *const names[],
+                    size_t count, size_t *index) {
+  if (token == NULL) {
+    return false;
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (strcmp(token, names[i]) == 0) {
+      *index = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+/** Reads the next token of a line as a number */
+bool map_parse_double(char **save, double *value) {
+  char *token = strtok_r(NULL, MAP_DELIMITERS, save);
+  if (token == NULL) {
+    return false;
+  }
+  char *end;
+  *value = strtod(token, &end);
+  return *end == '\0' && isfinite(*value);
+}
+
+/** Reads the next several tokens of a line as numbers */
+bool map_parse_doubles(char **save, double *values, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (!map_parse_double(save, &values[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/** Returns the offset of a texture name, adding it if it is new */
+uint32_t map_builder_texture(map_builder_t *builder, const char *name) {
+  size_t offset = 0;
+  for (size_t i = 0; i < list_size(builder->names); i++) {
+    char *other = list_get(builder->names, i);
+    if (strcmp(name, other) == 0) {
+      return offset;
+    }
+    offset += strlen(other) + 1;
+  }
+  char *copy = malloc(strlen(name) + 1);
+  assert(copy != NULL);
+  strcpy(copy, name);
+  list_add(builder->names, copy);
+  builder->name_bytes += strlen(name) + 1;
+  return offset;
+}
+
+/**
+ * Reads a rect or circle line, whose first token has been read.
+ * Returns an error message, or NULL if the body was added.
+ */
+const char *map_parse_body(map_builder_t *builder, const char *shape_name,
+                           char **save) {
+  size_t type, motion;
+  if (!map_parse_name(strtok_r(NULL, MAP_DELIMITERS, save), BODY_TYPE_NAMES,
+                      BODY_TYPE_COUNT, &type)) {
+    return "unknown body type";
+  }
+  if (!map_parse_name(strtok_r(NULL, MAP_DELIMITERS, save), MOTION_TYPE_NAMES,
+                      MOTION_STATIC + 1, &motion)) {
+    return "motion must be static, kinematic, or dynamic";
+  }
+  double dimensions[2];
+  if (!map_parse_doubles(save, dimensions, 2)) {
+    return "expected the body's size";
+  }
+  list_t *shape;
+  if (strcmp(shape_name, "rect") == 0) {
+    shape = rect_init(dimensions[0], dimensions[1]);
+  } else {
+    if (dimensions[1] < 3 || dimensions[1] != floor(dimensions[1])) {
+      return "a circle needs a whole number of points, at least 3";
+    }
+    shape = circle_init(dimensions[0], dimensions[1]);
+  }
+  double place[5];
+  if (!map_parse_doubles(save, place, 5)) {
+    list_free(shape);
+    return "expected the body's position and color";
+  }
+
+  map_file_body_t *record = malloc(sizeof(map_file_body_t));
+  assert(record != NULL);
+  *record = (map_file_body_t){
+      .centroid = {.x = place[0], .y = place[1]},
+      .mass = INFINITY,
+      .color = {.r = place[2], .g = place[3], .b = place[4]},
+      .type = type,
+      .motion = motion,
+      .first_vertex = list_size(builder->vertices),
+      .vertex_count = list_size(shape),
+      .texture = MAP_FILE_NO_TEXTURE};
+  while (list_size(shape) > 0) {
+    list_add(builder->vertices, list_remove(shape, 0));
+  }
+  list_free(shape);
+  list_add(builder->bodies, record);
+
+  char *option;
+  while ((option = strtok_r(NULL, MAP_DELIMITERS, save)) != NULL) {
+    if (strcmp(option, "mass") == 0) {
+      if (!map_parse_double(save, &record->mass) || record->mass <= 0) {
+        return "mass must be a positive number";
+      }
+    } else if (strcmp(option, "spin") == 0) {
+      double spin[4];
+      if (!map_parse_doubles(save, spin, 4)) {
+        return "spin needs a velocity, an acceleration, and a center";
+      }
+      record->rot_velocity = spin[0];
+      record->rot_acceleration = spin[1];
+      record->rotation_center = (vector_t){.x = spin[2], .y = spin[3]};
+      record->spins = true;
+    } else if (strcmp(option, "texture") == 0) {
+      char *name = strtok_r(NULL, MAP_DELIMITERS, save);
+      if (name == NULL) {
+        return "expected a texture name";
+      }
+      record->texture = map_builder_texture(builder, name);
+    } else {
+      return "unknown option";
+    }
+  }
+  return NULL;
+}
+
+/** Reads one line of a map. Returns an error message, or NULL */
+const char *map_parse_line(map_builder_t *builder, char *line) {
+  char *comment = strchr(line, '#');
+  if (comment != NULL) {
+    *comment = '\0';
+  }
+  char *save;
+  char *command = strtok_r(line, MAP_DELIMITERS, &save);
+  if (command == NULL) {
+    return NULL;
+  }
+  if (strcmp(command, "rect") == 0 || strcmp(command, "circle") == 0) {
+    return map_parse_body(builder, command, &save);
+  }
+
+  double values[2];
+  if (strcmp(command, "size") == 0) {
+    if (!map_parse_doubles(&save, values, 2)) {
+      return "expected the map's width and height";
+    }
+    builder->size = (vector_t){.x = values[0], .y = values[1]};
+    builder->has_size = true;
+  } else if (strcmp(command, "spawn") == 0) {
+    size_t kind;
+    if (!map_parse_name(strtok_r(NULL, MAP_DELIMITERS, &save),
+                        SPAWN_KIND_NAMES, SPAWN_KIND_COUNT, &kind)) {
+      return "spawn must be PLAYER1, PLAYER2, or POWERUP";
+    }
+    if (!map_parse_doubles(&save, values, 2)) {
+      return "expected the spawn point";
+    }
+    map_file_spawn_t *spawn = malloc(sizeof(map_file_spawn_t));
+    assert(spawn != NULL);
+    *spawn = (map_file_spawn_t){
+        .position = {.x = values[0], .y = values[1]}, .kind = kind};
+    list_add(builder->spawns, spawn);
+  } else {
+    return "unknown command";
+  }
+  return strtok_r(NULL, MAP_DELIMITERS, &save) == NULL ? NULL
+                                                       : "too many values";
+}
+
+/** Reads the text form of a map, reporting any error on stderr */
+bool map_parse(map_builder_t *builder, const char *text_path) {
+  FILE *file = fopen(text_path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "%s: could not open map\n", text_path);
+    return false;
+  }
+  char line[MAP_LINE_LENGTH];
+  size_t line_number = 0;
+  const char *error = NULL;
+  while (error == NULL && fgets(line, sizeof(line), file) != NULL) {
+    line_number++;
+    if (strchr(line, '\n') == NULL && !feof(file)) {
+      error = "line too long";
+    } else {
+      error = map_parse_line(builder, line);
+    }
+  }
+  fclose(file);
+  if (error == NULL && !builder->has_size) {
+    error = "missing size";
+  }
+  if (error != NULL) {
+    fprintf(stderr, "%s:%zu: %s\n", text_path, line_number, error);
+    return false;
+  }
+  return true;
+}
+
+/** Copies a list of records into an array */
+void *map_flatten(list_t *records, size_t record_size) {
+  char *array = malloc(list_size(records) * record_size + 1);
+  assert(array != NULL);
+  for (size_t i = 0; i < list_size(records); i++) {
+    memcpy(array + i * record_size, list_get(records, i), record_size);
+  }
+  return array;
+}
+
+/**
+ * Builds the static hierarchy the scene will build over the map's bodies,
+ * with its items referring to bodies by their index in the map. The bodies
+ * come from the arena.
+ */
+bvh_t *map_bake_static_bvh(const map_file_body_t *records, size_t body_count,
+                           const vector_t *vertices, arena_t *arena,
+                           list_t **bodies) {
+  *bodies = list_init(body_count, (free_func_t)body_free);
+  for (size_t i = 0; i < body_count; i++) {
+    list_add(*bodies, map_body_init(arena, &records[i], vertices, NULL));
+  }
+  // Statics are gathered by type, like the scene does (see
+  // scene_build_static_bvh()), so the trees are the same
+  list_t *statics = list_init(body_count, NULL);
+  for (size_t type = 0; type < BODY_TYPE_COUNT; type++) {
+    for (size_t i = 0; i < body_count; i++) {
+      if (records[i].type == type && records[i].motion == MOTION_STATIC) {
+        list_add(statics, list_get(*bodies, i));
+      }
+    }
+  }
+  bvh_t *bvh = bvh_init(statics);
+  list_free(statics);
+  return bvh;
+}
+
+bool map_file_write(map_builder_t *builder, const char *map_path) {
+  size_t body_count = list_size(builder->bodies);
+  map_file_body_t *bodies = map_flatten(builder->bodies, sizeof(*bodies));
+  vector_t *vertices = map_flatten(builder->vertices, sizeof(*vertices));
+  map_file_spawn_t *spawns = malloc(list_size(builder->spawns) *
+                                    sizeof(map_file_spawn_t));
+  assert(spawns != NULL);
+  size_t spawn_count = 0;
+  for (map_spawn_t kind = 0; kind < SPAWN_KIND_COUNT; kind++) {
+    for (size_t i = 0; i < list_size(builder->spawns); i++) {
+      map_file_spawn_t *spawn = list_get(builder->spawns, i);
+      if (spawn->kind == kind) {
+        spawns[spawn_count++] = *spawn;
+      }
+    }
+  }
+  char *names = malloc(builder->name_bytes + 1);
+  assert(names != NULL);
+  size_t name_bytes = 0;
+  for (size_t i = 0; i < list_size(builder->names); i++) {
+    char *name = list_get(builder->names, i);
+    strcpy(names + name_bytes, name);
+    name_bytes += strlen(name) + 1;
+  }
+
+  list_t *baked_bodies;
+  arena_t *arena = arena_init(MAP_ARENA_BLOCK_SIZE);
+  bvh_t *bvh =
+      map_bake_static_bvh(bodies, body_count, vertices, arena, &baked_bodies);
+  size_t node_count = bvh_node_count(bvh);
+  size_t item_count = bvh_size(bvh);
+  bvh_baked_node_t *nodes = malloc(node_count * sizeof(bvh_baked_node_t) + 1);
+  bvh_baked_item_t *items = malloc(item_count * sizeof(bvh_baked_item_t) + 1);
+  assert(nodes != NULL && items != NULL);
+  bvh_bake(bvh, baked_bodies, nodes, items);
+  bvh_free(bvh);
+  list_free(baked_bodies);
+  arena_free(arena);
+
+  map_file_header_t header = {.version = MAP_FILE_VERSION,
+                              .size = builder->size,
+                              .body_count = body_count,
+                              .vertex_count = list_size(builder->vertices),
+                              .spawn_count = spawn_count,
+                              .node_count = node_count,
+                              .item_count = item_count,
+                              .name_bytes = name_bytes};
+  memcpy(header.magic, MAP_FILE_MAGIC, sizeof(header.magic));
+
+  bool written = false;
+  FILE *file = fopen(map_path, "wb");
+  if (file != NULL) {
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(bodies, sizeof(*bodies), body_count, file);
+    fwrite(vertices, sizeof(*vertices), header.vertex_count, file);
+    fwrite(spawns, sizeof(*spawns), spawn_count, file);
+    fwrite(nodes, sizeof(*nodes), node_count, file);
+    fwrite(items, sizeof(*items), item_count, file);
+    fwrite(names, 1, name_bytes, file);
+    written = !ferror(file);
+    written = fclose(file) == 0 && written;
+  }
+  if (!written) {
+    fprintf(stderr, "%s: could not write map\n", map_path);
+  }
+
+  free(items);
+  free(nodes);
+  free(names);
+  free(spawns);
+  free(vertices);
+  free(bodies);
+  return written;
+}
+
+bool map_file_convert(const char *text_path, const char *map_path) {
+  map_builder_t builder = {.bodies = list_init(1, free),
+                           .vertices = list_init(1, free),
+                           .spawns = list_init(1, free),
+                           .names = list_init(1, free)};
+  bool converted =
+      map_parse(&builder, text_path) && map_file_write(&builder, map_path);
+  list_free(builder.names);
+  list_free(builder.spawns);
+  list_free(builder.vertices);
+  list_free(builder.bodies);
+  return converted;
+}
+
+/** Checks that a mapped file is a whole, consistent map, and indexes it */
+bool map_file_index(map_file_t *map) {
+  if (map->length < sizeof(map_file_header_t)) {
+    return false;
+  }
+  const map_file_header_t *header = map->data;
+  if (memcmp(header->magic, MAP_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != MAP_FILE_VERSION) {
+    return false;
+  }
+  const char *section = (const char *)(header + 1);
+  map->header = header;
+  map->bodies = (const map_file_body_t *)section;
+  section += header->body_count * sizeof(map_file_body_t);
+  map->vertices = (const vector_t *)section;
+  section += header->vertex_count * sizeof(vector_t);
+  map->spawns = (const map_file_spawn_t *)section;
+  section += header->spawn_count * sizeof(map_file_spawn_t);
+  map->nodes = (const bvh_baked_node_t *)section;
+  section += header->node_count * sizeof(bvh_baked_node_t);
+  map->items = (const bvh_baked_item_t *)section;
+  section += header->item_count * sizeof(bvh_baked_item_t);
+  map->names = section;
+  section += header->name_bytes;
+  if (section != (const char *)map->data + map->length ||
+      (header->name_bytes > 0 && map->names[header->name_bytes - 1] != '\0')) {
+    return false;
+  }
+
+  size_t statics = 0;
+  for (size_t i = 0; i < header->body_count; i++) {
+    const map_file_body_t *body = &map->bodies[i];
+    if (body->type >= BODY_TYPE_COUNT || body->motion > MOTION_STATIC ||
+        body->vertex_count < 3 || body->first_vertex > header->vertex_count ||
+        body->vertex_count > header->vertex_count - body->first_vertex ||
+        (body->texture != MAP_FILE_NO_TEXTURE &&
+         body->texture >= header->name_bytes)) {
+      return false;
+    }
+    statics += body->motion == MOTION_STATIC;
+  }
+  // The hierarchy must cover just the static bodies (see
+  // scene_set_static_bvh())
+  if (header->item_count != statics) {
+    return false;
+  }
+  for (size_t i = 0; i < header->item_count; i++) {
+    uint32_t body = map->items[i].body;
+    if (body >= header->body_count ||
+        map->bodies[body].motion != MOTION_STATIC) {
+      return false;
+    }
+  }
+  if (!bvh_baked_is_valid(map->nodes, header->node_count,
+                          header->item_count)) {
+    return false;
+  }
+
+  map_spawn_t kind = 0;
+  map->spawn_starts[0] = 0;
+  for (size_t i = 0; i < header->spawn_count; i++) {
+    if (map->spawns[i].kind < kind || map->spawns[i].kind >= SPAWN_KIND_COUNT) {
+      return false;
+    }
+    while (kind < map->spawns[i].kind) {
+      map->spawn_starts[++kind] = i;
+    }
+  }
+  while (kind < SPAWN_KIND_COUNT) {
+    map->spawn_starts[++kind] = header->spawn_count;
+  }
+  return true;
+}
+
+map_file_t *map_file_load(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    return NULL;
+  }
+  void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps the file open
+  close(fd);
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+
+  map_file_t *map = malloc(sizeof(map_file_t));
+  assert(map != NULL);
+  *map = (map_file_t){.data = data, .length = info.st_size};
+  if (!map_file_index(map)) {
+    map_file_free(map);
+    return NULL;
+  }
+  return map;
+}
+
+void map_file_free(map_file_t *map) {
+  munmap(map->data, map->length);
+  free(map);
+}
+
+vector_t map_file_size(map_file_t *map) { return map->header->size; }
+
+size_t map_file_bodies(map_file_t *map) { return map->header->body_count; }
+
+const char *map_file_texture(map_file_t *map, size_t index) {
+  assert(index < map->header->body_count);
+  uint32_t texture = map->bodies[index].texture;
+  return texture == MAP_FILE_NO_TEXTURE ? NULL : &map->names[texture];
+}
+
+size_t map_file_spawns(map_file_t *map, map_spawn_t kind) {
+  assert(kind < SPAWN_KIND_COUNT);
+  return map->spawn_starts[kind + 1] - map->spawn_starts[kind];
+}
+
+vector_t map_file_spawn(map_file_t *map, map_spawn_t kind, size_t index) {
+  assert(index < map_file_spawns(map, kind));
+  return map->spawns[map->spawn_starts[kind] + index].position;
+}
+
+void map_file_instantiate(map_file_t *map, scene_t *scene) {
+  list_t *bodies = list_init(map->header->body_count, NULL);
+  // The bodies stay in the scene until it is freed, so they all come from
+  // its arena instead of several allocations each
+  arena_t *arena = scene_get_arena(scene);
+  for (size_t i = 0; i < map->header->body_count; i++) {
+    body_t *body = map_body_init(arena, &map->bodies[i], map->vertices,
+                                 map_file_texture(map, i));
+    scene_add_body(scene, body);
+    list_add(bodies, body);
+  }
+  bvh_t *bvh = bvh_init_baked(bodies, map->nodes, map->header->node_count,
+                              map->items, map->header->item_count);
+  // map_file_index() checked the hierarchy when the map was loaded
+  assert(bvh != NULL);
+  scene_set_static_bvh(scene, bvh);
+  list_free(bodies);
+}
+
+void map_file_share(map_file_t *map, scene_t *scene, scene_t *owner) {
+  assert(scene_bodies(scene) == 0 &&
+         scene_bodies(owner) >= map->header->body_count);
+  for (size_t i = 0; i < map->header->body_count; i++) {
+    if (map->bodies[i].motion == MOTION_STATIC) {
+      scene_share_body(scene, owner, i);
+      continue;
+    }
+    body_t *body = map_body_init(scene_get_arena(scene), &map->bodies[i],
+                                 map->vertices, map_file_texture(map, i));
+    scene_add_body(scene, body);
+  }
+  scene_share_static_bvh(scene, owner);
+}
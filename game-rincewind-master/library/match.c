@@ -0,0 +1,282 @@
+#include "match.h"
+#include "game_const.h"
+#include "game_weapon.h"
+#include "map.h"
+#include "player.h"
+#include "projectile.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+typedef struct match {
+  scene_t *scene;
+  game_state_t map;
+  double time_since_drop;
+  double time_since_jump[MATCH_PLAYERS];
+  size_t lives[MATCH_PLAYERS];
+  size_t round;
+  bool over;
+} match_t;
+
+typedef struct match_state {
+  // Copy of the match's rules state; its scene pointer is not used
+  match_t match;
+  scene_state_t *scene;
+} match_state_t;
+
+match_t *match_init(game_state_t map) {
+  assert(map == MAP1 || map == MAP2 || map == MAP3);
+  match_t *match = malloc(sizeof(match_t));
+  assert(match != NULL);
+  *match = (match_t){.scene = game_scene_init(),
+                     .map = map,
+                     .time_since_drop = 0,
+                     .time_since_jump = {0, 0},
+                     .lives = {STARTING_LIVES, STARTING_LIVES},
+                     .round = 0,
+                     .over = false};
+  create_map(match->scene, map);
+  return match;
+}
+
+void match_free(match_t *match) {
+  scene_free(match->scene);
+  free(match);
+}
+
+/** Applies one player's input, like the keys of the hot-seat game */
+void match_apply_input(match_t *match, body_type_t type, body_t *player,
+                       player_input_t input) {
+  if (input & INPUT_LEFT) {
+    player_run(player, LEFT);
+  } else if (input & INPUT_RIGHT) {
+    player_run(player, RIGHT);
+  } else {
+    body_set_velocity(player, (vector_t){0.0, body_get_velocity(player).y});
+  }
+
+  if (input & INPUT_SHOOT) {
+    game_weapon_shoot(match->scene, player);
+  }
+  if ((input & INPUT_JUMP) && match->time_since_jump[type] > TIME_THRESHOLD) {
+    player_jump(match->scene, player);
+    match->time_since_jump[type] = 0;
+  }
+}
+
+/** Starts the next round if a player has been shot */
+void match_respawn(match_t *match) {
+  for (body_type_t type = PLAYER1; type <= PLAYER2; type++) {
+    if (fetch_object(match->scene, type) != NULL || match->lives[type] < 1) {
+      continue;
+    }
+    match->lives[type]--;
+    match->round++;
+    match->over = match->lives[type] == 0;
+    // Seeded from the last round, so a replayed match drops the same powerups
+    uint32_t seed = scene_random(match->scene);
+    scene_free(match->scene);
+    match->scene = game_scene_init();
+    scene_seed_random(match->scene, seed);
+    create_map(match->scene, match->map);
+    return;
+  }
+}
+
+void match_step(match_t *match, const player_input_t inputs[MATCH_PLAYERS],
+                double dt) {
+  if (match->over) {
+    return;
+  }
+  scene_t *scene = match->scene;
+  body_t *player1 = fetch_object(scene, PLAYER1);
+  body_t *player2 = fetch_object(scene, PLAYER2);
+
+  // Timers
+  match->time_since_drop += TIME_MULT * dt;
+  match->time_since_jump[PLAYER1] += TIME_MULT * dt;
+  match->time_since_jump[PLAYER2] += TIME_MULT * dt;
+  if (player1 != NULL && player2 != NULL) {
+    get_info(player1)->time_since_last_shot += TIME_MULT * dt;
+    get_info(player2)->time_since_last_shot += TIME_MULT * dt;
+    match_apply_input(match, PLAYER1, player1, inputs[PLAYER1]);
+    match_apply_input(match, PLAYER2, player2, inputs[PLAYER2]);
+  }
+
+  map_update(scene, match->map);
+
+  // Powerups
+  size_t powerups_on_screen = scene_bodies_of_type(scene, POWERUP_RICOCHET) +
+                              scene_bodies_of_type(scene, POWERUP_SHOTGUN);
+  if (spawn_powerup(scene, match->time_since_drop, powerups_on_screen,
+                    match->map) != NULL) {
+    match->time_since_drop = 0;
+  }
+
+  scene_tick(scene, dt);
+  match_respawn(match);
+}
+
+scene_t *match_get_scene(match_t *match) { return match->scene; }
+
+game_state_t match_get_map(match_t *match) { return match->map; }
+
+size_t match_get_lives(match_t *match, body_type_t player) {
+  assert(player == PLAYER1 || player == PLAYER2);
+  return match->lives[player];
+}
+
+size_t match_get_round(match_t *match) { return match->round; }
+
+bool match_is_over(match_t *match) { return match->over; }
+
+/** Lists the powerups of one type in an observation, while there is room */
+void match_observe_powerups(scene_t *scene, body_type_t type,
+                            match_observation_t *observation) {
+  size_t count = scene_bodies_of_type(scene, type);
+  for (size_t i = 0;
+       i < count && observation->powerup_count < OBSERVED_POWERUPS; i++) {
+    body_t *powerup = scene_get_body_of_type(scene, type, i);
+    observation->powerup_types[observation->powerup_count] = type;
+    observation->powerup_positions[observation->powerup_count] =
+        body_get_centroid(powerup);
+    observation->powerup_count++;
+  }
+}
+
+void match_observe(match_t *match, match_observation_t *observation) {
+  scene_t *scene = match->scene;
+  for (body_type_t type = PLAYER1; type <= PLAYER2; type++) {
+    body_t *player = fetch_object(scene, type);
+    player_observation_t *observed = &observation->players[type];
+    *observed = (player_observation_t){.alive = player != NULL,
+                                       .position = VEC_ZERO,
+                                       .velocity = VEC_ZERO,
+                                       .grounded = false,
+                                       .lives = match->lives[type],
+                                       .weapon = NO_WEAPON,
+                                       .shots_left = 0,
+                                       .time_since_last_shot = 0,
+                                       .time_since_jump =
+                                           match->time_since_jump[type]};
+    if (player == NULL) {
+      continue;
+    }
+    body_info_t *info = get_info(player);
+    observed->position = body_get_centroid(player);
+    observed->velocity = body_get_velocity(player);
+    observed->grounded = player_is_grounded(scene, player);
+    observed->weapon = info->weapon_type;
+    observed->shots_left = info->shots_left;
+    observed->time_since_last_shot = info->time_since_last_shot;
+  }
+
+  observation->powerup_count = 0;
+  match_observe_powerups(scene, POWERUP_RICOCHET, observation);
+  match_observe_powerups(scene, POWERUP_SHOTGUN, observation);
+
+  projectiles_t *projectiles = scene_get_projectiles(scene);
+  size_t bullets = projectiles_count(projectiles);
+  observation->bullet_count =
+      bullets < OBSERVED_BULLETS ? bullets : OBSERVED_BULLETS;
+  for (size_t i = 0; i < observation->bullet_count; i++) {
+    observation->bullet_weapons[i] = projectiles_get_weapon(projectiles, i);
+    observation->bullet_positions[i] =
+        projectiles_get_position(projectiles, i);
+    observation->bullet_velocities[i] =
+        projectiles_get_velocity(projectiles, i);
+  }
+
+  observation->round = match->round;
+  observation->over = match->over;
+}
+
+match_state_t *match_state_init(void) {
+  match_state_t *state = malloc(sizeof(match_state_t));
+  assert(state != NULL);
+  *state = (match_state_t){.match = {.scene = NULL},
+                           .scene = scene_state_init(sizeof(body_info_t))};
+  return state;
+}
+
+void match_state_free(match_state_t *state) {
+  scene_state_free(state->scene);
+  free(state);
+}
+
+void match_save(match_t *match, match_state_t *state) {
+  state->match = *match;
+  state->match.scene = NULL;
+  scene_save(match->scene, state->scene);
+}
+
+/**
+ * Replaces a match's scene with a new one built like the saved one: the
+ * map, then the powerups that had dropped, in the same order.
+ */
+void match_rebuild(match_t *match, const scene_state_t *state) {
+  scene_free(match->scene);
+  match->scene = game_scene_init();
+  create_map(match->scene, match->map);
+  size_t map_bodies = scene_bodies(match->scene);
+  assert(map_bodies <= scene_state_bodies(state));
+  for (size_t i = map_bodies; i < scene_state_bodies(state); i++) {
+    const body_info_t *info = scene_state_get_info(state, i);
+    assert(info != NULL && (info->type == POWERUP_RICOCHET ||
+                            info->type == POWERUP_SHOTGUN));
+    get_powerup(match->scene, info->type);
+  }
+}
+
+void match_load(match_t *match, const match_state_t *state) {
+  scene_t *scene = match->scene;
+  *match = state->match;
+  match->scene = scene;
+  if (!scene_can_restore(scene, state->scene)) {
+    match_rebuild(match, state->scene);
+  }
+  scene_restore(match->scene, state->scene);
+}
+
+/**
+ * Builds a scene body for body like a match's, to fork the match into: the
+ * map's moving bodies, then the players and powerups, in the same order. The
+ * map's static bodies and hierarchy are shared with the match's scene.
+ */
+scene_t *match_fork_scene(match_t *match) {
+  scene_t *scene = game_scene_init();
+  map_file_t *file = map_get_file(match->map);
+  map_file_share(file, scene, match->scene);
+  for (size_t i = map_file_bodies(file); i < scene_bodies(match->scene); i++) {
+    body_t *body = scene_get_body(match->scene, i);
+    body_type_t type = get_info(body)->type;
+    if (type == PLAYER1 || type == PLAYER2) {
+      add_player(scene, type, body_get_centroid(body));
+    } else {
+      assert(type == POWERUP_RICOCHET || type == POWERUP_SHOTGUN);
+      get_powerup(scene, type);
+    }
+  }
+  scene_mirror(scene, match->scene);
+  return scene;
+}
+
+match_t *match_fork(match_t *match, match_t *fork) {
+  if (fork == NULL) {
+    fork = malloc(sizeof(match_t));
+    assert(fork != NULL);
+    fork->scene = match_fork_scene(match);
+  } else {
+    assert(fork->map == match->map);
+  }
+  scene_t *scene = fork->scene;
+  if (!scene_fork(scene, match->scene, sizeof(body_info_t))) {
+    // A body was freed in one of the matches, e.g. a round ended
+    scene_free(scene);
+    scene = match_fork_scene(match);
+    scene_fork(scene, match->scene, sizeof(body_info_t));
+  }
+  *fork = *match;
+  fork->scene = scene;
+  return fork;
+}
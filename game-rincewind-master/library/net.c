@@ -0,0 +1,167 @@
+#include "net.h"
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Datagrams a simulating socket can hold back; more are dropped
+#define NET_MAX_PENDING 256
+
+typedef struct net_pending {
+  size_t send_tick;
+  net_address_t to;
+  size_t size;
+  uint8_t data[NET_MAX_PACKET];
+} net_pending_t;
+
+typedef struct net_socket {
+  int fd;
+  uint16_t port;
+  size_t bytes_sent;
+
+  bool simulating;
+  size_t latency;
+  double loss;
+  uint32_t random;
+  size_t tick;
+  // A ring of held datagrams, in the order they were sent
+  net_pending_t *pending;
+  size_t pending_start;
+  size_t pending_count;
+} net_socket_t;
+
+net_address_t net_address_loopback(uint16_t port) {
+  return (net_address_t){.host = INADDR_LOOPBACK, .port = port};
+}
+
+bool net_address_equal(net_address_t address1, net_address_t address2) {
+  return address1.host == address2.host && address1.port == address2.port;
+}
+
+struct sockaddr_in net_sockaddr(net_address_t address) {
+  struct sockaddr_in sockaddr;
+  memset(&sockaddr, 0, sizeof(sockaddr));
+  sockaddr.sin_family = AF_INET;
+  sockaddr.sin_addr.s_addr = htonl(address.host);
+  sockaddr.sin_port = htons(address.port);
+  return sockaddr;
+}
+
+net_socket_t *net_socket_open(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct sockaddr_in sockaddr = net_sockaddr(net_address_loopback(port));
+  socklen_t length = sizeof(sockaddr);
+  if (bind(fd, (struct sockaddr *)&sockaddr, length) < 0 ||
+      getsockname(fd, (struct sockaddr *)&sockaddr, &length) < 0 ||
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+    close(fd);
+    return NULL;
+  }
+
+  net_socket_t *sock = malloc(sizeof(net_socket_t));
+  assert(sock != NULL);
+  *sock = (net_socket_t){.fd = fd,
+                         .port = ntohs(sockaddr.sin_port),
+                         .bytes_sent = 0,
+                         .simulating = false,
+                         .pending = NULL};
+  return sock;
+}
+
+void net_socket_close(net_socket_t *sock) {
+  close(sock->fd);
+  free(sock->pending);
+  free(sock);
+}
+
+uint16_t net_socket_port(net_socket_t *sock) { return sock->port; }
+
+void net_socket_send_now(net_socket_t *sock, net_address_t to,
+                         const void *data, size_t size) {
+  struct sockaddr_in sockaddr = net_sockaddr(to);
+  // A full send buffer loses the datagram, which UDP allows anyway
+  sendto(sock->fd, data, size, 0, (struct sockaddr *)&sockaddr,
+         sizeof(sockaddr));
+}
+
+/** Returns a pseudorandom number from 0 to 1 from the socket's own stream */
+double net_socket_random(net_socket_t *sock) {
+  sock->random = sock->random * 1664525 + 1013904223;
+  return (double)(sock->random >> 8) / (1 << 24);
+}
+
+void net_socket_send(net_socket_t *sock, net_address_t to, const void *data,
+                     size_t size) {
+  assert(size <= NET_MAX_PACKET);
+  sock->bytes_sent += size;
+  if (!sock->simulating) {
+    net_socket_send_now(sock, to, data, size);
+    return;
+  }
+
+  if (net_socket_random(sock) < sock->loss ||
+      sock->pending_count == NET_MAX_PENDING) {
+    return;
+  }
+  size_t index = (sock->pending_start + sock->pending_count) % NET_MAX_PENDING;
+  net_pending_t *pending = &sock->pending[index];
+  pending->send_tick = sock->tick + sock->latency;
+  pending->to = to;
+  pending->size = size;
+  memcpy(pending->data, data, size);
+  sock->pending_count++;
+}
+
+size_t net_socket_receive(net_socket_t *sock, net_address_t *from,
+                          void *buffer, size_t capacity) {
+  struct sockaddr_in sockaddr;
+  socklen_t length = sizeof(sockaddr);
+  ssize_t size = recvfrom(sock->fd, buffer, capacity, 0,
+                          (struct sockaddr *)&sockaddr, &length);
+  if (size <= 0) {
+    return 0;
+  }
+  *from = (net_address_t){.host = ntohl(sockaddr.sin_addr.s_addr),
+                          .port = ntohs(sockaddr.sin_port)};
+  return size;
+}
+
+void net_socket_simulate(net_socket_t *sock, size_t latency, double loss,
+                         uint32_t seed) {
+  if (sock->pending == NULL) {
+    sock->pending = malloc(NET_MAX_PENDING * sizeof(net_pending_t));
+    assert(sock->pending != NULL);
+    sock->pending_start = 0;
+    sock->pending_count = 0;
+  }
+  sock->simulating = true;
+  sock->latency = latency;
+  sock->loss = loss;
+  sock->random = seed;
+}
+
+void net_socket_pump(net_socket_t *sock) {
+  if (!sock->simulating) {
+    return;
+  }
+  sock->tick++;
+  while (sock->pending_count > 0) {
+    net_pending_t *pending = &sock->pending[sock->pending_start];
+    if (pending->send_tick > sock->tick) {
+      break;
+    }
+    net_socket_send_now(sock, pending->to, pending->data, pending->size);
+    sock->pending_start = (sock->pending_start + 1) % NET_MAX_PENDING;
+    sock->pending_count--;
+  }
+}
+
+size_t net_socket_bytes_sent(net_socket_t *sock) { return sock->bytes_sent; }
@@ -0,0 +1,248 @@
+#include "netcode.h"
+#include "bitstream.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+// Size of an input packet: an ack flag, the acked tick, and the input
+#define INPUT_PACKET_SIZE 6
+
+// Bits of the fields of an input packet
+const size_t INPUT_TICK_BITS = 32;
+const size_t INPUT_BITS = 8;
+
+typedef struct net_peer {
+  bool joined;
+  net_address_t address;
+  player_input_t input;
+  bool has_ack;
+  uint32_t ack;
+  size_t bytes_sent;
+} net_peer_t;
+
+typedef struct net_server {
+  net_socket_t *sock;
+  match_t *match;
+  uint32_t tick;
+  net_peer_t peers[MATCH_PLAYERS];
+  // The snapshot of each of the last NET_HISTORY ticks, by tick % NET_HISTORY
+  snapshot_t *history;
+} net_server_t;
+
+typedef struct net_client {
+  net_socket_t *sock;
+  net_address_t server;
+  bool has_latest;
+  uint32_t latest;
+  // Received snapshots by tick % NET_HISTORY, like a server's history
+  snapshot_t *history;
+  snapshot_t decoded;
+} net_client_t;
+
+/** Returns the snapshot for a tick if it is still in a history ring */
+snapshot_t *net_history_find(snapshot_t *history, uint32_t newest,
+                             uint32_t tick) {
+  snapshot_t *snapshot = &history[tick % NET_HISTORY];
+  if (tick == 0 || newest - tick >= NET_HISTORY || snapshot->tick != tick) {
+    return NULL;
+  }
+  return snapshot;
+}
+
+snapshot_t *net_history_init(void) {
+  snapshot_t *history = calloc(NET_HISTORY, sizeof(snapshot_t));
+  assert(history != NULL);
+  return history;
+}
+
+net_server_t *net_server_init(uint16_t port, game_state_t map) {
+  net_socket_t *sock = net_socket_open(port);
+  if (sock == NULL) {
+    return NULL;
+  }
+  net_server_t *server = malloc(sizeof(net_server_t));
+  assert(server != NULL);
+  *server = (net_server_t){.sock = sock,
+                           .match = match_init(map),
+                           .tick = 0,
+                           .history = net_history_init()};
+  return server;
+}
+
+void net_server_free(net_server_t *server) {
+  net_socket_close(server->sock);
+  match_free(server->match);
+  free(server->history);
+  free(server);
+}
+
+net_socket_t *net_server_get_socket(net_server_t *server) {
+  return server->sock;
+}
+
+match_t *net_server_get_match(net_server_t *server) { return server->match; }
+
+size_t net_server_players(net_server_t *server) {
+  size_t players = 0;
+  for (size_t i = 0; i < MATCH_PLAYERS; i++) {
+    players += server->peers[i].joined;
+  }
+  return players;
+}
+
+/** Finds the player a packet came from, joining them if there is room */
+net_peer_t *net_server_peer(net_server_t *server, net_address_t address) {
+  for (size_t i = 0; i < MATCH_PLAYERS; i++) {
+    net_peer_t *peer = &server->peers[i];
+    if (!peer->joined) {
+      *peer = (net_peer_t){.joined = true, .address = address};
+      return peer;
+    }
+    if (net_address_equal(peer->address, address)) {
+      return peer;
+    }
+  }
+  return NULL;
+}
+
+void net_server_receive(net_server_t *server) {
+  uint8_t packet[NET_MAX_PACKET];
+  net_address_t from;
+  size_t size;
+  while ((size = net_socket_receive(server->sock, &from, packet,
+                                    sizeof(packet))) > 0) {
+    net_peer_t *peer = net_server_peer(server, from);
+    if (peer == NULL || size != INPUT_PACKET_SIZE) {
+      continue;
+    }
+    bitstream_t stream;
+    bitstream_init(&stream, packet, size);
+    bool has_ack = bitstream_read(&stream, 1);
+    uint32_t ack = bitstream_read(&stream, INPUT_TICK_BITS);
+    peer->input = bitstream_read(&stream, INPUT_BITS);
+    // Acks can arrive out of order; only a newer one is worth keeping
+    if (has_ack && ack <= server->tick && (!peer->has_ack || ack > peer->ack)) {
+      peer->has_ack = true;
+      peer->ack = ack;
+    }
+  }
+}
+
+void net_server_tick(net_server_t *server, double dt) {
+  net_server_receive(server);
+  if (net_server_players(server) < MATCH_PLAYERS) {
+    return;
+  }
+
+  player_input_t inputs[MATCH_PLAYERS];
+  for (size_t i = 0; i < MATCH_PLAYERS; i++) {
+    inputs[i] = server->peers[i].input;
+  }
+  match_step(server->match, inputs, dt);
+  server->tick++;
+  snapshot_t *snapshot = &server->history[server->tick % NET_HISTORY];
+  snapshot_capture(snapshot, server->match, server->tick);
+
+  uint8_t packet[NET_MAX_PACKET];
+  for (size_t i = 0; i < MATCH_PLAYERS; i++) {
+    net_peer_t *peer = &server->peers[i];
+    snapshot_t *baseline =
+        peer->has_ack
+            ? net_history_find(server->history, server->tick, peer->ack)
+            : NULL;
+    size_t size = snapshot_encode(snapshot, baseline, packet, sizeof(packet));
+    if (size > 0) {
+      net_socket_send(server->sock, peer->address, packet, size);
+      peer->bytes_sent += size;
+    }
+  }
+}
+
+const snapshot_t *net_server_snapshot(net_server_t *server, uint32_t tick) {
+  return net_history_find(server->history, server->tick, tick);
+}
+
+size_t net_server_bytes_sent(net_server_t *server, body_type_t player) {
+  assert(player == PLAYER1 || player == PLAYER2);
+  return server->peers[player].bytes_sent;
+}
+
+net_client_t *net_client_init(net_address_t server) {
+  net_socket_t *sock = net_socket_open(0);
+  if (sock == NULL) {
+    return NULL;
+  }
+  net_client_t *client = malloc(sizeof(net_client_t));
+  assert(client != NULL);
+  client->sock = sock;
+  client->server = server;
+  client->has_latest = false;
+  client->latest = 0;
+  client->history = net_history_init();
+  return client;
+}
+
+void net_client_free(net_client_t *client) {
+  net_socket_close(client->sock);
+  free(client->history);
+  free(client);
+}
+
+net_socket_t *net_client_get_socket(net_client_t *client) {
+  return client->sock;
+}
+
+void net_client_send_input(net_client_t *client, player_input_t input) {
+  uint8_t packet[INPUT_PACKET_SIZE];
+  bitstream_t stream;
+  bitstream_init(&stream, packet, sizeof(packet));
+  bitstream_write(&stream, client->has_latest, 1);
+  bitstream_write(&stream, client->latest, INPUT_TICK_BITS);
+  bitstream_write(&stream, input, INPUT_BITS);
+  net_socket_send(client->sock, client->server, packet, sizeof(packet));
+}
+
+size_t net_client_poll(net_client_t *client) {
+  uint8_t packet[NET_MAX_PACKET];
+  net_address_t from;
+  size_t size;
+  size_t decoded = 0;
+  while ((size = net_socket_receive(client->sock, &from, packet,
+                                    sizeof(packet))) > 0) {
+    if (!net_address_equal(from, client->server)) {
+      continue;
+    }
+    uint32_t tick, baseline_tick;
+    bool has_baseline =
+        snapshot_read_header(packet, size, &tick, &baseline_tick);
+    uint32_t newest = client->latest > tick ? client->latest : tick;
+    if (newest - tick >= NET_HISTORY) {
+      continue;
+    }
+    snapshot_t *baseline = NULL;
+    if (has_baseline) {
+      baseline = net_history_find(client->history, newest, baseline_tick);
+      if (baseline == NULL) {
+        continue;
+      }
+    }
+    // Decode aside so a bad packet cannot clobber the history
+    if (!snapshot_decode(&client->decoded, baseline, packet, size)) {
+      continue;
+    }
+    client->history[tick % NET_HISTORY] = client->decoded;
+    if (!client->has_latest || tick > client->latest) {
+      client->has_latest = true;
+      client->latest = tick;
+    }
+    decoded++;
+  }
+  return decoded;
+}
+
+const snapshot_t *net_client_latest(net_client_t *client) {
+  if (!client->has_latest) {
+    return NULL;
+  }
+  return &client->history[client->latest % NET_HISTORY];
+}
@@ -1,36 +1,61 @@
 #include "player.h"
+#include "alloc_track.h"
 #include "game_const.h"
 
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
 const double PLAYER_WIDTH = 6.0;
 const double PLAYER_HEIGHT = 9.0;
 const vector_t START_VELOCITY = {.x = 0.0, .y = 15.0};
-const rgb_color_t PLAYER_FEET_COLOR = {.r = 0, .g = 0, .b = 0};
 const double PLAYER_FEET_HEIGHT = 1.0;
 const double PLAYER_DRAG = 0.5;
 const double WALL_ELASTICITY = 0.5;
 const double GROUND_ELASTICITY = 0.0;
+const double PLAYER_ACCELERATION = 5000.0;
+const double PLAYER_MAX_SPEED = 40.0;
 
 body_info_t *info_init(body_type_t type, side_t side,
                        game_weapon_type_t weapon) {
-  body_info_t *info = malloc(sizeof(body_info_t));
+  return info_init_in(NULL, type, side, weapon);
+}
+
+body_info_t *info_init_in(arena_t *arena, body_type_t type, side_t side,
+                          game_weapon_type_t weapon) {
+  body_info_t *info = arena != NULL
+                          ? arena_alloc(arena, sizeof(body_info_t))
+                          : track_malloc(TRACK_INFO, sizeof(body_info_t));
   info->type = type;
   info->side = side;
   info->weapon_type = weapon;
   info->time_since_last_shot = 0;
   info->shots_left = INFINITY;
+  info->texture = NULL;
   return info;
 }
 
+void info_free(void *info) { track_free(info); }
+
 body_info_t *get_info(body_t *body) {
   return (body_info_t *)body_get_info(body);
 }
 
+size_t get_body_type(body_t *body) {
+  body_info_t *info = get_info(body);
+  return info == NULL ? BODY_TYPE_COUNT : info->type;
+}
+
+scene_t *game_scene_init(void) {
+  return scene_init_with_types(BODY_TYPE_COUNT, get_body_type);
+}
+
 body_t *get_player(vector_t center, vector_t velocity, body_type_t type,
                    side_t dir) {
   list_t *shape = rect_init(PLAYER_WIDTH, PLAYER_HEIGHT);
   rgb_color_t color = type == PLAYER1 ? PLAYER_1_COLOR : PLAYER_2_COLOR;
   body_t *player = body_init_with_info(shape, PLAYER_MASS, color,
-                                       info_init(type, dir, PISTOL), free);
+                                       info_init(type, dir, PISTOL), info_free);
 
   body_set_centroid(player, center);
 
@@ -48,6 +73,8 @@ body_t *add_player(scene_t *scene, body_type_t type, vector_t spawn) {
   }
 
   create_drag(scene, PLAYER_DRAG, player);
+  create_static_contacts(scene, WALL_ELASTICITY, player, BODY_MASK(WALL));
+  create_static_contacts(scene, GROUND_ELASTICITY, player, BODY_MASK(GROUND));
   size_t body_count = scene_bodies(scene);
   scene_add_body(scene, player);
 
@@ -62,14 +89,6 @@ body_t *add_player(scene_t *scene, body_type_t type, vector_t spawn) {
     case POWERUP_RICOCHET:
     case POWERUP_SHOTGUN:
       break;
-    case WALL:
-      create_physics_collision(scene, WALL_ELASTICITY, player, body);
-      create_normal_force(scene, player, body);
-      break;
-    case GROUND:
-      create_physics_collision(scene, GROUND_ELASTICITY, player, body);
-      create_normal_force(scene, player, body);
-      break;
     case GRAVITY:
       create_newtonian_gravity(scene, G, body, player);
       break;
@@ -81,40 +100,47 @@ body_t *add_player(scene_t *scene, body_type_t type, vector_t spawn) {
   return player;
 }
 
-body_t *get_player_feet(body_t *player) {
-  list_t *shape = rect_init(PLAYER_WIDTH, PLAYER_FEET_HEIGHT);
-  body_t *player_feet = body_init(shape, PLAYER_MASS, PLAYER_FEET_COLOR);
-  vector_t centroid = body_get_centroid(player);
-  body_set_centroid(player_feet,
-                    (vector_t){centroid.x, centroid.y - PLAYER_HEIGHT / 2});
+bool player_is_grounded(scene_t *scene, body_t *player) {
+  // The feet reach half their height below the player's shape
+  scene_hit_t hit;
+  return scene_shapecast(scene, body_get_world_shape(player),
+                         (vector_t){0, -1}, PLAYER_FEET_HEIGHT / 2,
+                         BODY_MASK(GROUND), &hit);
+}
 
-  return player_feet;
+void player_run(body_t *player, side_t side) {
+  assert(side == LEFT || side == RIGHT);
+  double dir = side == LEFT ? -1.0 : 1.0;
+  get_info(player)->side = side;
+  vector_t velocity = body_get_velocity(player);
+  if (velocity.x * dir < 0) {
+    velocity.x = 0.0;
+    body_set_velocity(player, velocity);
+  }
+  if (velocity.x * dir < PLAYER_MAX_SPEED) {
+    body_add_force(player,
+                   (vector_t){.x = dir * PLAYER_ACCELERATION, .y = 0.0});
+  }
+}
+
+bool player_jump(scene_t *scene, body_t *player) {
+  vector_t PLAYER_JUMP = {.x = 0.0, .y = (PLAYER_MASS * 85)};
+
+  if (!player_is_grounded(scene, player)) {
+    return false;
+  }
+  body_add_impulse(player, PLAYER_JUMP);
+  return true;
 }
 
 /** Returns pointer to specified player */
 body_t *fetch_object(scene_t *scene, body_type_t body_type) {
-  body_t *obj = NULL;
-  for (size_t i = 0; i < scene_bodies(scene); i++) {
-    if (get_info(scene_get_body(scene, i))->type == body_type) {
-      obj = scene_get_body(scene, i);
-      break;
-    }
-  }
-  return obj;
+  return scene_first_of_type(scene, body_type);
 }
 
 /** Returns pointer to specified body_type
  * Undefined behavior when there are multiple bodies of the same type in scene
  */
 sprite_t *fetch_sprite(scene_t *scene, body_type_t body_type) {
-  sprite_t *obj = NULL;
-  size_t sprites_size = list_size(scene_get_sprites(scene));
-  for (size_t i = 0; i < sprites_size; i++) {
-    sprite_t *sprite = scene_get_sprite(scene, i);
-    if (get_info(sprite_get_body(sprite))->type == body_type) {
-      obj = sprite;
-      break;
-    }
-  }
-  return obj;
+  return scene_first_sprite_of_type(scene, body_type);
 }
\ No newline at end of file
@@ -0,0 +1,426 @@
+#include "projectile.h"
+#include "alloc_track.h"
+#include "game_const.h"
+#include "player.h"
+#include "scene.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+const size_t INITIAL_PROJECTILES = 64;
+
+const double BULLET_LENGTH = 3.0;
+const double DEFAULT_BULLET_HEIGHT = 1.0;
+const rgb_color_t PISTOL_BULLET_COLOR = {.r = 0.01, .g = 0.98, .b = 0.05};
+const rgb_color_t RICOCHET_BULLET_COLOR = {.r = 0.78, .g = 0, .b = 0.98};
+const rgb_color_t SHOTGUN_BULLET_COLOR = {.r = 0.8, .g = 0, .b = 0.18};
+
+// Walls a ricochet bullet bounces off before the next one destroys it
+const size_t RICOCHET_BOUNCES = 3;
+// Shotgun pellets are destroyed this far from the player who fired them
+const double SHOTGUN_RANGE = 30.0;
+// Bullets that never hit anything are dropped after this many seconds
+const double BULLET_LIFETIME = 10.0;
+// How far in front of a wall a bouncing bullet is placed
+const double BOUNCE_SKIN = 0.01;
+// Gravity bodies never pull harder than they would from this distance
+const double MIN_GRAVITY_DISTANCE = 5.0;
+
+/** Body types a bullet bounces off or is stopped by */
+#define GEOMETRY_MASK                                                          \
+  (BODY_MASK(WALL) | BODY_MASK(GROUND) | BODY_MASK(CLOCK_BIG_ARM) |            \
+   BODY_MASK(CLOCK_SMALL_ARM))
+/**
+ * Body types a bullet can hit: geometry, players (destroyed along with the
+ * bullet), and powerups (which stop the bullet without being harmed)
+ */
+#define BULLET_MASK                                                            \
+  (GEOMETRY_MASK | BODY_MASK(PLAYER1) | BODY_MASK(PLAYER2) |                   \
+   BODY_MASK(POWERUP_RICOCHET) | BODY_MASK(POWERUP_SHOTGUN))
+
+/**
+ * What a live bullet's path covers along the x axis this tick, for finding
+ * bullets that meet
+ */
+typedef struct projectile_extent {
+  double min;
+  double max;
+  size_t index;
+} projectile_extent_t;
+
+/** Two bullets close enough to meet, by index with first < second */
+typedef struct projectile_pair {
+  size_t first;
+  size_t second;
+} projectile_pair_t;
+
+typedef struct projectiles {
+  size_t count;
+  size_t capacity;
+  vector_t *position;
+  vector_t *velocity;
+  game_weapon_type_t *weapon;
+  size_t *bounces_left;
+  body_type_t *owner;
+  double *age;
+  bool *is_dead;
+  // Scratch space for projectiles_tick(), never copied: where each bullet
+  // started the tick, and what projectiles_collide() sorts and pairs
+  vector_t *start;
+  projectile_extent_t *extents;
+  projectile_pair_t *pairs;
+  size_t pair_capacity;
+} projectiles_t;
+
+projectiles_t *projectiles_init(void) {
+  projectiles_t *projectiles =
+      track_malloc(TRACK_PROJECTILE, sizeof(projectiles_t));
+  assert(projectiles != NULL);
+  *projectiles = (projectiles_t){.count = 0, .capacity = 0, .pair_capacity = 0};
+  return projectiles;
+}
+
+void projectiles_free(projectiles_t *projectiles) {
+  track_free(projectiles->position);
+  track_free(projectiles->velocity);
+  track_free(projectiles->weapon);
+  track_free(projectiles->bounces_left);
+  track_free(projectiles->owner);
+  track_free(projectiles->age);
+  track_free(projectiles->is_dead);
+  track_free(projectiles->start);
+  track_free(projectiles->extents);
+  track_free(projectiles->pairs);
+  track_free(projectiles);
+}
+
+/**
+ * Moves the first count elements of an array into a new one of the given
+ * capacity, and frees the old one
+ */
+void *projectiles_grow_array(void *array, size_t count, size_t capacity,
+                             size_t size) {
+  void *grown = track_malloc(TRACK_PROJECTILE, capacity * size);
+  assert(grown != NULL);
+  if (count > 0) {
+    memcpy(grown, array, count * size);
+  }
+  track_free(array);
+  return grown;
+}
+
+void projectiles_grow(projectiles_t *projectiles) {
+  size_t old = projectiles->capacity;
+  size_t capacity = old == 0 ? INITIAL_PROJECTILES : 2 * old;
+  projectiles->position = projectiles_grow_array(
+      projectiles->position, old, capacity, sizeof(vector_t));
+  projectiles->velocity = projectiles_grow_array(
+      projectiles->velocity, old, capacity, sizeof(vector_t));
+  projectiles->weapon = projectiles_grow_array(
+      projectiles->weapon, old, capacity, sizeof(game_weapon_type_t));
+  projectiles->bounces_left = projectiles_grow_array(
+      projectiles->bounces_left, old, capacity, sizeof(size_t));
+  projectiles->owner = projectiles_grow_array(projectiles->owner, old, capacity,
+                                              sizeof(body_type_t));
+  projectiles->age = projectiles_grow_array(projectiles->age, old, capacity,
+                                            sizeof(double));
+  projectiles->is_dead = projectiles_grow_array(
+      projectiles->is_dead, old, capacity, sizeof(bool));
+  projectiles->start = projectiles_grow_array(projectiles->start, old, capacity,
+                                              sizeof(vector_t));
+  projectiles->extents = projectiles_grow_array(
+      projectiles->extents, old, capacity, sizeof(projectile_extent_t));
+  projectiles->capacity = capacity;
+}
+
+void projectiles_copy(projectiles_t *dest, projectiles_t *src) {
+  while (dest->capacity < src->count) {
+    projectiles_grow(dest);
+  }
+  size_t count = src->count;
+  dest->count = count;
+  if (count == 0) {
+    return;
+  }
+  memcpy(dest->position, src->position, count * sizeof(vector_t));
+  memcpy(dest->velocity, src->velocity, count * sizeof(vector_t));
+  memcpy(dest->weapon, src->weapon, count * sizeof(game_weapon_type_t));
+  memcpy(dest->bounces_left, src->bounces_left, count * sizeof(size_t));
+  memcpy(dest->owner, src->owner, count * sizeof(body_type_t));
+  memcpy(dest->age, src->age, count * sizeof(double));
+  memcpy(dest->is_dead, src->is_dead, count * sizeof(bool));
+}
+
+void projectiles_add(projectiles_t *projectiles, vector_t position,
+                     vector_t velocity, game_weapon_type_t weapon,
+                     body_type_t owner) {
+  if (projectiles->count == projectiles->capacity) {
+    projectiles_grow(projectiles);
+  }
+  size_t i = projectiles->count++;
+  projectiles->position[i] = position;
+  projectiles->velocity[i] = velocity;
+  projectiles->weapon[i] = weapon;
+  projectiles->bounces_left[i] = weapon == RICOCHET ? RICOCHET_BOUNCES : 0;
+  projectiles->owner[i] = owner;
+  projectiles->age[i] = 0;
+  projectiles->is_dead[i] = false;
+}
+
+size_t projectiles_count(projectiles_t *projectiles) {
+  return projectiles->count;
+}
+
+vector_t projectiles_get_position(projectiles_t *projectiles, size_t index) {
+  assert(index < projectiles->count);
+  return projectiles->position[index];
+}
+
+vector_t projectiles_get_velocity(projectiles_t *projectiles, size_t index) {
+  assert(index < projectiles->count);
+  return projectiles->velocity[index];
+}
+
+game_weapon_type_t projectiles_get_weapon(projectiles_t *projectiles,
+                                          size_t index) {
+  assert(index < projectiles->count);
+  return projectiles->weapon[index];
+}
+
+rgb_color_t projectile_appearance(game_weapon_type_t weapon, vector_t *size) {
+  switch (weapon) {
+  case RICOCHET:
+    *size = (vector_t){BULLET_LENGTH, DEFAULT_BULLET_HEIGHT * 2 / 3};
+    return RICOCHET_BULLET_COLOR;
+  case SHOTGUN:
+    *size = (vector_t){BULLET_LENGTH, DEFAULT_BULLET_HEIGHT * 0.35};
+    return SHOTGUN_BULLET_COLOR;
+  default:
+    *size = (vector_t){BULLET_LENGTH, DEFAULT_BULLET_HEIGHT};
+    return PISTOL_BULLET_COLOR;
+  }
+}
+
+/** Acceleration of a point at position due to the scene's gravity bodies */
+vector_t projectile_gravity(scene_t *scene, vector_t position) {
+  vector_t acceleration = VEC_ZERO;
+  for (size_t i = 0; i < scene_bodies_of_type(scene, GRAVITY); i++) {
+    body_t *body = scene_get_body_of_type(scene, GRAVITY, i);
+    vector_t diff = vec_subtract(body_get_centroid(body), position);
+    double distance = fmax(vec_length(diff), MIN_GRAVITY_DISTANCE);
+    acceleration = vec_add(
+        acceleration, vec_multiply(G * body_get_mass(body) /
+                                       (distance * distance * distance),
+                                   diff));
+  }
+  return acceleration;
+}
+
+/** Moves one bullet, resolving whatever its path hits */
+void projectile_move(projectiles_t *projectiles, size_t i, scene_t *scene,
+                     double dt) {
+  if (projectiles->weapon[i] != SHOTGUN) {
+    vector_t acceleration = projectile_gravity(scene, projectiles->position[i]);
+    projectiles->velocity[i] =
+        vec_add(projectiles->velocity[i], vec_multiply(dt, acceleration));
+  }
+
+  vector_t velocity = projectiles->velocity[i];
+  double distance = vec_length(velocity) * dt;
+  scene_hit_t hit;
+  if (distance == 0 || !scene_raycast(scene, projectiles->position[i],
+                                      velocity, distance, BULLET_MASK, &hit)) {
+    projectiles->position[i] =
+        vec_add(projectiles->position[i], vec_multiply(dt, velocity));
+    return;
+  }
+
+  body_type_t type = get_info(hit.body)->type;
+  if ((GEOMETRY_MASK & BODY_MASK(type)) && projectiles->bounces_left[i] > 0) {
+    // Reflect off the surface and stop just in front of it
+    projectiles->velocity[i] = vec_subtract(
+        velocity, vec_multiply(2 * vec_dot(velocity, hit.normal), hit.normal));
+    projectiles->position[i] =
+        vec_add(hit.point, vec_multiply(BOUNCE_SKIN, hit.normal));
+    projectiles->bounces_left[i]--;
+    return;
+  }
+
+  if (type == PLAYER1 || type == PLAYER2) {
+    body_remove(hit.body);
+  }
+  projectiles->position[i] = hit.point;
+  projectiles->is_dead[i] = true;
+}
+
+/**
+ * The box a bullet covers at a position: its rect from
+ * projectile_appearance(), pointing along its velocity as it is drawn
+ */
+aabb_t projectile_box(projectiles_t *projectiles, size_t i,
+                      vector_t position) {
+  vector_t size;
+  projectile_appearance(projectiles->weapon[i], &size);
+  vector_t velocity = projectiles->velocity[i];
+  vector_t along = vec_length(velocity) > 0 ? vec_unit_vector(velocity)
+                                            : (vector_t){1, 0};
+  vector_t half = {(fabs(along.x) * size.x + fabs(along.y) * size.y) / 2,
+                   (fabs(along.y) * size.x + fabs(along.x) * size.y) / 2};
+  return (aabb_t){.min = vec_subtract(position, half),
+                  .max = vec_add(position, half)};
+}
+
+/**
+ * Whether two bullets meet during the tick. Each moved in a straight line
+ * from where it started the tick, so they meet if their boxes overlapped at
+ * the start, or one box's motion relative to the other reaches it.
+ */
+bool projectiles_meet(projectiles_t *projectiles, size_t i, size_t j) {
+  aabb_t box1 = projectile_box(projectiles, i, projectiles->start[i]);
+  aabb_t box2 = projectile_box(projectiles, j, projectiles->start[j]);
+  if (aabb_overlaps(box1, box2)) {
+    return true;
+  }
+  vector_t motion1 =
+      vec_subtract(projectiles->position[i], projectiles->start[i]);
+  vector_t motion2 =
+      vec_subtract(projectiles->position[j], projectiles->start[j]);
+  return find_time_of_impact(box1, vec_subtract(motion1, motion2), box2) <= 1;
+}
+
+int projectile_extent_compare(const void *a, const void *b) {
+  const projectile_extent_t *extent1 = a;
+  const projectile_extent_t *extent2 = b;
+  if (extent1->min != extent2->min) {
+    return extent1->min < extent2->min ? -1 : 1;
+  }
+  return extent1->index < extent2->index ? -1 : 1;
+}
+
+int projectile_pair_compare(const void *a, const void *b) {
+  const projectile_pair_t *pair1 = a;
+  const projectile_pair_t *pair2 = b;
+  if (pair1->first != pair2->first) {
+    return pair1->first < pair2->first ? -1 : 1;
+  }
+  return pair1->second < pair2->second ? -1 : 1;
+}
+
+/** Records two bullets that meet */
+void projectiles_add_pair(projectiles_t *projectiles, size_t count, size_t i,
+                          size_t j) {
+  if (count == projectiles->pair_capacity) {
+    projectiles->pair_capacity = projectiles->pair_capacity == 0
+                                     ? INITIAL_PROJECTILES
+                                     : 2 * projectiles->pair_capacity;
+    projectiles->pairs =
+        projectiles_grow_array(projectiles->pairs, count,
+                               projectiles->pair_capacity,
+                               sizeof(projectile_pair_t));
+  }
+  projectiles->pairs[count] =
+      (projectile_pair_t){.first = i < j ? i : j, .second = i < j ? j : i};
+}
+
+/**
+ * Destroys bullets that meet each other this tick. The live bullets are
+ * sorted by the x extent of their paths and swept, so only bullets whose
+ * paths overlap along x are tested, rather than every pair.
+ */
+void projectiles_collide(projectiles_t *projectiles) {
+  size_t live = 0;
+  for (size_t i = 0; i < projectiles->count; i++) {
+    if (!projectiles->is_dead[i]) {
+      aabb_t path =
+          aabb_union(projectile_box(projectiles, i, projectiles->start[i]),
+                     projectile_box(projectiles, i, projectiles->position[i]));
+      projectiles->extents[live++] = (projectile_extent_t){
+          .min = path.min.x, .max = path.max.x, .index = i};
+    }
+  }
+  if (live < 2) {
+    return;
+  }
+  qsort(projectiles->extents, live, sizeof(projectile_extent_t),
+        projectile_extent_compare);
+
+  size_t pair_count = 0;
+  for (size_t a = 0; a < live; a++) {
+    projectile_extent_t *extent = &projectiles->extents[a];
+    for (size_t b = a + 1; b < live; b++) {
+      projectile_extent_t *other = &projectiles->extents[b];
+      if (other->min > extent->max) {
+        break;
+      }
+      if (projectiles_meet(projectiles, extent->index, other->index)) {
+        projectiles_add_pair(projectiles, pair_count++, extent->index,
+                             other->index);
+      }
+    }
+  }
+
+  // Resolve the pairs in the order bullets were fired, so a bullet that is
+  // destroyed by one pair does not go on to destroy another
+  if (pair_count > 1) {
+    qsort(projectiles->pairs, pair_count, sizeof(projectile_pair_t),
+          projectile_pair_compare);
+  }
+  for (size_t p = 0; p < pair_count; p++) {
+    size_t i = projectiles->pairs[p].first;
+    size_t j = projectiles->pairs[p].second;
+    if (projectiles->is_dead[i] || projectiles->is_dead[j]) {
+      continue;
+    }
+    // Shotgun pellets survive, and destroy any other bullet they meet
+    if (projectiles->weapon[i] != SHOTGUN) {
+      projectiles->is_dead[i] = true;
+    }
+    if (projectiles->weapon[j] != SHOTGUN) {
+      projectiles->is_dead[j] = true;
+    }
+  }
+}
+
+/** Drops dead bullets, keeping the live ones in the order they were fired */
+void projectiles_compact(projectiles_t *projectiles) {
+  size_t live = 0;
+  for (size_t i = 0; i < projectiles->count; i++) {
+    if (projectiles->is_dead[i]) {
+      continue;
+    }
+    projectiles->position[live] = projectiles->position[i];
+    projectiles->velocity[live] = projectiles->velocity[i];
+    projectiles->weapon[live] = projectiles->weapon[i];
+    projectiles->bounces_left[live] = projectiles->bounces_left[i];
+    projectiles->owner[live] = projectiles->owner[i];
+    projectiles->age[live] = projectiles->age[i];
+    projectiles->is_dead[live] = false;
+    live++;
+  }
+  projectiles->count = live;
+}
+
+void projectiles_tick(projectiles_t *projectiles, scene_t *scene, double dt) {
+  for (size_t i = 0; i < projectiles->count; i++) {
+    projectiles->age[i] += dt;
+    if (projectiles->age[i] > BULLET_LIFETIME) {
+      projectiles->is_dead[i] = true;
+      continue;
+    }
+    projectiles->start[i] = projectiles->position[i];
+    projectile_move(projectiles, i, scene, dt);
+
+    if (projectiles->weapon[i] == SHOTGUN) {
+      body_t *owner = scene_first_of_type(scene, projectiles->owner[i]);
+      if (owner != NULL &&
+          vec_length(vec_subtract(projectiles->position[i],
+                                  body_get_centroid(owner))) > SHOTGUN_RANGE) {
+        projectiles->is_dead[i] = true;
+      }
+    }
+  }
+  projectiles_collide(projectiles);
+  projectiles_compact(projectiles);
+}
@@ -0,0 +1,153 @@
+#include "rollback.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Saved frames: every frame from the oldest that may be rolled back to, up
+// to and including the current one
+#define ROLLBACK_STATES (ROLLBACK_MAX_FRAMES + 1)
+// Frames of input kept, covering ROLLBACK_MAX_FRAMES behind the current
+// frame to ROLLBACK_MAX_FRAMES ahead of it
+#define ROLLBACK_INPUTS (2 * ROLLBACK_MAX_FRAMES + 2)
+
+// Marks an input slot that holds no frame's input
+const size_t NO_FRAME = SIZE_MAX;
+
+typedef struct rollback {
+  match_t *match;
+  body_type_t local_player;
+  double dt;
+  size_t frame;
+  size_t confirmed;
+  // Earliest simulated frame whose remote input was mispredicted, or
+  // NO_FRAME if every prediction so far still holds
+  size_t mispredicted;
+  size_t resimulated;
+  // The match as it was before each frame, by frame % ROLLBACK_STATES
+  match_state_t *states[ROLLBACK_STATES];
+  // Inputs of each frame, by frame % ROLLBACK_INPUTS
+  player_input_t local[ROLLBACK_INPUTS];
+  player_input_t predicted[ROLLBACK_INPUTS];
+  player_input_t remote[ROLLBACK_INPUTS];
+  // The frame each remote input slot holds, or NO_FRAME
+  size_t remote_frames[ROLLBACK_INPUTS];
+} rollback_t;
+
+rollback_t *rollback_init(match_t *match, body_type_t local_player,
+                          double dt) {
+  assert(local_player == PLAYER1 || local_player == PLAYER2);
+  rollback_t *rollback = malloc(sizeof(rollback_t));
+  assert(rollback != NULL);
+  *rollback = (rollback_t){.match = match,
+                           .local_player = local_player,
+                           .dt = dt,
+                           .frame = 0,
+                           .confirmed = 0,
+                           .mispredicted = NO_FRAME,
+                           .resimulated = 0};
+  for (size_t i = 0; i < ROLLBACK_STATES; i++) {
+    rollback->states[i] = match_state_init();
+  }
+  for (size_t i = 0; i < ROLLBACK_INPUTS; i++) {
+    rollback->remote_frames[i] = NO_FRAME;
+  }
+  return rollback;
+}
+
+void rollback_free(rollback_t *rollback) {
+  for (size_t i = 0; i < ROLLBACK_STATES; i++) {
+    match_state_free(rollback->states[i]);
+  }
+  free(rollback);
+}
+
+/** Returns whether the remote input for a frame has arrived */
+bool rollback_has_remote(rollback_t *rollback, size_t frame) {
+  return rollback->remote_frames[frame % ROLLBACK_INPUTS] == frame;
+}
+
+/**
+ * Gets the remote input to simulate a frame with: the real one if it has
+ * arrived, or else a guess that the other player is still holding the same
+ * buttons as in the last confirmed frame.
+ */
+player_input_t rollback_remote_input(rollback_t *rollback, size_t frame) {
+  if (rollback_has_remote(rollback, frame)) {
+    return rollback->remote[frame % ROLLBACK_INPUTS];
+  }
+  if (rollback->confirmed == 0) {
+    return 0;
+  }
+  return rollback->remote[(rollback->confirmed - 1) % ROLLBACK_INPUTS];
+}
+
+/** Saves the match and steps it through the current frame */
+void rollback_step(rollback_t *rollback) {
+  size_t frame = rollback->frame;
+  size_t slot = frame % ROLLBACK_INPUTS;
+  match_save(rollback->match, rollback->states[frame % ROLLBACK_STATES]);
+
+  player_input_t remote = rollback_remote_input(rollback, frame);
+  rollback->predicted[slot] = remote;
+  player_input_t inputs[MATCH_PLAYERS];
+  inputs[rollback->local_player] = rollback->local[slot];
+  inputs[rollback->local_player == PLAYER1 ? PLAYER2 : PLAYER1] = remote;
+  match_step(rollback->match, inputs, rollback->dt);
+  rollback->frame++;
+}
+
+void rollback_resimulate(rollback_t *rollback) {
+  if (rollback->mispredicted == NO_FRAME) {
+    return;
+  }
+  size_t present = rollback->frame;
+  size_t start = rollback->mispredicted;
+  assert(present - start <= ROLLBACK_MAX_FRAMES);
+  match_load(rollback->match, rollback->states[start % ROLLBACK_STATES]);
+  rollback->frame = start;
+  rollback->mispredicted = NO_FRAME;
+  while (rollback->frame < present) {
+    rollback_step(rollback);
+  }
+  rollback->resimulated += present - start;
+}
+
+bool rollback_advance(rollback_t *rollback, player_input_t local_input) {
+  rollback_resimulate(rollback);
+  if (rollback->frame >= rollback->confirmed + ROLLBACK_MAX_FRAMES) {
+    return false;
+  }
+  rollback->local[rollback->frame % ROLLBACK_INPUTS] = local_input;
+  rollback_step(rollback);
+  return true;
+}
+
+void rollback_add_remote_input(rollback_t *rollback, size_t frame,
+                               player_input_t input) {
+  if (frame < rollback->confirmed ||
+      frame >= rollback->frame + ROLLBACK_MAX_FRAMES ||
+      rollback_has_remote(rollback, frame)) {
+    return;
+  }
+  size_t slot = frame % ROLLBACK_INPUTS;
+  rollback->remote[slot] = input;
+  rollback->remote_frames[slot] = frame;
+  if (frame < rollback->frame && rollback->predicted[slot] != input &&
+      frame < rollback->mispredicted) {
+    rollback->mispredicted = frame;
+  }
+  while (rollback_has_remote(rollback, rollback->confirmed)) {
+    rollback->confirmed++;
+  }
+}
+
+size_t rollback_frame(rollback_t *rollback) { return rollback->frame; }
+
+size_t rollback_confirmed_frame(rollback_t *rollback) {
+  return rollback->confirmed;
+}
+
+size_t rollback_resimulated_frames(rollback_t *rollback) {
+  return rollback->resimulated;
+}
@@ -1,10 +1,30 @@
 #include "scene.h"
-#include "game.h"
+#include "alloc_track.h"
+#include "bvh.h"
+#include "projectile.h"
 #include <assert.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 const size_t INITIAL_CAPACITY_S = 20;
+// Sequential-impulse iterations per tick; warm starting keeps this low
+const size_t DEFAULT_CONTACT_ITERATIONS = 8;
+// How far around its swept box a body looks for static bodies to contact
+const double STATIC_CONTACT_MARGIN = 1.0;
+// Seed of every scene's random number generator until it is reseeded
+const uint32_t DEFAULT_RANDOM_SEED = 2463534242u;
+// Room for the bodies of a map in one or two blocks
+const size_t SCENE_ARENA_BLOCK_SIZE = 16384;
+
+// Identifies each body ever added to a scene, so a saved state can tell
+// whether the bodies it was saved from are still there. Atomic, since scenes
+// may be built on several threads at once.
+atomic_size_t scene_body_serials = 0;
 
 // FORCE BIND DEFINITION AND FUNCTIONS
 typedef struct force_bind {
@@ -21,7 +41,7 @@ void force_bind_free(force_bind_t *force_bind) {
   if (force_bind->body_targets != NULL) {
     list_free(force_bind->body_targets);
   }
-  free(force_bind);
+  track_free(force_bind);
 }
 
 bool bind_is_removed(force_bind_t *force_bind) {
@@ -39,36 +59,235 @@ bool bind_is_removed(force_bind_t *force_bind) {
 }
 // END OF FORCE_BIND DEFINITION
 
+bool scene_body_in_mask(scene_t *scene, body_t *body, uint32_t mask);
+
+// STATIC CONTACT SET DEFINITION AND FUNCTIONS
+typedef struct static_contacts {
+  scene_t *scene;
+  body_t *body;
+  uint32_t mask;
+  double elasticity;
+  // Contacts with the static bodies near the body this tick
+  list_t *contacts;
+  // Last tick's contacts, kept while gathering so they stay warm started
+  list_t *previous;
+  // Contacts no longer in use, kept to be reused instead of freed
+  list_t *spare;
+} static_contacts_t;
+
+static_contacts_t *static_contacts_init(scene_t *scene, body_t *body,
+                                        uint32_t mask, double elasticity) {
+  static_contacts_t *set = malloc(sizeof(static_contacts_t));
+  assert(set != NULL);
+  *set = (static_contacts_t){
+      .scene = scene,
+      .body = body,
+      .mask = mask,
+      .elasticity = elasticity,
+      .contacts = list_init(INITIAL_CAPACITY_S, (free_func_t)contact_free),
+      .previous = list_init(INITIAL_CAPACITY_S, (free_func_t)contact_free),
+      .spare = list_init(INITIAL_CAPACITY_S, (free_func_t)contact_free)};
+  return set;
+}
+
+void static_contacts_free(static_contacts_t *set) {
+  list_free(set->contacts);
+  list_free(set->previous);
+  list_free(set->spare);
+  free(set);
+}
+
+/** Makes a contact between the set's body and another, reusing a spare one */
+contact_t *static_contacts_take(static_contacts_t *set, body_t *body) {
+  size_t spares = list_size(set->spare);
+  if (spares == 0) {
+    return contact_init(set->body, body, set->elasticity);
+  }
+  contact_t *contact = list_remove(set->spare, spares - 1);
+  contact_reset(contact, set->body, body, set->elasticity);
+  return contact;
+}
+
+/** Moves every contact in a list to the set's spares */
+void static_contacts_retire(static_contacts_t *set, list_t *contacts) {
+  while (list_size(contacts) > 0) {
+    list_add(set->spare, list_remove(contacts, list_size(contacts) - 1));
+  }
+}
+
+/** Moves the contact with a static body over from last tick, or makes one */
+void static_contacts_visit(body_t *body, static_contacts_t *set) {
+  if (body_is_removed(body) ||
+      !scene_body_in_mask(set->scene, body, set->mask)) {
+    return;
+  }
+  for (size_t i = 0; i < list_size(set->previous); i++) {
+    if (contact_get_body2(list_get(set->previous, i)) == body) {
+      list_add(set->contacts, list_remove(set->previous, i));
+      return;
+    }
+  }
+  list_add(set->contacts, static_contacts_take(set, body));
+}
+
+/**
+ * Retires the contacts with static bodies that have been removed, waking the
+ * set's body, since whatever held it up may be gone
+ */
+void static_contacts_prune(static_contacts_t *set) {
+  for (int i = 0; i < list_size(set->contacts); i++) {
+    if (contact_is_removed(list_get(set->contacts, i))) {
+      list_add(set->spare, list_remove(set->contacts, i));
+      i -= 1;
+      if (body_is_sleeping(set->body)) {
+        body_wake(set->body);
+      }
+    }
+  }
+}
+// END OF STATIC CONTACT SET DEFINITION
+
+// COLLISION EVENT DEFINITION AND FUNCTIONS
+typedef struct queued_event {
+  collision_event_t event;
+  // Order the event was recorded in, so sorting by handler is stable
+  size_t sequence;
+} queued_event_t;
+
+int queued_event_compare(const void *a, const void *b) {
+  const queued_event_t *event1 = a;
+  const queued_event_t *event2 = b;
+  uintptr_t handler1 = (uintptr_t)event1->event.handler;
+  uintptr_t handler2 = (uintptr_t)event2->event.handler;
+  if (handler1 != handler2) {
+    return handler1 < handler2 ? -1 : 1;
+  }
+  return event1->sequence < event2->sequence ? -1 : 1;
+}
+
+void collision_event_dispatch(collision_event_t *event) {
+  if (event->phase == COLLISION_BEGIN) {
+    event->handler(event->body1, event->body2, event->axis, event->aux);
+  }
+}
+// END OF COLLISION EVENT DEFINITION
+
 typedef struct scene {
   list_t *bodies;
   list_t *force_binds;
   list_t *list_of_sprites;
+  list_t *contacts;
+  list_t *static_contact_sets;
+  size_t contact_iterations;
+  projectiles_t *projectiles;
+  queued_event_t *events;
+  size_t event_count;
+  size_t event_capacity;
+  // Live bodies and sprites of each of the type_count body types, in scene
+  // order except that scene_build_static_bvh() moves static bodies to the front
+  size_t type_count;
+  body_type_getter_t get_type;
+  list_t **bodies_by_type;
+  list_t **sprites_by_type;
+  // Hierarchy over the first static_counts[type] bodies of each type, which
+  // are static; bodies of a type past its count are checked one by one
+  bvh_t *static_bvh;
+  // Whether static_bvh is another scene's (see scene_share_static_bvh())
+  bool static_bvh_shared;
+  size_t *static_counts;
+  scene_stats_t stats;
+  // Whether scene_tick() records tick_time in stats
+  bool timed;
+  uint32_t random;
+  // Serial of each body in bodies, in the same order
+  size_t *body_serials;
+  // Whether each body in bodies is another scene's (see scene_share_body())
+  bool *body_shared;
+  size_t body_serial_capacity;
+  // Made by scene_get_arena(), or NULL until then
+  arena_t *arena;
 } scene_t;
 
-scene_t *scene_init(void) {
+/** Removes value from a type index, returning where it was */
+size_t type_index_remove(list_t *index, void *value) {
+  for (size_t i = 0; i < list_size(index); i++) {
+    if (list_get(index, i) == value) {
+      list_remove(index, i);
+      return i;
+    }
+  }
+  return list_size(index);
+}
+
+/**
+ * Type a body is indexed under, or the scene's type count if it is not
+ * indexed
+ */
+size_t scene_body_type(scene_t *scene, body_t *body) {
+  if (scene->get_type == NULL) {
+    return scene->type_count;
+  }
+  size_t type = scene->get_type(body);
+  return type < scene->type_count ? type : scene->type_count;
+}
+
+/** Returns whether a body is indexed under one of the masked types */
+bool scene_body_in_mask(scene_t *scene, body_t *body, uint32_t mask) {
+  size_t type = scene_body_type(scene, body);
+  return type < scene->type_count && (mask & BODY_MASK(type)) != 0;
+}
+
+scene_t *scene_init(void) { return scene_init_with_types(0, NULL); }
+
+scene_t *scene_init_with_types(size_t type_count,
+                               body_type_getter_t get_type) {
+  assert(type_count <= SCENE_MAX_BODY_TYPES);
+  assert(type_count == 0 || get_type != NULL);
   scene_t *scene = malloc(sizeof(scene_t));
+  assert(scene != NULL);
   *scene =
-      (scene_t){.bodies = list_init(INITIAL_CAPACITY_S, (free_func_t)body_free),
+      (scene_t){.bodies = list_init(INITIAL_CAPACITY_S, NULL),
                 .force_binds =
                     list_init(INITIAL_CAPACITY_S, (free_func_t)force_bind_free),
                 .list_of_sprites =
-                    list_init(INITIAL_CAPACITY_S, (free_func_t)sprite_free)};
-  assert(scene != NULL);
+                    list_init(INITIAL_CAPACITY_S, (free_func_t)sprite_free),
+                .contacts =
+                    list_init(INITIAL_CAPACITY_S, (free_func_t)contact_free),
+                .static_contact_sets = list_init(
+                    INITIAL_CAPACITY_S, (free_func_t)static_contacts_free),
+                .contact_iterations = DEFAULT_CONTACT_ITERATIONS,
+                .projectiles = projectiles_init(),
+                .events = malloc(INITIAL_CAPACITY_S * sizeof(queued_event_t)),
+                .event_count = 0,
+                .event_capacity = INITIAL_CAPACITY_S,
+                .static_bvh = NULL,
+                .static_bvh_shared = false,
+                .stats = {.bodies = 0},
+                .timed = false,
+                .random = DEFAULT_RANDOM_SEED,
+                .body_serials = malloc(INITIAL_CAPACITY_S * sizeof(size_t)),
+                .body_shared = malloc(INITIAL_CAPACITY_S * sizeof(bool)),
+                .body_serial_capacity = INITIAL_CAPACITY_S,
+                .arena = NULL,
+                .type_count = type_count,
+                .get_type = get_type,
+                .bodies_by_type = malloc(type_count * sizeof(list_t *)),
+                .sprites_by_type = malloc(type_count * sizeof(list_t *)),
+                .static_counts = malloc(type_count * sizeof(size_t))};
+  assert(scene->events != NULL && scene->body_serials != NULL &&
+         scene->body_shared != NULL);
+  assert(type_count == 0 ||
+         (scene->bodies_by_type != NULL && scene->sprites_by_type != NULL &&
+          scene->static_counts != NULL));
+  for (size_t type = 0; type < type_count; type++) {
+    scene->bodies_by_type[type] = list_init(INITIAL_CAPACITY_S, NULL);
+    scene->sprites_by_type[type] = list_init(INITIAL_CAPACITY_S, NULL);
+    scene->static_counts[type] = 0;
+  }
 
   return scene;
 }
 
-void sprite_list_init(scene_t *scene) {
-  size_t body_count = scene_bodies(scene);
-  for (size_t i = 0; i < body_count; i++) {
-    body_t *body = scene_get_body(scene, i);
-    if (((body_info_t *)body_get_info(body))->type != GRAVITY) {
-      sprite_t *new_sprite = sprite_init(body);
-      scene_add_sprite(scene, new_sprite);
-    }
-  }
-}
-
 void sprite_list_update(scene_t *scene) {
   size_t sprite_count = list_size(scene->list_of_sprites);
   for (size_t i = 0; i < sprite_count; i++) {
@@ -78,9 +297,35 @@ void sprite_list_update(scene_t *scene) {
 }
 
 void scene_free(scene_t *scene) {
+  // Shared bodies are left to the scene they were shared from
+  for (size_t i = 0; i < list_size(scene->bodies); i++) {
+    if (!scene->body_shared[i]) {
+      body_free(list_get(scene->bodies, i));
+    }
+  }
   list_free(scene->bodies);
   list_free(scene->force_binds);
   list_free(scene->list_of_sprites);
+  list_free(scene->contacts);
+  list_free(scene->static_contact_sets);
+  projectiles_free(scene->projectiles);
+  if (scene->static_bvh != NULL && !scene->static_bvh_shared) {
+    bvh_free(scene->static_bvh);
+  }
+  free(scene->events);
+  free(scene->body_serials);
+  free(scene->body_shared);
+  for (size_t type = 0; type < scene->type_count; type++) {
+    list_free(scene->bodies_by_type[type]);
+    list_free(scene->sprites_by_type[type]);
+  }
+  free(scene->bodies_by_type);
+  free(scene->sprites_by_type);
+  free(scene->static_counts);
+  // Last, since bodies and lists freed above may live in it
+  if (scene->arena != NULL) {
+    arena_free(scene->arena);
+  }
   free(scene);
 }
 
@@ -91,8 +336,108 @@ body_t *scene_get_body(scene_t *scene, size_t index) {
   return (body_t *)(list_get(scene->bodies, index));
 }
 
-void scene_add_body(scene_t *scene, body_t *body) {
+/** Adds a body under a serial, noting whether it is another scene's */
+void scene_add_entry(scene_t *scene, body_t *body, size_t serial,
+                     bool shared) {
+  size_t count = list_size(scene->bodies);
+  if (count == scene->body_serial_capacity) {
+    scene->body_serial_capacity *= 2;
+    scene->body_serials = realloc(scene->body_serials,
+                                  scene->body_serial_capacity * sizeof(size_t));
+    scene->body_shared = realloc(scene->body_shared,
+                                 scene->body_serial_capacity * sizeof(bool));
+    assert(scene->body_serials != NULL && scene->body_shared != NULL);
+  }
+  scene->body_serials[count] = serial;
+  scene->body_shared[count] = shared;
   list_add(scene->bodies, body);
+  size_t type = scene_body_type(scene, body);
+  if (type < scene->type_count) {
+    list_add(scene->bodies_by_type[type], body);
+  }
+}
+
+void scene_add_body(scene_t *scene, body_t *body) {
+  scene_add_entry(scene, body, atomic_fetch_add(&scene_body_serials, 1),
+                  false);
+}
+
+void scene_share_body(scene_t *scene, scene_t *owner, size_t index) {
+  body_t *body = scene_get_body(owner, index);
+  assert(body_get_motion_type(body) == MOTION_STATIC &&
+         !body_is_removed(body));
+  // Filled in now, so the scenes only ever read it
+  body_get_world_shape(body);
+  // Under the owner's serial, so scene_fork() sees the same body in both
+  scene_add_entry(scene, body, owner->body_serials[index], true);
+}
+
+/** Drops the static hierarchy; every body is then checked one by one */
+void scene_drop_static_bvh(scene_t *scene) {
+  if (scene->static_bvh != NULL && !scene->static_bvh_shared) {
+    bvh_free(scene->static_bvh);
+  }
+  scene->static_bvh = NULL;
+  scene->static_bvh_shared = false;
+  for (size_t type = 0; type < scene->type_count; type++) {
+    scene->static_counts[type] = 0;
+  }
+}
+
+/** Drops a body from the type index and frees it */
+void scene_free_body(scene_t *scene, body_t *body) {
+  size_t type = scene_body_type(scene, body);
+  if (type < scene->type_count) {
+    size_t index = type_index_remove(scene->bodies_by_type[type], body);
+    if (index < scene->static_counts[type]) {
+      scene_drop_static_bvh(scene);
+    }
+  }
+  body_free(body);
+}
+
+/** Removes the body at an index from the scene and frees it */
+void scene_drop_body(scene_t *scene, size_t index) {
+  // Shared bodies are static, and only their owner may remove them
+  assert(!scene->body_shared[index]);
+  size_t count = list_size(scene->bodies);
+  memmove(&scene->body_serials[index], &scene->body_serials[index + 1],
+          (count - index - 1) * sizeof(size_t));
+  memmove(&scene->body_shared[index], &scene->body_shared[index + 1],
+          (count - index - 1) * sizeof(bool));
+  scene_free_body(scene, list_remove(scene->bodies, index));
+}
+
+/** Drops a sprite from the type index and frees it */
+void scene_free_sprite(scene_t *scene, sprite_t *sprite) {
+  size_t type = scene_body_type(scene, sprite_get_body(sprite));
+  if (type < scene->type_count) {
+    type_index_remove(scene->sprites_by_type[type], sprite);
+  }
+  sprite_free(sprite);
+}
+
+size_t scene_bodies_of_type(scene_t *scene, size_t type) {
+  assert(type < scene->type_count);
+  return list_size(scene->bodies_by_type[type]);
+}
+
+body_t *scene_get_body_of_type(scene_t *scene, size_t type, size_t index) {
+  assert(type < scene->type_count);
+  assert(index < list_size(scene->bodies_by_type[type]));
+  return list_get(scene->bodies_by_type[type], index);
+}
+
+body_t *scene_first_of_type(scene_t *scene, size_t type) {
+  assert(type < scene->type_count);
+  list_t *bodies = scene->bodies_by_type[type];
+  return list_size(bodies) == 0 ? NULL : list_get(bodies, 0);
+}
+
+sprite_t *scene_first_sprite_of_type(scene_t *scene, size_t type) {
+  assert(type < scene->type_count);
+  list_t *sprites = scene->sprites_by_type[type];
+  return list_size(sprites) == 0 ? NULL : list_get(sprites, 0);
 }
 
 void scene_remove_body(scene_t *scene, size_t index) {
@@ -100,10 +445,14 @@ void scene_remove_body(scene_t *scene, size_t index) {
 }
 void scene_add_sprite(scene_t *scene, sprite_t *sprite) {
   list_add(scene->list_of_sprites, sprite);
+  size_t type = scene_body_type(scene, sprite_get_body(sprite));
+  if (type < scene->type_count) {
+    list_add(scene->sprites_by_type[type], sprite);
+  }
 }
 
 void scene_remove_sprite(scene_t *scene, size_t index) {
-  sprite_free((sprite_t *)list_remove(scene->list_of_sprites, index));
+  scene_free_sprite(scene, list_remove(scene->list_of_sprites, index));
 }
 
 list_t *scene_get_sprites(scene_t *scene) { return scene->list_of_sprites; }
@@ -116,7 +465,8 @@ sprite_t *scene_get_sprite(scene_t *scene, size_t index) {
 void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
                                     void *aux, list_t *bodies,
                                     free_func_t freer) {
-  force_bind_t *force_bind = malloc(sizeof(force_bind_t));
+  force_bind_t *force_bind =
+      track_malloc(TRACK_FORCE_BIND, sizeof(force_bind_t));
   force_bind->aux = aux;
   force_bind->body_targets = bodies;
   force_bind->freer = freer;
@@ -124,18 +474,727 @@ void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
   list_add(scene->force_binds, force_bind);
 }
 
+void scene_add_collision_event(scene_t *scene, collision_event_t event) {
+  if (scene->event_count == scene->event_capacity) {
+    scene->event_capacity *= 2;
+    scene->events = realloc(scene->events,
+                            scene->event_capacity * sizeof(queued_event_t));
+    assert(scene->events != NULL);
+  }
+  scene->events[scene->event_count] =
+      (queued_event_t){.event = event, .sequence = scene->event_count};
+  scene->event_count++;
+}
+
+size_t scene_collision_events(scene_t *scene) { return scene->event_count; }
+
+collision_event_t scene_get_collision_event(scene_t *scene, size_t index) {
+  assert(index < scene->event_count);
+  return scene->events[index].event;
+}
+
+/**
+ * Applies the collisions recorded by the force creators: touching bodies
+ * wake each other up, then handlers run one handler type at a time.
+ */
+void scene_dispatch_collisions(scene_t *scene) {
+  for (size_t i = 0; i < scene->event_count; i++) {
+    collision_event_t *event = &scene->events[i].event;
+    if (event->phase != COLLISION_END) {
+      body_touch(event->body1, event->body2);
+    }
+  }
+  qsort(scene->events, scene->event_count, sizeof(queued_event_t),
+        queued_event_compare);
+  for (size_t i = 0; i < scene->event_count; i++) {
+    collision_event_dispatch(&scene->events[i].event);
+  }
+}
+
+void scene_add_contact(scene_t *scene, body_t *body1, body_t *body2,
+                       double elasticity) {
+  list_add(scene->contacts, contact_init(body1, body2, elasticity));
+}
+
+void scene_add_static_contacts(scene_t *scene, body_t *body, uint32_t mask,
+                               double elasticity) {
+  list_add(scene->static_contact_sets,
+           static_contacts_init(scene, body, mask, elasticity));
+}
+
+/**
+ * Moves the live static bodies of each type to the front of its index, where
+ * the static hierarchy covers them, and lists them
+ */
+list_t *scene_gather_statics(scene_t *scene) {
+  scene_drop_static_bvh(scene);
+  list_t *statics = list_init(INITIAL_CAPACITY_S, NULL);
+  for (size_t type = 0; type < scene->type_count; type++) {
+    // Move the live static bodies to the front, keeping both groups in order
+    list_t *bodies = scene->bodies_by_type[type];
+    list_t *others = list_init(INITIAL_CAPACITY_S, NULL);
+    for (size_t i = list_size(bodies); i > 0; i--) {
+      body_t *body = list_remove(bodies, 0);
+      if (body_get_motion_type(body) == MOTION_STATIC &&
+          !body_is_removed(body)) {
+        list_add(statics, body);
+        scene->static_counts[type]++;
+        list_add(bodies, body);
+      } else {
+        list_add(others, body);
+      }
+    }
+    while (list_size(others) > 0) {
+      list_add(bodies, list_remove(others, 0));
+    }
+    list_free(others);
+  }
+  return statics;
+}
+
+void scene_build_static_bvh(scene_t *scene) {
+  list_t *statics = scene_gather_statics(scene);
+  scene->static_bvh = bvh_init(statics);
+  list_free(statics);
+}
+
+void scene_set_static_bvh(scene_t *scene, bvh_t *bvh) {
+  list_t *statics = scene_gather_statics(scene);
+  assert(bvh_size(bvh) == list_size(statics));
+  list_free(statics);
+  scene->static_bvh = bvh;
+}
+
+void scene_share_static_bvh(scene_t *scene, scene_t *owner) {
+  assert(owner->static_bvh != NULL);
+  scene_set_static_bvh(scene, owner->static_bvh);
+  scene->static_bvh_shared = true;
+}
+
+arena_t *scene_get_arena(scene_t *scene) {
+  if (scene->arena == NULL) {
+    scene->arena = arena_init(SCENE_ARENA_BLOCK_SIZE);
+  }
+  return scene->arena;
+}
+
+void scene_set_contact_iterations(scene_t *scene, size_t iterations) {
+  assert(iterations > 0);
+  scene->contact_iterations = iterations;
+}
+
+/** Smallest box holding shape both before and after it is displaced */
+aabb_t swept_aabb(list_t *shape, vector_t displacement) {
+  aabb_t box = {.min = {INFINITY, INFINITY}, .max = {-INFINITY, -INFINITY}};
+  for (size_t i = 0; i < list_size(shape); i++) {
+    vector_t vertex = *(vector_t *)list_get(shape, i);
+    box.min.x = fmin(box.min.x, vertex.x);
+    box.min.y = fmin(box.min.y, vertex.y);
+    box.max.x = fmax(box.max.x, vertex.x);
+    box.max.y = fmax(box.max.y, vertex.y);
+  }
+  box.min = vec_add(box.min, (vector_t){fmin(displacement.x, 0),
+                                        fmin(displacement.y, 0)});
+  box.max = vec_add(box.max, (vector_t){fmax(displacement.x, 0),
+                                        fmax(displacement.y, 0)});
+  return box;
+}
+
+/**
+ * Calls visit on the live static bodies of the masked types whose bounding
+ * boxes overlap box: those in the static hierarchy, then any added since.
+ * The visitor must check the body's type and whether it was removed.
+ */
+void scene_visit_static(scene_t *scene, aabb_t box, uint32_t mask,
+                        bvh_visitor_t visit, void *aux) {
+  if (scene->static_bvh != NULL) {
+    bvh_query(scene->static_bvh, box, visit, aux);
+  }
+  for (size_t type = 0; type < scene->type_count; type++) {
+    if ((mask & BODY_MASK(type)) == 0) {
+      continue;
+    }
+    list_t *bodies = scene->bodies_by_type[type];
+    for (size_t i = scene->static_counts[type]; i < list_size(bodies); i++) {
+      body_t *body = list_get(bodies, i);
+      if (body_get_motion_type(body) == MOTION_STATIC &&
+          aabb_overlaps(box, body_get_aabb(body))) {
+        visit(body, aux);
+      }
+    }
+  }
+}
+
+/** Calls visit on the bodies of the masked types that are not static */
+void scene_visit_moving(scene_t *scene, aabb_t box, uint32_t mask,
+                        bvh_visitor_t visit, void *aux) {
+  for (size_t type = 0; type < scene->type_count; type++) {
+    if ((mask & BODY_MASK(type)) == 0) {
+      continue;
+    }
+    list_t *bodies = scene->bodies_by_type[type];
+    for (size_t i = scene->static_counts[type]; i < list_size(bodies); i++) {
+      body_t *body = list_get(bodies, i);
+      if (body_get_motion_type(body) != MOTION_STATIC &&
+          aabb_overlaps(box, body_get_aabb(body))) {
+        visit(body, aux);
+      }
+    }
+  }
+}
+
+/** A ray (if shape is NULL) or polygon cast, and its earliest hit so far */
+typedef struct cast_query {
+  scene_t *scene;
+  list_t *shape;
+  vector_t origin;
+  vector_t displacement;
+  uint32_t mask;
+  segment_hit_t best;
+  body_t *best_body;
+} cast_query_t;
+
+void cast_query_visit(body_t *body, cast_query_t *query) {
+  if (body_is_removed(body) ||
+      !scene_body_in_mask(query->scene, body, query->mask)) {
+    return;
+  }
+  list_t *world_shape = body_get_world_shape(body);
+  segment_hit_t candidate =
+      query->shape == NULL
+          ? find_segment_hit(world_shape, query->origin,
+                             vec_add(query->origin, query->displacement))
+          : find_shape_hit(query->shape, query->displacement, world_shape);
+  if (candidate.hit && candidate.fraction < query->best.fraction) {
+    query->best = candidate;
+    query->best_body = body;
+  }
+}
+
+/**
+ * Casts a ray (if shape is NULL) or a polygon by displacement against the
+ * live bodies of the masked types, keeping the earliest hit.
+ */
+bool scene_cast(scene_t *scene, list_t *shape, vector_t origin,
+                vector_t displacement, uint32_t mask, scene_hit_t *hit) {
+  aabb_t box;
+  if (shape == NULL) {
+    box = (aabb_t){.min = {fmin(origin.x, origin.x + displacement.x),
+                           fmin(origin.y, origin.y + displacement.y)},
+                   .max = {fmax(origin.x, origin.x + displacement.x),
+                           fmax(origin.y, origin.y + displacement.y)}};
+  } else {
+    box = swept_aabb(shape, displacement);
+  }
+
+  cast_query_t query = {.scene = scene,
+                        .shape = shape,
+                        .origin = origin,
+                        .displacement = displacement,
+                        .mask = mask,
+                        .best = {.hit = false, .fraction = INFINITY},
+                        .best_body = NULL};
+  scene_visit_static(scene, box, mask, (bvh_visitor_t)cast_query_visit,
+                     &query);
+  scene_visit_moving(scene, box, mask, (bvh_visitor_t)cast_query_visit,
+                     &query);
+  if (query.best_body == NULL) {
+    return false;
+  }
+  *hit = (scene_hit_t){.body = query.best_body,
+                       .point = query.best.point,
+                       .normal = query.best.normal,
+                       .distance =
+                           query.best.fraction * vec_length(displacement)};
+  return true;
+}
+
+bool scene_raycast(scene_t *scene, vector_t origin, vector_t dir,
+                   double max_dist, uint32_t mask, scene_hit_t *hit) {
+  assert(vec_length(dir) > 0);
+  vector_t displacement = vec_multiply(max_dist / vec_length(dir), dir);
+  return scene_cast(scene, NULL, origin, displacement, mask, hit);
+}
+
+bool scene_shapecast(scene_t *scene, list_t *shape, vector_t dir,
+                     double max_dist, uint32_t mask, scene_hit_t *hit) {
+  assert(vec_length(dir) > 0);
+  vector_t displacement = vec_multiply(max_dist / vec_length(dir), dir);
+  return scene_cast(scene, shape, VEC_ZERO, displacement, mask, hit);
+}
+
+projectiles_t *scene_get_projectiles(scene_t *scene) {
+  return scene->projectiles;
+}
+
+scene_stats_t scene_get_stats(scene_t *scene) { return scene->stats; }
+
+void scene_set_timed(scene_t *scene, bool timed) { scene->timed = timed; }
+
+#ifndef HEADLESS
+/** Reads a monotonic clock, in seconds */
+double scene_clock(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+#endif
+
 void scene_add_force_creator(scene_t *scene, force_creator_t forcer, void *aux,
                              free_func_t freer) {
   scene_add_bodies_force_creator(scene, forcer, aux, NULL, freer);
 }
 
+uint32_t scene_random(scene_t *scene) {
+  // xorshift32: small, fast, and the same on every platform
+  uint32_t x = scene->random;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  scene->random = x;
+  return x;
+}
+
+void scene_seed_random(scene_t *scene, uint32_t seed) {
+  // xorshift never leaves 0, so that seed gets the default instead
+  scene->random = seed == 0 ? DEFAULT_RANDOM_SEED : seed;
+}
+
+// SCENE STATE DEFINITION AND FUNCTIONS
+typedef struct static_contact_state {
+  // Index in the scene of the static body the contact is with
+  size_t body;
+  contact_state_t contact;
+} static_contact_state_t;
+
+typedef struct scene_state {
+  size_t info_size;
+  uint32_t random;
+  size_t body_count;
+  size_t body_capacity;
+  size_t *body_serials;
+  body_state_t *bodies;
+  bool *has_info;
+  // info_size bytes for each body
+  char *infos;
+  size_t contact_count;
+  size_t contact_capacity;
+  contact_state_t *contacts;
+  // Number of contacts saved for each static contact set
+  size_t set_count;
+  size_t set_capacity;
+  size_t *set_sizes;
+  size_t static_count;
+  size_t static_capacity;
+  static_contact_state_t *static_contacts;
+  projectiles_t *projectiles;
+} scene_state_t;
+
+scene_state_t *scene_state_init(size_t info_size) {
+  scene_state_t *state = malloc(sizeof(scene_state_t));
+  assert(state != NULL);
+  *state = (scene_state_t){.info_size = info_size,
+                           .random = DEFAULT_RANDOM_SEED,
+                           .body_count = 0,
+                           .body_capacity = 0,
+                           .body_serials = NULL,
+                           .bodies = NULL,
+                           .has_info = NULL,
+                           .infos = NULL,
+                           .contact_count = 0,
+                           .contact_capacity = 0,
+                           .contacts = NULL,
+                           .set_count = 0,
+                           .set_capacity = 0,
+                           .set_sizes = NULL,
+                           .static_count = 0,
+                           .static_capacity = 0,
+                           .static_contacts = NULL,
+                           .projectiles = projectiles_init()};
+  return state;
+}
+
+void scene_state_free(scene_state_t *state) {
+  free(state->body_serials);
+  free(state->bodies);
+  free(state->has_info);
+  free(state->infos);
+  free(state->contacts);
+  free(state->set_sizes);
+  free(state->static_contacts);
+  projectiles_free(state->projectiles);
+  free(state);
+}
+
+/**
+ * Grows an array of a scene state so it holds at least count elements.
+ * Returns false if it was already big enough.
+ */
+bool scene_state_reserve(void **array, size_t *capacity, size_t count,
+                         size_t size) {
+  if (count <= *capacity) {
+    return false;
+  }
+  size_t new_capacity = *capacity == 0 ? INITIAL_CAPACITY_S : *capacity;
+  while (new_capacity < count) {
+    new_capacity *= 2;
+  }
+  *array = realloc(*array, new_capacity * size);
+  assert(*array != NULL);
+  *capacity = new_capacity;
+  return true;
+}
+
+/** Makes room in a scene state for count bodies */
+void scene_state_reserve_bodies(scene_state_t *state, size_t count) {
+  size_t capacity = state->body_capacity;
+  if (!scene_state_reserve((void **)&state->bodies, &capacity, count,
+                           sizeof(body_state_t))) {
+    return;
+  }
+  state->body_serials =
+      realloc(state->body_serials, capacity * sizeof(size_t));
+  state->has_info = realloc(state->has_info, capacity * sizeof(bool));
+  state->infos = realloc(state->infos, capacity * state->info_size);
+  assert(state->body_serials != NULL && state->has_info != NULL);
+  assert(state->infos != NULL || state->info_size == 0);
+  state->body_capacity = capacity;
+}
+
+/** Finds where a body is in the scene */
+size_t scene_body_index(scene_t *scene, body_t *body) {
+  size_t count = list_size(scene->bodies);
+  for (size_t i = 0; i < count; i++) {
+    if (list_get(scene->bodies, i) == body) {
+      return i;
+    }
+  }
+  assert(false && "body is not in the scene");
+  return count;
+}
+
+void scene_save(scene_t *scene, scene_state_t *state) {
+  size_t body_count = list_size(scene->bodies);
+  scene_state_reserve_bodies(state, body_count);
+  state->body_count = body_count;
+  memcpy(state->body_serials, scene->body_serials,
+         body_count * sizeof(size_t));
+  for (size_t i = 0; i < body_count; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    state->bodies[i] = body_save(body);
+    void *info = body_get_info(body);
+    state->has_info[i] = info != NULL;
+    if (info != NULL) {
+      memcpy(&state->infos[i * state->info_size], info, state->info_size);
+    }
+  }
+
+  size_t contact_count = list_size(scene->contacts);
+  scene_state_reserve((void **)&state->contacts, &state->contact_capacity,
+                      contact_count, sizeof(contact_state_t));
+  state->contact_count = contact_count;
+  for (size_t i = 0; i < contact_count; i++) {
+    state->contacts[i] = contact_save(list_get(scene->contacts, i));
+  }
+
+  size_t set_count = list_size(scene->static_contact_sets);
+  scene_state_reserve((void **)&state->set_sizes, &state->set_capacity,
+                      set_count, sizeof(size_t));
+  state->set_count = set_count;
+  state->static_count = 0;
+  for (size_t i = 0; i < set_count; i++) {
+    static_contacts_t *set = list_get(scene->static_contact_sets, i);
+    size_t size = list_size(set->contacts);
+    state->set_sizes[i] = size;
+    scene_state_reserve((void **)&state->static_contacts,
+                        &state->static_capacity, state->static_count + size,
+                        sizeof(static_contact_state_t));
+    for (size_t j = 0; j < size; j++) {
+      contact_t *contact = list_get(set->contacts, j);
+      state->static_contacts[state->static_count++] = (static_contact_state_t){
+          .body = scene_body_index(scene, contact_get_body2(contact)),
+          .contact = contact_save(contact)};
+    }
+  }
+
+  projectiles_copy(state->projectiles, scene->projectiles);
+  state->random = scene->random;
+}
+
+bool scene_can_restore(scene_t *scene, const scene_state_t *state) {
+  return list_size(scene->bodies) >= state->body_count &&
+         memcmp(scene->body_serials, state->body_serials,
+                state->body_count * sizeof(size_t)) == 0;
+}
+
+/** Frees every removed body and everything that belongs to it */
+void scene_reap(scene_t *scene) {
+  for (int i = 0; i < list_size(scene->contacts); i++) {
+    if (contact_is_removed(list_get(scene->contacts, i))) {
+      contact_free(list_remove(scene->contacts, i));
+      i -= 1;
+    }
+  }
+  for (int i = 0; i < list_size(scene->static_contact_sets); i++) {
+    static_contacts_t *set = list_get(scene->static_contact_sets, i);
+    if (body_is_removed(set->body)) {
+      static_contacts_free(list_remove(scene->static_contact_sets, i));
+      i -= 1;
+    }
+  }
+  for (int i = 0; i < list_size(scene->force_binds); i++) {
+    if (bind_is_removed(list_get(scene->force_binds, i))) {
+      force_bind_free(list_remove(scene->force_binds, i));
+      i -= 1;
+    }
+  }
+  for (int i = 0; i < list_size(scene->list_of_sprites); i++) {
+    if (sprite_is_removed(list_get(scene->list_of_sprites, i))) {
+      scene_free_sprite(scene, list_remove(scene->list_of_sprites, i));
+      i -= 1;
+    }
+  }
+  for (int i = 0; i < list_size(scene->bodies); i++) {
+    if (body_is_removed(list_get(scene->bodies, i))) {
+      scene_drop_body(scene, i);
+      i -= 1;
+    }
+  }
+}
+
+/** Removes and frees every body past the first count, with what they own */
+void scene_truncate(scene_t *scene, size_t count) {
+  size_t body_count = list_size(scene->bodies);
+  assert(body_count >= count);
+  if (body_count > count) {
+    for (size_t i = count; i < body_count; i++) {
+      body_remove(list_get(scene->bodies, i));
+    }
+    scene_reap(scene);
+  }
+}
+
+/**
+ * Puts a body in a saved state, unless it is already in it, so bodies that
+ * have not changed keep their world shapes
+ */
+void scene_restore_body(body_t *body, const body_state_t *state) {
+  body_state_t current = body_save(body);
+  if (!body_state_equal(&current, state)) {
+    body_restore(body, state);
+  }
+}
+
+void scene_restore(scene_t *scene, const scene_state_t *state) {
+  scene_truncate(scene, state->body_count);
+  // Bodies rebuilt from the state now stand for the ones it was saved from
+  memcpy(scene->body_serials, state->body_serials,
+         state->body_count * sizeof(size_t));
+  for (size_t i = 0; i < state->body_count; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    // Shared bodies are static, so they are already as they were saved
+    if (!scene->body_shared[i]) {
+      scene_restore_body(body, &state->bodies[i]);
+    }
+    void *info = body_get_info(body);
+    assert((info != NULL) == state->has_info[i]);
+    if (info != NULL) {
+      memcpy(info, &state->infos[i * state->info_size], state->info_size);
+    }
+  }
+
+  assert(list_size(scene->contacts) == state->contact_count);
+  for (size_t i = 0; i < state->contact_count; i++) {
+    contact_restore(list_get(scene->contacts, i), &state->contacts[i]);
+  }
+
+  assert(list_size(scene->static_contact_sets) == state->set_count);
+  const static_contact_state_t *saved = state->static_contacts;
+  for (size_t i = 0; i < state->set_count; i++) {
+    static_contacts_t *set = list_get(scene->static_contact_sets, i);
+    static_contacts_retire(set, set->contacts);
+    for (size_t j = 0; j < state->set_sizes[i]; j++, saved++) {
+      contact_t *contact =
+          static_contacts_take(set, list_get(scene->bodies, saved->body));
+      contact_restore(contact, &saved->contact);
+      list_add(set->contacts, contact);
+    }
+  }
+
+  projectiles_copy(scene->projectiles, state->projectiles);
+  scene->random = state->random;
+}
+
+bool scene_fork(scene_t *fork, scene_t *scene, size_t info_size) {
+  size_t body_count = list_size(scene->bodies);
+  if (list_size(fork->bodies) < body_count ||
+      memcmp(fork->body_serials, scene->body_serials,
+             body_count * sizeof(size_t)) != 0) {
+    return false;
+  }
+  scene_truncate(fork, body_count);
+  for (size_t i = 0; i < body_count; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    body_t *copy = list_get(fork->bodies, i);
+    if (fork->body_shared[i]) {
+      // Under the same serial, a shared body is the scene's own
+      assert(copy == body);
+      continue;
+    }
+    body_state_t state = body_save(body);
+    scene_restore_body(copy, &state);
+    void *info = body_get_info(body);
+    void *copy_info = body_get_info(copy);
+    assert((info != NULL) == (copy_info != NULL));
+    if (info != NULL) {
+      memcpy(copy_info, info, info_size);
+    }
+  }
+
+  assert(list_size(fork->contacts) == list_size(scene->contacts));
+  for (size_t i = 0; i < list_size(scene->contacts); i++) {
+    contact_state_t state = contact_save(list_get(scene->contacts, i));
+    contact_restore(list_get(fork->contacts, i), &state);
+  }
+
+  size_t set_count = list_size(scene->static_contact_sets);
+  assert(list_size(fork->static_contact_sets) == set_count);
+  for (size_t i = 0; i < set_count; i++) {
+    static_contacts_t *set = list_get(scene->static_contact_sets, i);
+    static_contacts_t *copy = list_get(fork->static_contact_sets, i);
+    static_contacts_retire(copy, copy->contacts);
+    for (size_t j = 0; j < list_size(set->contacts); j++) {
+      contact_t *contact = list_get(set->contacts, j);
+      size_t index = scene_body_index(scene, contact_get_body2(contact));
+      contact_t *contact_copy =
+          static_contacts_take(copy, list_get(fork->bodies, index));
+      contact_state_t state = contact_save(contact);
+      contact_restore(contact_copy, &state);
+      list_add(copy->contacts, contact_copy);
+    }
+  }
+
+  projectiles_copy(fork->projectiles, scene->projectiles);
+  fork->random = scene->random;
+  return true;
+}
+
+void scene_mirror(scene_t *fork, scene_t *scene) {
+  size_t body_count = list_size(scene->bodies);
+  assert(list_size(fork->bodies) == body_count);
+  for (size_t i = 0; i < body_count; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    body_t *copy = list_get(fork->bodies, i);
+    assert(fork->body_shared[i] ? copy == body
+                                : body_get_motion_type(copy) ==
+                                      body_get_motion_type(body));
+  }
+  // The fork's bodies now stand for the scene's, as after scene_restore()
+  memcpy(fork->body_serials, scene->body_serials,
+         body_count * sizeof(size_t));
+}
+
+size_t scene_state_bodies(const scene_state_t *state) {
+  return state->body_count;
+}
+
+const void *scene_state_get_info(const scene_state_t *state, size_t index) {
+  assert(index < state->body_count);
+  if (!state->has_info[index]) {
+    return NULL;
+  }
+  return &state->infos[index * state->info_size];
+}
+// END OF SCENE STATE DEFINITION
+
+/**
+ * Replaces a static contact set's contacts with ones for the static bodies
+ * near where its body could reach this tick, keeping the contacts it had.
+ */
+void scene_gather_static_contacts(scene_t *scene, static_contacts_t *set,
+                                  double dt) {
+  list_t *swap = set->previous;
+  set->previous = set->contacts;
+  set->contacts = swap;
+
+  aabb_t box = body_get_aabb(set->body);
+  vector_t displacement = body_get_tick_displacement(set->body, dt);
+  aabb_t moved = {.min = vec_add(box.min, displacement),
+                  .max = vec_add(box.max, displacement)};
+  box = aabb_union(box, moved);
+  vector_t margin = {STATIC_CONTACT_MARGIN, STATIC_CONTACT_MARGIN};
+  box = (aabb_t){.min = vec_subtract(box.min, margin),
+                 .max = vec_add(box.max, margin)};
+  scene_visit_static(scene, box, set->mask,
+                     (bvh_visitor_t)static_contacts_visit, set);
+
+  static_contacts_retire(set, set->previous);
+}
+
 void scene_tick(scene_t *scene, double dt) {
+#ifndef HEADLESS
+  double start = scene->timed ? scene_clock() : 0;
+#endif
+  size_t pair_tests = collision_test_count();
+  size_t static_queries = 0;
+  scene->event_count = 0;
+  // Every body starts out on its own island; collisions join them. Shared
+  // bodies are static, so they never join one, and are left as they are.
+  for (size_t i = 0; i < list_size(scene->bodies); i++) {
+    if (!scene->body_shared[i]) {
+      body_island_begin(list_get(scene->bodies, i));
+    }
+  }
 
   // Execute all forces in scene
   for (size_t i = 0; i < list_size(scene->force_binds); i++) {
     force_bind_t *force_bind = (force_bind_t *)list_get(scene->force_binds, i);
     force_bind->force_function(force_bind->aux);
   }
+  scene_dispatch_collisions(scene);
+
+  // Solve all contacts together, starting from last tick's impulses
+  for (int i = 0; i < list_size(scene->contacts); i++) {
+    contact_t *contact = list_get(scene->contacts, i);
+    if (contact_is_removed(contact)) {
+      contact_free(list_remove(scene->contacts, i));
+      i -= 1;
+      continue;
+    }
+    contact_prepare(contact, dt);
+  }
+  for (int i = 0; i < list_size(scene->static_contact_sets); i++) {
+    static_contacts_t *set = list_get(scene->static_contact_sets, i);
+    if (body_is_removed(set->body)) {
+      static_contacts_free(list_remove(scene->static_contact_sets, i));
+      i -= 1;
+      continue;
+    }
+    // A sleeping body cannot move, so it keeps touching the same static
+    // bodies until it wakes
+    if (body_is_sleeping(set->body)) {
+      static_contacts_prune(set);
+    } else {
+      scene_gather_static_contacts(scene, set, dt);
+      static_queries++;
+    }
+    for (size_t j = 0; j < list_size(set->contacts); j++) {
+      contact_prepare(list_get(set->contacts, j), dt);
+    }
+  }
+  for (size_t iteration = 0; iteration < scene->contact_iterations;
+       iteration++) {
+    for (size_t i = 0; i < list_size(scene->contacts); i++) {
+      contact_solve(list_get(scene->contacts, i), dt);
+    }
+    for (size_t i = 0; i < list_size(scene->static_contact_sets); i++) {
+      static_contacts_t *set = list_get(scene->static_contact_sets, i);
+      for (size_t j = 0; j < list_size(set->contacts); j++) {
+        contact_solve(list_get(set->contacts, j), dt);
+      }
+    }
+  }
+  projectiles_tick(scene->projectiles, scene, dt);
 
   // Remove force binds if body is_removed == true
   for (int i = 0; i < list_size(scene->force_binds); i++) {
@@ -150,21 +1209,54 @@ void scene_tick(scene_t *scene, double dt) {
   for (int i = 0; i < list_size(scene->list_of_sprites); i++) {
     sprite_t *sprite = list_get(scene->list_of_sprites, i);
     if (sprite_is_removed(sprite)) {
-      sprite_free(list_remove(scene->list_of_sprites, i));
+      scene_free_sprite(scene, list_remove(scene->list_of_sprites, i));
       i -= 1;
     }
   }
 
+  // Wake or put to sleep whole islands at once
+  for (size_t i = 0; i < list_size(scene->bodies); i++) {
+    body_t *body = list_get(scene->bodies, i);
+    if (!body_is_removed(body)) {
+      body_island_gather(body, dt);
+    }
+  }
+  for (size_t i = 0; i < list_size(scene->bodies); i++) {
+    body_t *body = list_get(scene->bodies, i);
+    if (!body_is_removed(body)) {
+      body_island_settle(body);
+    }
+  }
+
+  // Kept static contacts must not outlive the bodies removed below
+  for (size_t i = 0; i < list_size(scene->static_contact_sets); i++) {
+    static_contacts_prune(list_get(scene->static_contact_sets, i));
+  }
+
   // Remove bodies where is_removed == true
   for (int i = 0; i < list_size(scene->bodies); i++) {
     body_t *body = (body_t *)list_get(scene->bodies, i);
 
     if (body_is_removed(body)) {
-      body_free(list_remove(scene->bodies, i));
+      scene_drop_body(scene, i);
       i -= 1; // fix current index after removal of item from list
       continue;
     }
 
-    body_tick(body, dt);
+    if (!body_is_resting(body)) {
+      body_tick(body, dt);
+    }
+  }
+
+  scene->stats = (scene_stats_t){
+      .bodies = list_size(scene->bodies),
+      .force_binds = list_size(scene->force_binds),
+      .pair_tests = collision_test_count() - pair_tests,
+      .static_queries = static_queries,
+      .tick_time = 0};
+#ifndef HEADLESS
+  if (scene->timed) {
+    scene->stats.tick_time = scene_clock() - start;
   }
+#endif
 }
\ No newline at end of file
@@ -1,12 +1,16 @@
 #include "sdl_wrapper.h"
+#include "alloc_track.h"
+#include "atlas.h"
 #include "list.h"
 #include "map.h"
+#include "projectile.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL2_gfxPrimitives.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_mixer.h>
 #include <assert.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -20,6 +24,24 @@ const int FREQUENCY = 44100;
 const int CHANNELS = 2;
 const int CHUNKSIZE = 1024;
 
+/** Number of mixer channels sound effects can play on at once */
+#define VOICE_COUNT 16
+/** Most sound effect requests that can be queued within one frame */
+#define SOUND_QUEUE_CAPACITY 32
+/** Frames shown in the performance overlay's frame time graph */
+#define HUD_HISTORY 120
+
+/** Key that shows or hides the performance overlay */
+const SDL_Keycode HUD_TOGGLE_KEY = SDLK_F3;
+/** Overlay position and text line height, in pixels */
+const int HUD_MARGIN = 8;
+const int HUD_LINE_HEIGHT = 12;
+/** Graph height, and the frame time that fills it */
+const int HUD_GRAPH_HEIGHT = 40;
+const double HUD_GRAPH_MAX_MS = 50;
+/** Frames slower than this are drawn in red */
+const double HUD_BUDGET_MS = 1000.0 / 60;
+
 /**
  * The coordinate at the center of the screen.
  */
@@ -51,15 +73,98 @@ uint32_t key_start_timestamp;
  */
 clock_t last_clock = 0;
 
+/**
+ * Mixing limits for each sound effect.
+ * max_voices caps how many copies of the effect can overlap and
+ * priority decides which voices may be stolen when the pool is full.
+ */
+typedef struct sound_limit {
+  size_t max_voices;
+  size_t priority;
+} sound_limit_t;
+
+/** Indexed by sound_t; music entries are unused since music has no voice */
+const sound_limit_t SOUND_LIMITS[] = {
+    [PISTOL_S] = {.max_voices = 4, .priority = 1},
+    [SHOTGUN_S] = {.max_voices = 2, .priority = 2},
+    [RICOCHET_S] = {.max_voices = 3, .priority = 1},
+    [JUMP] = {.max_voices = 2, .priority = 2},
+    [CLICK] = {.max_voices = 1, .priority = 3},
+    [HIT] = {.max_voices = 2, .priority = 3},
+};
+
+/** What is currently playing on one mixer channel */
+typedef struct voice {
+  sound_t sound;
+  size_t priority;
+  size_t started;
+} voice_t;
+
+/**
+ * The voice pool, indexed by mixer channel.
+ * A voice is only meaningful while Mix_Playing() reports its channel busy.
+ */
+voice_t voices[VOICE_COUNT];
+/** Counts voices started, used to find the oldest voice to steal */
+size_t voices_started = 0;
+/** Sound effects requested since the last sdl_flush_sounds() */
+sound_t sound_queue[SOUND_QUEUE_CAPACITY];
+size_t sound_queue_size = 0;
+/**
+ * Incremented whenever the scene-to-pixel mapping changes,
+ * so sprites know their cached destination rects are stale.
+ */
+size_t view_revision = 0;
+
+size_t sdl_get_view_revision(void) { return view_revision; }
+
+/** Whether the performance overlay is drawn */
+bool hud_visible = false;
+/** Recent frame times in milliseconds, as a ring buffer */
+double hud_frame_ms[HUD_HISTORY];
+size_t hud_frame_next = 0;
+/** The value of hud_clock_ms() when the last frame started rendering */
+double hud_last_frame = 0;
+
+/** Draw order of the render queue; lower layers are drawn first */
+typedef enum render_layer {
+  LAYER_BACKGROUND,
+  LAYER_WORLD,
+  LAYER_SHAPES,
+  LAYER_PLAYERS,
+  LAYER_HUD
+} render_layer_t;
+
+/** Bits of a render key below the layer, holding the texture's address */
+#define RENDER_TEXTURE_BITS 56
+/** Radix sort digit size */
+#define RENDER_RADIX_BITS 8
+#define RENDER_RADIX (1 << RENDER_RADIX_BITS)
+
+/**
+ * One thing to draw this frame: a textured sprite, the polygon of a body
+ * if sprite is NULL, or a bullet if both are NULL.
+ * The key orders items by layer, then by texture.
+ */
+typedef struct render_item {
+  uint64_t key;
+  sprite_t *sprite;
+  body_t *body;
+  projectiles_t *projectiles;
+  size_t projectile;
+} render_item_t;
+
+/** Items queued for the current frame, and scratch space for sorting */
+render_item_t *render_queue = NULL;
+render_item_t *render_scratch = NULL;
+size_t render_queue_size = 0;
+size_t render_queue_capacity = 0;
+
 /** Computes the center of the window in pixel coordinates */
 vector_t get_window_center(void) {
-  int *width = malloc(sizeof(*width)), *height = malloc(sizeof(*height));
-  assert(width != NULL);
-  assert(height != NULL);
-  SDL_GetWindowSize(window, width, height);
-  vector_t dimensions = {.x = *width, .y = *height};
-  free(width);
-  free(height);
+  int width, height;
+  SDL_GetWindowSize(window, &width, &height);
+  vector_t dimensions = {.x = width, .y = height};
   return vec_multiply(0.5, dimensions);
 }
 
@@ -136,8 +241,19 @@ bool sdl_is_done(void *state) {
     case SDL_QUIT:
       free(event);
       return true;
+    case SDL_WINDOWEVENT:
+      if (event->window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+        view_revision++;
+      }
+      break;
     case SDL_KEYDOWN:
     case SDL_KEYUP:
+      if (event->key.keysym.sym == HUD_TOGGLE_KEY) {
+        if (event->type == SDL_KEYDOWN && !event->key.repeat) {
+          hud_visible = !hud_visible;
+        }
+        break;
+      }
       // Skip the keypress if no handler is configured
       // or an unrecognized key was pressed
       if (key_handler == NULL)
@@ -196,14 +312,15 @@ void sdl_draw_polygon(list_t *points, rgb_color_t color) {
 }
 
 void sdl_change_music(state_t *state, sound_t sound) {
-  Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 1024);
   Mix_HaltMusic();
   sdl_music(state, sound);
 }
 
 list_t *sdl_load_sounds(void) {
-  list_t *sound_effects = list_init(3, NULL);
-  Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 1024);
+  list_t *sound_effects = list_init(3, (free_func_t)Mix_FreeChunk);
+  // The audio device stays open until sdl_clean()
+  Mix_OpenAudio(FREQUENCY, MIX_DEFAULT_FORMAT, CHANNELS, CHUNKSIZE);
+  Mix_AllocateChannels(VOICE_COUNT);
   Mix_Chunk *pistol = Mix_LoadWAV("assets/pistol.wav");
   Mix_Chunk *shotgun = Mix_LoadWAV("assets/shotgun.wav");
   Mix_Chunk *ricochet = Mix_LoadWAV("assets/ricochet.wav");
@@ -231,13 +348,103 @@ list_t *sdl_load_sounds(void) {
 }
 
 void sdl_music(state_t *state, sound_t sound) {
-  Mix_OpenAudio(FREQUENCY, MIX_DEFAULT_FORMAT, CHANNELS, CHUNKSIZE);
   Mix_PlayMusic((Mix_Music *)state_get_sounds(state, sound), -1);
 }
 
 void sdl_sound_effects(state_t *state, sound_t sound) {
-  Mix_OpenAudio(FREQUENCY, MIX_DEFAULT_FORMAT, CHANNELS, CHUNKSIZE);
-  Mix_PlayChannel(-1, (Mix_Chunk *)state_get_sounds(state, sound), 0);
+  assert(sound < sizeof(SOUND_LIMITS) / sizeof(*SOUND_LIMITS));
+  if (sound_queue_size < SOUND_QUEUE_CAPACITY) {
+    sound_queue[sound_queue_size++] = sound;
+    return;
+  }
+
+  // Queue is full: replace the least important queued request, if any
+  size_t lowest = 0;
+  for (size_t i = 1; i < SOUND_QUEUE_CAPACITY; i++) {
+    if (SOUND_LIMITS[sound_queue[i]].priority <
+        SOUND_LIMITS[sound_queue[lowest]].priority) {
+      lowest = i;
+    }
+  }
+  if (SOUND_LIMITS[sound_queue[lowest]].priority <
+      SOUND_LIMITS[sound].priority) {
+    sound_queue[lowest] = sound;
+  }
+}
+
+/**
+ * Picks the channel a sound effect should play on.
+ * Uses a free channel if the effect is under its voice limit,
+ * otherwise steals the oldest voice of the same effect.
+ * If no channel is free, steals the oldest voice of lower or equal priority.
+ *
+ * @return the channel to play on, or -1 if the effect should be dropped
+ */
+int sound_pick_channel(sound_t sound) {
+  sound_limit_t limit = SOUND_LIMITS[sound];
+  int free_channel = -1;
+  int oldest_same = -1;
+  int oldest_stealable = -1;
+  size_t playing_same = 0;
+
+  for (int channel = 0; channel < VOICE_COUNT; channel++) {
+    if (!Mix_Playing(channel)) {
+      if (free_channel == -1) {
+        free_channel = channel;
+      }
+      continue;
+    }
+    voice_t *voice = &voices[channel];
+    if (voice->sound == sound) {
+      playing_same++;
+      if (oldest_same == -1 || voice->started < voices[oldest_same].started) {
+        oldest_same = channel;
+      }
+    }
+    if (voice->priority <= limit.priority &&
+        (oldest_stealable == -1 ||
+         voice->priority < voices[oldest_stealable].priority ||
+         (voice->priority == voices[oldest_stealable].priority &&
+          voice->started < voices[oldest_stealable].started))) {
+      oldest_stealable = channel;
+    }
+  }
+
+  if (playing_same >= limit.max_voices) {
+    return oldest_same;
+  }
+  if (free_channel != -1) {
+    return free_channel;
+  }
+  return oldest_stealable;
+}
+
+void sdl_flush_sounds(state_t *state) {
+  for (size_t i = 0; i < sound_queue_size; i++) {
+    sound_t sound = sound_queue[i];
+    int channel = sound_pick_channel(sound);
+    if (channel == -1) {
+      continue;
+    }
+    // Playing on a busy channel halts whatever was there
+    Mix_PlayChannel(channel, (Mix_Chunk *)state_get_sounds(state, sound), 0);
+    voices[channel] = (voice_t){.sound = sound,
+                                .priority = SOUND_LIMITS[sound].priority,
+                                .started = voices_started++};
+  }
+  sound_queue_size = 0;
+}
+
+/** Gives every body but the gravity wells a sprite */
+void sprite_list_init(scene_t *scene) {
+  size_t body_count = scene_bodies(scene);
+  for (size_t i = 0; i < body_count; i++) {
+    body_t *body = scene_get_body(scene, i);
+    if (((body_info_t *)body_get_info(body))->type != GRAVITY) {
+      sprite_t *new_sprite = sprite_init(body);
+      scene_add_sprite(scene, new_sprite);
+    }
+  }
 }
 
 void sdl_sprites_init(scene_t *scene, game_state_t state) {
@@ -245,177 +452,169 @@ void sdl_sprites_init(scene_t *scene, game_state_t state) {
   sprite_img_init(scene, state);
 }
 
-void sprite_img_init(scene_t *scene, game_state_t state) {
-  size_t MAX_PATH_LENGTH = 50;
-  size_t name_len = 8;
-  size_t assets_len = 7;
-  size_t prefix_length = name_len + assets_len;
-
-  char state_name[name_len];
-  if (state == MAP1 || state == MAP3) {
-    strcpy(state_name, "map1_");
-  } else if (state == MAP2) {
-    strcpy(state_name, "map2_");
-  } else if (state == INTRO_MENU) {
-    strcpy(state_name, "intr_");
-  } else if (state == MAIN_MENU) {
-    strcpy(state_name, "main_");
-  } else if (state == LORE) {
-    strcpy(state_name, "lore_");
-  } else if (state == MAP_SELECT) {
-    strcpy(state_name, "slec_");
-  } else if (state == CREDITS) {
-    strcpy(state_name, "cred_");
-  } else if (state == INSTRUCTIONS) {
-    strcpy(state_name, "inst_");
-  } else if (state == GAME_WIN_P1) {
-    strcpy(state_name, "end1_");
-  } else if (state == GAME_WIN_P2) {
-    strcpy(state_name, "end2_");
-  }
-
-  size_t sprite_count = list_size(scene_get_sprites(scene));
-  for (size_t i = 0; i < sprite_count; i++) {
-    sprite_t *sprite = scene_get_sprite(scene, i);
-    body_t *body = sprite_get_body(sprite);
-    list_t *surfaces = list_init(1, (free_func_t)SDL_FreeSurface);
+/** File name prefix of each game state's assets, NULL if it has none */
+const char *STATE_ASSET_PREFIXES[GAME_STATE_COUNT] = {
+    [INTRO_MENU] = "intr_",  [MAIN_MENU] = "main_",    [LORE] = "lore_",
+    [MAP_SELECT] = "slec_",  [CREDITS] = "cred_",      [INSTRUCTIONS] = "inst_",
+    [MAP1] = "map1_",        [MAP2] = "map2_",         [MAP3] = "map1_",
+    [GAME_WIN_P1] = "end1_", [GAME_WIN_P2] = "end2_"};
 
-    char path[MAX_PATH_LENGTH];
-    strcpy(path, "assets/");
-    strcat(path, state_name);
+/** Images loaded with a game state's prefix; missing ones are skipped */
+const char *STATE_ASSETS[] = {"p1_0.png", "p1_1.png", "p1_2.png",
+                              "p1_3.png", "p2_0.png", "p2_1.png",
+                              "p2_2.png", "p2_3.png", "background.jpg"};
 
-    switch (((body_info_t *)body_get_info(body))->type) {
-    case PLAYER1: {
-      char path_suffix[9] = "p1_0.png";
-      strcat(path, path_suffix);
-      list_add(surfaces, IMG_Load(path));
+/** Images without a prefix, packed into the atlas of every map */
+const char *SHARED_ASSETS[] = {"powerup_ricochet.png", "powerup_shotgun.png",
+                               "p1_life.png", "p2_life.png"};
 
-      path[prefix_length] = '1';
-      list_add(surfaces, IMG_Load(path));
+/**
+ * One atlas per game state, built the first time the state is loaded and
+ * kept until sdl_clean(), so restarting a state reuses its texture.
+ */
+atlas_t *state_atlases[GAME_STATE_COUNT] = {NULL};
 
-      path[prefix_length] = '2';
-      list_add(surfaces, IMG_Load(path));
+bool is_map_state(game_state_t state) {
+  return state == MAP1 || state == MAP2 || state == MAP3;
+}
 
-      path[prefix_length] = '3';
-      list_add(surfaces, IMG_Load(path));
+void atlas_load(atlas_t *atlas, const char *prefix, const char *name) {
+  size_t MAX_PATH_LENGTH = 50;
+  char path[MAX_PATH_LENGTH];
+  snprintf(path, MAX_PATH_LENGTH, "assets/%s%s", prefix, name);
+  SDL_Surface *surface = IMG_Load(path);
+  if (surface == NULL) {
+    return;
+  }
+  SDL_SetColorKey(surface, SDL_TRUE,
+                  SDL_MapRGB(surface->format, 255, 255, 255));
+  atlas_add(atlas, name, surface);
+}
 
-      break;
+atlas_t *sdl_get_atlas(game_state_t state) {
+  if (state_atlases[state] != NULL) {
+    return state_atlases[state];
+  }
+  atlas_t *atlas = atlas_init();
+  size_t state_assets = sizeof(STATE_ASSETS) / sizeof(*STATE_ASSETS);
+  if (STATE_ASSET_PREFIXES[state] == NULL) {
+    state_assets = 0;
+  }
+  for (size_t i = 0; i < state_assets; i++) {
+    atlas_load(atlas, STATE_ASSET_PREFIXES[state], STATE_ASSETS[i]);
+  }
+  if (is_map_state(state)) {
+    // Plus the images the map's bodies name, with the state's prefix
+    map_file_t *file = map_get_file(state);
+    for (size_t i = 0; i < map_file_bodies(file); i++) {
+      const char *texture = map_file_texture(file, i);
+      SDL_Rect region;
+      if (texture != NULL && !atlas_find(atlas, texture, &region)) {
+        atlas_load(atlas, STATE_ASSET_PREFIXES[state], texture);
+      }
     }
-    case PLAYER2: {
-      char path_suffix[9] = "p2_0.png";
-      strcat(path, path_suffix);
-      list_add(surfaces, IMG_Load(path));
-
-      path[prefix_length] = '1';
-      list_add(surfaces, IMG_Load(path));
+    size_t shared_assets = sizeof(SHARED_ASSETS) / sizeof(*SHARED_ASSETS);
+    for (size_t i = 0; i < shared_assets; i++) {
+      atlas_load(atlas, "", SHARED_ASSETS[i]);
+    }
+  }
+  atlas_build(atlas, renderer);
+  state_atlases[state] = atlas;
+  return atlas;
+}
 
-      path[prefix_length] = '2';
-      list_add(surfaces, IMG_Load(path));
+/**
+ * Points the sprite at the state's atlas and adds a frame for each image
+ * in names that the atlas holds.
+ */
+void sprite_set_images(sprite_t *sprite, game_state_t state,
+                       const char *names[], size_t count) {
+  atlas_t *atlas = sdl_get_atlas(state);
+  sprite_set_texture(sprite, atlas_get_texture(atlas));
+  for (size_t i = 0; i < count; i++) {
+    SDL_Rect region;
+    if (atlas_find(atlas, names[i], &region)) {
+      sprite_add_frame(sprite, region);
+    }
+  }
+}
 
-      path[prefix_length] = '3';
-      list_add(surfaces, IMG_Load(path));
+void sprite_img_init(scene_t *scene, game_state_t state) {
+  const char *P1_FRAMES[] = {"p1_0.png", "p1_1.png", "p1_2.png", "p1_3.png"};
+  const char *P2_FRAMES[] = {"p2_0.png", "p2_1.png", "p2_2.png", "p2_3.png"};
+  const char *BACKGROUND_IMAGE[] = {"background.jpg"};
 
-      break;
+  size_t sprite_count = list_size(scene_get_sprites(scene));
+  for (size_t i = 0; i < sprite_count; i++) {
+    sprite_t *sprite = scene_get_sprite(scene, i);
+    body_info_t *info = get_info(sprite_get_body(sprite));
+    // Map bodies are drawn with the image their map file names
+    if (info->texture != NULL) {
+      sprite_set_images(sprite, state, &info->texture, 1);
+      continue;
     }
-    case GROUND: {
-      char path_suffix[11] = "ground.png";
-      strcat(path, path_suffix);
-      list_add(surfaces, IMG_Load(path));
+
+    switch (info->type) {
+    case PLAYER1:
+      sprite_set_images(sprite, state, P1_FRAMES, SPRITE_MAX_FRAMES);
       break;
-    }
-    case WALL: {
-      char path_suffix[9] = "wall.png";
-      strcat(path, path_suffix);
-      list_add(surfaces, IMG_Load(path));
+    case PLAYER2:
+      sprite_set_images(sprite, state, P2_FRAMES, SPRITE_MAX_FRAMES);
       break;
-    }
-    case BACKGROUND: {
-      char path_suffix[15] = "background.jpg";
-      strcat(path, path_suffix);
-      list_add(surfaces, IMG_Load(path));
+    case BACKGROUND:
+      sprite_set_images(sprite, state, BACKGROUND_IMAGE, 1);
       break;
-    }
     default:
       break;
     }
-
-    // for each surface in list
-    for (size_t i = 0; i < list_size(surfaces); i++) {
-      SDL_Surface *surface = (SDL_Surface *)list_get(surfaces, i);
-      SDL_SetColorKey(surface, SDL_TRUE,
-                      SDL_MapRGB(surface->format, 255, 255, 255));
-      SDL_Texture *tex = SDL_CreateTextureFromSurface(renderer, surface);
-      if (tex != NULL) {
-        sprite_add_tex(sprite, tex);
-      }
-    }
-
-    list_free(surfaces);
   }
 }
 
 void sprite_img_add(scene_t *scene, body_t *body, game_state_t state) {
   sprite_t *sprite = sprite_init(body);
   body_info_t *info = get_info(body);
-  SDL_Surface *surface = NULL;
+  const char *name[1] = {NULL};
   switch (info->type) {
   case POWERUP_RICOCHET:
-    surface = IMG_Load("assets/powerup_ricochet.png");
+    name[0] = "powerup_ricochet.png";
     break;
   case POWERUP_SHOTGUN:
-    surface = IMG_Load("assets/powerup_shotgun.png");
+    name[0] = "powerup_shotgun.png";
     break;
   case P1_LIFE:
-    if (state == MAP1 || state == MAP3) {
-      surface = IMG_Load("assets/p1_life.png");
-    } else if (state == MAP2) {
-      surface = IMG_Load("assets/p1_life.png");
-    }
+    name[0] = "p1_life.png";
     break;
   case P2_LIFE:
-    if (state == MAP1 || state == MAP3) {
-      surface = IMG_Load("assets/p2_life.png");
-    } else if (state == MAP2) {
-      surface = IMG_Load("assets/p2_life.png");
-    }
+    name[0] = "p2_life.png";
     break;
   default:
     break;
   }
-  assert(surface != NULL);
-  SDL_SetColorKey(surface, SDL_TRUE,
-                  SDL_MapRGB(surface->format, 255, 255, 255));
-  SDL_Texture *tex = SDL_CreateTextureFromSurface(renderer, surface);
-  SDL_FreeSurface(surface);
-
-  sprite_add_tex(sprite, tex);
+  assert(name[0] != NULL && is_map_state(state));
+  sprite_set_images(sprite, state, name, 1);
+  assert(sprite_frames(sprite) == 1);
   scene_add_sprite(scene, sprite);
 }
 
 void sprite_img_update(sprite_t *sprite) {
-  const size_t WALKING_MOD = 38;
-  const size_t RUNNING_MOD = 12;
   body_type_t body_type = get_info(sprite_get_body(sprite))->type;
   assert(body_type == PLAYER1 || body_type == PLAYER2);
 
-  size_t new_frame = sprite_get_curr_ind(sprite);
   vector_t vel = body_get_velocity(sprite_get_body(sprite));
-
   if (vel.y > 0) {
-    new_frame = 1;
+    sprite_set_tex(sprite, 1);
   } else if (vel.y < 0) {
-    new_frame = 3;
-  } else if (vel.y == 0) {
-    size_t mod = WALKING_MOD;
-    if (vel.x != 0) {
-      mod = RUNNING_MOD;
-    }
-    if (rand() % mod == 0) {
-      new_frame = (new_frame + 1) % sprite_textures(sprite);
-    }
+    sprite_set_tex(sprite, 3);
   }
+}
 
-  sprite_set_tex(sprite, new_frame);
+void sprite_img_advance(sprite_t *sprite) {
+  if (sprite_frames(sprite) == 0 ||
+      body_get_velocity(sprite_get_body(sprite)).y != 0) {
+    return;
+  }
+  sprite_set_tex(sprite,
+                 (sprite_get_curr_ind(sprite) + 1) % sprite_frames(sprite));
 }
 
 void sdl_show(void) {
@@ -438,98 +637,285 @@ void sdl_show(void) {
 }
 
 void sdl_init(vector_t min, vector_t max) {
-  // Check parameters
-  assert(min.x < max.x);
-  assert(min.y < max.y);
+  // The window and renderer live for the whole program
+  assert(window == NULL && renderer == NULL);
 
-  center = vec_multiply(0.5, vec_add(min, max));
-  max_diff = vec_subtract(max, center);
   SDL_Init(SDL_INIT_EVERYTHING);
   window = SDL_CreateWindow(WINDOW_TITLE, SDL_WINDOWPOS_CENTERED,
                             SDL_WINDOWPOS_CENTERED, WINDOW_WIDTH, WINDOW_HEIGHT,
                             SDL_WINDOW_RESIZABLE);
   renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_PRESENTVSYNC);
+  sdl_set_viewport(min, max);
+}
+
+void sdl_set_viewport(vector_t min, vector_t max) {
+  // Check parameters
+  assert(min.x < max.x);
+  assert(min.y < max.y);
+
+  center = vec_multiply(0.5, vec_add(min, max));
+  max_diff = vec_subtract(max, center);
+  view_revision++;
 }
 
 void sdl_clean(void) {
+  // Atlas textures belong to the renderer, so they go first
+  for (size_t i = 0; i < GAME_STATE_COUNT; i++) {
+    if (state_atlases[i] != NULL) {
+      atlas_free(state_atlases[i]);
+      state_atlases[i] = NULL;
+    }
+  }
   SDL_DestroyRenderer(renderer);
   SDL_DestroyWindow(window);
+  renderer = NULL;
+  window = NULL;
+  Mix_HaltMusic();
+  Mix_CloseAudio();
+  SDL_Quit();
+  free(render_queue);
+  free(render_scratch);
+  render_queue = NULL;
+  render_scratch = NULL;
+  render_queue_size = 0;
+  render_queue_capacity = 0;
 }
 
-void sdl_render_game(scene_t *scene) {
-  sdl_clear();
-  sprite_list_update(scene);
-  size_t sprite_count = list_size(scene_get_sprites(scene));
-  sprite_t *player1_sprite = NULL;
-  sprite_t *player2_sprite = NULL;
-  for (size_t i = 0; i < sprite_count; i++) {
-    sprite_t *sprite = scene_get_sprite(scene, i);
-    body_info_t *info = get_info(sprite_get_body(sprite));
+/** Which layer a sprite is drawn in, based on its body's type */
+render_layer_t sprite_layer(body_type_t type) {
+  switch (type) {
+  case BACKGROUND:
+    return LAYER_BACKGROUND;
+  case PLAYER1:
+  case PLAYER2:
+    return LAYER_PLAYERS;
+  case P1_LIFE:
+  case P2_LIFE:
+    return LAYER_HUD;
+  default:
+    return LAYER_WORLD;
+  }
+}
+
+render_item_t *render_queue_push(render_layer_t layer, SDL_Texture *texture,
+                                 sprite_t *sprite, body_t *body) {
+  if (render_queue_size == render_queue_capacity) {
+    render_queue_capacity =
+        render_queue_capacity == 0 ? RENDER_RADIX : 2 * render_queue_capacity;
+    render_queue = realloc(render_queue,
+                           render_queue_capacity * sizeof(render_item_t));
+    render_scratch = realloc(render_scratch,
+                             render_queue_capacity * sizeof(render_item_t));
+    assert(render_queue != NULL && render_scratch != NULL);
+  }
+  uint64_t texture_key =
+      (uintptr_t)texture & (((uint64_t)1 << RENDER_TEXTURE_BITS) - 1);
+  render_queue[render_queue_size] =
+      (render_item_t){.key = (uint64_t)layer << RENDER_TEXTURE_BITS |
+                             texture_key,
+                      .sprite = sprite,
+                      .body = body,
+                      .projectiles = NULL};
+  return &render_queue[render_queue_size++];
+}
 
-    if (info->type == PLAYER1) {
-      player1_sprite = sprite;
-    } else if (info->type == PLAYER2) {
-      player2_sprite = sprite;
+/**
+ * Stable LSD radix sort of the queue by key.
+ * Digits that every item shares are skipped, so in practice only the layer
+ * and the few low texture address digits that differ cost a pass.
+ */
+void render_queue_sort(void) {
+  for (size_t shift = 0; shift < 64; shift += RENDER_RADIX_BITS) {
+    size_t counts[RENDER_RADIX] = {0};
+    for (size_t i = 0; i < render_queue_size; i++) {
+      counts[(render_queue[i].key >> shift) & (RENDER_RADIX - 1)]++;
     }
+    if (render_queue_size == 0 ||
+        counts[(render_queue[0].key >> shift) & (RENDER_RADIX - 1)] ==
+            render_queue_size) {
+      continue;
+    }
+    size_t offset = 0;
+    for (size_t digit = 0; digit < RENDER_RADIX; digit++) {
+      size_t count = counts[digit];
+      counts[digit] = offset;
+      offset += count;
+    }
+    for (size_t i = 0; i < render_queue_size; i++) {
+      size_t digit = (render_queue[i].key >> shift) & (RENDER_RADIX - 1);
+      render_scratch[counts[digit]++] = render_queue[i];
+    }
+    render_item_t *sorted = render_scratch;
+    render_scratch = render_queue;
+    render_queue = sorted;
+  }
+}
 
-    SDL_RendererFlip flip = SDL_FLIP_NONE;
-    if (sprite_textures(sprite) != 0) {
-      if (info->side == LEFT) {
-        flip = SDL_FLIP_HORIZONTAL;
-      }
+/** Draws a bullet as a rect pointing along its velocity */
+void sdl_draw_projectile(projectiles_t *projectiles, size_t index) {
+  vector_t size;
+  game_weapon_type_t weapon = projectiles_get_weapon(projectiles, index);
+  rgb_color_t color = projectile_appearance(weapon, &size);
+  vector_t position = projectiles_get_position(projectiles, index);
+  vector_t velocity = projectiles_get_velocity(projectiles, index);
+  vector_t along = vec_length(velocity) > 0 ? vec_unit_vector(velocity)
+                                            : (vector_t){1, 0};
+  vector_t half_length = vec_multiply(size.x / 2, along);
+  vector_t half_height =
+      vec_multiply(size.y / 2, (vector_t){-along.y, along.x});
 
-      SDL_RenderCopyEx(renderer,
-                       sprite_get_tex(sprite, sprite_get_curr_ind(sprite)),
-                       NULL, sprite_get_destR(sprite), 0, NULL, flip);
-    }
+  vector_t window_center = get_window_center();
+  vector_t corners[] = {
+      vec_subtract(vec_subtract(position, half_length), half_height),
+      vec_add(vec_subtract(position, half_length), half_height),
+      vec_add(vec_add(position, half_length), half_height),
+      vec_subtract(vec_add(position, half_length), half_height)};
+  size_t n = sizeof(corners) / sizeof(*corners);
+  int16_t x_points[n], y_points[n];
+  for (size_t i = 0; i < n; i++) {
+    vector_t pixel = get_window_position(corners[i], window_center);
+    x_points[i] = pixel.x;
+    y_points[i] = pixel.y;
   }
+  filledPolygonRGBA(renderer, x_points, y_points, n, color.r * 255,
+                    color.g * 255, color.b * 255, 255);
+}
 
-  size_t body_count = scene_bodies(scene);
-  for (size_t i = 0; i < body_count; i++) {
-    body_t *body = scene_get_body(scene, i);
-    list_t *shape = body_get_shape(body);
-    body_type_t type = get_info(body)->type;
-    if (type == BULLET || type == CLOCK || type == CLOCK_BIG_ARM ||
-        type == CLOCK_SMALL_ARM) {
-      sdl_draw_polygon(shape, body_get_color(body));
-    }
-    list_free(shape);
+void render_item_draw(render_item_t *item) {
+  if (item->projectiles != NULL) {
+    sdl_draw_projectile(item->projectiles, item->projectile);
+    return;
+  }
+  if (item->sprite == NULL) {
+    sdl_draw_polygon(body_get_world_shape(item->body),
+                     body_get_color(item->body));
+    return;
   }
+  SDL_RendererFlip flip = SDL_FLIP_NONE;
+  if (get_info(item->body)->side == LEFT) {
+    flip = SDL_FLIP_HORIZONTAL;
+  }
+  SDL_RenderCopyEx(
+      renderer, sprite_get_texture(item->sprite),
+      sprite_get_frame(item->sprite, sprite_get_curr_ind(item->sprite)),
+      sprite_get_destR(item->sprite), 0, NULL, flip);
+}
 
-  if (player1_sprite != NULL) {
-    body_info_t *info = get_info(sprite_get_body(player1_sprite));
-    sprite_img_update(player1_sprite);
+/** Body types drawn as plain polygons instead of sprites */
+const body_type_t POLYGON_TYPES[] = {CLOCK, CLOCK_BIG_ARM, CLOCK_SMALL_ARM};
 
-    SDL_RendererFlip flip = SDL_FLIP_NONE;
-    if (sprite_textures(player1_sprite) != 0) {
-      if (info->side == LEFT) {
-        flip = SDL_FLIP_HORIZONTAL;
-      }
+/** Draws one line of overlay text, formatted into a stack buffer */
+void hud_print(int line, const char *format, double value) {
+  char text[64];
+  snprintf(text, sizeof(text), format, value);
+  stringRGBA(renderer, HUD_MARGIN, HUD_MARGIN + line * HUD_LINE_HEIGHT, text,
+             255, 255, 255, 255);
+}
 
-      SDL_RenderCopyEx(
-          renderer,
-          sprite_get_tex(player1_sprite, sprite_get_curr_ind(player1_sprite)),
-          NULL, sprite_get_destR(player1_sprite), 0, NULL, flip);
-    }
+/**
+ * Draws the performance overlay: the recent frame times, where the last
+ * frame's time went, and how much work the last tick did.
+ * Only draws into the frame, so it allocates nothing.
+ */
+void sdl_draw_hud(scene_t *scene, double render_ms) {
+  const int LINES = 7;
+  int graph_top = HUD_MARGIN + LINES * HUD_LINE_HEIGHT;
+  int graph_bottom = graph_top + HUD_GRAPH_HEIGHT;
+  boxRGBA(renderer, 0, 0, 2 * HUD_MARGIN + HUD_HISTORY + 80,
+          graph_bottom + HUD_MARGIN, 0, 0, 0, 160);
+
+  scene_stats_t stats = scene_get_stats(scene);
+  size_t last = (hud_frame_next + HUD_HISTORY - 1) % HUD_HISTORY;
+  hud_print(0, "frame   %6.2f ms", hud_frame_ms[last]);
+  hud_print(1, "sim     %6.2f ms", stats.tick_time * MS_PER_S);
+  hud_print(2, "render  %6.2f ms", render_ms);
+  hud_print(3, "bodies  %6.0f", stats.bodies);
+  hud_print(4, "binds   %6.0f", stats.force_binds);
+  hud_print(5, "tests   %6.0f", stats.pair_tests);
+#ifdef TRACK_ALLOCATIONS
+  size_t allocs = 0;
+  for (size_t tag = 0; tag < TRACK_TAG_COUNT; tag++) {
+    allocs += track_frame_allocs(tag);
+  }
+  hud_print(6, "allocs  %6.0f", allocs);
+#else
+  hud_print(6, "allocs     off", 0);
+#endif
+
+  // Oldest frame on the left; the budget line marks 60 frames per second
+  double scale = HUD_GRAPH_HEIGHT / HUD_GRAPH_MAX_MS;
+  for (size_t i = 0; i < HUD_HISTORY; i++) {
+    double ms = hud_frame_ms[(hud_frame_next + i) % HUD_HISTORY];
+    int height = (int)fmin(ms * scale, HUD_GRAPH_HEIGHT);
+    uint8_t red = ms > HUD_BUDGET_MS ? 255 : 0;
+    vlineRGBA(renderer, HUD_MARGIN + i, graph_bottom, graph_bottom - height,
+              red, 255 - red, 0, 255);
   }
+  hlineRGBA(renderer, HUD_MARGIN, HUD_MARGIN + HUD_HISTORY,
+            graph_bottom - (int)(HUD_BUDGET_MS * scale), 255, 255, 255, 255);
+}
 
-  if (player2_sprite != NULL) {
-    body_info_t *info = get_info(sprite_get_body(player2_sprite));
-    sprite_img_update(player2_sprite);
+/**
+ * Reads the wall clock, in milliseconds. Unlike clock(), it counts time spent
+ * waiting, e.g. on vsync, like the scene's tick timer does.
+ */
+double hud_clock_ms(void) {
+  return (double)SDL_GetPerformanceCounter() * MS_PER_S /
+         SDL_GetPerformanceFrequency();
+}
 
-    SDL_RendererFlip flip = SDL_FLIP_NONE;
-    if (sprite_textures(player2_sprite) != 0) {
-      if (info->side == LEFT) {
-        flip = SDL_FLIP_HORIZONTAL;
-      }
+void sdl_render_game(scene_t *scene) {
+  // Ticks are only timed while the HUD shows the time
+  scene_set_timed(scene, hud_visible);
+  double start = hud_clock_ms();
+  if (hud_last_frame != 0) {
+    hud_frame_ms[hud_frame_next] = start - hud_last_frame;
+    hud_frame_next = (hud_frame_next + 1) % HUD_HISTORY;
+  }
+  hud_last_frame = start;
+
+  sdl_clear();
+  sprite_list_update(scene);
+  render_queue_size = 0;
 
-      SDL_RenderCopyEx(
-          renderer,
-          sprite_get_tex(player2_sprite, sprite_get_curr_ind(player2_sprite)),
-          NULL, sprite_get_destR(player2_sprite), 0, NULL, flip);
+  size_t sprite_count = list_size(scene_get_sprites(scene));
+  for (size_t i = 0; i < sprite_count; i++) {
+    sprite_t *sprite = scene_get_sprite(scene, i);
+    if (sprite_frames(sprite) == 0) {
+      continue;
+    }
+    body_t *body = sprite_get_body(sprite);
+    body_type_t type = get_info(body)->type;
+    if (type == PLAYER1 || type == PLAYER2) {
+      sprite_img_update(sprite);
     }
+    render_queue_push(sprite_layer(type), sprite_get_texture(sprite), sprite,
+                      body);
   }
 
+  size_t polygon_types = sizeof(POLYGON_TYPES) / sizeof(*POLYGON_TYPES);
+  for (size_t i = 0; i < polygon_types; i++) {
+    size_t count = scene_bodies_of_type(scene, POLYGON_TYPES[i]);
+    for (size_t j = 0; j < count; j++) {
+      body_t *body = scene_get_body_of_type(scene, POLYGON_TYPES[i], j);
+      render_queue_push(LAYER_SHAPES, NULL, NULL, body);
+    }
+  }
+  projectiles_t *projectiles = scene_get_projectiles(scene);
+  for (size_t i = 0; i < projectiles_count(projectiles); i++) {
+    render_item_t *item = render_queue_push(LAYER_SHAPES, NULL, NULL, NULL);
+    item->projectiles = projectiles;
+    item->projectile = i;
+  }
+
+  render_queue_sort();
+  for (size_t i = 0; i < render_queue_size; i++) {
+    render_item_draw(&render_queue[i]);
+  }
+
+  if (hud_visible) {
+    sdl_draw_hud(scene, hud_clock_ms() - start);
+  }
   sdl_show();
 }
 
@@ -538,9 +924,7 @@ void sdl_render_scene(scene_t *scene) {
   size_t body_count = scene_bodies(scene);
   for (size_t i = 0; i < body_count; i++) {
     body_t *body = scene_get_body(scene, i);
-    list_t *shape = body_get_shape(body);
-    sdl_draw_polygon(shape, body_get_color(body));
-    list_free(shape);
+    sdl_draw_polygon(body_get_world_shape(body), body_get_color(body));
   }
   sdl_show();
 }
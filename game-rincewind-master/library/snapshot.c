@@ -0,0 +1,392 @@
+#include "snapshot.h"
+#include "bitstream.h"
+#include "player.h"
+#include "projectile.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+// Fixed point steps: 1/64 of a unit, 1/16 of a unit per second, 1/1024 rad
+const double POSITION_SCALE = 64.0;
+const double VELOCITY_SCALE = 16.0;
+const double ANGLE_SCALE = 1024.0;
+// Quantized values are clamped so the difference of any two fits in 32 bits
+const double QUANTIZE_LIMIT = 1 << 30;
+
+// Bits of the fixed width fields in a packet
+const size_t TICK_BITS = 32;
+const size_t MAP_BITS = 4;
+const size_t SIDE_BITS = 3;
+const size_t WEAPON_BITS = 2;
+const size_t SHOTS_BITS = 8;
+const size_t CHANGE_MASK_BITS = 8;
+
+/** The fields of an entity_state_t, as bits of a packet's change masks */
+typedef enum entity_field {
+  FIELD_X = 1 << 0,
+  FIELD_Y = 1 << 1,
+  FIELD_VX = 1 << 2,
+  FIELD_VY = 1 << 3,
+  FIELD_ANGLE = 1 << 4,
+  FIELD_SIDE = 1 << 5,
+  FIELD_WEAPON = 1 << 6,
+  FIELD_SHOTS = 1 << 7
+} entity_field_t;
+
+int32_t quantize(double value, double scale) {
+  double scaled = round(value * scale);
+  if (!(scaled > -QUANTIZE_LIMIT)) {
+    return -QUANTIZE_LIMIT;
+  }
+  if (scaled > QUANTIZE_LIMIT) {
+    return QUANTIZE_LIMIT;
+  }
+  return scaled;
+}
+
+vector_t snapshot_dequantize_position(int32_t x, int32_t y) {
+  return (vector_t){x / POSITION_SCALE, y / POSITION_SCALE};
+}
+
+vector_t snapshot_dequantize_velocity(int32_t vx, int32_t vy) {
+  return (vector_t){vx / VELOCITY_SCALE, vy / VELOCITY_SCALE};
+}
+
+double snapshot_dequantize_angle(int32_t angle) { return angle / ANGLE_SCALE; }
+
+entity_state_t entity_capture(body_t *body, uint16_t id) {
+  body_info_t *info = get_info(body);
+  vector_t position = body_get_centroid(body);
+  vector_t velocity = body_get_velocity(body);
+  // Only the angle's direction matters, and it stays small if wrapped
+  double angle = fmod(body_get_angle(body), 2 * M_PI);
+  if (angle < 0) {
+    angle += 2 * M_PI;
+  }
+  return (entity_state_t){
+      .id = id,
+      .side = info->side,
+      .weapon = info->weapon_type,
+      .shots_left = info->shots_left < UINT8_MAX ? info->shots_left : UINT8_MAX,
+      .x = quantize(position.x, POSITION_SCALE),
+      .y = quantize(position.y, POSITION_SCALE),
+      .vx = quantize(velocity.x, VELOCITY_SCALE),
+      .vy = quantize(velocity.y, VELOCITY_SCALE),
+      .angle = quantize(angle, ANGLE_SCALE)};
+}
+
+void snapshot_capture(snapshot_t *snapshot, match_t *match, uint32_t tick) {
+  scene_t *scene = match_get_scene(match);
+  snapshot->tick = tick;
+  snapshot->map = match_get_map(match);
+  snapshot->round = match_get_round(match);
+  snapshot->lives[PLAYER1] = match_get_lives(match, PLAYER1);
+  snapshot->lives[PLAYER2] = match_get_lives(match, PLAYER2);
+
+  // Walking the types in order keeps the entities sorted by id
+  snapshot->entity_count = 0;
+  for (body_type_t type = 0; type < BODY_TYPE_COUNT; type++) {
+    size_t count = scene_bodies_of_type(scene, type);
+    for (size_t i = 0; i < count && i <= UINT8_MAX; i++) {
+      body_t *body = scene_get_body_of_type(scene, type, i);
+      if (body_get_motion_type(body) == MOTION_STATIC ||
+          body_is_removed(body) ||
+          snapshot->entity_count == SNAPSHOT_MAX_ENTITIES) {
+        continue;
+      }
+      snapshot->entities[snapshot->entity_count++] =
+          entity_capture(body, type << 8 | i);
+    }
+  }
+
+  projectiles_t *projectiles = scene_get_projectiles(scene);
+  size_t count = projectiles_count(projectiles);
+  snapshot->projectile_count =
+      count < SNAPSHOT_MAX_PROJECTILES ? count : SNAPSHOT_MAX_PROJECTILES;
+  for (size_t i = 0; i < snapshot->projectile_count; i++) {
+    vector_t position = projectiles_get_position(projectiles, i);
+    vector_t velocity = projectiles_get_velocity(projectiles, i);
+    snapshot->projectiles[i] = (projectile_state_t){
+        .weapon = projectiles_get_weapon(projectiles, i),
+        .x = quantize(position.x, POSITION_SCALE),
+        .y = quantize(position.y, POSITION_SCALE),
+        .vx = quantize(velocity.x, VELOCITY_SCALE),
+        .vy = quantize(velocity.y, VELOCITY_SCALE)};
+  }
+}
+
+/** Returns the fields of an entity that differ from its baseline */
+uint8_t entity_changes(const entity_state_t *entity,
+                       const entity_state_t *base) {
+  return (entity->x != base->x ? FIELD_X : 0) |
+         (entity->y != base->y ? FIELD_Y : 0) |
+         (entity->vx != base->vx ? FIELD_VX : 0) |
+         (entity->vy != base->vy ? FIELD_VY : 0) |
+         (entity->angle != base->angle ? FIELD_ANGLE : 0) |
+         (entity->side != base->side ? FIELD_SIDE : 0) |
+         (entity->weapon != base->weapon ? FIELD_WEAPON : 0) |
+         (entity->shots_left != base->shots_left ? FIELD_SHOTS : 0);
+}
+
+void entity_write(bitstream_t *stream, const entity_state_t *entity,
+                  const entity_state_t *base, uint8_t changes) {
+  bitstream_write(stream, changes, CHANGE_MASK_BITS);
+  if (changes & FIELD_X) {
+    bitstream_write_varint(stream, entity->x - base->x);
+  }
+  if (changes & FIELD_Y) {
+    bitstream_write_varint(stream, entity->y - base->y);
+  }
+  if (changes & FIELD_VX) {
+    bitstream_write_varint(stream, entity->vx - base->vx);
+  }
+  if (changes & FIELD_VY) {
+    bitstream_write_varint(stream, entity->vy - base->vy);
+  }
+  if (changes & FIELD_ANGLE) {
+    bitstream_write_varint(stream, entity->angle - base->angle);
+  }
+  if (changes & FIELD_SIDE) {
+    bitstream_write(stream, entity->side, SIDE_BITS);
+  }
+  if (changes & FIELD_WEAPON) {
+    bitstream_write(stream, entity->weapon, WEAPON_BITS);
+  }
+  if (changes & FIELD_SHOTS) {
+    bitstream_write(stream, entity->shots_left, SHOTS_BITS);
+  }
+}
+
+/** Applies the changes written by entity_write() to an entity in place */
+void entity_read(bitstream_t *stream, entity_state_t *entity) {
+  uint8_t changes = bitstream_read(stream, CHANGE_MASK_BITS);
+  if (changes & FIELD_X) {
+    entity->x += bitstream_read_varint(stream);
+  }
+  if (changes & FIELD_Y) {
+    entity->y += bitstream_read_varint(stream);
+  }
+  if (changes & FIELD_VX) {
+    entity->vx += bitstream_read_varint(stream);
+  }
+  if (changes & FIELD_VY) {
+    entity->vy += bitstream_read_varint(stream);
+  }
+  if (changes & FIELD_ANGLE) {
+    entity->angle += bitstream_read_varint(stream);
+  }
+  if (changes & FIELD_SIDE) {
+    entity->side = bitstream_read(stream, SIDE_BITS);
+  }
+  if (changes & FIELD_WEAPON) {
+    entity->weapon = bitstream_read(stream, WEAPON_BITS);
+  }
+  if (changes & FIELD_SHOTS) {
+    entity->shots_left = bitstream_read(stream, SHOTS_BITS);
+  }
+}
+
+size_t snapshot_encode(const snapshot_t *snapshot, const snapshot_t *baseline,
+                       void *buffer, size_t capacity) {
+  bitstream_t stream;
+  bitstream_init(&stream, buffer, capacity);
+  bitstream_write(&stream, snapshot->tick, TICK_BITS);
+  bitstream_write(&stream, baseline != NULL, 1);
+  if (baseline != NULL) {
+    assert(baseline->tick < snapshot->tick);
+    bitstream_write_varint(&stream, snapshot->tick - baseline->tick);
+  }
+  bitstream_write(&stream, snapshot->map, MAP_BITS);
+  bitstream_write_varint(&stream, snapshot->round);
+  bitstream_write_varint(&stream, snapshot->lives[PLAYER1]);
+  bitstream_write_varint(&stream, snapshot->lives[PLAYER2]);
+
+  // Match the entities to the baseline's by walking both sorted lists
+  const entity_state_t ZERO_ENTITY = {0};
+  const entity_state_t *changed[SNAPSHOT_MAX_ENTITIES];
+  const entity_state_t *bases[SNAPSHOT_MAX_ENTITIES];
+  uint16_t removed[SNAPSHOT_MAX_ENTITIES];
+  size_t changed_count = 0, removed_count = 0;
+  size_t base_count = baseline != NULL ? baseline->entity_count : 0;
+  size_t i = 0, j = 0;
+  while (i < snapshot->entity_count || j < base_count) {
+    const entity_state_t *entity =
+        i < snapshot->entity_count ? &snapshot->entities[i] : NULL;
+    const entity_state_t *base = j < base_count ? &baseline->entities[j] : NULL;
+    if (entity == NULL || (base != NULL && base->id < entity->id)) {
+      removed[removed_count++] = base->id;
+      j++;
+    } else if (base == NULL || entity->id < base->id) {
+      // New entities are sent as changes from all zeros
+      changed[changed_count] = entity;
+      bases[changed_count++] = &ZERO_ENTITY;
+      i++;
+    } else {
+      if (entity_changes(entity, base) != 0) {
+        changed[changed_count] = entity;
+        bases[changed_count++] = base;
+      }
+      i++;
+      j++;
+    }
+  }
+
+  // Ids are sorted, so each is written as the gap from the one before
+  bitstream_write_varint(&stream, removed_count);
+  uint16_t last_id = 0;
+  for (size_t k = 0; k < removed_count; k++) {
+    bitstream_write_varint(&stream, removed[k] - last_id);
+    last_id = removed[k];
+  }
+  bitstream_write_varint(&stream, changed_count);
+  last_id = 0;
+  for (size_t k = 0; k < changed_count; k++) {
+    bitstream_write_varint(&stream, changed[k]->id - last_id);
+    last_id = changed[k]->id;
+    entity_write(&stream, changed[k], bases[k],
+                 entity_changes(changed[k], bases[k]));
+  }
+
+  // Bullets have no lasting identity, so they are sent whole every tick, as
+  // changes from the bullet before since they are often fired together
+  bitstream_write_varint(&stream, snapshot->projectile_count);
+  projectile_state_t last = {0};
+  for (size_t k = 0; k < snapshot->projectile_count; k++) {
+    const projectile_state_t *projectile = &snapshot->projectiles[k];
+    bitstream_write(&stream, projectile->weapon, WEAPON_BITS);
+    bitstream_write_varint(&stream, projectile->x - last.x);
+    bitstream_write_varint(&stream, projectile->y - last.y);
+    bitstream_write_varint(&stream, projectile->vx - last.vx);
+    bitstream_write_varint(&stream, projectile->vy - last.vy);
+    last = *projectile;
+  }
+
+  if (bitstream_overflowed(&stream)) {
+    return 0;
+  }
+  return bitstream_bytes(&stream);
+}
+
+bool snapshot_read_header(const void *buffer, size_t size, uint32_t *tick,
+                          uint32_t *baseline_tick) {
+  bitstream_t stream;
+  bitstream_init(&stream, (void *)buffer, size);
+  *tick = bitstream_read(&stream, TICK_BITS);
+  bool has_baseline = bitstream_read(&stream, 1);
+  *baseline_tick = has_baseline ? *tick - bitstream_read_varint(&stream) : 0;
+  return has_baseline && !bitstream_overflowed(&stream);
+}
+
+bool snapshot_decode(snapshot_t *snapshot, const snapshot_t *baseline,
+                     const void *buffer, size_t size) {
+  bitstream_t stream;
+  bitstream_init(&stream, (void *)buffer, size);
+  snapshot->tick = bitstream_read(&stream, TICK_BITS);
+  bool has_baseline = bitstream_read(&stream, 1);
+  if (has_baseline != (baseline != NULL)) {
+    return false;
+  }
+  if (has_baseline &&
+      snapshot->tick - bitstream_read_varint(&stream) != baseline->tick) {
+    return false;
+  }
+  snapshot->map = bitstream_read(&stream, MAP_BITS);
+  snapshot->round = bitstream_read_varint(&stream);
+  snapshot->lives[PLAYER1] = bitstream_read_varint(&stream);
+  snapshot->lives[PLAYER2] = bitstream_read_varint(&stream);
+
+  // Start from the baseline's entities, less the ones that were removed
+  size_t removed_count = bitstream_read_varint(&stream);
+  size_t base_count = baseline != NULL ? baseline->entity_count : 0;
+  snapshot->entity_count = 0;
+  uint16_t removed_id = 0;
+  size_t j = 0;
+  for (size_t k = 0; k < removed_count && k < SNAPSHOT_MAX_ENTITIES; k++) {
+    removed_id += bitstream_read_varint(&stream);
+    while (j < base_count && baseline->entities[j].id < removed_id) {
+      snapshot->entities[snapshot->entity_count++] = baseline->entities[j++];
+    }
+    if (j < base_count && baseline->entities[j].id == removed_id) {
+      j++;
+    }
+  }
+  while (j < base_count) {
+    snapshot->entities[snapshot->entity_count++] = baseline->entities[j++];
+  }
+
+  // Then apply the changes, adding the entities that are new
+  size_t changed_count = bitstream_read_varint(&stream);
+  uint16_t id = 0;
+  size_t i = 0;
+  for (size_t k = 0; k < changed_count && !stream.overflow; k++) {
+    id += bitstream_read_varint(&stream);
+    while (i < snapshot->entity_count && snapshot->entities[i].id < id) {
+      i++;
+    }
+    if (i == snapshot->entity_count || snapshot->entities[i].id != id) {
+      if (snapshot->entity_count == SNAPSHOT_MAX_ENTITIES) {
+        return false;
+      }
+      memmove(&snapshot->entities[i + 1], &snapshot->entities[i],
+              (snapshot->entity_count - i) * sizeof(entity_state_t));
+      snapshot->entities[i] = (entity_state_t){.id = id};
+      snapshot->entity_count++;
+    }
+    entity_read(&stream, &snapshot->entities[i]);
+  }
+
+  size_t projectile_count = bitstream_read_varint(&stream);
+  if (projectile_count > SNAPSHOT_MAX_PROJECTILES) {
+    return false;
+  }
+  snapshot->projectile_count = projectile_count;
+  projectile_state_t last = {0};
+  for (size_t k = 0; k < projectile_count; k++) {
+    projectile_state_t *projectile = &snapshot->projectiles[k];
+    projectile->weapon = bitstream_read(&stream, WEAPON_BITS);
+    projectile->x = last.x + bitstream_read_varint(&stream);
+    projectile->y = last.y + bitstream_read_varint(&stream);
+    projectile->vx = last.vx + bitstream_read_varint(&stream);
+    projectile->vy = last.vy + bitstream_read_varint(&stream);
+    last = *projectile;
+  }
+
+  return removed_count <= SNAPSHOT_MAX_ENTITIES && !stream.overflow;
+}
+
+bool entity_equal(const entity_state_t *entity1,
+                  const entity_state_t *entity2) {
+  return entity1->id == entity2->id && entity_changes(entity1, entity2) == 0;
+}
+
+bool projectile_equal(const projectile_state_t *projectile1,
+                      const projectile_state_t *projectile2) {
+  return projectile1->weapon == projectile2->weapon &&
+         projectile1->x == projectile2->x && projectile1->y == projectile2->y &&
+         projectile1->vx == projectile2->vx &&
+         projectile1->vy == projectile2->vy;
+}
+
+bool snapshot_equal(const snapshot_t *snapshot1, const snapshot_t *snapshot2) {
+  if (snapshot1->tick != snapshot2->tick || snapshot1->map != snapshot2->map ||
+      snapshot1->round != snapshot2->round ||
+      snapshot1->lives[PLAYER1] != snapshot2->lives[PLAYER1] ||
+      snapshot1->lives[PLAYER2] != snapshot2->lives[PLAYER2] ||
+      snapshot1->entity_count != snapshot2->entity_count ||
+      snapshot1->projectile_count != snapshot2->projectile_count) {
+    return false;
+  }
+  for (size_t i = 0; i < snapshot1->entity_count; i++) {
+    if (!entity_equal(&snapshot1->entities[i], &snapshot2->entities[i])) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < snapshot1->projectile_count; i++) {
+    if (!projectile_equal(&snapshot1->projectiles[i],
+                          &snapshot2->projectiles[i])) {
+      return false;
+    }
+  }
+  return true;
+}
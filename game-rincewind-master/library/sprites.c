@@ -1,4 +1,5 @@
 #include "sprites.h"
+#include "alloc_track.h"
 #include "body.h"
 #include "game.h"
 #include "list.h"
@@ -6,85 +7,106 @@
 #include <assert.h>
 
 typedef struct sprite {
-  char *path;
-  list_t *tex;
-  SDL_Rect *destR;
   body_t *body;
+#ifndef HEADLESS
+  SDL_Texture *texture;
+  SDL_Rect frames[SPRITE_MAX_FRAMES];
+  size_t frame_count;
+  SDL_Rect destR;
   size_t tex_index;
+  size_t body_revision;
+  size_t view_revision;
+#endif
 } sprite_t;
 
-sprite_t *sprite_init(body_t *body) {
-  size_t TEXT_INITIAL_CAPACITY = 4;
-
-  sprite_t *new_sprite = malloc(sizeof(sprite_t));
-  SDL_Rect *destR = malloc(sizeof(SDL_Rect));
+#ifndef HEADLESS
+/**
+ * Recomputes the sprite's destination rect from the current position of its
+ * body. Reads the body's vertices in place, so no memory is allocated.
+ */
+void sprite_compute_destR(sprite_t *sprite) {
+  body_t *body = sprite->body;
   vector_t window_center = get_window_center();
 
-  vector_t *top_right = list_get(body_get_shape(body), 3);
-  vector_t *bottom_left = list_get(body_get_shape(body), 1);
-  vector_t *top_left = list_get(body_get_shape(body), 0);
+  vector_t top_left_pix =
+      get_window_position(body_get_vertex(body, 0), window_center);
+  vector_t bottom_left_pix =
+      get_window_position(body_get_vertex(body, 1), window_center);
+  vector_t top_right_pix =
+      get_window_position(body_get_vertex(body, 3), window_center);
 
-  vector_t top_left_pix = get_window_position(*top_left, window_center);
-  vector_t top_right_pix = get_window_position(*top_right, window_center);
-  vector_t bottom_left_pix = get_window_position(*bottom_left, window_center);
+  sprite->destR.x = top_left_pix.x;
+  sprite->destR.y = top_left_pix.y;
+  sprite->destR.w = top_right_pix.x - bottom_left_pix.x;
+  sprite->destR.h = bottom_left_pix.y - top_right_pix.y;
 
-  destR->x = top_left_pix.x;
-  destR->y = top_left_pix.y;
-  destR->w = top_right_pix.x - bottom_left_pix.x;
-  destR->h = bottom_left_pix.y - top_right_pix.y;
+  sprite->body_revision = body_get_revision(body);
+  sprite->view_revision = sdl_get_view_revision();
+}
+#endif // #ifndef HEADLESS
 
-  new_sprite->destR = destR;
+sprite_t *sprite_init(body_t *body) {
+  sprite_t *new_sprite = track_malloc(TRACK_SPRITE, sizeof(sprite_t));
+  assert(new_sprite != NULL);
   new_sprite->body = body;
-  new_sprite->path = malloc(sizeof(char));
-  free(top_right);
-  free(bottom_left);
-  free(top_left);
-
-  new_sprite->tex = list_init(TEXT_INITIAL_CAPACITY, (free_func_t)free);
+#ifndef HEADLESS
+  new_sprite->texture = NULL;
+  new_sprite->frame_count = 0;
   new_sprite->tex_index = 0;
+  sprite_compute_destR(new_sprite);
+#endif
   return new_sprite;
 }
 
-// updates texture and surface based on body type
+// only recomputes the destination rect if the body or the view has moved
 void sprite_update(sprite_t *sprite) {
-  sprite_t *new_sprite = sprite_init(sprite_get_body(sprite));
-
-  sprite->destR = new_sprite->destR;
-  free(new_sprite);
+#ifndef HEADLESS
+  if (sprite->body_revision != body_get_revision(sprite->body) ||
+      sprite->view_revision != sdl_get_view_revision()) {
+    sprite_compute_destR(sprite);
+  }
+#endif
 }
 
 body_t *sprite_get_body(sprite_t *sprite) { return sprite->body; }
 
-void sprite_add_tex(sprite_t *sprite, SDL_Texture *tex) {
-  list_add(sprite->tex, tex);
+bool sprite_is_removed(sprite_t *sprite) {
+  assert(sprite->body != NULL);
+  return body_is_removed(sprite->body);
+}
+
+void sprite_free(sprite_t *sprite) {
+  track_free(sprite);
 }
 
-SDL_Texture *sprite_get_tex(sprite_t *sprite, size_t index) {
-  return list_get(sprite->tex, index);
+#ifndef HEADLESS
+void sprite_set_texture(sprite_t *sprite, SDL_Texture *texture) {
+  sprite->texture = texture;
+}
+
+SDL_Texture *sprite_get_texture(sprite_t *sprite) { return sprite->texture; }
+
+void sprite_add_frame(sprite_t *sprite, SDL_Rect region) {
+  assert(sprite->frame_count < SPRITE_MAX_FRAMES);
+  sprite->frames[sprite->frame_count++] = region;
+}
+
+SDL_Rect *sprite_get_frame(sprite_t *sprite, size_t index) {
+  assert(index < sprite->frame_count);
+  return &sprite->frames[index];
 }
 
 void sprite_set_tex(sprite_t *sprite, size_t index) {
   sprite->tex_index = index;
 }
 
-size_t sprite_textures(sprite_t *sprite) { return list_size(sprite->tex); }
+size_t sprite_frames(sprite_t *sprite) { return sprite->frame_count; }
 
-SDL_Rect *sprite_get_destR(sprite_t *sprite) { return sprite->destR; }
+SDL_Rect *sprite_get_destR(sprite_t *sprite) { return &sprite->destR; }
 
 void sprite_set_destR(sprite_t *sprite, SDL_Rect destR) {
-  *(sprite->destR) = destR;
+  sprite->destR = destR;
 }
 
 size_t sprite_get_curr_ind(sprite_t *sprite) { return sprite->tex_index; }
-
-bool sprite_is_removed(sprite_t *sprite) {
-  assert(sprite->body != NULL);
-  return body_is_removed(sprite->body);
-}
-
-void sprite_free(sprite_t *sprite) {
-  free(sprite->tex);
-  free(sprite->path);
-  free(sprite->destR);
-  free(sprite);
-}
+#endif // #ifndef HEADLESS
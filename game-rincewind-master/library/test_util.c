@@ -4,6 +4,7 @@
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #ifdef _WIN32
 #include <io.h>
@@ -48,6 +49,95 @@ void read_testname(char *filename, char *testname, size_t testname_size) {
   fclose(f);
 }
 
+player_input_t scripted_input(size_t seed, body_type_t player, size_t tick) {
+  size_t phase = tick + 7 * seed;
+  player_input_t input =
+      (phase / (20 + seed % 5) + player) % 2 ? INPUT_LEFT : INPUT_RIGHT;
+  if (phase % 25 == 3 * player) {
+    input |= INPUT_JUMP;
+  }
+  if (phase % 40 == 5 * player + seed % 3) {
+    input |= INPUT_SHOOT;
+  }
+  return input;
+}
+
+// Shortest a timing sample may take, so the clock's resolution is negligible
+const double BENCH_MIN_SAMPLE_NS = 1e6;
+// Samples discarded once the iteration count is settled
+const size_t BENCH_WARMUPS = 3;
+const double NS_PER_S = 1e9;
+
+double bench_now_ns(void) {
+  struct timespec now;
+  timespec_get(&now, TIME_UTC);
+  return now.tv_sec * NS_PER_S + now.tv_nsec;
+}
+
+int bench_compare_doubles(const void *a, const void *b) {
+  double d1 = *(const double *)a;
+  double d2 = *(const double *)b;
+  return (d1 > d2) - (d1 < d2);
+}
+
+/** Median of values, which are sorted in place */
+double bench_median(double *values, size_t count) {
+  qsort(values, count, sizeof(double), bench_compare_doubles);
+  return count % 2 == 1 ? values[count / 2]
+                        : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+bench_t bench_init(void) {
+  return (bench_t){.remaining = 0,
+                   .iterations = 0,
+                   .calibrated = false,
+                   .warmups_left = BENCH_WARMUPS,
+                   .samples_taken = 0};
+}
+
+bool bench_next_sample(bench_t *bench) {
+  double now = bench_now_ns();
+  if (bench->iterations == 0) {
+    bench->iterations = 1;
+  } else {
+    double elapsed = now - bench->sample_start;
+    if (!bench->calibrated) {
+      if (elapsed < BENCH_MIN_SAMPLE_NS) {
+        bench->iterations *= 2;
+      } else {
+        bench->calibrated = true;
+      }
+    } else if (bench->warmups_left > 0) {
+      bench->warmups_left--;
+    } else {
+      bench->samples[bench->samples_taken++] = elapsed / bench->iterations;
+    }
+  }
+
+  if (bench->samples_taken == BENCH_SAMPLES) {
+    double sorted[BENCH_SAMPLES];
+    memcpy(sorted, bench->samples, sizeof(sorted));
+    bench->median_ns = bench_median(sorted, BENCH_SAMPLES);
+    double deviations[BENCH_SAMPLES];
+    for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+      deviations[i] = fabs(bench->samples[i] - bench->median_ns);
+    }
+    bench->mad_ns = bench_median(deviations, BENCH_SAMPLES);
+    return false;
+  }
+  // This call starts one iteration of the next sample
+  bench->remaining = bench->iterations - 1;
+  bench->sample_start = bench_now_ns();
+  return true;
+}
+
+void bench_report(const char *name, bench_t *bench) {
+  printf("{\"bench\": \"%s\", \"median_ns\": %.3f, \"mad_ns\": %.3f, "
+         "\"iterations\": %zu, \"samples\": %d}\n",
+         name, bench->median_ns, bench->mad_ns, bench->iterations,
+         BENCH_SAMPLES);
+}
+
 #ifdef _WIN32
 void signal_handler(int signum) {
   if (signum == SIGABRT) {
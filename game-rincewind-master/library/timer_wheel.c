@@ -0,0 +1,251 @@
+#include "timer_wheel.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Each wheel has 1 << TIMER_WHEEL_BITS slots
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+// Four wheels reach 2^24 ticks ahead; later timers wait in the last wheel
+#define TIMER_WHEEL_LEVELS 4
+
+const size_t TIMER_INITIAL_CAPACITY = 16;
+// Ends a slot's list of timers, and marks timers that are in no slot
+const uint32_t TIMER_NIL = UINT32_MAX;
+// Delays that are a whole number of ticks are not rounded up a tick by
+// floating-point error
+const double TIMER_EPSILON = 1e-9;
+
+typedef struct timer_entry {
+  // The tick the timer fires on
+  uint64_t expires;
+  timer_callback_t fire;
+  void *aux;
+  // Bumped whenever the entry is released, so old IDs stop matching it
+  uint32_t generation;
+  // The slot whose list holds the timer, or TIMER_NIL if it is free
+  uint32_t slot;
+  // Neighbours in the slot's list; free entries use next for the free list
+  uint32_t next;
+  uint32_t prev;
+} timer_entry_t;
+
+typedef struct timer_wheel {
+  double tick_length;
+  // Time that has passed since the last tick
+  double remainder;
+  uint64_t now;
+  timer_entry_t *timers;
+  size_t capacity;
+  size_t size;
+  uint32_t free_list;
+  uint32_t heads[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+  uint32_t tails[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+} timer_wheel_t;
+
+/** Adds entries from the old capacity up to capacity to the free list */
+void timer_wheel_add_free(timer_wheel_t *wheel, size_t old_capacity) {
+  for (size_t i = wheel->capacity; i > old_capacity; i--) {
+    timer_entry_t *timer = &wheel->timers[i - 1];
+    *timer = (timer_entry_t){.generation = 0,
+                             .slot = TIMER_NIL,
+                             .next = wheel->free_list,
+                             .prev = TIMER_NIL};
+    wheel->free_list = i - 1;
+  }
+}
+
+timer_wheel_t *timer_wheel_init(double tick_length) {
+  assert(tick_length > 0);
+  timer_wheel_t *wheel = malloc(sizeof(timer_wheel_t));
+  assert(wheel != NULL);
+  wheel->tick_length = tick_length;
+  wheel->remainder = 0;
+  wheel->now = 0;
+  wheel->capacity = TIMER_INITIAL_CAPACITY;
+  wheel->timers = malloc(wheel->capacity * sizeof(timer_entry_t));
+  assert(wheel->timers != NULL);
+  wheel->size = 0;
+  wheel->free_list = TIMER_NIL;
+  timer_wheel_add_free(wheel, 0);
+  for (size_t i = 0; i < TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS; i++) {
+    wheel->heads[i] = TIMER_NIL;
+    wheel->tails[i] = TIMER_NIL;
+  }
+  return wheel;
+}
+
+void timer_wheel_free(timer_wheel_t *wheel) {
+  free(wheel->timers);
+  free(wheel);
+}
+
+/** Appends a timer to the slot of the wheel its expiry falls in */
+void timer_wheel_insert(timer_wheel_t *wheel, uint32_t index) {
+  timer_entry_t *timer = &wheel->timers[index];
+  assert(timer->expires >= wheel->now);
+  uint64_t delta = timer->expires - wheel->now;
+  uint64_t expires = timer->expires;
+  size_t level = 0;
+  while (level < TIMER_WHEEL_LEVELS - 1 &&
+         delta >= (uint64_t)1 << (TIMER_WHEEL_BITS * (level + 1))) {
+    level++;
+  }
+  uint64_t reach = (uint64_t)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS);
+  if (delta >= reach) {
+    // Waits in the last slot within reach, and is placed again from there
+    expires = wheel->now + reach - 1;
+  }
+  uint32_t slot = level * TIMER_WHEEL_SLOTS +
+                  ((expires >> (TIMER_WHEEL_BITS * level)) &
+                   (TIMER_WHEEL_SLOTS - 1));
+
+  timer->slot = slot;
+  timer->next = TIMER_NIL;
+  timer->prev = wheel->tails[slot];
+  if (wheel->tails[slot] == TIMER_NIL) {
+    wheel->heads[slot] = index;
+  } else {
+    wheel->timers[wheel->tails[slot]].next = index;
+  }
+  wheel->tails[slot] = index;
+}
+
+/** Takes a timer out of its slot's list */
+void timer_wheel_unlink(timer_wheel_t *wheel, uint32_t index) {
+  timer_entry_t *timer = &wheel->timers[index];
+  if (timer->prev == TIMER_NIL) {
+    wheel->heads[timer->slot] = timer->next;
+  } else {
+    wheel->timers[timer->prev].next = timer->next;
+  }
+  if (timer->next == TIMER_NIL) {
+    wheel->tails[timer->slot] = timer->prev;
+  } else {
+    wheel->timers[timer->next].prev = timer->prev;
+  }
+}
+
+/** Unlinks a timer and returns its entry to the free list */
+void timer_wheel_release(timer_wheel_t *wheel, uint32_t index) {
+  timer_wheel_unlink(wheel, index);
+  timer_entry_t *timer = &wheel->timers[index];
+  timer->generation++;
+  timer->slot = TIMER_NIL;
+  timer->next = wheel->free_list;
+  wheel->free_list = index;
+  wheel->size--;
+}
+
+timer_id_t timer_wheel_schedule(timer_wheel_t *wheel, double delay,
+                                timer_callback_t fire, void *aux) {
+  if (wheel->free_list == TIMER_NIL) {
+    size_t old_capacity = wheel->capacity;
+    wheel->capacity *= 2;
+    assert(wheel->capacity < TIMER_NIL);
+    wheel->timers =
+        realloc(wheel->timers, wheel->capacity * sizeof(timer_entry_t));
+    assert(wheel->timers != NULL);
+    timer_wheel_add_free(wheel, old_capacity);
+  }
+  uint32_t index = wheel->free_list;
+  timer_entry_t *timer = &wheel->timers[index];
+  wheel->free_list = timer->next;
+  wheel->size++;
+
+  // Time already passed since the last tick counts towards the delay
+  double ticks =
+      ceil((fmax(delay, 0) + wheel->remainder) / wheel->tick_length -
+           TIMER_EPSILON);
+  timer->expires = wheel->now + (ticks < 1 ? 1 : (uint64_t)ticks);
+  timer->fire = fire;
+  timer->aux = aux;
+  timer_wheel_insert(wheel, index);
+  return ((timer_id_t)timer->generation << 32) | (index + 1);
+}
+
+/** Finds the entry of a pending timer, or returns TIMER_NIL */
+uint32_t timer_wheel_find(timer_wheel_t *wheel, timer_id_t id) {
+  uint64_t index = (id & UINT32_MAX) - 1;
+  if (id == TIMER_NONE || index >= wheel->capacity) {
+    return TIMER_NIL;
+  }
+  timer_entry_t *timer = &wheel->timers[index];
+  if (timer->slot == TIMER_NIL || timer->generation != id >> 32) {
+    return TIMER_NIL;
+  }
+  return index;
+}
+
+void timer_wheel_cancel(timer_wheel_t *wheel, timer_id_t id) {
+  uint32_t index = timer_wheel_find(wheel, id);
+  if (index != TIMER_NIL) {
+    timer_wheel_release(wheel, index);
+  }
+}
+
+bool timer_wheel_pending(timer_wheel_t *wheel, timer_id_t id) {
+  return timer_wheel_find(wheel, id) != TIMER_NIL;
+}
+
+size_t timer_wheel_size(timer_wheel_t *wheel) { return wheel->size; }
+
+/** Moves the timers of a slot down to the wheels their expiry now falls in */
+void timer_wheel_cascade(timer_wheel_t *wheel, uint32_t slot) {
+  uint32_t index = wheel->heads[slot];
+  wheel->heads[slot] = TIMER_NIL;
+  wheel->tails[slot] = TIMER_NIL;
+  while (index != TIMER_NIL) {
+    uint32_t next = wheel->timers[index].next;
+    timer_wheel_insert(wheel, index);
+    index = next;
+  }
+}
+
+/** Moves on one tick and fires the timers due on it */
+void timer_wheel_tick(timer_wheel_t *wheel) {
+  wheel->now++;
+  // Once a wheel turns all the way, the next slot of the wheel above comes
+  // due. Higher wheels go first, so their timers can move down several.
+  size_t levels = 1;
+  while (levels < TIMER_WHEEL_LEVELS &&
+         (wheel->now & (((uint64_t)1 << (TIMER_WHEEL_BITS * levels)) - 1)) ==
+             0) {
+    levels++;
+  }
+  for (size_t level = levels - 1; level > 0; level--) {
+    timer_wheel_cascade(wheel, level * TIMER_WHEEL_SLOTS +
+                                   ((wheel->now >> (TIMER_WHEEL_BITS * level)) &
+                                    (TIMER_WHEEL_SLOTS - 1)));
+  }
+
+  uint32_t slot = wheel->now & (TIMER_WHEEL_SLOTS - 1);
+  // Timers fired here may schedule or cancel others, so the list is read
+  // afresh for each one
+  while (wheel->heads[slot] != TIMER_NIL) {
+    uint32_t index = wheel->heads[slot];
+    timer_entry_t *timer = &wheel->timers[index];
+    assert(timer->expires == wheel->now);
+    timer_callback_t fire = timer->fire;
+    void *aux = timer->aux;
+    timer_wheel_release(wheel, index);
+    if (fire != NULL) {
+      fire(aux);
+    }
+  }
+}
+
+void timer_wheel_advance(timer_wheel_t *wheel, double dt) {
+  assert(dt >= 0);
+  wheel->remainder += dt;
+  double ticks = floor(wheel->remainder / wheel->tick_length);
+  wheel->remainder -= ticks * wheel->tick_length;
+  for (uint64_t tick = 0; tick < (uint64_t)ticks; tick++) {
+    if (wheel->size == 0) {
+      // Nothing can come due, so the rest of the ticks can be skipped
+      wheel->now += (uint64_t)ticks - tick;
+      break;
+    }
+    timer_wheel_tick(wheel);
+  }
+}
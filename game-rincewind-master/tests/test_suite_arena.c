@@ -0,0 +1,122 @@
+#include "alloc_track.h"
+#include "arena.h"
+#include "body.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+const size_t BLOCK_SIZE = 256;
+
+void test_arena_alloc() {
+  arena_t *arena = arena_init(BLOCK_SIZE);
+  assert(arena_used(arena) == 0);
+  char *previous = NULL;
+  for (size_t size = 1; size < 100; size += 7) {
+    char *memory = arena_alloc(arena, size);
+    // Every allocation is aligned for any type, and apart from the others
+    assert((uintptr_t)memory % alignof(max_align_t) == 0);
+    memset(memory, (int)size, size);
+    if (previous != NULL) {
+      assert(*previous == (char)(size - 7));
+    }
+    previous = memory;
+  }
+
+  // Larger allocations than a block get one of their own
+  char *large = arena_alloc(arena, 4 * BLOCK_SIZE);
+  memset(large, 1, 4 * BLOCK_SIZE);
+  assert(arena_used(arena) >= 4 * BLOCK_SIZE);
+  arena_free(arena);
+}
+
+void test_arena_blocks() {
+  size_t blocks = track_live_count(TRACK_ARENA);
+  arena_t *arena = arena_init(BLOCK_SIZE);
+  // Nothing is allocated until something is asked for
+  assert(track_live_count(TRACK_ARENA) == blocks);
+  for (size_t i = 0; i < BLOCK_SIZE / sizeof(max_align_t); i++) {
+    arena_alloc(arena, 1);
+  }
+#ifdef TRACK_ALLOCATIONS
+  // Small allocations share a block
+  assert(track_live_count(TRACK_ARENA) == blocks + 1);
+#endif
+  arena_free(arena);
+  assert(track_live_count(TRACK_ARENA) == blocks);
+}
+
+void test_arena_list() {
+  arena_t *arena = arena_init(BLOCK_SIZE);
+  size_t lists = track_live_count(TRACK_LIST);
+  list_t *list = list_init_in(arena, 1, NULL);
+  int values[100];
+  for (size_t i = 0; i < 100; i++) {
+    values[i] = i;
+    list_add(list, &values[i]);
+  }
+  for (size_t i = 0; i < 100; i++) {
+    assert(*(int *)list_get(list, i) == (int)i);
+  }
+  // Neither the list nor its arrays were allocated on their own
+  assert(track_live_count(TRACK_LIST) == lists);
+  list_free(list);
+  arena_free(arena);
+}
+
+void test_arena_body() {
+  arena_t *arena = arena_init(BLOCK_SIZE);
+  size_t bodies = track_live_count(TRACK_BODY);
+  list_t *shape = list_init_in(arena, 4, NULL);
+  vector_t *vertices = arena_alloc(arena, 4 * sizeof(vector_t));
+  vertices[0] = (vector_t){0, 0};
+  vertices[1] = (vector_t){2, 0};
+  vertices[2] = (vector_t){2, 2};
+  vertices[3] = (vector_t){0, 2};
+  for (size_t i = 0; i < 4; i++) {
+    list_add(shape, &vertices[i]);
+  }
+  int info = 7;
+  body_t *body = body_init_in(arena, shape, 1, (rgb_color_t){0, 0, 0}, &info,
+                              NULL);
+  assert(track_live_count(TRACK_BODY) == bodies);
+  assert(vec_isclose(body_get_centroid(body), (vector_t){1, 1}));
+  assert(*(int *)body_get_info(body) == 7);
+
+  // The world shape is rebuilt in the arena as the body moves
+  body_set_centroid(body, (vector_t){5, 5});
+  list_t *world = body_get_world_shape(body);
+  assert(vec_isclose(*(vector_t *)list_get(world, 0), (vector_t){4, 4}));
+  // Reshaping reuses the world-shape cache while the vertices fit in it
+  size_t used = arena_used(arena);
+  list_t *copy = body_get_shape(body);
+  body_set_shape(body, copy);
+  assert(vec_isclose(body_get_centroid(body), (vector_t){5, 5}));
+  assert(arena_used(arena) == used);
+  vector_t *vertex = malloc(sizeof(vector_t));
+  *vertex = (vector_t){5, 7};
+  body_add_vertex(body, vertex);
+  assert(list_size(body_get_world_shape(body)) == 5);
+  assert(arena_used(arena) > used);
+  body_free(body);
+  arena_free(arena);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_arena_alloc)
+  DO_TEST(test_arena_blocks)
+  DO_TEST(test_arena_list)
+  DO_TEST(test_arena_body)
+
+  puts("arena_test PASS");
+}
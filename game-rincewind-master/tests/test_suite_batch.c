@@ -0,0 +1,159 @@
+#include "batch.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+
+const double DT = 1.0 / 60;
+
+void assert_vec_equal(vector_t v1, vector_t v2) { assert(vec_equal(v1, v2)); }
+
+void assert_observations_equal(const match_observation_t *observation1,
+                               const match_observation_t *observation2) {
+  for (size_t i = 0; i < MATCH_PLAYERS; i++) {
+    const player_observation_t *player1 = &observation1->players[i];
+    const player_observation_t *player2 = &observation2->players[i];
+    assert(player1->alive == player2->alive);
+    assert_vec_equal(player1->position, player2->position);
+    assert_vec_equal(player1->velocity, player2->velocity);
+    assert(player1->grounded == player2->grounded);
+    assert(player1->lives == player2->lives);
+    assert(player1->weapon == player2->weapon);
+    assert(player1->shots_left == player2->shots_left);
+    assert(player1->time_since_last_shot == player2->time_since_last_shot);
+    assert(player1->time_since_jump == player2->time_since_jump);
+  }
+  assert(observation1->powerup_count == observation2->powerup_count);
+  for (size_t i = 0; i < observation1->powerup_count; i++) {
+    assert(observation1->powerup_types[i] == observation2->powerup_types[i]);
+    assert_vec_equal(observation1->powerup_positions[i],
+                     observation2->powerup_positions[i]);
+  }
+  assert(observation1->bullet_count == observation2->bullet_count);
+  for (size_t i = 0; i < observation1->bullet_count; i++) {
+    assert(observation1->bullet_weapons[i] == observation2->bullet_weapons[i]);
+    assert_vec_equal(observation1->bullet_positions[i],
+                     observation2->bullet_positions[i]);
+    assert_vec_equal(observation1->bullet_velocities[i],
+                     observation2->bullet_velocities[i]);
+  }
+  assert(observation1->round == observation2->round);
+  assert(observation1->over == observation2->over);
+}
+
+void test_batch_matches_alone() {
+  const size_t MATCHES = 24;
+  const size_t THREADS = 4;
+  const size_t TICKS = 400;
+
+  game_state_t maps[MATCHES];
+  match_t *alone[MATCHES];
+  for (size_t i = 0; i < MATCHES; i++) {
+    maps[i] = i % 2 == 0 ? MAP1 : MAP2;
+    alone[i] = match_init(maps[i]);
+  }
+  batch_t *batch = batch_init(maps, MATCHES, THREADS);
+  assert(batch_size(batch) == MATCHES);
+  player_input_t(*inputs)[MATCH_PLAYERS] =
+      malloc(MATCHES * sizeof(*inputs));
+  match_observation_t *observations =
+      malloc(MATCHES * sizeof(match_observation_t));
+
+  size_t bullets_seen = 0;
+  for (size_t tick = 0; tick < TICKS; tick++) {
+    for (size_t i = 0; i < MATCHES; i++) {
+      for (body_type_t player = PLAYER1; player <= PLAYER2; player++) {
+        inputs[i][player] = scripted_input(i, player, tick);
+      }
+    }
+    batch_step(batch, inputs, DT, observations);
+
+    // Every match plays out just as it does stepped on its own
+    for (size_t i = 0; i < MATCHES; i++) {
+      match_step(alone[i], inputs[i], DT);
+      match_observation_t observation;
+      match_observe(alone[i], &observation);
+      assert_observations_equal(&observations[i], &observation);
+      bullets_seen += observation.bullet_count;
+    }
+  }
+  assert(bullets_seen > 0);
+
+  for (size_t i = 0; i < MATCHES; i++) {
+    match_free(alone[i]);
+  }
+  free(inputs);
+  free(observations);
+  batch_free(batch);
+}
+
+void test_batch_restart() {
+  const size_t TICKS = 120;
+  game_state_t maps[] = {MAP1, MAP2};
+  batch_t *batch = batch_init(maps, 2, 2);
+  player_input_t inputs[2][MATCH_PLAYERS] = {{INPUT_RIGHT, INPUT_LEFT},
+                                             {INPUT_LEFT, INPUT_RIGHT}};
+  for (size_t tick = 0; tick < TICKS; tick++) {
+    batch_step(batch, inputs, DT, NULL);
+  }
+
+  // The restarted match is new, and the other one carries on
+  match_t *fresh = match_init(MAP1);
+  match_observation_t expected, observation;
+  match_observe(fresh, &expected);
+  match_observe(batch_get_match(batch, 0), &observation);
+  assert(!vec_equal(observation.players[PLAYER1].position,
+                    expected.players[PLAYER1].position));
+  batch_restart(batch, 0);
+  match_observe(batch_get_match(batch, 0), &observation);
+  assert_observations_equal(&observation, &expected);
+  assert(match_get_map(batch_get_match(batch, 1)) == MAP2);
+
+  match_free(fresh);
+  batch_free(batch);
+}
+
+void test_batch_throughput() {
+  const size_t MATCHES = 64;
+  const size_t TICKS = 200;
+
+  game_state_t maps[MATCHES];
+  for (size_t i = 0; i < MATCHES; i++) {
+    maps[i] = i % 2 == 0 ? MAP1 : MAP2;
+  }
+  batch_t *batch = batch_init(maps, MATCHES, 1);
+  player_input_t(*inputs)[MATCH_PLAYERS] =
+      malloc(MATCHES * sizeof(*inputs));
+
+  clock_t start = clock();
+  for (size_t tick = 0; tick < TICKS; tick++) {
+    for (size_t i = 0; i < MATCHES; i++) {
+      for (body_type_t player = PLAYER1; player <= PLAYER2; player++) {
+        inputs[i][player] = scripted_input(i, player, tick);
+      }
+    }
+    batch_step(batch, inputs, DT, NULL);
+  }
+  double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  printf("batch: %.0f match ticks per second on one core\n",
+         MATCHES * TICKS / seconds);
+
+  free(inputs);
+  batch_free(batch);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_batch_matches_alone)
+  DO_TEST(test_batch_restart)
+  DO_TEST(test_batch_throughput)
+
+  puts("batch_test PASS");
+}
@@ -199,6 +199,111 @@ void test_body_remove() {
   body_free(body);
 }
 
+void test_body_revision() {
+  list_t *shape = list_init(3, free);
+  vector_t *v = malloc(sizeof(*v));
+  *v = (vector_t){+1, 0};
+  list_add(shape, v);
+  v = malloc(sizeof(*v));
+  *v = (vector_t){0, +1};
+  list_add(shape, v);
+  v = malloc(sizeof(*v));
+  *v = (vector_t){-1, 0};
+  list_add(shape, v);
+  body_t *body = body_init(shape, 1, (rgb_color_t){0, 0, 0});
+  assert(vec_equal(body_get_vertex(body, 1), (vector_t){0, +1}));
+
+  // A body at rest keeps its revision across ticks
+  size_t revision = body_get_revision(body);
+  body_tick(body, 1);
+  assert(body_get_revision(body) == revision);
+  body_set_centroid(body, body_get_centroid(body));
+  assert(body_get_revision(body) == revision);
+
+  // Moving or rotating the body changes its revision
+  body_set_velocity(body, (vector_t){1, 0});
+  body_tick(body, 1);
+  assert(body_get_revision(body) != revision);
+  assert(vec_isclose(body_get_vertex(body, 1), (vector_t){1, +1}));
+  revision = body_get_revision(body);
+  body_set_rotation(body, M_PI);
+  assert(body_get_revision(body) != revision);
+  body_free(body);
+}
+
+void test_world_shape() {
+  list_t *shape = list_init(4, free);
+  vector_t *v = malloc(sizeof(*v));
+  *v = (vector_t){0, 0};
+  list_add(shape, v);
+  v = malloc(sizeof(*v));
+  *v = (vector_t){2, 0};
+  list_add(shape, v);
+  v = malloc(sizeof(*v));
+  *v = (vector_t){2, 2};
+  list_add(shape, v);
+  v = malloc(sizeof(*v));
+  *v = (vector_t){0, 2};
+  list_add(shape, v);
+  body_t *body = body_init(shape, 1, (rgb_color_t){0, 0, 0});
+  list_t *world = body_get_world_shape(body);
+  assert(vec_isclose(*(vector_t *)list_get(world, 2), (vector_t){2, 2}));
+
+  // Rotating about a point moves the centroid and turns the vertices
+  body_rotate_about(body, M_PI / 2, (vector_t){0, 0});
+  assert(vec_isclose(body_get_centroid(body), (vector_t){-1, 1}));
+  assert(body_get_world_shape(body) == world);
+  assert(vec_isclose(*(vector_t *)list_get(world, 1), (vector_t){0, 2}));
+  assert(vec_isclose(*(vector_t *)list_get(world, 2), (vector_t){-2, 2}));
+
+  // Translating keeps the rotation
+  body_set_centroid(body, (vector_t){5, 5});
+  assert(vec_isclose(body_get_vertex(body, 1), (vector_t){6, 6}));
+  assert(vec_isclose(body_get_vertex(body, 3), (vector_t){4, 4}));
+
+  // Added vertices are in world space
+  v = malloc(sizeof(*v));
+  *v = (vector_t){7, 5};
+  body_add_vertex(body, v);
+  assert(list_size(body_get_world_shape(body)) == 5);
+  assert(vec_isclose(body_get_vertex(body, 4), (vector_t){7, 5}));
+  assert(vec_isclose(body_get_vertex(body, 0), (vector_t){6, 4}));
+  body_free(body);
+}
+
+void test_motion_types() {
+  list_t *shape = list_init(3, free);
+  vector_t *v = malloc(sizeof(*v));
+  *v = (vector_t){+1, 0};
+  list_add(shape, v);
+  v = malloc(sizeof(*v));
+  *v = (vector_t){0, +1};
+  list_add(shape, v);
+  v = malloc(sizeof(*v));
+  *v = (vector_t){-1, 0};
+  list_add(shape, v);
+  body_t *body = body_init(shape, 1, (rgb_color_t){0, 0, 0});
+  assert(body_get_motion_type(body) == MOTION_DYNAMIC);
+  vector_t start = body_get_centroid(body);
+
+  // Static bodies ignore velocity and forces
+  body_set_motion_type(body, MOTION_STATIC);
+  body_set_velocity(body, (vector_t){1, 0});
+  body_add_force(body, (vector_t){0, 1});
+  body_tick(body, 1);
+  assert(vec_isclose(body_get_centroid(body), start));
+  assert(vec_equal(body_get_net_force(body), VEC_ZERO));
+
+  // Kinematic bodies follow their velocity but ignore forces
+  body_set_motion_type(body, MOTION_KINEMATIC);
+  body_add_force(body, (vector_t){0, 1});
+  body_tick(body, 1);
+  assert(
+      vec_isclose(body_get_centroid(body), vec_add(start, (vector_t){1, 0})));
+  assert(vec_equal(body_get_velocity(body), (vector_t){1, 0}));
+  body_free(body);
+}
+
 void test_body_info() {
   list_t *shape = list_init(3, free);
   vector_t *v = malloc(sizeof(*v));
@@ -263,6 +368,9 @@ int main(int argc, char *argv[]) {
   DO_TEST(test_infinite_mass)
   DO_TEST(test_forces)
   DO_TEST(test_body_remove)
+  DO_TEST(test_body_revision)
+  DO_TEST(test_world_shape)
+  DO_TEST(test_motion_types)
   DO_TEST(test_body_info)
   DO_TEST(test_body_info_freer)
 
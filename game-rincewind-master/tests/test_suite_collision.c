@@ -1 +1,266 @@
-int main() {}
\ No newline at end of file
+#include "collision.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+/** Makes a counterclockwise rectangle centered at center */
+list_t *rect_at(vector_t center, double width, double height) {
+  list_t *rect = rect_init(width, height);
+  for (size_t i = 0; i < list_size(rect); i++) {
+    vector_t *vertex = list_get(rect, i);
+    *vertex = vec_add(*vertex, center);
+  }
+  return rect;
+}
+
+/** Makes a copy of a shape with its vertices in the opposite order */
+list_t *reversed(list_t *shape) {
+  size_t count = list_size(shape);
+  list_t *copy = list_init(count, free);
+  for (size_t i = count; i > 0; i--) {
+    vector_t *vertex = malloc(sizeof(vector_t));
+    assert(vertex != NULL);
+    *vertex = *(vector_t *)list_get(shape, i - 1);
+    list_add(copy, vertex);
+  }
+  return copy;
+}
+
+void test_find_collision() {
+  list_t *box = rect_at(VEC_ZERO, 2, 2);
+
+  list_t *separated = rect_at((vector_t){3, 0}, 2, 2);
+  assert(!find_collision(box, separated).collided);
+  assert(!find_collision(separated, box).collided);
+
+  // Shapes that share an edge count as colliding, with no overlap
+  list_t *touching = rect_at((vector_t){2, 0}, 2, 2);
+  collision_info_t collision = find_collision(box, touching);
+  assert(collision.collided);
+  assert(isclose(collision.depth, 0));
+
+  list_t *overlapping = rect_at((vector_t){1.5, 0.25}, 2, 2);
+  collision = find_collision(box, overlapping);
+  assert(collision.collided);
+  assert(isclose(collision.depth, 0.5));
+  assert(isclose(fabs(collision.axis.x), 1));
+  assert(isclose(collision.axis.y, 0));
+
+  list_free(overlapping);
+  list_free(touching);
+  list_free(separated);
+  list_free(box);
+}
+
+void test_find_contact_manifold() {
+  list_t *box = rect_at(VEC_ZERO, 2, 2);
+
+  list_t *separated = rect_at((vector_t){3, 0}, 2, 2);
+  assert(find_contact_manifold(box, separated).point_count == 0);
+
+  // Touching edges make a manifold of both ends of the shared edge
+  list_t *touching = rect_at((vector_t){2, 0}, 2, 2);
+  contact_manifold_t manifold = find_contact_manifold(box, touching);
+  assert(manifold.point_count == 2);
+  assert(vec_isclose(manifold.normal, (vector_t){1, 0}));
+  for (size_t i = 0; i < manifold.point_count; i++) {
+    assert(isclose(manifold.points[i].depth, 0));
+    assert(isclose(manifold.points[i].point.x, 1));
+  }
+
+  // The incident edge is clipped to the sides of the reference edge
+  list_t *overlapping = rect_at((vector_t){1.5, 0.5}, 2, 2);
+  manifold = find_contact_manifold(box, overlapping);
+  assert(manifold.point_count == 2);
+  assert(vec_isclose(manifold.normal, (vector_t){1, 0}));
+  assert(vec_isclose(manifold.points[0].point, (vector_t){0.5, 1}));
+  assert(vec_isclose(manifold.points[1].point, (vector_t){0.5, -0.5}));
+  assert(isclose(manifold.points[0].depth, 0.5));
+  assert(isclose(manifold.points[1].depth, 0.5));
+  assert(manifold.points[0].id != manifold.points[1].id);
+
+  // The normal always points from the first shape towards the second
+  contact_manifold_t swapped = find_contact_manifold(overlapping, box);
+  assert(swapped.point_count == 2);
+  assert(vec_isclose(swapped.normal, (vector_t){-1, 0}));
+
+  // Either winding gives the same manifold
+  list_t *clockwise = reversed(overlapping);
+  contact_manifold_t rewound = find_contact_manifold(box, clockwise);
+  assert(rewound.point_count == 2);
+  assert(vec_isclose(rewound.normal, manifold.normal));
+  for (size_t i = 0; i < rewound.point_count; i++) {
+    assert(isclose(rewound.points[i].depth, 0.5));
+  }
+
+  // The same features keep their ids as the shapes move a little
+  list_t *nudged = rect_at((vector_t){1.45, 0.55}, 2, 2);
+  contact_manifold_t next = find_contact_manifold(box, nudged);
+  assert(next.point_count == 2);
+  for (size_t i = 0; i < next.point_count; i++) {
+    assert(next.points[i].id == manifold.points[i].id);
+  }
+  assert(isclose(next.points[0].depth, 0.55));
+
+  list_free(nudged);
+  list_free(clockwise);
+  list_free(overlapping);
+  list_free(touching);
+  list_free(separated);
+  list_free(box);
+}
+
+void test_find_time_of_impact() {
+  aabb_t moving = {.min = {0, 0}, .max = {1, 1}};
+  aabb_t still = {.min = {5, 0}, .max = {6, 1}};
+  assert(isclose(find_time_of_impact(moving, (vector_t){10, 0}, still), 0.4));
+  // Diagonal motion enters once both axes overlap
+  aabb_t corner = {.min = {5, 5}, .max = {6, 6}};
+  assert(isclose(find_time_of_impact(moving, (vector_t){10, 10}, corner),
+                 0.4));
+
+  // Separated: passing by, falling short, or moving away
+  aabb_t above = {.min = {5, 5}, .max = {6, 6}};
+  assert(find_time_of_impact(moving, (vector_t){10, 0}, above) == INFINITY);
+  assert(find_time_of_impact(moving, (vector_t){2, 0}, still) == INFINITY);
+  assert(find_time_of_impact(moving, (vector_t){-10, 0}, still) == INFINITY);
+
+  // Touching boxes meet at the very start; overlapping ones are ignored
+  aabb_t touching = {.min = {1, 0}, .max = {2, 1}};
+  assert(find_time_of_impact(moving, (vector_t){10, 0}, touching) == 0);
+  aabb_t overlapping = {.min = {0.5, 0.5}, .max = {1.5, 1.5}};
+  assert(find_time_of_impact(moving, (vector_t){10, 0}, overlapping) ==
+         INFINITY);
+
+  // Boxes both moving meet when one moves by their relative displacement,
+  // even if they pass each other within the motion
+  aabb_t oncoming = {.min = {3, 0}, .max = {4, 1}};
+  vector_t relative = vec_subtract((vector_t){5, 0}, (vector_t){-5, 0});
+  assert(isclose(find_time_of_impact(moving, relative, oncoming), 0.2));
+}
+
+void test_find_segment_hit() {
+  list_t *box = rect_at(VEC_ZERO, 2, 2);
+
+  segment_hit_t hit =
+      find_segment_hit(box, (vector_t){-5, 0}, (vector_t){5, 0});
+  assert(hit.hit);
+  assert(isclose(hit.fraction, 0.4));
+  assert(vec_isclose(hit.point, (vector_t){-1, 0}));
+  assert(vec_isclose(hit.normal, (vector_t){-1, 0}));
+
+  // Falling short of the box, or running parallel to an edge beside it
+  assert(!find_segment_hit(box, (vector_t){-5, 0}, (vector_t){-2, 0}).hit);
+  assert(!find_segment_hit(box, (vector_t){-5, 2}, (vector_t){5, 2}).hit);
+  // Running along an edge, the segment meets the box at its corner
+  hit = find_segment_hit(box, (vector_t){-5, 1}, (vector_t){5, 1});
+  assert(hit.hit);
+  assert(vec_isclose(hit.point, (vector_t){-1, 1}));
+
+  // A segment starting inside hits the edge it leaves through, with the
+  // normal still facing back against the motion
+  hit = find_segment_hit(box, VEC_ZERO, (vector_t){5, 0});
+  assert(hit.hit);
+  assert(isclose(hit.fraction, 0.2));
+  assert(vec_isclose(hit.point, (vector_t){1, 0}));
+  assert(vec_isclose(hit.normal, (vector_t){-1, 0}));
+
+  // Either winding gives the same hit
+  list_t *clockwise = reversed(box);
+  hit = find_segment_hit(clockwise, (vector_t){0, 5}, (vector_t){0, -5});
+  assert(hit.hit);
+  assert(isclose(hit.fraction, 0.4));
+  assert(vec_isclose(hit.normal, (vector_t){0, 1}));
+
+  list_free(clockwise);
+  list_free(box);
+}
+
+void test_find_shape_hit() {
+  list_t *box = rect_at(VEC_ZERO, 2, 2);
+
+  list_t *moving = rect_at((vector_t){-5, 0}, 2, 2);
+  segment_hit_t hit = find_shape_hit(moving, (vector_t){10, 0}, box);
+  assert(hit.hit);
+  assert(isclose(hit.fraction, 0.3));
+  assert(isclose(hit.point.x, -1));
+  assert(vec_isclose(hit.normal, (vector_t){-1, 0}));
+  // Passing by, or stopping short
+  list_t *above = rect_at((vector_t){0, 3}, 2, 2);
+  assert(!find_shape_hit(moving, (vector_t){10, 0}, above).hit);
+  assert(!find_shape_hit(moving, (vector_t){2, 0}, box).hit);
+
+  // A vertex of the still shape can hit an edge of the moving one
+  list_t *wide = rect_at((vector_t){0, 3}, 4, 1);
+  list_t *small = rect_at(VEC_ZERO, 1, 1);
+  hit = find_shape_hit(wide, (vector_t){0, -10}, small);
+  assert(hit.hit);
+  assert(isclose(hit.fraction, 0.2));
+  assert(isclose(hit.point.y, 0.5));
+  assert(vec_isclose(hit.normal, (vector_t){0, 1}));
+
+  // Touching or overlapping shapes hit straight away
+  list_t *touching = rect_at((vector_t){-2, 0}, 2, 2);
+  hit = find_shape_hit(touching, (vector_t){10, 0}, box);
+  assert(hit.hit);
+  assert(hit.fraction == 0);
+  list_t *overlapping = rect_at((vector_t){-1.5, 0}, 2, 2);
+  hit = find_shape_hit(overlapping, (vector_t){0, 10}, box);
+  assert(hit.hit);
+  assert(hit.fraction == 0);
+  assert(isclose(fabs(hit.normal.x), 1));
+
+  list_free(overlapping);
+  list_free(touching);
+  list_free(small);
+  list_free(wide);
+  list_free(above);
+  list_free(moving);
+  list_free(box);
+}
+
+void test_aabb() {
+  aabb_t box = {.min = {0, 0}, .max = {2, 2}};
+  aabb_t separated = {.min = {3, 0}, .max = {4, 2}};
+  aabb_t diagonal = {.min = {2.5, 2.5}, .max = {4, 4}};
+  aabb_t touching = {.min = {2, 2}, .max = {3, 3}};
+  aabb_t overlapping = {.min = {1, -1}, .max = {3, 1}};
+  aabb_t inside = {.min = {0.5, 0.5}, .max = {1, 1}};
+  assert(!aabb_overlaps(box, separated));
+  assert(!aabb_overlaps(separated, box));
+  assert(!aabb_overlaps(box, diagonal));
+  assert(aabb_overlaps(box, touching));
+  assert(aabb_overlaps(box, overlapping));
+  assert(aabb_overlaps(overlapping, box));
+  assert(aabb_overlaps(box, inside));
+
+  aabb_t both = aabb_union(box, overlapping);
+  assert(vec_equal(both.min, (vector_t){0, -1}));
+  assert(vec_equal(both.max, (vector_t){3, 2}));
+  both = aabb_union(box, inside);
+  assert(vec_equal(both.min, box.min));
+  assert(vec_equal(both.max, box.max));
+  both = aabb_union(separated, diagonal);
+  assert(vec_equal(both.min, (vector_t){2.5, 0}));
+  assert(vec_equal(both.max, (vector_t){4, 4}));
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_find_collision)
+  DO_TEST(test_find_contact_manifold)
+  DO_TEST(test_find_time_of_impact)
+  DO_TEST(test_find_segment_hit)
+  DO_TEST(test_find_shape_hit)
+  DO_TEST(test_aabb)
+
+  puts("collision_test PASS");
+}
@@ -0,0 +1,249 @@
+#include "alloc_track.h"
+#include "bvh.h"
+#include "map.h"
+#include "map_file.h"
+#include "match.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const double DT = 1.0 / 60;
+// Seed of the inputs the players follow (see scripted_input())
+const size_t SCRIPT = 2;
+// Where the tests write the maps they convert
+const char *const TEST_MAP_PATH = "out/test_suite_map_file.map";
+const char *const TEST_TEXT_PATH = "out/test_suite_map_file.txt";
+
+/** Reads a whole file, setting length to its size */
+char *read_file(const char *path, size_t *length) {
+  FILE *file = fopen(path, "rb");
+  assert(file != NULL);
+  fseek(file, 0, SEEK_END);
+  *length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  char *contents = malloc(*length + 1);
+  assert(contents != NULL);
+  assert(fread(contents, 1, *length, file) == *length);
+  fclose(file);
+  return contents;
+}
+
+void write_text(const char *text) {
+  FILE *file = fopen(TEST_TEXT_PATH, "w");
+  assert(file != NULL);
+  fputs(text, file);
+  fclose(file);
+}
+
+void assert_files_equal(const char *path1, const char *path2) {
+  size_t length1, length2;
+  char *contents1 = read_file(path1, &length1);
+  char *contents2 = read_file(path2, &length2);
+  assert(length1 == length2);
+  assert(memcmp(contents1, contents2, length1) == 0);
+  free(contents1);
+  free(contents2);
+}
+
+void test_map_files_up_to_date() {
+  // The map files the game loads are the ones their text converts to
+  assert(map_file_convert("maps/map1.txt", TEST_MAP_PATH));
+  assert_files_equal(TEST_MAP_PATH, "assets/maps/map1.map");
+  assert(map_file_convert("maps/map2.txt", TEST_MAP_PATH));
+  assert_files_equal(TEST_MAP_PATH, "assets/maps/map2.map");
+  remove(TEST_MAP_PATH);
+}
+
+void test_map_file_load() {
+  map_file_t *map = map_file_load("assets/maps/map2.map");
+  assert(map != NULL);
+  assert(vec_equal(map_file_size(map), (vector_t){200, 100}));
+  assert(map_file_bodies(map) == 20);
+  assert(map_file_texture(map, 0) == NULL);
+  assert(strcmp(map_file_texture(map, 1), "background.jpg") == 0);
+  assert(strcmp(map_file_texture(map, 2), "ground.png") == 0);
+  assert(map_file_texture(map, 6) == NULL);
+
+  assert(map_file_spawns(map, SPAWN_PLAYER1) == 1);
+  assert(map_file_spawns(map, SPAWN_PLAYER2) == 1);
+  assert(map_file_spawns(map, SPAWN_POWERUP) == 4);
+  assert(vec_equal(map_file_spawn(map, SPAWN_PLAYER1, 0), (vector_t){50, 12}));
+  assert(vec_equal(map_file_spawn(map, SPAWN_PLAYER2, 0), (vector_t){150, 12}));
+  assert(vec_isclose(map_file_spawn(map, SPAWN_POWERUP, 3),
+                     (vector_t){200 * 11.0 / 12, 80}));
+  map_file_free(map);
+}
+
+void test_map_file_instantiate() {
+  map_file_t *map = map_file_load("assets/maps/map2.map");
+  scene_t *scene = game_scene_init();
+  size_t bodies = track_live_count(TRACK_BODY);
+  map_file_instantiate(map, scene);
+  // The scene owns its bodies, so the map can go first
+  map_file_free(map);
+  // They come from the scene's arena rather than one by one
+  assert(track_live_count(TRACK_BODY) == bodies);
+  assert(arena_used(scene_get_arena(scene)) > 0);
+
+  assert(scene_bodies(scene) == 20);
+  body_t *arm = scene_get_body(scene, 8);
+  assert(get_info(arm)->type == CLOCK_BIG_ARM);
+  assert(body_get_motion_type(arm) == MOTION_KINEMATIC);
+  assert(body_get_rot_velocity(arm) == 0.001);
+  assert(body_get_rot_acceleration(arm) == 0.0008);
+  body_t *gravity = scene_get_body(scene, 0);
+  assert(get_info(gravity)->type == GRAVITY);
+  assert(body_get_mass(gravity) == 6e24);
+  assert(body_get_motion_type(gravity) == MOTION_STATIC);
+  assert(vec_equal(body_get_centroid(scene_get_body(scene, 1)),
+                   (vector_t){100, 50}));
+  // Each body keeps its own copy of its texture's name
+  assert(get_info(gravity)->texture == NULL);
+  assert(strcmp(get_info(scene_get_body(scene, 2))->texture, "ground.png") ==
+         0);
+  scene_free(scene);
+}
+
+void test_map_file_baked_hierarchy() {
+  const size_t TICKS = 600;
+  game_state_t maps[] = {MAP1, MAP2};
+  for (size_t i = 0; i < sizeof(maps) / sizeof(maps[0]); i++) {
+    // A match whose static hierarchy is built from its bodies instead
+    match_t *baked = match_init(maps[i]);
+    match_t *built = match_init(maps[i]);
+    scene_build_static_bvh(match_get_scene(built));
+
+    for (size_t tick = 0; tick < TICKS; tick++) {
+      player_input_t inputs[MATCH_PLAYERS];
+      for (body_type_t player = PLAYER1; player <= PLAYER2; player++) {
+        inputs[player] = scripted_input(SCRIPT, player, tick);
+      }
+      match_step(baked, inputs, DT);
+      match_step(built, inputs, DT);
+      match_observation_t observation1, observation2;
+      match_observe(baked, &observation1);
+      match_observe(built, &observation2);
+      for (size_t player = 0; player < MATCH_PLAYERS; player++) {
+        assert(vec_equal(observation1.players[player].position,
+                         observation2.players[player].position));
+      }
+      assert(observation1.bullet_count == observation2.bullet_count);
+    }
+    match_free(baked);
+    match_free(built);
+  }
+}
+
+void test_map_file_errors() {
+  const char *const BAD_MAPS[] = {
+      "rect GROUND static 1 1 0 0 0 0 1\n",
+      "size 10 10\nrect FLOOR static 1 1 0 0 0 0 1\n",
+      "size 10 10\nrect GROUND still 1 1 0 0 0 0 1\n",
+      "size 10 10\nrect GROUND static 1 1 0 0 0 0\n",
+      "size 10 10\nrect GROUND static 1 1 0 0 0 0 1 bouncy\n",
+      "size 10 10\ncircle CLOCK static 1 2.5 0 0 0 0 1\n",
+      "size 10 10\nspawn PLAYER3 0 0\n",
+      "size 10 10 10\n",
+      "size ten 10\n"};
+  for (size_t i = 0; i < sizeof(BAD_MAPS) / sizeof(BAD_MAPS[0]); i++) {
+    write_text(BAD_MAPS[i]);
+    assert(!map_file_convert(TEST_TEXT_PATH, TEST_MAP_PATH));
+  }
+  assert(!map_file_convert("maps/no_such_map.txt", TEST_MAP_PATH));
+
+  // Comments and blank lines are fine
+  write_text("# A box\n\nsize 10 10 # wide\nrect WALL static 1 1 5 5 0 0 1\n");
+  assert(map_file_convert(TEST_TEXT_PATH, TEST_MAP_PATH));
+  map_file_t *map = map_file_load(TEST_MAP_PATH);
+  assert(map != NULL);
+  assert(map_file_bodies(map) == 1);
+  assert(map_file_spawns(map, SPAWN_POWERUP) == 0);
+  map_file_free(map);
+
+  // Only map files load
+  assert(map_file_load(TEST_TEXT_PATH) == NULL);
+  assert(map_file_load("maps/no_such_map.map") == NULL);
+  remove(TEST_TEXT_PATH);
+  remove(TEST_MAP_PATH);
+}
+
+/**
+ * Writes a copy of the map file at TEST_MAP_PATH with its last hierarchy node
+ * changed, and tries to load it. The map has no textures, so its file ends
+ * with the hierarchy's items, just after the nodes.
+ */
+map_file_t *load_with_last_node(size_t item_count, size_t offset,
+                                size_t count) {
+  size_t length;
+  char *contents = read_file(TEST_MAP_PATH, &length);
+  size_t node_start = length - item_count * sizeof(bvh_baked_item_t) -
+                      sizeof(bvh_baked_node_t);
+  bvh_baked_node_t node;
+  memcpy(&node, contents + node_start, sizeof(node));
+  node.offset = offset;
+  node.count = count;
+  memcpy(contents + node_start, &node, sizeof(node));
+  FILE *file = fopen(TEST_MAP_PATH, "wb");
+  assert(file != NULL);
+  assert(fwrite(contents, 1, length, file) == length);
+  fclose(file);
+  free(contents);
+  return map_file_load(TEST_MAP_PATH);
+}
+
+void test_map_file_corrupt_hierarchy() {
+  const size_t WALLS = 4;
+  // Walls far apart, so the hierarchy splits them between several leaves
+  write_text("size 100 10\n"
+             "rect WALL static 1 1 5 5 0 0 1\n"
+             "rect WALL static 1 1 30 5 0 0 1\n"
+             "rect WALL static 1 1 55 5 0 0 1\n"
+             "rect WALL static 1 1 80 5 0 0 1\n");
+  const struct {
+    size_t offset;
+    size_t count;
+  } CORRUPTIONS[] = {
+      // An internal node whose child is the root, making a cycle
+      {0, 0},
+      // An internal node whose child is past the last node
+      {1000, 0},
+      // Leaves that cover items twice, or past the last one
+      {0, 1},
+      {WALLS - 1, 2},
+      {WALLS, 1000},
+  };
+  for (size_t i = 0; i < sizeof(CORRUPTIONS) / sizeof(CORRUPTIONS[0]); i++) {
+    assert(map_file_convert(TEST_TEXT_PATH, TEST_MAP_PATH));
+    assert(load_with_last_node(WALLS, CORRUPTIONS[i].offset,
+                               CORRUPTIONS[i].count) == NULL);
+  }
+
+  // The last node is always a leaf of the last item, which loads unchanged
+  assert(map_file_convert(TEST_TEXT_PATH, TEST_MAP_PATH));
+  map_file_t *map = load_with_last_node(WALLS, WALLS - 1, 1);
+  assert(map != NULL);
+  map_file_free(map);
+  remove(TEST_TEXT_PATH);
+  remove(TEST_MAP_PATH);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_map_files_up_to_date)
+  DO_TEST(test_map_file_load)
+  DO_TEST(test_map_file_instantiate)
+  DO_TEST(test_map_file_baked_hierarchy)
+  DO_TEST(test_map_file_errors)
+  DO_TEST(test_map_file_corrupt_hierarchy)
+
+  puts("map_file_test PASS");
+}
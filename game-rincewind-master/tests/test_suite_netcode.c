@@ -0,0 +1,224 @@
+#include "bitstream.h"
+#include "netcode.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+
+const double DT = 1.0 / 60;
+// Seed of the inputs the players follow (see scripted_input())
+const size_t SCRIPT = 0;
+
+void step_scripted(match_t *match, uint32_t tick) {
+  player_input_t inputs[MATCH_PLAYERS] = {
+      scripted_input(SCRIPT, PLAYER1, tick),
+      scripted_input(SCRIPT, PLAYER2, tick)};
+  match_step(match, inputs, DT);
+}
+
+void test_bitstream() {
+  uint8_t buffer[64];
+  bitstream_t stream;
+  bitstream_init(&stream, buffer, sizeof(buffer));
+  int32_t varints[] = {0, 1, -1, 7, -8, 1000, -123456, INT32_MAX, INT32_MIN};
+  size_t varint_count = sizeof(varints) / sizeof(*varints);
+  bitstream_write(&stream, 1, 1);
+  bitstream_write(&stream, 0x2A, 6);
+  bitstream_write(&stream, 0xDEADBEEF, 32);
+  for (size_t i = 0; i < varint_count; i++) {
+    bitstream_write_varint(&stream, varints[i]);
+  }
+  assert(!bitstream_overflowed(&stream));
+  size_t size = bitstream_bytes(&stream);
+
+  bitstream_init(&stream, buffer, size);
+  assert(bitstream_read(&stream, 1) == 1);
+  assert(bitstream_read(&stream, 6) == 0x2A);
+  assert(bitstream_read(&stream, 32) == 0xDEADBEEF);
+  for (size_t i = 0; i < varint_count; i++) {
+    assert(bitstream_read_varint(&stream) == varints[i]);
+  }
+  assert(!bitstream_overflowed(&stream));
+  assert(bitstream_read(&stream, 8) == 0);
+  assert(bitstream_overflowed(&stream));
+
+  // Small values are cheap
+  bitstream_init(&stream, buffer, sizeof(buffer));
+  bitstream_write_varint(&stream, -3);
+  assert(stream.bit == 5);
+
+  // Writing past the end leaves the rest of memory alone
+  bitstream_init(&stream, buffer, 2);
+  buffer[2] = 0x55;
+  bitstream_write(&stream, UINT32_MAX, 24);
+  assert(bitstream_overflowed(&stream));
+  assert(buffer[2] == 0x55);
+}
+
+void test_snapshot_encoding() {
+  match_t *match = match_init(MAP2);
+  snapshot_t *snapshots = malloc(3 * sizeof(snapshot_t));
+  snapshot_t *decoded = malloc(sizeof(snapshot_t));
+  uint8_t full[NET_MAX_PACKET];
+  uint8_t delta[NET_MAX_PACKET];
+  uint32_t tick = 0;
+  for (; tick < 60; tick++) {
+    step_scripted(match, tick);
+  }
+  snapshot_capture(&snapshots[0], match, tick);
+  for (; tick < 70; tick++) {
+    step_scripted(match, tick);
+  }
+  snapshot_capture(&snapshots[1], match, tick);
+  assert(snapshots[1].entity_count >= MATCH_PLAYERS);
+  assert(snapshots[1].lives[PLAYER1] == match_get_lives(match, PLAYER1));
+
+  // A whole snapshot decodes without a baseline
+  size_t full_size =
+      snapshot_encode(&snapshots[1], NULL, full, sizeof(full));
+  assert(full_size > 0);
+  uint32_t packet_tick, baseline_tick;
+  assert(!snapshot_read_header(full, full_size, &packet_tick, &baseline_tick));
+  assert(packet_tick == tick);
+  assert(snapshot_decode(decoded, NULL, full, full_size));
+  assert(snapshot_equal(decoded, &snapshots[1]));
+
+  // A delta is smaller, and needs its baseline
+  size_t delta_size =
+      snapshot_encode(&snapshots[1], &snapshots[0], delta, sizeof(delta));
+  assert(delta_size > 0 && delta_size < full_size);
+  assert(snapshot_read_header(delta, delta_size, &packet_tick, &baseline_tick));
+  assert(packet_tick == snapshots[1].tick);
+  assert(baseline_tick == snapshots[0].tick);
+  assert(!snapshot_decode(decoded, NULL, delta, delta_size));
+  assert(snapshot_decode(decoded, &snapshots[0], delta, delta_size));
+  assert(snapshot_equal(decoded, &snapshots[1]));
+
+  // Nothing changed costs only a header
+  snapshots[2] = snapshots[1];
+  snapshots[2].tick++;
+  size_t idle_size =
+      snapshot_encode(&snapshots[2], &snapshots[1], delta, sizeof(delta));
+  assert(idle_size > 0 && idle_size < delta_size);
+  assert(snapshot_decode(decoded, &snapshots[1], delta, idle_size));
+  assert(snapshot_equal(decoded, &snapshots[2]));
+
+  // Entities that appear and disappear
+  snapshots[2] = snapshots[1];
+  snapshots[2].tick++;
+  snapshot_t *changed = &snapshots[2];
+  changed->entities[0].x += 5;
+  changed->entities[0].weapon = SHOTGUN;
+  changed->entity_count--;
+  memmove(&changed->entities[1], &changed->entities[2],
+          (changed->entity_count - 1) * sizeof(entity_state_t));
+  changed->entities[changed->entity_count++] =
+      (entity_state_t){.id = 0xFF00, .x = -12345, .side = RIGHT};
+  size_t changed_size =
+      snapshot_encode(&snapshots[2], &snapshots[1], delta, sizeof(delta));
+  assert(changed_size > 0);
+  assert(snapshot_decode(decoded, &snapshots[1], delta, changed_size));
+  assert(snapshot_equal(decoded, &snapshots[2]));
+
+  // Packets that are too small are refused, not overrun
+  assert(snapshot_encode(&snapshots[1], NULL, full, 4) == 0);
+  assert(!snapshot_decode(decoded, NULL, full, full_size / 2));
+
+  free(snapshots);
+  free(decoded);
+  match_free(match);
+}
+
+void test_loopback_match() {
+  const uint32_t TICKS = 600;
+  const size_t LATENCY = 3;
+  const double LOSS = 0.1;
+
+  net_server_t *server = net_server_init(0, MAP2);
+  assert(server != NULL);
+  net_address_t address =
+      net_address_loopback(net_socket_port(net_server_get_socket(server)));
+  net_client_t *clients[MATCH_PLAYERS];
+  for (size_t i = 0; i < MATCH_PLAYERS; i++) {
+    clients[i] = net_client_init(address);
+    assert(clients[i] != NULL);
+    net_socket_simulate(net_client_get_socket(clients[i]), LATENCY, LOSS,
+                        i + 1);
+  }
+  net_socket_simulate(net_server_get_socket(server), LATENCY, LOSS, 3);
+
+  // Join in order, so the first client is PLAYER1
+  for (size_t i = 0; i < MATCH_PLAYERS; i++) {
+    while (net_server_players(server) == i) {
+      net_socket_pump(net_client_get_socket(clients[i]));
+      net_client_send_input(clients[i], 0);
+      net_server_tick(server, DT);
+    }
+  }
+
+  clock_t server_time = 0;
+  size_t checked = 0;
+  for (uint32_t tick = 0; tick < TICKS; tick++) {
+    net_socket_pump(net_server_get_socket(server));
+    for (size_t i = 0; i < MATCH_PLAYERS; i++) {
+      net_socket_pump(net_client_get_socket(clients[i]));
+      net_client_send_input(clients[i], scripted_input(SCRIPT, i, tick));
+    }
+
+    clock_t start = clock();
+    net_server_tick(server, DT);
+    server_time += clock() - start;
+
+    // Whatever a client has decoded is exactly what the server sent
+    for (size_t i = 0; i < MATCH_PLAYERS; i++) {
+      net_client_poll(clients[i]);
+      const snapshot_t *latest = net_client_latest(clients[i]);
+      if (latest == NULL) {
+        continue;
+      }
+      const snapshot_t *sent = net_server_snapshot(server, latest->tick);
+      assert(sent != NULL);
+      assert(snapshot_equal(latest, sent));
+      checked++;
+    }
+  }
+  assert(checked > TICKS);
+
+  // Round trip latency plus a few lost packets, but never falling behind
+  for (size_t i = 0; i < MATCH_PLAYERS; i++) {
+    uint32_t lag = TICKS - net_client_latest(clients[i])->tick;
+    assert(lag < NET_HISTORY);
+  }
+
+  double seconds = TICKS * DT;
+  for (body_type_t player = PLAYER1; player <= PLAYER2; player++) {
+    double bandwidth = net_server_bytes_sent(server, player) / seconds;
+    printf("netcode: player %d receives %.0f bytes/s\n", player + 1,
+           bandwidth);
+    // Far less than whole snapshots would take
+    assert(bandwidth < NET_MAX_PACKET / DT);
+  }
+  printf("netcode: server tick takes %.1f us\n",
+         1e6 * server_time / CLOCKS_PER_SEC / TICKS);
+
+  for (size_t i = 0; i < MATCH_PLAYERS; i++) {
+    net_client_free(clients[i]);
+  }
+  net_server_free(server);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_bitstream)
+  DO_TEST(test_snapshot_encoding)
+  DO_TEST(test_loopback_match)
+
+  puts("netcode_test PASS");
+}
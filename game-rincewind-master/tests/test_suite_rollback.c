@@ -0,0 +1,240 @@
+#include "alloc_track.h"
+#include "player.h"
+#include "rollback.h"
+#include "snapshot.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+
+const double DT = 1.0 / 60;
+// Seed of the inputs the players follow (see scripted_input())
+const size_t SCRIPT = 1;
+
+// Inputs in flight between the peers at once, at most
+#define MAX_IN_FLIGHT 64
+
+/** An input sent by one peer, which the other gets once arrival passes */
+typedef struct in_flight {
+  body_type_t to;
+  size_t frame;
+  player_input_t input;
+  size_t arrival;
+} in_flight_t;
+
+typedef struct loopback {
+  in_flight_t inputs[MAX_IN_FLIGHT];
+  size_t count;
+  size_t delay;
+} loopback_t;
+
+void loopback_send(loopback_t *loopback, body_type_t to, size_t frame,
+                   player_input_t input, size_t now) {
+  assert(loopback->count < MAX_IN_FLIGHT);
+  loopback->inputs[loopback->count++] =
+      (in_flight_t){.to = to,
+                    .frame = frame,
+                    .input = input,
+                    .arrival = now + loopback->delay};
+}
+
+/** Hands every input that has arrived by now to its peer */
+void loopback_deliver(loopback_t *loopback, rollback_t *peers[MATCH_PLAYERS],
+                      size_t now) {
+  size_t kept = 0;
+  for (size_t i = 0; i < loopback->count; i++) {
+    in_flight_t *sent = &loopback->inputs[i];
+    if (sent->arrival <= now) {
+      rollback_add_remote_input(peers[sent->to], sent->frame, sent->input);
+    } else {
+      loopback->inputs[kept++] = *sent;
+    }
+  }
+  loopback->count = kept;
+}
+
+/** Asserts two matches are in exactly the same state */
+void assert_matches_equal(match_t *match1, match_t *match2, size_t frame) {
+  assert(match_get_round(match1) == match_get_round(match2));
+  for (body_type_t player = PLAYER1; player <= PLAYER2; player++) {
+    assert(match_get_lives(match1, player) == match_get_lives(match2, player));
+  }
+  snapshot_t snapshot1, snapshot2;
+  snapshot_capture(&snapshot1, match1, frame);
+  snapshot_capture(&snapshot2, match2, frame);
+  assert(snapshot_equal(&snapshot1, &snapshot2));
+
+  scene_t *scene1 = match_get_scene(match1);
+  scene_t *scene2 = match_get_scene(match2);
+  assert(scene_bodies(scene1) == scene_bodies(scene2));
+  for (size_t i = 0; i < scene_bodies(scene1); i++) {
+    body_t *body1 = scene_get_body(scene1, i);
+    body_t *body2 = scene_get_body(scene2, i);
+    assert(vec_equal(body_get_centroid(body1), body_get_centroid(body2)));
+    assert(vec_equal(body_get_velocity(body1), body_get_velocity(body2)));
+  }
+}
+
+void test_loopback_delays() {
+  const size_t FRAMES = 600;
+
+  for (size_t delay = 0; delay <= ROLLBACK_MAX_FRAMES; delay++) {
+    match_t *reference = match_init(MAP2);
+    for (size_t frame = 0; frame < FRAMES; frame++) {
+      player_input_t inputs[MATCH_PLAYERS] = {
+          scripted_input(SCRIPT, PLAYER1, frame),
+          scripted_input(SCRIPT, PLAYER2, frame)};
+      match_step(reference, inputs, DT);
+    }
+
+    match_t *matches[MATCH_PLAYERS];
+    rollback_t *peers[MATCH_PLAYERS];
+    for (body_type_t player = PLAYER1; player <= PLAYER2; player++) {
+      matches[player] = match_init(MAP2);
+      peers[player] = rollback_init(matches[player], player, DT);
+    }
+    loopback_t loopback = {.count = 0, .delay = delay};
+
+    size_t now = 0;
+    while (rollback_frame(peers[PLAYER1]) < FRAMES ||
+           rollback_frame(peers[PLAYER2]) < FRAMES) {
+      for (body_type_t player = PLAYER1; player <= PLAYER2; player++) {
+        size_t frame = rollback_frame(peers[player]);
+        if (frame == FRAMES) {
+          continue;
+        }
+        player_input_t input = scripted_input(SCRIPT, player, frame);
+        if (rollback_advance(peers[player], input)) {
+          loopback_send(&loopback, 1 - player, frame, input, now);
+        }
+      }
+      loopback_deliver(&loopback, peers, now);
+      now++;
+    }
+    // Let the last inputs arrive, then both peers agree with the reference
+    loopback_deliver(&loopback, peers, now + delay);
+    assert(loopback.count == 0);
+    for (body_type_t player = PLAYER1; player <= PLAYER2; player++) {
+      rollback_resimulate(peers[player]);
+      assert(rollback_confirmed_frame(peers[player]) == FRAMES);
+      assert_matches_equal(matches[player], reference, FRAMES);
+      // Each frame is stepped before the other input for it can arrive
+      assert(rollback_resimulated_frames(peers[player]) > 0);
+      rollback_free(peers[player]);
+      match_free(matches[player]);
+    }
+    // Only a delay that fills the whole window makes the peers wait
+    if (delay < ROLLBACK_MAX_FRAMES) {
+      assert(now == FRAMES);
+    }
+    match_free(reference);
+  }
+}
+
+void test_max_rollback() {
+  const size_t WARMUP = 120;
+  const player_input_t REMOTE = INPUT_LEFT | INPUT_JUMP;
+
+  match_t *match = match_init(MAP1);
+  rollback_t *peer = rollback_init(match, PLAYER1, DT);
+  // Settle the players and fill every saved frame once
+  for (size_t frame = 0; frame < WARMUP; frame++) {
+    rollback_add_remote_input(peer, frame,
+                              scripted_input(SCRIPT, PLAYER2, frame));
+    assert(rollback_advance(peer, INPUT_RIGHT));
+  }
+  // Predict the remote player keeps running right, until too far ahead
+  size_t predicted = 0;
+  while (rollback_advance(peer, INPUT_RIGHT)) {
+    predicted++;
+  }
+  assert(predicted == ROLLBACK_MAX_FRAMES);
+
+  // The real inputs turn back left, so every predicted frame is redone
+  for (size_t frame = WARMUP; frame < rollback_frame(peer); frame++) {
+    rollback_add_remote_input(peer, frame, REMOTE);
+  }
+  size_t resimulated = rollback_resimulated_frames(peer);
+  track_end_frame();
+  clock_t start = clock();
+  rollback_resimulate(peer);
+  double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  track_end_frame();
+  assert(rollback_resimulated_frames(peer) - resimulated ==
+         ROLLBACK_MAX_FRAMES);
+  for (size_t tag = 0; tag < TRACK_TAG_COUNT; tag++) {
+    assert(track_frame_allocs(tag) == 0);
+  }
+  printf("rollback: resimulating %d frames takes %.2f ms\n",
+         ROLLBACK_MAX_FRAMES, 1e3 * seconds);
+  assert(seconds < DT);
+
+  rollback_free(peer);
+  match_free(match);
+}
+
+void test_match_fork() {
+  const size_t FRAMES = 900;
+  const size_t LOOKAHEAD = 30;
+  const size_t FORK_EVERY = 10;
+  const player_input_t TRIES[] = {INPUT_JUMP, INPUT_SHOOT,
+                                  INPUT_LEFT | INPUT_JUMP};
+
+  match_t *match = match_init(MAP1);
+  match_t *fork = NULL;
+  size_t in_place = 0;
+  for (size_t frame = 0; frame < FRAMES && !match_is_over(match); frame++) {
+    player_input_t inputs[MATCH_PLAYERS] = {
+        scripted_input(SCRIPT, PLAYER1, frame),
+        scripted_input(SCRIPT, PLAYER2, frame)};
+    if (frame % FORK_EVERY == 0) {
+      for (size_t i = 0; i < sizeof(TRIES) / sizeof(TRIES[0]); i++) {
+        track_end_frame();
+        fork = match_fork(match, fork);
+        // A map built afresh puts its bodies in the fork scene's arena
+        in_place += track_frame_allocs(TRACK_BODY) == 0 &&
+                    track_frame_allocs(TRACK_ARENA) == 0;
+        assert_matches_equal(fork, match, frame);
+        // The map's static bodies are shared, everything else is copied
+        scene_t *scene = match_get_scene(match);
+        for (size_t j = 0; j < scene_bodies(scene); j++) {
+          body_t *body = scene_get_body(scene, j);
+          assert((scene_get_body(match_get_scene(fork), j) == body) ==
+                 (body_get_motion_type(body) == MOTION_STATIC));
+        }
+
+        // Looking ahead in the fork leaves the match as it was
+        size_t bodies = scene_bodies(match_get_scene(match));
+        player_input_t tried[MATCH_PLAYERS] = {TRIES[i], inputs[PLAYER2]};
+        for (size_t tick = 0; tick < LOOKAHEAD; tick++) {
+          match_step(fork, tried, DT);
+        }
+        assert(scene_bodies(match_get_scene(match)) == bodies);
+      }
+    }
+    match_step(match, inputs, DT);
+  }
+  // Most forks reuse the map they already built, without allocating bodies
+  size_t forks = FRAMES / FORK_EVERY * sizeof(TRIES) / sizeof(TRIES[0]);
+  assert(in_place > forks / 2);
+
+  // The fork only reads the shared bodies, so it can be freed after them
+  match_free(match);
+  match_free(fork);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_loopback_delays)
+  DO_TEST(test_max_rollback)
+  DO_TEST(test_match_fork)
+
+  puts("rollback_test PASS");
+}
@@ -1,3 +1,6 @@
+#include "forces.h"
+#include "player.h"
+#include "projectile.h"
 #include "scene.h"
 #include "test_util.h"
 #include <assert.h>
@@ -228,6 +231,388 @@ void test_reaping() {
   scene_free(scene);
 }
 
+void ignore_collision(body_t *body1, body_t *body2, vector_t axis,
+                      void *aux) {}
+
+void test_sleeping() {
+  scene_t *scene = scene_init();
+  body_t *lone = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_centroid(lone, (vector_t){-10, 0});
+  scene_add_body(scene, lone);
+  body_t *body1 = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  scene_add_body(scene, body1);
+  body_t *body2 = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_centroid(body2, (vector_t){1.5, 0});
+  scene_add_body(scene, body2);
+  create_collision(scene, body1, body2, ignore_collision, NULL, NULL);
+
+  // Bodies that stay still fall asleep
+  for (int i = 0; i < 100; i++) {
+    scene_tick(scene, 0.01);
+  }
+  assert(body_is_sleeping(lone));
+  assert(body_is_sleeping(body1));
+  assert(body_is_sleeping(body2));
+
+  // A force wakes a body up
+  body_add_force(lone, (vector_t){100, 0});
+  assert(!body_is_sleeping(lone));
+  scene_tick(scene, 0.01);
+  assert(body_get_centroid(lone).x > -10);
+
+  // Waking one body in an island wakes the whole island
+  body_add_impulse(body1, (vector_t){-1, 0});
+  scene_tick(scene, 0.01);
+  assert(!body_is_sleeping(body1));
+  assert(!body_is_sleeping(body2));
+  scene_free(scene);
+}
+
+void test_contact_stacking() {
+  const double GRAVITY = 100;
+  const double DT = 1.0 / 60;
+  scene_t *scene = scene_init();
+  scene_set_contact_iterations(scene, 4);
+  body_t *ground = body_init(make_shape(), INFINITY, (rgb_color_t){0, 0, 0});
+  body_set_motion_type(ground, MOTION_STATIC);
+  scene_add_body(scene, ground);
+  body_t *boxes[3];
+  for (size_t i = 0; i < 3; i++) {
+    boxes[i] = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+    body_set_centroid(boxes[i], (vector_t){0, 2 * (i + 1)});
+    scene_add_body(scene, boxes[i]);
+  }
+  create_contact(scene, 0, ground, boxes[0]);
+  create_contact(scene, 0, boxes[0], boxes[1]);
+  create_contact(scene, 0, boxes[1], boxes[2]);
+  force_aux_t *gravity_aux = malloc(sizeof(*gravity_aux));
+  gravity_aux->scene = scene;
+  gravity_aux->coefficient = GRAVITY;
+  scene_add_force_creator(scene, constant_gravity, gravity_aux, free);
+
+  // The stack holds still at a large dt instead of sinking or jittering
+  for (int i = 0; i < 300; i++) {
+    scene_tick(scene, DT);
+  }
+  for (size_t i = 0; i < 3; i++) {
+    assert(vec_within(0.1, body_get_centroid(boxes[i]),
+                      (vector_t){0, 2 * (i + 1)}));
+    assert(vec_length(body_get_velocity(boxes[i])) < 0.5);
+  }
+  // Each tick tests every contact's pair of shapes
+  scene_stats_t stats = scene_get_stats(scene);
+  assert(stats.bodies == 4);
+  assert(stats.force_binds == 1);
+  assert(stats.pair_tests >= 3);
+  // Ticks are only timed when asked
+  assert(stats.tick_time == 0);
+  scene_set_timed(scene, true);
+  scene_tick(scene, DT);
+  assert(scene_get_stats(scene).tick_time > 0);
+  scene_set_timed(scene, false);
+
+  // A box dropped onto a bouncy contact comes back up
+  body_t *ball = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_centroid(ball, (vector_t){10, 2});
+  body_set_velocity(ball, (vector_t){0, -20});
+  scene_add_body(scene, ball);
+  body_t *floor = body_init(make_shape(), INFINITY, (rgb_color_t){0, 0, 0});
+  body_set_centroid(floor, (vector_t){10, 0});
+  body_set_motion_type(floor, MOTION_STATIC);
+  scene_add_body(scene, floor);
+  create_contact(scene, 1, floor, ball);
+  scene_tick(scene, DT);
+  assert(body_get_velocity(ball).y > 15);
+  scene_free(scene);
+}
+
+void count_collision(body_t *body1, body_t *body2, vector_t axis,
+                     void *aux) {
+  (*(int *)aux)++;
+}
+
+void test_collision_events() {
+  scene_t *scene = scene_init();
+  body_t *mover = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  scene_add_body(scene, mover);
+  body_t *wall = body_init(make_shape(), INFINITY, (rgb_color_t){0, 0, 0});
+  body_set_centroid(wall, (vector_t){2.5, 0});
+  scene_add_body(scene, wall);
+  int calls = 0;
+  create_collision(scene, mover, wall, count_collision, &calls, NULL);
+  create_destructive_collision(scene, wall, wall, true, true);
+
+  body_set_velocity(mover, (vector_t){1, 0});
+  scene_tick(scene, 1);
+  assert(scene_collision_events(scene) == 0);
+  scene_tick(scene, 1);
+  assert(scene_collision_events(scene) == 1);
+  collision_event_t event = scene_get_collision_event(scene, 0);
+  assert(event.phase == COLLISION_BEGIN);
+  assert(event.body1 == mover && event.body2 == wall);
+  assert(isclose(event.depth, 0.5));
+  assert(calls == 1);
+
+  // The handler only runs when the bodies start touching
+  scene_tick(scene, 1);
+  assert(scene_get_collision_event(scene, 0).phase == COLLISION_PERSIST);
+  assert(calls == 1);
+  body_set_centroid(mover, (vector_t){-10, 0});
+  scene_tick(scene, 1);
+  assert(scene_get_collision_event(scene, 0).phase == COLLISION_END);
+  assert(calls == 1);
+  assert(scene_bodies(scene) == 2);
+  scene_free(scene);
+}
+
+body_t *make_typed_body(body_type_t type) {
+  body_info_t *info = malloc(sizeof(*info));
+  info->type = type;
+  return body_init_with_info(make_shape(), 1, (rgb_color_t){0, 0, 0}, info,
+                             free);
+}
+
+void test_type_index() {
+  scene_t *scene = game_scene_init();
+  assert(scene_first_of_type(scene, PLAYER1) == NULL);
+  body_t *wall1 = make_typed_body(WALL);
+  scene_add_body(scene, wall1);
+  body_t *player = make_typed_body(PLAYER1);
+  scene_add_body(scene, player);
+  body_t *wall2 = make_typed_body(WALL);
+  scene_add_body(scene, wall2);
+  scene_add_body(scene, body_init(make_shape(), 1, (rgb_color_t){0, 0, 0}));
+
+  assert(scene_first_of_type(scene, PLAYER1) == player);
+  assert(scene_bodies_of_type(scene, WALL) == 2);
+  assert(scene_get_body_of_type(scene, WALL, 0) == wall1);
+  assert(scene_get_body_of_type(scene, WALL, 1) == wall2);
+  assert(scene_bodies_of_type(scene, BULLET) == 0);
+
+  // Removed bodies leave the index once the scene frees them
+  body_remove(wall1);
+  body_remove(player);
+  scene_tick(scene, 0);
+  assert(scene_first_of_type(scene, PLAYER1) == NULL);
+  assert(scene_bodies_of_type(scene, WALL) == 1);
+  assert(scene_first_of_type(scene, WALL) == wall2);
+  scene_free(scene);
+
+  // A scene without types indexes none of its bodies, whatever their info
+  scene = scene_init();
+  body_t *ground = make_typed_body(GROUND);
+  scene_add_body(scene, ground);
+  scene_hit_t hit;
+  assert(!scene_raycast(scene, (vector_t){0, 10}, (vector_t){0, -1}, 20,
+                        BODY_MASK_ALL, &hit));
+  scene_free(scene);
+}
+
+void test_scene_casts() {
+  scene_t *scene = game_scene_init();
+  body_t *ground = make_typed_body(GROUND);
+  scene_add_body(scene, ground);
+  body_t *wall = make_typed_body(WALL);
+  body_set_centroid(wall, (vector_t){0, 4});
+  scene_add_body(scene, wall);
+
+  // Rays only hit the masked types
+  scene_hit_t hit;
+  assert(scene_raycast(scene, (vector_t){0, 10}, (vector_t){0, -2}, 20,
+                       BODY_MASK(GROUND), &hit));
+  assert(hit.body == ground);
+  assert(isclose(hit.distance, 9));
+  assert(vec_isclose(hit.point, (vector_t){0, 1}));
+  assert(vec_isclose(hit.normal, (vector_t){0, 1}));
+  assert(scene_raycast(scene, (vector_t){0, 10}, (vector_t){0, -1}, 20,
+                       BODY_MASK_ALL, &hit));
+  assert(hit.body == wall);
+  assert(!scene_raycast(scene, (vector_t){0, 10}, (vector_t){0, -1}, 3,
+                        BODY_MASK_ALL, &hit));
+
+  // A box above the ground reaches it only if it moves far enough
+  body_t *box = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_centroid(box, (vector_t){5, 2.5});
+  list_t *shape = body_get_world_shape(box);
+  assert(!scene_shapecast(scene, shape, (vector_t){0, -1}, 0.4,
+                          BODY_MASK(GROUND), &hit));
+  assert(!scene_shapecast(scene, shape, (vector_t){-1, 0}, 10,
+                          BODY_MASK(GROUND), &hit));
+  assert(scene_shapecast(scene, shape, (vector_t){-1, 0}, 10, BODY_MASK_ALL,
+                         &hit));
+  assert(hit.body == wall);
+  assert(isclose(hit.distance, 3));
+  assert(vec_isclose(hit.normal, (vector_t){1, 0}));
+  body_set_centroid(box, (vector_t){0.5, 2.5});
+  shape = body_get_world_shape(box);
+  assert(scene_shapecast(scene, shape, (vector_t){0, -1}, 1,
+                         BODY_MASK(GROUND), &hit));
+  assert(hit.body == ground);
+  assert(isclose(hit.distance, 0.5));
+  assert(vec_isclose(hit.normal, (vector_t){0, 1}));
+  body_set_centroid(box, (vector_t){0.5, 1.5});
+  assert(scene_shapecast(scene, body_get_world_shape(box), (vector_t){0, -1},
+                         1, BODY_MASK(GROUND), &hit));
+  assert(hit.distance == 0);
+  body_free(box);
+  scene_free(scene);
+}
+
+void test_static_bvh() {
+  const double DT = 1.0 / 60;
+  scene_t *scene = game_scene_init();
+  // A row of static floor tiles with gaps between them, and a wall
+  body_t *tiles[8];
+  for (size_t i = 0; i < 8; i++) {
+    tiles[i] = make_typed_body(GROUND);
+    body_set_centroid(tiles[i], (vector_t){4 * i, 0});
+    body_set_motion_type(tiles[i], MOTION_STATIC);
+    scene_add_body(scene, tiles[i]);
+  }
+  body_t *box = make_typed_body(PLAYER1);
+  body_set_centroid(box, (vector_t){12, 3});
+  scene_add_body(scene, box);
+  body_t *wall = make_typed_body(WALL);
+  body_set_centroid(wall, (vector_t){20, 10});
+  body_set_motion_type(wall, MOTION_STATIC);
+  scene_add_body(scene, wall);
+  // A distant planet pulls the box down at about 100; unlike a constant
+  // force, its gravity lets the box sleep once it lands
+  body_t *planet = make_typed_body(GRAVITY);
+  body_set_centroid(planet, (vector_t){12, -1e4});
+  body_set_motion_type(planet, MOTION_STATIC);
+  scene_add_body(scene, planet);
+  scene_build_static_bvh(scene);
+  create_static_contacts(scene, 0, box, BODY_MASK(GROUND));
+  create_newtonian_gravity(scene, 1e10, planet, box);
+
+  // Casts find the static bodies through the hierarchy
+  scene_hit_t hit;
+  assert(scene_raycast(scene, (vector_t){20, 20}, (vector_t){0, -1}, 30,
+                       BODY_MASK_ALL, &hit));
+  assert(hit.body == wall);
+  assert(scene_raycast(scene, (vector_t){20, 20}, (vector_t){0, -1}, 30,
+                       BODY_MASK(GROUND), &hit));
+  assert(hit.body == tiles[5]);
+  assert(!scene_raycast(scene, (vector_t){2, 20}, (vector_t){0, -1}, 30,
+                        BODY_MASK_ALL, &hit));
+
+  // The box lands on the tile below it, and only contacts nearby tiles
+  for (int i = 0; i < 120; i++) {
+    scene_tick(scene, DT);
+  }
+  assert(vec_within(0.1, body_get_centroid(box), (vector_t){12, 2}));
+  // Once asleep, the box keeps its contacts instead of searching again
+  assert(body_is_sleeping(box));
+  assert(scene_get_stats(scene).static_queries == 0);
+
+  // Freeing the tile drops the hierarchy; the box then falls through
+  body_remove(tiles[3]);
+  for (int i = 0; i < 60; i++) {
+    scene_tick(scene, DT);
+  }
+  assert(body_get_centroid(box).y < 0);
+  assert(scene_raycast(scene, (vector_t){16, 20}, (vector_t){0, -1}, 30,
+                       BODY_MASK(GROUND), &hit));
+  assert(hit.body == tiles[4]);
+
+  // Static bodies added later are still found
+  body_t *late = make_typed_body(GROUND);
+  body_set_centroid(late, (vector_t){2, 0});
+  body_set_motion_type(late, MOTION_STATIC);
+  scene_add_body(scene, late);
+  assert(scene_raycast(scene, (vector_t){2, 20}, (vector_t){0, -1}, 30,
+                       BODY_MASK_ALL, &hit));
+  assert(hit.body == late);
+  scene_free(scene);
+}
+
+void test_projectiles() {
+  const double DT = 0.1;
+  scene_t *scene = game_scene_init();
+  body_t *wall = make_typed_body(WALL);
+  body_set_centroid(wall, (vector_t){10, 0});
+  scene_add_body(scene, wall);
+  body_t *player = make_typed_body(PLAYER1);
+  body_set_centroid(player, (vector_t){-10, 0});
+  scene_add_body(scene, player);
+  projectiles_t *projectiles = scene_get_projectiles(scene);
+
+  // A pistol bullet stops at the wall
+  projectiles_add(projectiles, VEC_ZERO, (vector_t){100, 0}, PISTOL, PLAYER2);
+  scene_tick(scene, DT);
+  assert(projectiles_count(projectiles) == 0);
+  assert(!body_is_removed(wall));
+
+  // A ricochet bullet bounces back off the wall and hits the player
+  projectiles_add(projectiles, VEC_ZERO, (vector_t){100, 0}, RICOCHET,
+                  PLAYER2);
+  scene_tick(scene, DT);
+  assert(projectiles_count(projectiles) == 1);
+  assert(vec_isclose(projectiles_get_velocity(projectiles, 0),
+                     (vector_t){-100, 0}));
+  assert(projectiles_get_position(projectiles, 0).x < 9);
+  scene_tick(scene, DT);
+  scene_tick(scene, DT);
+  assert(projectiles_count(projectiles) == 0);
+  assert(scene_first_of_type(scene, PLAYER1) == NULL);
+  assert(scene_bodies(scene) == 1);
+  scene_free(scene);
+}
+
+void test_projectiles_meet() {
+  scene_t *scene = game_scene_init();
+  projectiles_t *projectiles = scene_get_projectiles(scene);
+  vector_t positions[] = {{0, 0},   {1, 0},     {50, 0},  {51, 0},
+                          {51.5, 0}, {100, 0},   {101, 0}, {101.5, 0},
+                          {200, 0},  {200, 10}};
+  game_weapon_type_t weapons[] = {PISTOL, PISTOL, SHOTGUN, PISTOL, PISTOL,
+                                  PISTOL, PISTOL, PISTOL,  PISTOL, PISTOL};
+  for (size_t i = 0; i < sizeof(weapons) / sizeof(weapons[0]); i++) {
+    projectiles_add(projectiles, positions[i], VEC_ZERO, weapons[i], PLAYER1);
+  }
+  scene_tick(scene, 0.1);
+
+  // Two bullets that meet destroy each other, while a shotgun pellet
+  // survives and destroys both bullets near it. Pairs are resolved in the
+  // order the bullets were fired, so once the first two of three bullets
+  // meet, the third is left. Bullets far apart in y are left alone.
+  vector_t survivors[] = {{50, 0}, {101.5, 0}, {200, 0}, {200, 10}};
+  size_t count = sizeof(survivors) / sizeof(survivors[0]);
+  assert(projectiles_count(projectiles) == count);
+  for (size_t i = 0; i < count; i++) {
+    assert(vec_isclose(projectiles_get_position(projectiles, i),
+                       survivors[i]));
+  }
+  scene_free(scene);
+}
+
+void test_projectiles_cross() {
+  const double DT = 1.0 / 60;
+  const double SPEED = 300;
+  scene_t *scene = game_scene_init();
+  projectiles_t *projectiles = scene_get_projectiles(scene);
+  // Head on, these pass each other within a tick, ending as far apart as
+  // they started
+  projectiles_add(projectiles, (vector_t){0, 0}, (vector_t){SPEED, 0},
+                  PISTOL, PLAYER1);
+  projectiles_add(projectiles, (vector_t){5, 0}, (vector_t){-SPEED, 0},
+                  PISTOL, PLAYER2);
+  // These pass a bullet's height apart, so their rects never touch
+  projectiles_add(projectiles, (vector_t){100, 0}, (vector_t){SPEED, 0},
+                  PISTOL, PLAYER1);
+  projectiles_add(projectiles, (vector_t){105, 1.5}, (vector_t){-SPEED, 0},
+                  PISTOL, PLAYER2);
+  scene_tick(scene, DT);
+
+  assert(projectiles_count(projectiles) == 2);
+  assert(vec_isclose(projectiles_get_position(projectiles, 0),
+                     (vector_t){105, 0}));
+  assert(vec_isclose(projectiles_get_position(projectiles, 1),
+                     (vector_t){100, 1.5}));
+  scene_free(scene);
+}
+
 int main(int argc, char *argv[]) {
   // Run all tests if there are no command-line arguments
   bool all_tests = argc == 1;
@@ -242,6 +627,15 @@ int main(int argc, char *argv[]) {
   DO_TEST(test_force_creator)
   DO_TEST(test_force_creator_aux)
   DO_TEST(test_reaping)
+  DO_TEST(test_sleeping)
+  DO_TEST(test_contact_stacking)
+  DO_TEST(test_collision_events)
+  DO_TEST(test_type_index)
+  DO_TEST(test_scene_casts)
+  DO_TEST(test_static_bvh)
+  DO_TEST(test_projectiles)
+  DO_TEST(test_projectiles_meet)
+  DO_TEST(test_projectiles_cross)
 
   puts("scene_test PASS");
 }
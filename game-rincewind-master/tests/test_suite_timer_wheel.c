@@ -0,0 +1,183 @@
+#include "test_util.h"
+#include "timer_wheel.h"
+#include <assert.h>
+#include <stdlib.h>
+
+// A power of two, so whole numbers of ticks add up exactly
+const double TICK = 0.125;
+
+/** Records when each timer fires, by the tick count in the aux */
+typedef struct firing_log {
+  size_t *fired_at;
+  size_t count;
+  size_t now;
+} firing_log_t;
+
+typedef struct logged_timer {
+  firing_log_t *log;
+  size_t index;
+} logged_timer_t;
+
+void log_firing(void *aux) {
+  logged_timer_t *timer = aux;
+  timer->log->fired_at[timer->index] = timer->log->now;
+  timer->log->count++;
+}
+
+void count_firing(void *aux) { (*(size_t *)aux)++; }
+
+void test_timer_wheel_fires_on_time() {
+  const size_t TIMERS = 5000;
+  // Spread the delays over every wheel, including past their reach
+  const size_t DELAYS[] = {1, 2, 63, 64, 65, 100, 4095, 4096, 4097, 70000,
+                          300000};
+  const size_t DELAY_COUNT = sizeof(DELAYS) / sizeof(DELAYS[0]);
+  const size_t FAR = 1 << 24;
+
+  timer_wheel_t *wheel = timer_wheel_init(TICK);
+  firing_log_t log = {.fired_at = calloc(TIMERS + 1, sizeof(size_t))};
+  logged_timer_t *timers = malloc((TIMERS + 1) * sizeof(logged_timer_t));
+  size_t *expected = malloc((TIMERS + 1) * sizeof(size_t));
+  for (size_t i = 0; i < TIMERS; i++) {
+    timers[i] = (logged_timer_t){.log = &log, .index = i};
+    expected[i] = DELAYS[i % DELAY_COUNT] + i % 7;
+    timer_wheel_schedule(wheel, expected[i] * TICK, log_firing, &timers[i]);
+  }
+  timers[TIMERS] = (logged_timer_t){.log = &log, .index = TIMERS};
+  expected[TIMERS] = FAR + 3000;
+  timer_wheel_schedule(wheel, expected[TIMERS] * TICK, log_firing,
+                       &timers[TIMERS]);
+  assert(timer_wheel_size(wheel) == TIMERS + 1);
+
+  while (log.count < TIMERS) {
+    log.now++;
+    timer_wheel_advance(wheel, TICK);
+  }
+  // The last timer waits in the last wheel, and fires on time all the same
+  timer_wheel_advance(wheel, (expected[TIMERS] - 1 - log.now) * TICK);
+  assert(log.count == TIMERS);
+  log.now = expected[TIMERS];
+  timer_wheel_advance(wheel, TICK);
+  assert(log.count == TIMERS + 1);
+  for (size_t i = 0; i <= TIMERS; i++) {
+    assert(log.fired_at[i] == expected[i]);
+  }
+  assert(timer_wheel_size(wheel) == 0);
+
+  free(expected);
+  free(timers);
+  free(log.fired_at);
+  timer_wheel_free(wheel);
+}
+
+void test_timer_wheel_cancel() {
+  timer_wheel_t *wheel = timer_wheel_init(TICK);
+  size_t fired = 0;
+  timer_id_t kept = timer_wheel_schedule(wheel, 1, count_firing, &fired);
+  timer_id_t cancelled = timer_wheel_schedule(wheel, 1, count_firing, &fired);
+  timer_id_t later = timer_wheel_schedule(wheel, 50, count_firing, &fired);
+  assert(timer_wheel_pending(wheel, kept));
+  assert(timer_wheel_pending(wheel, cancelled));
+  assert(!timer_wheel_pending(wheel, TIMER_NONE));
+
+  timer_wheel_cancel(wheel, cancelled);
+  assert(!timer_wheel_pending(wheel, cancelled));
+  timer_wheel_cancel(wheel, later);
+  assert(timer_wheel_size(wheel) == 1);
+  timer_wheel_advance(wheel, 100);
+  assert(fired == 1);
+  assert(!timer_wheel_pending(wheel, kept));
+
+  // Old IDs stay stale after their entries are used again
+  timer_id_t reused = timer_wheel_schedule(wheel, 1, count_firing, &fired);
+  assert(timer_wheel_pending(wheel, reused));
+  assert(!timer_wheel_pending(wheel, kept));
+  assert(!timer_wheel_pending(wheel, cancelled));
+  timer_wheel_cancel(wheel, kept);
+  timer_wheel_cancel(wheel, TIMER_NONE);
+  assert(timer_wheel_pending(wheel, reused));
+  timer_wheel_free(wheel);
+}
+
+void test_timer_wheel_rounding() {
+  timer_wheel_t *wheel = timer_wheel_init(TICK);
+  size_t fired = 0;
+  // A whole number of ticks fires on the last of them
+  timer_wheel_schedule(wheel, 3 * TICK, count_firing, &fired);
+  timer_wheel_advance(wheel, 2 * TICK);
+  assert(fired == 0);
+  timer_wheel_advance(wheel, TICK);
+  assert(fired == 1);
+
+  // Part of a tick has passed, so the delay is counted from then
+  timer_wheel_advance(wheel, TICK / 2);
+  timer_wheel_schedule(wheel, TICK, count_firing, &fired);
+  timer_wheel_advance(wheel, TICK / 2);
+  assert(fired == 1);
+  timer_wheel_advance(wheel, TICK / 2);
+  assert(fired == 1);
+  timer_wheel_advance(wheel, TICK / 2);
+  assert(fired == 2);
+
+  // A zero delay still waits for the next tick
+  timer_wheel_schedule(wheel, 0, count_firing, &fired);
+  assert(fired == 2);
+  timer_wheel_advance(wheel, TICK);
+  assert(fired == 3);
+
+  // Cooldowns need no callback
+  timer_id_t cooldown = timer_wheel_schedule(wheel, 1, NULL, NULL);
+  timer_wheel_advance(wheel, 0.5);
+  assert(timer_wheel_pending(wheel, cooldown));
+  timer_wheel_advance(wheel, 0.5);
+  assert(!timer_wheel_pending(wheel, cooldown));
+  timer_wheel_free(wheel);
+}
+
+typedef struct repeater {
+  timer_wheel_t *wheel;
+  size_t fired;
+  timer_id_t other;
+} repeater_t;
+
+/** Fires every tick, and cancels another timer the third time */
+void repeat(void *aux) {
+  repeater_t *repeater = aux;
+  repeater->fired++;
+  if (repeater->fired == 3) {
+    timer_wheel_cancel(repeater->wheel, repeater->other);
+  }
+  timer_wheel_schedule(repeater->wheel, TICK, repeat, repeater);
+}
+
+void test_timer_wheel_reschedule_while_firing() {
+  timer_wheel_t *wheel = timer_wheel_init(TICK);
+  size_t other_fired = 0;
+  repeater_t repeater = {.wheel = wheel};
+  timer_wheel_schedule(wheel, TICK, repeat, &repeater);
+  repeater.other = timer_wheel_schedule(wheel, 5, count_firing, &other_fired);
+
+  // Many ticks at once still fire each tick's timers in turn
+  timer_wheel_advance(wheel, 100 * TICK);
+  assert(repeater.fired == 100);
+  assert(other_fired == 0);
+  assert(timer_wheel_size(wheel) == 1);
+  timer_wheel_free(wheel);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_timer_wheel_fires_on_time)
+  DO_TEST(test_timer_wheel_cancel)
+  DO_TEST(test_timer_wheel_rounding)
+  DO_TEST(test_timer_wheel_reschedule_while_firing)
+
+  puts("timer_wheel_test PASS");
+}